@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdint.h>
+
+#include <functional>
+
+#include "timer.h"
+
+// Settings shared by every benchmark.  Each benchmark scales its own default
+// iteration counts and runs its multi-threaded cases with 1 thread up to
+// threads threads, doubling each time.  fdcfg is the freeDiameter
+// configuration that loads the dictionaries for the Diameter benchmarks.
+struct BenchOptions {
+  BenchOptions() : scale(1.0), threads(4), fdcfg("conf/bench.conf") {}
+
+  double scale;
+  int threads;
+  const char* fdcfg;
+
+  uint64_t iterations(uint64_t base) const {
+    uint64_t n = (uint64_t)(base * scale);
+    return n ? n : 1;
+  }
+};
+
+typedef void (*BenchFunc)(const BenchOptions& opt);
+
+// Runs fn(index) on threads threads that are all released together and
+// returns the elapsed time in nanoseconds until the last one is done.
+stimer_t benchThreads(int threads, std::function<void(int)> fn);
+
+// Initializes the freeDiameter core from opt.fdcfg the first time it is
+// called, without starting it.  Returns false if the dictionaries could not
+// be loaded.
+bool benchDiameter(const BenchOptions& opt);
+
+// Prints one result line: the time per operation and the throughput.
+void benchReport(const char* name, uint64_t ops, stimer_t ns);
+
+// The benchmarks, registered in main.cpp.
+void benchAir(const BenchOptions& opt);
+void benchQueue(const BenchOptions& opt);
+void benchPool(const BenchOptions& opt);
+void benchLocks(const BenchOptions& opt);
+void benchAvp(const BenchOptions& opt);
+void benchDecode(const BenchOptions& opt);
+
+#endif  // #define __BENCH_H
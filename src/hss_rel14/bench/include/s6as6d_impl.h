@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __S6AS6D_IMPL_H
+#define __S6AS6D_IMPL_H
+
+#include "s6as6d.h"
+
+namespace s6as6d {
+
+// Only the dictionary and the extractors of the s6a/s6d application are
+// benchmarked, no handler is registered and nothing is sent.
+class Application : public ApplicationBase {
+ public:
+  Application() {}
+  ~Application() {}
+};
+
+}  // namespace s6as6d
+
+#endif  // __S6AS6D_IMPL_H
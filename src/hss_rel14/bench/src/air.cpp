@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+#include "hss_config.h"
+#include "aucpp.h"
+#include "auc.h"
+}
+
+#include "bench.h"
+
+// hsssec reads its random mode from the HSS configuration
+hss_config_t hss_config;
+
+// TS 35.208 test set 1
+static uint8_t airOpc[16] = {0xcd, 0x63, 0xcb, 0x71, 0x95, 0x4a, 0x9f, 0x4e,
+                             0x48, 0xa5, 0x99, 0x4e, 0x37, 0xa0, 0x2b, 0xaf};
+static uint8_t airKey[16] = {0x46, 0x5b, 0x5c, 0xe8, 0xb1, 0x99, 0xb4, 0x9f,
+                             0xaa, 0x5f, 0x0a, 0x2e, 0xe2, 0x38, 0xa6, 0xbc};
+static uint8_t airPlmn[3] = {0x00, 0xf1, 0x10};
+static uint8_t airSqn[6]  = {0xff, 0x9b, 0xb4, 0xd0, 0xb6, 0x07};
+
+// an AIR asking for n vectors, each one computed on its own as the HSS did
+// before generate_vectors()
+static void airSingle(uint32_t n, auc_vector_t* vectors) {
+  for (uint32_t v = 0; v < n; v++) {
+    generate_random(vectors[v].rand, sizeof(vectors[v].rand));
+    generate_vector(airOpc, 0, airKey, airPlmn, airSqn, &vectors[v]);
+  }
+}
+
+void benchAir(const BenchOptions& opt) {
+  char name[64];
+
+  memset(&hss_config, 0, sizeof(hss_config));
+  hss_config.random_bool = 1;
+  random_init();
+
+  uint64_t n = opt.iterations(1000000);
+  for (int t = 1; t <= opt.threads; t *= 2) {
+    stimer_t ns = benchThreads(t, [n](int) {
+      uint8_t rand[16];
+      for (uint64_t i = 0; i < n; i++) generate_random(rand, sizeof(rand));
+    });
+    snprintf(
+        name, sizeof(name), "generate_random 16 bytes, %d thread%s", t,
+        t > 1 ? "s" : "");
+    benchReport(name, n * t, ns);
+  }
+
+  static const uint32_t counts[] = {1, 5};
+  n = opt.iterations(20000);
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    uint32_t cnt = counts[c];
+    auc_vector_t vectors[5];
+
+    stimer_t start = STIMER_GET_CURRENT_TIME;
+    for (uint64_t i = 0; i < n; i++) airSingle(cnt, vectors);
+    snprintf(name, sizeof(name), "AIR of %u, generate_vector each", cnt);
+    benchReport(name, n, STIMER_GET_CURRENT_TIME - start);
+
+    start = STIMER_GET_CURRENT_TIME;
+    for (uint64_t i = 0; i < n; i++)
+      generate_vectors(airOpc, airKey, airPlmn, airSqn, cnt, vectors);
+    snprintf(name, sizeof(name), "AIR of %u, generate_vectors", cnt);
+    benchReport(name, n, STIMER_GET_CURRENT_TIME - start);
+  }
+
+  for (int t = 2; t <= opt.threads; t *= 2) {
+    stimer_t ns = benchThreads(t, [n](int) {
+      auc_vector_t vectors[5];
+      for (uint64_t i = 0; i < n; i++)
+        generate_vectors(airOpc, airKey, airPlmn, airSqn, 5, vectors);
+    });
+    snprintf(name, sizeof(name), "AIR of 5, generate_vectors, %d threads", t);
+    benchReport(name, n * t, ns);
+  }
+}
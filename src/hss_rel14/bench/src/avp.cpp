@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fd.h"
+
+#include "bench.h"
+
+#define AVP_VECTORS (5)
+
+// the AVPs of an AIA, resolved once as the application Dictionary does
+struct AvpDictionary {
+  AvpDictionary()
+      : vnd3gpp("3GPP"),
+        cmdAir("Authentication-Information-Request"),
+        avpAuthenticationInfo("Authentication-Info", vnd3gpp.getId()),
+        avpEUtranVector("E-UTRAN-Vector", vnd3gpp.getId()),
+        avpRand("RAND", vnd3gpp.getId()),
+        avpXres("XRES", vnd3gpp.getId()),
+        avpAutn("AUTN", vnd3gpp.getId()),
+        avpKasme("KASME", vnd3gpp.getId()) {}
+
+  FDDictionaryEntryVendor vnd3gpp;
+  FDDictionaryEntryCommand cmdAir;
+  FDDictionaryEntryAVP avpAuthenticationInfo;
+  FDDictionaryEntryAVP avpEUtranVector;
+  FDDictionaryEntryAVP avpRand;
+  FDDictionaryEntryAVP avpXres;
+  FDDictionaryEntryAVP avpAutn;
+  FDDictionaryEntryAVP avpKasme;
+};
+
+struct AvpVector {
+  uint8_t rand[16];
+  uint8_t xres[8];
+  uint8_t autn[16];
+  uint8_t kasme[32];
+};
+
+// each member AVP wrapped in an FDAvp and appended on its own, as the AIA
+// was built before FDAvpMember
+static void addPerAvp(
+    AvpDictionary& d, FDMessage& msg, const AvpVector* vectors) {
+  for (int i = 0; i < AVP_VECTORS; i++) {
+    FDAvp authentication_info(d.avpAuthenticationInfo);
+    FDAvp eutran_vector(d.avpEUtranVector);
+
+    eutran_vector.add(d.avpRand, vectors[i].rand, sizeof(vectors[i].rand));
+    eutran_vector.add(d.avpXres, vectors[i].xres, sizeof(vectors[i].xres));
+    eutran_vector.add(d.avpAutn, vectors[i].autn, sizeof(vectors[i].autn));
+    eutran_vector.add(d.avpKasme, vectors[i].kasme, sizeof(vectors[i].kasme));
+
+    authentication_info.add(eutran_vector);
+    msg.add(authentication_info);
+  }
+}
+
+// the E-UTRAN-Vector built in one call, as AIRProcessor::phase2() does
+static void addGrouped(
+    AvpDictionary& d, FDMessage& msg, const AvpVector* vectors) {
+  for (int i = 0; i < AVP_VECTORS; i++) {
+    FDAvp authentication_info(d.avpAuthenticationInfo);
+    FDAvpMember eutran_vector[] = {
+        FDAvpMember(d.avpRand, vectors[i].rand, sizeof(vectors[i].rand)),
+        FDAvpMember(d.avpXres, vectors[i].xres, sizeof(vectors[i].xres)),
+        FDAvpMember(d.avpAutn, vectors[i].autn, sizeof(vectors[i].autn)),
+        FDAvpMember(d.avpKasme, vectors[i].kasme, sizeof(vectors[i].kasme))};
+
+    authentication_info.add(
+        d.avpEUtranVector, eutran_vector,
+        sizeof(eutran_vector) / sizeof(eutran_vector[0]));
+    msg.add(authentication_info);
+  }
+}
+
+void benchAvp(const BenchOptions& opt) {
+  if (!benchDiameter(opt)) {
+    printf("  skipped, see --fdcfg\n");
+    return;
+  }
+
+  AvpDictionary d;
+  AvpVector vectors[AVP_VECTORS];
+  uint64_t n = opt.iterations(200000);
+
+  memset(vectors, 0x5a, sizeof(vectors));
+
+  // every case creates and frees the message, this is the cost of that
+  // alone
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) FDMessageRequest msg(&d.cmdAir);
+  benchReport("message new/free", n, STIMER_GET_CURRENT_TIME - start);
+
+  start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) {
+    FDMessageRequest msg(&d.cmdAir);
+    addPerAvp(d, msg, vectors);
+  }
+  benchReport(
+      "5 E-UTRAN-Vectors, per-AVP add", n, STIMER_GET_CURRENT_TIME - start);
+
+  start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) {
+    FDMessageRequest msg(&d.cmdAir);
+    addGrouped(d, msg, vectors);
+  }
+  benchReport(
+      "5 E-UTRAN-Vectors, grouped add", n, STIMER_GET_CURRENT_TIME - start);
+}
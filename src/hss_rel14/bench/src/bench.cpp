@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "fd.h"
+#include "ssync.h"
+#include "sthread.h"
+
+#include "bench.h"
+
+class BenchThread : public SThread {
+ public:
+  BenchThread(int index, SEvent& start, std::function<void(int)>& fn)
+      : m_index(index), m_start(start), m_fn(fn) {}
+
+  unsigned long threadProc(void* arg) {
+    m_start.wait();
+    m_fn(m_index);
+    return 0;
+  }
+
+ private:
+  int m_index;
+  SEvent& m_start;
+  std::function<void(int)>& m_fn;
+};
+
+stimer_t benchThreads(int threads, std::function<void(int)> fn) {
+  std::vector<BenchThread*> workers;
+  SEvent start;
+
+  for (int i = 0; i < threads; i++) {
+    workers.push_back(new BenchThread(i, start, fn));
+    workers.back()->init(NULL);
+  }
+
+  stimer_t begin = STIMER_GET_CURRENT_TIME;
+  start.set();
+
+  for (size_t i = 0; i < workers.size(); i++) workers[i]->join();
+
+  stimer_t elapsed = STIMER_GET_CURRENT_TIME - begin;
+
+  for (size_t i = 0; i < workers.size(); i++) delete workers[i];
+
+  return elapsed;
+}
+
+bool benchDiameter(const BenchOptions& opt) {
+  static FDEngine engine;
+  static int state = 0;  // 0 not initialized, 1 ready, -1 failed
+
+  if (state == 0) {
+    engine.setConfigFile(opt.fdcfg);
+    state = engine.init() ? 1 : -1;
+    if (state < 0)
+      printf("  freeDiameter could not be initialized from %s\n", opt.fdcfg);
+  }
+
+  return state > 0;
+}
+
+void benchReport(const char* name, uint64_t ops, stimer_t ns) {
+  printf(
+      "  %-44s %10.1f ns/op %10.3f Mops/s\n", name, (double) ns / ops,
+      ns ? ops * 1000.0 / ns : 0.0);
+  fflush(stdout);
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <string>
+
+#include "s6as6d_impl.h"
+
+#include "bench.h"
+
+using namespace s6as6d;
+
+static const std::string decodeImsi = "001010000000001";
+static const uint8_t decodePlmn[3]  = {0x00, 0xf1, 0x10};
+
+// the AVPs every MME request carries
+static void addHeader(FDMessageRequest& req, Dictionary& dict) {
+  req.add(dict.avpSessionId(), "bench.openair4G.eur;1;1;bench");
+  req.add(dict.avpAuthSessionState(), 1);  // NO_STATE_MAINTAINED
+  req.add(dict.avpOriginHost(), "bench.openair4G.eur");
+  req.add(dict.avpOriginRealm(), "openair4G.eur");
+  req.add(dict.avpDestinationRealm(), "openair4G.eur");
+  req.add(dict.avpUserName(), decodeImsi);
+  req.add(dict.avpVisitedPlmnId(), decodePlmn, sizeof(decodePlmn));
+}
+
+static void buildAir(FDMessageRequest& req, Dictionary& dict) {
+  addHeader(req, dict);
+
+  FDAvp reai(dict.avpRequestedEutranAuthenticationInfo());
+  reai.add(dict.avpNumberOfRequestedVectors(), (uint32_t) 5);
+  reai.add(dict.avpImmediateResponsePreferred(), (uint32_t) 0);
+  req.add(reai);
+}
+
+static void buildUlr(FDMessageRequest& req, Dictionary& dict) {
+  addHeader(req, dict);
+
+  req.add(dict.avpRatType(), (uint32_t) 1004);  // EUTRAN
+  req.add(dict.avpUlrFlags(), (uint32_t) 0x22);  // S6a/S6d, initial attach
+  req.add(dict.avpUeSrvccCapability(), (uint32_t) 1);
+
+  FDAvp ti(dict.avpTerminalInformation());
+  ti.add(dict.avpImei(), "35609204079301");
+  ti.add(dict.avpSoftwareVersion(), "01");
+  req.add(ti);
+
+  FDAvp sf(dict.avpSupportedFeatures());
+  sf.add(dict.avpVendorId(), (uint32_t) 10415);
+  sf.add(dict.avpFeatureListId(), (uint32_t) 1);
+  sf.add(dict.avpFeatureList(), (uint32_t) 0x0fffffff);
+  req.add(sf);
+}
+
+// the fields AIRProcessor::phase1() reads
+static void decodeAir(FDMessageRequest& req, Dictionary& dict) {
+  AuthenticationInformationRequestExtractor air(req, dict);
+  std::string imsi;
+  uint8_t plmn[3];
+  size_t plmnlen = sizeof(plmn);
+  uint32_t u32;
+
+  air.auth_session_state.get(u32);
+  air.user_name.get(imsi);
+  air.requested_eutran_authentication_info.number_of_requested_vectors.get(
+      u32);
+  air.visited_plmn_id.get(plmn, plmnlen);
+}
+
+// the fields ULRProcessor::phase1() reads
+static void decodeUlr(FDMessageRequest& req, Dictionary& dict) {
+  UpdateLocationRequestExtractor ulr(req, dict);
+  std::string imsi, host, realm, imei, sv;
+  uint8_t plmn[3];
+  size_t plmnlen = sizeof(plmn);
+  uint32_t u32;
+
+  ulr.auth_session_state.get(u32);
+  ulr.user_name.get(imsi);
+  ulr.origin_host.get(host);
+  ulr.origin_realm.get(realm);
+  ulr.rat_type.get(u32);
+  ulr.ulr_flags.get(u32);
+  ulr.visited_plmn_id.get(plmn, plmnlen);
+  ulr.terminal_information.imei.get(imei);
+  ulr.terminal_information.software_version.get(sv);
+  ulr.ue_srvcc_capability.get(u32);
+
+  for (std::list<SupportedFeaturesExtractor*>::iterator it =
+           ulr.supported_features.getList().begin();
+       it != ulr.supported_features.getList().end(); ++it) {
+    (*it)->vendor_id.get(u32);
+    (*it)->feature_list_id.get(u32);
+    (*it)->feature_list.get(u32);
+  }
+}
+
+void benchDecode(const BenchOptions& opt) {
+  if (!benchDiameter(opt)) {
+    printf("  skipped, see --fdcfg\n");
+    return;
+  }
+
+  Application app;
+  Dictionary& dict = app.getDict();
+  uint64_t n       = opt.iterations(200000);
+
+  // the requests are built once, each iteration decodes them as a new
+  // request would be
+  FDMessageRequest air(&dict.cmdAUIR());
+  FDMessageRequest ulr(&dict.cmdUPLR());
+  buildAir(air, dict);
+  buildUlr(ulr, dict);
+
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++)
+    AuthenticationInformationRequestExtractor e(air, dict);
+  benchReport(
+      "AIR extractor, construct only", n, STIMER_GET_CURRENT_TIME - start);
+
+  start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) decodeAir(air, dict);
+  benchReport(
+      "AIR extractor, phase1 fields", n, STIMER_GET_CURRENT_TIME - start);
+
+  start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) UpdateLocationRequestExtractor e(ulr, dict);
+  benchReport(
+      "ULR extractor, construct only", n, STIMER_GET_CURRENT_TIME - start);
+
+  start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) decodeUlr(ulr, dict);
+  benchReport(
+      "ULR extractor, phase1 fields", n, STIMER_GET_CURRENT_TIME - start);
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "ssync.h"
+
+#include "bench.h"
+
+// the work done while the lock is held, kept short so that the lock itself
+// is measured
+#define LOCKS_WORK (1)
+
+struct LockedCounter {
+  LockedCounter(SMutex& m) : mutex(m), value(0) {}
+
+  SMutex& mutex;
+  volatile uint64_t value;
+};
+
+static void lockLoop(LockedCounter& c, uint64_t n) {
+  for (uint64_t i = 0; i < n; i++) {
+    SMutexLock l(c.mutex);
+    for (int w = 0; w < LOCKS_WORK; w++) c.value = c.value + 1;
+  }
+}
+
+static void tryLockLoop(LockedCounter& c, uint64_t n) {
+  for (uint64_t i = 0; i < n; i++) {
+    SMutexLock l(c.mutex, false);
+    if (l.acquire(false)) c.value = c.value + 1;
+  }
+}
+
+static void lockCase(
+    const char* label, SMutex& mutex, const BenchOptions& opt, uint64_t n) {
+  LockedCounter c(mutex);
+  char name[64];
+
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+  lockLoop(c, n);
+  snprintf(name, sizeof(name), "%s lock/unlock", label);
+  benchReport(name, n, STIMER_GET_CURRENT_TIME - start);
+
+  start = STIMER_GET_CURRENT_TIME;
+  tryLockLoop(c, n);
+  snprintf(name, sizeof(name), "%s try-lock/unlock", label);
+  benchReport(name, n, STIMER_GET_CURRENT_TIME - start);
+
+  for (int t = 2; t <= opt.threads; t *= 2) {
+    stimer_t ns = benchThreads(t, [&c, n](int) { lockLoop(c, n); });
+    snprintf(name, sizeof(name), "%s lock/unlock, %d threads", label, t);
+    benchReport(name, n * t, ns);
+  }
+}
+
+void benchLocks(const BenchOptions& opt) {
+  uint64_t n = opt.iterations(2000000);
+
+  SMutex shared;
+  lockCase("SMutex", shared, opt, n);
+
+  SFastMutex plain;
+  lockCase("SFastMutex", plain, opt, n);
+
+  SFastMutex adaptive(true);
+  lockCase("SFastMutex adaptive", adaptive, opt, n);
+}
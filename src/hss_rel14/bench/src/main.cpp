@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+struct Benchmark {
+  const char* name;
+  const char* description;
+  BenchFunc run;
+};
+
+static const Benchmark benchmarks[] = {
+    {"air", "AIR authentication vector generation", benchAir},
+    {"queue", "SQueue push/pop", benchQueue},
+    {"pool", "SPool and SArena allocation", benchPool},
+    {"locks", "SMutex and SFastMutex contention", benchLocks},
+    {"avp", "grouped AVP append to a Diameter answer", benchAvp},
+    {"decode", "AIR and ULR request extractors", benchDecode},
+};
+
+#define BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static void help(const char* prog) {
+  printf(
+      "Usage: %s [OPTIONS] [benchmark...]\n"
+      "  -h, --help             Print help and exit\n"
+      "  -s, --scale  factor    Multiply the iteration counts by factor\n"
+      "  -t, --threads  max     Run the threaded cases with up to max "
+      "threads\n"
+      "  -c, --fdcfg  filename  The freeDiameter configuration used by the "
+      "Diameter\n"
+      "                         benchmarks (default conf/bench.conf)\n"
+      "\n"
+      "Benchmarks, all of them are run when none is named:\n",
+      prog);
+  for (size_t i = 0; i < BENCHMARKS; i++)
+    printf("  %-22s %s\n", benchmarks[i].name, benchmarks[i].description);
+}
+
+int main(int argc, char** argv) {
+  static struct option long_options[] = {
+      {"help", no_argument, NULL, 'h'},
+      {"scale", required_argument, NULL, 's'},
+      {"threads", required_argument, NULL, 't'},
+      {"fdcfg", required_argument, NULL, 'c'},
+      {NULL, 0, NULL, 0}};
+  BenchOptions opt;
+  int c;
+
+  while ((c = getopt_long(argc, argv, "hs:t:c:", long_options, NULL)) != -1) {
+    switch (c) {
+      case 'h': {
+        help(argv[0]);
+        return 0;
+      }
+      case 's': {
+        opt.scale = atof(optarg);
+        break;
+      }
+      case 't': {
+        opt.threads = atoi(optarg);
+        break;
+      }
+      case 'c': {
+        opt.fdcfg = optarg;
+        break;
+      }
+      default: {
+        help(argv[0]);
+        return 1;
+      }
+    }
+  }
+
+  if (opt.scale <= 0 || opt.threads < 1) {
+    help(argv[0]);
+    return 1;
+  }
+
+  for (int i = optind; i < argc; i++) {
+    size_t b;
+    for (b = 0; b < BENCHMARKS && strcmp(argv[i], benchmarks[b].name); b++)
+      ;
+    if (b == BENCHMARKS) {
+      printf("Unknown benchmark %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  for (size_t b = 0; b < BENCHMARKS; b++) {
+    bool selected = optind == argc;
+    for (int i = optind; i < argc && !selected; i++)
+      selected = strcmp(argv[i], benchmarks[b].name) == 0;
+    if (!selected) continue;
+
+    printf("%s: %s\n", benchmarks[b].name, benchmarks[b].description);
+    benchmarks[b].run(opt);
+  }
+
+  return 0;
+}
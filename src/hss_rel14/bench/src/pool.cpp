@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "spool.h"
+#include "ssync.h"
+
+#include "bench.h"
+
+#define POOL_OBJECT_SIZE (256)
+#define POOL_HANDOFF (1024)
+#define POOL_ACTIONS (6)
+#define POOL_ACTION_SIZE (48)
+#define POOL_ARENA (256)
+
+// about the size of a request processor, one from the heap and one pooled
+struct HeapObject {
+  char data[POOL_OBJECT_SIZE];
+};
+
+struct PooledObject {
+  SPOOL_ALLOCATOR(PooledObject)
+  char data[POOL_OBJECT_SIZE];
+};
+
+struct Action {
+  char data[POOL_ACTION_SIZE];
+};
+
+template <class T>
+static stimer_t allocFree(uint64_t n) {
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) {
+    T* volatile p = new T;
+    delete p;
+  }
+  return STIMER_GET_CURRENT_TIME - start;
+}
+
+// objects created on one thread and deleted on another, as a processor is
+// created on a freeDiameter thread and released by a worker
+template <class T>
+static stimer_t handoff(uint64_t rounds) {
+  std::vector<T*> objects(POOL_HANDOFF);
+  SSemaphore allocated(0, 1);
+  SSemaphore released(1, 1);
+
+  return benchThreads(2, [&](int index) {
+    for (uint64_t r = 0; r < rounds; r++) {
+      if (index == 0) {
+        released.decrement();
+        for (int i = 0; i < POOL_HANDOFF; i++) objects[i] = new T;
+        allocated.increment();
+      } else {
+        allocated.decrement();
+        for (int i = 0; i < POOL_HANDOFF; i++) delete objects[i];
+        released.increment();
+      }
+    }
+  });
+}
+
+// the database actions of one request, deleted one by one or released
+// with the request's arena
+static stimer_t actionsHeap(uint64_t n) {
+  Action* volatile actions[POOL_ACTIONS];
+
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) {
+    for (int a = 0; a < POOL_ACTIONS; a++) actions[a] = new Action;
+    for (int a = 0; a < POOL_ACTIONS; a++) delete actions[a];
+  }
+  return STIMER_GET_CURRENT_TIME - start;
+}
+
+static stimer_t actionsArena(uint64_t n) {
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < n; i++) {
+    SArena<POOL_ARENA> arena;
+    for (int a = 0; a < POOL_ACTIONS; a++) new (arena) Action;
+  }
+  return STIMER_GET_CURRENT_TIME - start;
+}
+
+void benchPool(const BenchOptions& opt) {
+  uint64_t n = opt.iterations(2000000);
+  char name[64];
+
+  benchReport("new/delete 256 bytes, heap", n, allocFree<HeapObject>(n));
+  benchReport("new/delete 256 bytes, SPool", n, allocFree<PooledObject>(n));
+
+  uint64_t rounds = opt.iterations(1000);
+  benchReport(
+      "new, delete on another thread, heap", rounds * POOL_HANDOFF,
+      handoff<HeapObject>(rounds));
+  benchReport(
+      "new, delete on another thread, SPool", rounds * POOL_HANDOFF,
+      handoff<PooledObject>(rounds));
+
+  for (int t = 2; t <= opt.threads; t *= 2) {
+    stimer_t ns = benchThreads(t, [n](int) { allocFree<HeapObject>(n); });
+    snprintf(name, sizeof(name), "new/delete 256 bytes, heap, %d threads", t);
+    benchReport(name, n * t, ns);
+
+    ns = benchThreads(t, [n](int) { allocFree<PooledObject>(n); });
+    snprintf(name, sizeof(name), "new/delete 256 bytes, SPool, %d threads", t);
+    benchReport(name, n * t, ns);
+  }
+
+  printf(
+      "    SPool heap allocations %llu\n",
+      (unsigned long long) SPool<sizeof(PooledObject)>::heapAllocations());
+
+  n = opt.iterations(500000);
+  benchReport("6 actions per request, heap", n, actionsHeap(n));
+  benchReport("6 actions per request, SArena<256>", n, actionsArena(n));
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "shistogram.h"
+#include "squeue.h"
+
+#include "bench.h"
+
+#define QUEUE_BATCH 64
+
+// the contended cases always go up to this many producers, each paired with
+// a consumer, since the worker queues see that many threads in production
+#define QUEUE_MAX_THREADS 64
+
+// one push in QUEUE_SAMPLE is timed, timing every push would add the cost
+// of reading the clock twice to the throughput being measured
+#define QUEUE_SAMPLE 16
+
+// t producers and t consumers moving n messages through one queue, the
+// messages are not allocated per push so only the queue is measured
+static void queueContended(
+    const char* label, uint32_t capacity, int t, uint64_t n) {
+  SQueue q(capacity);
+  SQueueMessage msg(1);
+  uint64_t per = n / t;
+  SHistogram* latency = new SHistogram[t];
+  SHistogram enqueue;
+  char name[64];
+
+  stimer_t ns = benchThreads(2 * t, [&q, &msg, t, per, latency](int index) {
+    if (index < t) {
+      for (uint64_t i = 0; i < per; i++) {
+        if (i % QUEUE_SAMPLE) {
+          q.push(&msg);
+        } else {
+          stimer_t start = STIMER_GET_CURRENT_TIME;
+          q.push(&msg);
+          latency[index].recordLocal(STIMER_GET_CURRENT_TIME - start);
+        }
+      }
+    } else {
+      for (uint64_t i = 0; i < per; i++) q.pop();
+    }
+  });
+
+  for (int i = 0; i < t; i++) enqueue.merge(latency[i]);
+  delete[] latency;
+
+  snprintf(name, sizeof(name), "%s, %dx%d threads", label, t, t);
+  benchReport(name, per * t, ns);
+  printf(
+      "    push p50 %llu p99 %llu p99.9 %llu max %llu ns, "
+      "ring depth max %u/%u\n",
+      (unsigned long long) enqueue.percentile(50.0),
+      (unsigned long long) enqueue.percentile(99.0),
+      (unsigned long long) enqueue.percentile(99.9),
+      (unsigned long long) enqueue.max(), q.maxDepth(), q.capacity());
+  if (q.spills())
+    printf("    %llu messages spilled\n", (unsigned long long) q.spills());
+}
+
+void benchQueue(const BenchOptions& opt) {
+  uint64_t n      = opt.iterations(2000000);
+  uint64_t rounds = n / QUEUE_BATCH + 1;
+  int threads = opt.threads > QUEUE_MAX_THREADS ? opt.threads :
+                                                  QUEUE_MAX_THREADS;
+  SQueue q;
+  SQueueMessage msg(1);
+
+  // push a batch then pop it, no contention and no waiting
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+  for (uint64_t i = 0; i < rounds; i++) {
+    for (int b = 0; b < QUEUE_BATCH; b++) q.push(&msg);
+    for (int b = 0; b < QUEUE_BATCH; b++) q.pop();
+  }
+  benchReport(
+      "push+pop, 1 thread", rounds * QUEUE_BATCH,
+      STIMER_GET_CURRENT_TIME - start);
+
+  for (int t = 1; t <= threads; t *= 2)
+    queueContended("ring 4096", SQUEUE_DEFAULT_CAPACITY, t, n);
+
+  // a ring small enough for the producers to overrun, the backlog goes to
+  // the overflow list
+  for (int t = 1; t <= threads; t *= 2)
+    queueContended("ring 64", 64, t, n);
+}
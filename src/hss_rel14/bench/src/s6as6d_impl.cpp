@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "s6as6d_impl.h"
+
+namespace s6as6d {
+
+// The generated command and request classes need their handlers defined,
+// hssbench never registers or sends them
+
+void UPLRreq::processAnswer(FDMessageAnswer& ans) {}
+void CALRreq::processAnswer(FDMessageAnswer& ans) {}
+void AUIRreq::processAnswer(FDMessageAnswer& ans) {}
+void INSDRreq::processAnswer(FDMessageAnswer& ans) {}
+void DESDRreq::processAnswer(FDMessageAnswer& ans) {}
+void PUURreq::processAnswer(FDMessageAnswer& ans) {}
+void RERreq::processAnswer(FDMessageAnswer& ans) {}
+
+int UPLRcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int CALRcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int AUIRcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int INSDRcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int DESDRcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int PUURcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int RERcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+}  // namespace s6as6d
@@ -37,9 +37,52 @@
 extern uint8_t opc[16];
 typedef uint8_t uint8_t;
 
+/* Rijndael round keys, one context per expanded key */
+typedef struct rijndael_ctx_s {
+  uint8_t round_keys[11][16] __attribute__((aligned(16)));
+  int aesni; /* non-zero when the AES-NI implementation is used */
+} rijndael_ctx_t;
+
+void RijndaelKeyScheduleCtx(rijndael_ctx_t* ctx, uint8_t const key[16]);
+void RijndaelEncryptCtx(
+    const rijndael_ctx_t* ctx, uint8_t const in[16], uint8_t out[16]);
+void RijndaelEncryptCtxN(
+    const rijndael_ctx_t* ctx, int n, uint8_t const in[][16],
+    uint8_t out[][16]);
+
+/* Legacy API, the round keys are kept per thread */
 void RijndaelKeySchedule(uint8_t const key[16]);
 void RijndaelEncrypt(uint8_t const in[16], uint8_t out[16]);
 
+/* Milenage context, K expanded once and used by all the f-functions */
+typedef struct milenage_ctx_s {
+  rijndael_ctx_t rijndael;
+  uint8_t opc[16];
+} milenage_ctx_t;
+
+void milenage_init(
+    milenage_ctx_t* ctx, uint8_t const opc[16], uint8_t const k[16]);
+void milenage_clear(milenage_ctx_t* ctx);
+
+void milenage_f1(
+    const milenage_ctx_t* ctx, uint8_t const rand[16], uint8_t const sqn[6],
+    uint8_t const amf[2], uint8_t mac_a[8]);
+void milenage_f1star(
+    const milenage_ctx_t* ctx, uint8_t const rand[16], uint8_t const sqn[6],
+    uint8_t const amf[2], uint8_t mac_s[8]);
+void milenage_f2345(
+    const milenage_ctx_t* ctx, uint8_t const rand[16], uint8_t res[8],
+    uint8_t ck[16], uint8_t ik[16], uint8_t ak[6]);
+void milenage_f5star(
+    const milenage_ctx_t* ctx, uint8_t const rand[16], uint8_t ak[6]);
+void milenage_f1_f2345_n(
+    const milenage_ctx_t* ctx, int n, uint8_t const rand[][16],
+    uint8_t const sqn[6], uint8_t const amf[2], uint8_t mac_a[][8],
+    uint8_t res[][8], uint8_t ck[][16], uint8_t ik[][16], uint8_t ak[][6]);
+
+/* TS 35.208 known answer test, returns the number of mismatches */
+int milenage_self_test(void);
+
 /* Sequence number functions */
 struct sqn_ue_s;
 struct sqn_ue_s* sqn_exists(uint64_t imsi);
@@ -52,6 +95,7 @@ void sqn_get(uint64_t imsi, uint8_t sqn[6]);
 /* Random number functions */
 struct random_state_s;
 void generate_random(uint8_t* random, ssize_t length);
+void generate_random_n(uint8_t* random, ssize_t length, int count);
 
 // void SetOP(char *opP);
 
@@ -76,6 +120,9 @@ void generate_autn(
 int generate_vector(
     uint8_t const opc[16], uint64_t imsi, uint8_t key[16], uint8_t plmn[3],
     uint8_t sqn[6], auc_vector_t* vector);
+int generate_vectors(
+    uint8_t const opc[16], uint8_t key[16], uint8_t plmn[3], uint8_t sqn[6],
+    uint32_t n, auc_vector_t* vectors);
 
 void kdf(
     uint8_t* key, uint16_t key_len, uint8_t* s, uint16_t s_len, uint8_t* out,
@@ -39,6 +39,10 @@ int generate_vector_cpp(
     const uint8_t opc[16], uint64_t imsi, uint8_t key[16], uint8_t plmn[3],
     uint8_t sqn[6], auc_vector_t* vector);
 
+int generate_vectors_cpp(
+    const uint8_t opc[16], uint8_t key[16], uint8_t plmn[3], uint8_t sqn[6],
+    uint32_t n, auc_vector_t* vectors);
+
 void random_init(void);
 
 #endif /* AUCPP_H_ */
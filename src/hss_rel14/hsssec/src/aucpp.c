@@ -32,3 +32,9 @@ int generate_vector_cpp(
     uint8_t sqn[6], auc_vector_t* vector) {
   return generate_vector(opc, imsi, key, plmn, sqn, vector);
 }
+
+int generate_vectors_cpp(
+    const uint8_t opc[16], uint8_t key[16], uint8_t plmn[3], uint8_t sqn[6],
+    uint32_t n, auc_vector_t* vectors) {
+  return generate_vectors(opc, key, plmn, sqn, n, vectors);
+}
@@ -24,7 +24,11 @@
    a byte-oriented implementation of the functions, and of the block
    cipher kernel function Rijndael.
 
-   This has been coded for clarity, not necessarily for efficiency.
+   The subscriber key is expanded once into a milenage_ctx_t and the
+   functions milenage_f1(), milenage_f1star(), milenage_f2345() and
+   milenage_f5star() operate on that context. The original f1(),
+   f1star(), f2345() and f5star() entry points are kept and build a
+   temporary context on each call.
 
    The functions f2, f3, f4 and f5 share the same inputs and have
    been coded together as a single function. f1, f1* and f5* are
@@ -66,28 +70,46 @@ void generate_autn(
 }
 
 /*-------------------------------------------------------------------
-   Algorithm f1
+   Milenage context
   -------------------------------------------------------------------
 
-   Computes network authentication code MAC-A from key K, random
-   challenge RAND, sequence number SQN and authentication management
-   field AMF.
+   Expands the subscriber key K once and keeps it, together with OPc,
+   in a caller owned context. The f-functions below only read the
+   context, so a context may be used concurrently by several threads
+   and no global state is touched.
 
   -----------------------------------------------------------------*/
-void f1(
-    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
-    uint8_t const sqn[6], uint8_t const amf[2], uint8_t mac_a[8]) {
-  uint8_t temp[16];
-  uint8_t in1[16];
-  uint8_t out1[16];
+void milenage_init(
+    milenage_ctx_t* ctx, uint8_t const opc[16], uint8_t const k[16]) {
+  RijndaelKeyScheduleCtx(&ctx->rijndael, k);
+  memcpy(ctx->opc, opc, sizeof(ctx->opc));
+}
+
+void milenage_clear(milenage_ctx_t* ctx) {
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+/*-------------------------------------------------------------------
+   Computes TEMP = E[RAND XOR OPc]K, shared by all the f-functions.
+  -----------------------------------------------------------------*/
+static void milenage_temp(
+    const milenage_ctx_t* ctx, uint8_t const _rand[16], uint8_t temp[16]) {
   uint8_t rijndaelInput[16];
   uint8_t i;
 
-  RijndaelKeySchedule(k);
+  for (i = 0; i < 16; i++) rijndaelInput[i] = _rand[i] ^ ctx->opc[i];
 
-  for (i = 0; i < 16; i++) rijndaelInput[i] = _rand[i] ^ opc[i];
+  RijndaelEncryptCtx(&ctx->rijndael, rijndaelInput, temp);
+}
 
-  RijndaelEncrypt(rijndaelInput, temp);
+/*-------------------------------------------------------------------
+   Builds the Rijndael input for OUT1 from TEMP, SQN and AMF.
+  -----------------------------------------------------------------*/
+static void milenage_in1(
+    const milenage_ctx_t* ctx, uint8_t const temp[16], uint8_t const sqn[6],
+    uint8_t const amf[2], uint8_t rijndaelInput[16]) {
+  uint8_t in1[16];
+  uint8_t i;
 
   for (i = 0; i < 6; i++) {
     in1[i]     = sqn[i];
@@ -103,20 +125,88 @@ void f1(
    * XOR op_c and in1, rotate by r1=64, and XOR
    * * * * on the constant c1 (which is all zeroes)
    */
-  for (i = 0; i < 16; i++) rijndaelInput[(i + 8) % 16] = in1[i] ^ opc[i];
+  for (i = 0; i < 16; i++) rijndaelInput[(i + 8) % 16] = in1[i] ^ ctx->opc[i];
 
   /*
    * XOR on the value temp computed before
    */
   for (i = 0; i < 16; i++) rijndaelInput[i] ^= temp[i];
+}
 
-  RijndaelEncrypt(rijndaelInput, out1);
+/*-------------------------------------------------------------------
+   Builds the Rijndael input for OUTn (n = 2..5) from TEMP: XOR OPc
+   and TEMP, rotate by r bytes and XOR on the constant c (all zeroes
+   except for the last byte).
+  -----------------------------------------------------------------*/
+static void milenage_inn(
+    const milenage_ctx_t* ctx, uint8_t const temp[16], uint8_t rot,
+    uint8_t c, uint8_t rijndaelInput[16]) {
+  uint8_t i;
 
-  for (i = 0; i < 16; i++) out1[i] ^= opc[i];
+  for (i = 0; i < 16; i++)
+    rijndaelInput[(i + rot) % 16] = temp[i] ^ ctx->opc[i];
 
-  for (i = 0; i < 8; i++) mac_a[i] = out1[i];
+  rijndaelInput[15] ^= c;
+}
 
-  return;
+/*-------------------------------------------------------------------
+   Computes OUT1, whose first half is MAC-A and second half is MAC-S.
+  -----------------------------------------------------------------*/
+static void milenage_out1(
+    const milenage_ctx_t* ctx, uint8_t const temp[16], uint8_t const sqn[6],
+    uint8_t const amf[2], uint8_t out1[16]) {
+  uint8_t rijndaelInput[16];
+  uint8_t i;
+
+  milenage_in1(ctx, temp, sqn, amf, rijndaelInput);
+  RijndaelEncryptCtx(&ctx->rijndael, rijndaelInput, out1);
+
+  for (i = 0; i < 16; i++) out1[i] ^= ctx->opc[i];
+}
+
+/*-------------------------------------------------------------------
+   Computes OUTn (n = 2..5) from TEMP.
+  -----------------------------------------------------------------*/
+static void milenage_outn(
+    const milenage_ctx_t* ctx, uint8_t const temp[16], uint8_t rot,
+    uint8_t c, uint8_t out[16]) {
+  uint8_t rijndaelInput[16];
+  uint8_t i;
+
+  milenage_inn(ctx, temp, rot, c, rijndaelInput);
+  RijndaelEncryptCtx(&ctx->rijndael, rijndaelInput, out);
+
+  for (i = 0; i < 16; i++) out[i] ^= ctx->opc[i];
+}
+
+/*-------------------------------------------------------------------
+   Algorithm f1
+  -------------------------------------------------------------------
+
+   Computes network authentication code MAC-A from key K, random
+   challenge RAND, sequence number SQN and authentication management
+   field AMF.
+
+  -----------------------------------------------------------------*/
+void milenage_f1(
+    const milenage_ctx_t* ctx, uint8_t const _rand[16], uint8_t const sqn[6],
+    uint8_t const amf[2], uint8_t mac_a[8]) {
+  uint8_t temp[16];
+  uint8_t out1[16];
+
+  milenage_temp(ctx, _rand, temp);
+  milenage_out1(ctx, temp, sqn, amf, out1);
+  memcpy(mac_a, out1, 8);
+} /* end of function milenage_f1 */
+
+void f1(
+    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
+    uint8_t const sqn[6], uint8_t const amf[2], uint8_t mac_a[8]) {
+  milenage_ctx_t ctx;
+
+  milenage_init(&ctx, opc, k);
+  milenage_f1(&ctx, _rand, sqn, amf, mac_a);
+  milenage_clear(&ctx);
 } /* end of function f1 */
 
 /*-------------------------------------------------------------------
@@ -127,67 +217,109 @@ void f1(
    confidentiality key CK, integrity key IK and anonymity key AK.
 
   -----------------------------------------------------------------*/
-void f2345(
-    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
-    uint8_t res[8], uint8_t ck[16], uint8_t ik[16], uint8_t ak[6]) {
+void milenage_f2345(
+    const milenage_ctx_t* ctx, uint8_t const _rand[16], uint8_t res[8],
+    uint8_t ck[16], uint8_t ik[16], uint8_t ak[6]) {
   uint8_t temp[16];
   uint8_t out[16];
-  uint8_t rijndaelInput[16];
-  uint8_t i;
-
-  RijndaelKeySchedule(k);
-
-  for (i = 0; i < 16; i++) rijndaelInput[i] = _rand[i] ^ opc[i];
 
-  RijndaelEncrypt(rijndaelInput, temp);
+  milenage_temp(ctx, _rand, temp);
 
   /*
    * To obtain output block OUT2: XOR OPc and TEMP,
    * * * * rotate by r2=0, and XOR on the constant c2 (which *
    * * * * is all zeroes except that the last bit is 1).
    */
-  for (i = 0; i < 16; i++) rijndaelInput[i] = temp[i] ^ opc[i];
-
-  rijndaelInput[15] ^= 1;
-  RijndaelEncrypt(rijndaelInput, out);
-
-  for (i = 0; i < 16; i++) out[i] ^= opc[i];
-
-  for (i = 0; i < 8; i++) res[i] = out[i + 8];
-
-  for (i = 0; i < 6; i++) ak[i] = out[i];
+  milenage_outn(ctx, temp, 0, 1, out);
+  memcpy(res, &out[8], 8);
+  memcpy(ak, out, 6);
 
   /*
    * To obtain output block OUT3: XOR OPc and TEMP,
    * * * * rotate by r3=32, and XOR on the constant c3 (which *
    * * * * is all zeroes except that the next to last bit is 1).
    */
-
-  for (i = 0; i < 16; i++) rijndaelInput[(i + 12) % 16] = temp[i] ^ opc[i];
-
-  rijndaelInput[15] ^= 2;
-  RijndaelEncrypt(rijndaelInput, out);
-
-  for (i = 0; i < 16; i++) out[i] ^= opc[i];
-
-  for (i = 0; i < 16; i++) ck[i] = out[i];
+  milenage_outn(ctx, temp, 12, 2, ck);
 
   /*
    * To obtain output block OUT4: XOR OPc and TEMP,
    * * * * rotate by r4=64, and XOR on the constant c4 (which *
    * * * * is all zeroes except that the 2nd from last bit is 1).
    */
-  for (i = 0; i < 16; i++) rijndaelInput[(i + 8) % 16] = temp[i] ^ opc[i];
+  milenage_outn(ctx, temp, 8, 4, ik);
+} /* end of function milenage_f2345 */
 
-  rijndaelInput[15] ^= 4;
-  RijndaelEncrypt(rijndaelInput, out);
+void f2345(
+    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
+    uint8_t res[8], uint8_t ck[16], uint8_t ik[16], uint8_t ak[6]) {
+  milenage_ctx_t ctx;
+
+  milenage_init(&ctx, opc, k);
+  milenage_f2345(&ctx, _rand, res, ck, ik, ak);
+  milenage_clear(&ctx);
+} /* end of function f2345 */
 
-  for (i = 0; i < 16; i++) out[i] ^= opc[i];
+/*-------------------------------------------------------------------
+   Algorithms f1 and f2-f5 for several RAND values
+  -------------------------------------------------------------------
 
-  for (i = 0; i < 16; i++) ik[i] = out[i];
+   Computes MAC-A, RES, CK, IK and AK for n random challenges sharing
+   the same SQN and AMF. TEMP is computed once per RAND and the
+   Rijndael blocks of all the challenges are handed to the cipher
+   together so that they can be interleaved.
 
-  return;
-} /* end of function f2345 */
+  -----------------------------------------------------------------*/
+#define MILENAGE_BATCH 8
+
+void milenage_f1_f2345_n(
+    const milenage_ctx_t* ctx, int n, uint8_t const _rand[][16],
+    uint8_t const sqn[6], uint8_t const amf[2], uint8_t mac_a[][8],
+    uint8_t res[][8], uint8_t ck[][16], uint8_t ik[][16], uint8_t ak[][6]) {
+  uint8_t in[4 * MILENAGE_BATCH][16];
+  uint8_t out[4 * MILENAGE_BATCH][16];
+  uint8_t temp[MILENAGE_BATCH][16];
+  int v, cnt, b, i;
+
+  for (v = 0; v < n; v += MILENAGE_BATCH) {
+    cnt = (n - v) < MILENAGE_BATCH ? (n - v) : MILENAGE_BATCH;
+
+    /*
+     * TEMP = E[RAND XOR OPc]K for every challenge
+     */
+    for (b = 0; b < cnt; b++)
+      for (i = 0; i < 16; i++) in[b][i] = _rand[v + b][i] ^ ctx->opc[i];
+
+    RijndaelEncryptCtxN(&ctx->rijndael, cnt, (const uint8_t(*)[16]) in, temp);
+
+    /*
+     * OUT1 (r1=64, c1), OUT2 (r2=0, c2), OUT3 (r3=32, c3) and
+     * * * * OUT4 (r4=64, c4) for every challenge
+     */
+    for (b = 0; b < cnt; b++) {
+      milenage_in1(ctx, temp[b], sqn, amf, in[4 * b]);
+      milenage_inn(ctx, temp[b], 0, 1, in[4 * b + 1]);
+      milenage_inn(ctx, temp[b], 12, 2, in[4 * b + 2]);
+      milenage_inn(ctx, temp[b], 8, 4, in[4 * b + 3]);
+    }
+
+    RijndaelEncryptCtxN(
+        &ctx->rijndael, 4 * cnt, (const uint8_t(*)[16]) in, out);
+
+    for (b = 0; b < 4 * cnt; b++)
+      for (i = 0; i < 16; i++) out[b][i] ^= ctx->opc[i];
+
+    for (b = 0; b < cnt; b++) {
+      memcpy(mac_a[v + b], out[4 * b], 8);
+      memcpy(res[v + b], &out[4 * b + 1][8], 8);
+      memcpy(ak[v + b], out[4 * b + 1], 6);
+      memcpy(ck[v + b], out[4 * b + 2], 16);
+      memcpy(ik[v + b], out[4 * b + 3], 16);
+    }
+  }
+
+  memset(temp, 0, sizeof(temp));
+  memset(out, 0, sizeof(out));
+} /* end of function milenage_f1_f2345_n */
 
 /*-------------------------------------------------------------------
    Algorithm f1
@@ -198,49 +330,25 @@ void f2345(
    field AMF.
 
   -----------------------------------------------------------------*/
-void f1star(
-    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
-    uint8_t const sqn[6], uint8_t const amf[2], uint8_t mac_s[8]) {
+void milenage_f1star(
+    const milenage_ctx_t* ctx, uint8_t const _rand[16], uint8_t const sqn[6],
+    uint8_t const amf[2], uint8_t mac_s[8]) {
   uint8_t temp[16];
-  uint8_t in1[16];
   uint8_t out1[16];
-  uint8_t rijndaelInput[16];
-  uint8_t i;
 
-  RijndaelKeySchedule(k);
+  milenage_temp(ctx, _rand, temp);
+  milenage_out1(ctx, temp, sqn, amf, out1);
+  memcpy(mac_s, &out1[8], 8);
+} /* end of function milenage_f1star */
 
-  for (i = 0; i < 16; i++) rijndaelInput[i] = _rand[i] ^ opc[i];
-
-  RijndaelEncrypt(rijndaelInput, temp);
-
-  for (i = 0; i < 6; i++) {
-    in1[i]     = sqn[i];
-    in1[i + 8] = sqn[i];
-  }
-
-  for (i = 0; i < 2; i++) {
-    in1[i + 6]  = amf[i];
-    in1[i + 14] = amf[i];
-  }
-
-  /*
-   * XOR op_c and in1, rotate by r1=64, and XOR
-   * * * * on the constant c1 (which is all zeroes)
-   */
-  for (i = 0; i < 16; i++) rijndaelInput[(i + 8) % 16] = in1[i] ^ opc[i];
-
-  /*
-   * XOR on the value temp computed before
-   */
-  for (i = 0; i < 16; i++) rijndaelInput[i] ^= temp[i];
-
-  RijndaelEncrypt(rijndaelInput, out1);
-
-  for (i = 0; i < 16; i++) out1[i] ^= opc[i];
-
-  for (i = 0; i < 8; i++) mac_s[i] = out1[i + 8];
+void f1star(
+    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
+    uint8_t const sqn[6], uint8_t const amf[2], uint8_t mac_s[8]) {
+  milenage_ctx_t ctx;
 
-  return;
+  milenage_init(&ctx, opc, k);
+  milenage_f1star(&ctx, _rand, sqn, amf, mac_s);
+  milenage_clear(&ctx);
 } /* end of function f1star */
 
 /*-------------------------------------------------------------------
@@ -251,51 +359,48 @@ void f1star(
    anonymity key AK.
 
   -----------------------------------------------------------------*/
-void f5star(
-    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
-    uint8_t ak[6]) {
+void milenage_f5star(
+    const milenage_ctx_t* ctx, uint8_t const _rand[16], uint8_t ak[6]) {
   uint8_t temp[16];
   uint8_t out[16];
-  uint8_t rijndaelInput[16];
-  uint8_t i;
 
-  RijndaelKeySchedule(k);
-
-  for (i = 0; i < 16; i++) rijndaelInput[i] = _rand[i] ^ opc[i];
-
-  RijndaelEncrypt(rijndaelInput, temp);
+  milenage_temp(ctx, _rand, temp);
 
   /*
    * To obtain output block OUT5: XOR OPc and TEMP,
    * * * * rotate by r5=96, and XOR on the constant c5 (which *
    * * * * is all zeroes except that the 3rd from last bit is 1).
    */
-  for (i = 0; i < 16; i++) rijndaelInput[(i + 4) % 16] = temp[i] ^ opc[i];
-
-  rijndaelInput[15] ^= 8;
-  RijndaelEncrypt(rijndaelInput, out);
-
-  for (i = 0; i < 16; i++) out[i] ^= opc[i];
+  milenage_outn(ctx, temp, 4, 8, out);
+  memcpy(ak, out, 6);
+} /* end of function milenage_f5star */
 
-  for (i = 0; i < 6; i++) ak[i] = out[i];
+void f5star(
+    uint8_t const opc[16], uint8_t const k[16], uint8_t const _rand[16],
+    uint8_t ak[6]) {
+  milenage_ctx_t ctx;
 
-  return;
+  milenage_init(&ctx, opc, k);
+  milenage_f5star(&ctx, _rand, ak);
+  milenage_clear(&ctx);
 } /* end of function f5star */
 
 /*-------------------------------------------------------------------
    Function to compute OPc from OP and K.
   -----------------------------------------------------------------*/
 void ComputeOPc(uint8_t const kP[16], uint8_t const opP[16], uint8_t opcP[16]) {
+  rijndael_ctx_t ctx;
   uint8_t i;
 
-  RijndaelKeySchedule(kP);
+  RijndaelKeyScheduleCtx(&ctx, kP);
   FPRINTF_DEBUG(
       "Compute "
       "opc:\n\tK:\t%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%"
       "02X%02X\n",
       kP[0], kP[1], kP[2], kP[3], kP[4], kP[5], kP[6], kP[7], kP[8], kP[9],
       kP[10], kP[11], kP[12], kP[13], kP[14], kP[15]);
-  RijndaelEncrypt(opP, opcP);
+  RijndaelEncryptCtx(&ctx, opP, opcP);
+  memset(&ctx, 0, sizeof(ctx));
   FPRINTF_DEBUG(
       "\tIn:\t%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%"
       "02X\n\tRinj:\t%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%"
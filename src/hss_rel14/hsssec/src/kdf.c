@@ -124,6 +124,61 @@ inline void derive_kasme(
   kdf(key, 32, s, 14, kasme, 32);
 }
 
+/*
+   Computes XRES, AUTN and KASME of n authentication vectors whose RAND is
+   already set, using a Milenage context that holds the expanded key.
+*/
+#define GENERATE_VECTORS_BATCH 8
+
+static void compute_vectors(
+    const milenage_ctx_t* ctx, uint8_t plmn[3], uint8_t sqn[6], uint32_t n,
+    auc_vector_t* vectors) {
+  uint8_t amf[] = {0x80, 0x00};
+  uint8_t rand[GENERATE_VECTORS_BATCH][16];
+  uint8_t mac_a[GENERATE_VECTORS_BATCH][8];
+  uint8_t xres[GENERATE_VECTORS_BATCH][8];
+  uint8_t ck[GENERATE_VECTORS_BATCH][16];
+  uint8_t ik[GENERATE_VECTORS_BATCH][16];
+  uint8_t ak[GENERATE_VECTORS_BATCH][6];
+  uint32_t v, cnt, b;
+
+  for (v = 0; v < n; v += GENERATE_VECTORS_BATCH) {
+    cnt = (n - v) < GENERATE_VECTORS_BATCH ? (n - v) : GENERATE_VECTORS_BATCH;
+
+    for (b = 0; b < cnt; b++) memcpy(rand[b], vectors[v + b].rand, 16);
+
+    /*
+     * Compute MAC, XRES, CK, IK, AK of all the vectors in one pass
+     */
+    milenage_f1_f2345_n(
+        ctx, cnt, (const uint8_t(*)[16]) rand, sqn, amf, mac_a, xres, ck, ik,
+        ak);
+
+    for (b = 0; b < cnt; b++) {
+      auc_vector_t* vector = &vectors[v + b];
+
+      memcpy(vector->xres, xres[b], sizeof(vector->xres));
+      print_buffer("MAC_A   : ", mac_a[b], 8);
+      print_buffer("SQN     : ", sqn, 6);
+      print_buffer("RAND    : ", vector->rand, 16);
+      print_buffer("AK      : ", ak[b], 6);
+      print_buffer("CK      : ", ck[b], 16);
+      print_buffer("IK      : ", ik[b], 16);
+      print_buffer("XRES    : ", vector->xres, 8);
+      /*
+       * AUTN = SQN ^ AK || AMF || MAC
+       */
+      generate_autn(sqn, ak[b], amf, mac_a[b], vector->autn);
+      print_buffer("AUTN    : ", vector->autn, 16);
+      derive_kasme(ck[b], ik[b], plmn, sqn, ak[b], vector->kasme);
+      print_buffer("KASME   : ", vector->kasme, 32);
+    }
+  }
+
+  memset(ck, 0, sizeof(ck));
+  memset(ik, 0, sizeof(ik));
+}
+
 int generate_vector(
     const uint8_t opc[16], uint64_t imsi, uint8_t key[16], uint8_t plmn[3],
     uint8_t sqn[6], auc_vector_t* vector) {
@@ -134,37 +189,49 @@ int generate_vector(
    * * * * - AUTN
    * * * * - KASME
    */
-  uint8_t amf[] = {0x80, 0x00};
-  uint8_t mac_a[8];
-  uint8_t ck[16];
-  uint8_t ik[16];
-  uint8_t ak[6];
+  milenage_ctx_t ctx;
 
   if (vector == NULL) {
     return EINVAL;
   }
 
   /*
-   * Compute MAC
-   */
-  f1(opc, key, vector->rand, sqn, amf, mac_a);
-  print_buffer("MAC_A   : ", mac_a, 8);
-  print_buffer("SQN     : ", sqn, 6);
-  print_buffer("RAND    : ", vector->rand, 16);
-  /*
-   * Compute XRES, CK, IK, AK
+   * Expand K once for all the f-functions
    */
-  f2345(opc, key, vector->rand, vector->xres, ck, ik, ak);
-  print_buffer("AK      : ", ak, 6);
-  print_buffer("CK      : ", ck, 16);
-  print_buffer("IK      : ", ik, 16);
-  print_buffer("XRES    : ", vector->xres, 8);
+  milenage_init(&ctx, opc, key);
+  compute_vectors(&ctx, plmn, sqn, 1, vector);
+  milenage_clear(&ctx);
+  return 0;
+}
+
+/*
+   Generates n E-UTRAN authentication vectors for the same subscriber in a
+   single pass: K is expanded once, a fresh RAND is drawn for every vector
+   and the Milenage blocks of all the vectors are computed together.
+*/
+int generate_vectors(
+    const uint8_t opc[16], uint8_t key[16], uint8_t plmn[3], uint8_t sqn[6],
+    uint32_t n, auc_vector_t* vectors) {
+  uint8_t rand[GENERATE_VECTORS_BATCH][RAND_LENGTH_OCTETS];
+  milenage_ctx_t ctx;
+  uint32_t v, cnt, i;
+
+  if (vectors == NULL) {
+    return EINVAL;
+  }
+
   /*
-   * AUTN = SQN ^ AK || AMF || MAC
+   * Draw the RAND of every vector from the per thread generator
    */
-  generate_autn(sqn, ak, amf, mac_a, vector->autn);
-  print_buffer("AUTN    : ", vector->autn, 16);
-  derive_kasme(ck, ik, plmn, sqn, ak, vector->kasme);
-  print_buffer("KASME   : ", vector->kasme, 32);
+  for (v = 0; v < n; v += GENERATE_VECTORS_BATCH) {
+    cnt = (n - v) < GENERATE_VECTORS_BATCH ? (n - v) : GENERATE_VECTORS_BATCH;
+    generate_random_n(&rand[0][0], RAND_LENGTH_OCTETS, cnt);
+    for (i = 0; i < cnt; i++)
+      memcpy(vectors[v + i].rand, rand[i], RAND_LENGTH_OCTETS);
+  }
+
+  milenage_init(&ctx, opc, key);
+  compute_vectors(&ctx, plmn, sqn, n, vectors);
+  milenage_clear(&ctx);
   return 0;
 }
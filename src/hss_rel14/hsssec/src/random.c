@@ -18,39 +18,126 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
-#include <gmp.h>
-#include <sys/time.h>
+#include <sys/random.h>
 
 #include "log.h"
 #include "auc.h"
 #include "hss_config.h"
 
-typedef mpz_t random_t;
-typedef mpz_t sqn_t;
+/*
+   RAND values are produced by a per thread AES-128 CTR DRBG:
+   - every thread owns its state, no lock is taken on the hot path
+   - the key and the counter are seeded from getrandom()
+   - each refill encrypts RANDOM_BLOCKS counter blocks in one pass, the
+     first block replaces the key (fast key erasure) so that previously
+     returned values cannot be recomputed from the current state
+   - the state is reseeded from the kernel every RANDOM_RESEED_BYTES
+*/
+#define RANDOM_BLOCKS 16
+#define RANDOM_RESEED_BYTES (1 << 20)
 
 typedef struct random_state_s {
-  pthread_mutex_t lock;
-  gmp_randstate_t state;
+  rijndael_ctx_t aes;
+  uint8_t counter[16];
+  uint8_t buffer[RANDOM_BLOCKS - 1][16];
+  size_t available;
+  size_t generated;
+  int seeded;
 } random_state_t;
 
-random_state_t random_state;
+static __thread random_state_t random_state;
 extern hss_config_t hss_config;
 static uint8_t no_random_delta = 0;
 
+static int random_seed_bytes(uint8_t* buf, size_t len) {
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t ret = getrandom(buf + done, len - done, 0);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    done += ret;
+  }
+
+  if (done < len) {
+    /*
+     * kernels without getrandom(), fall back to /dev/urandom
+     */
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) return -1;
+    while (done < len) {
+      ssize_t ret = read(fd, buf + done, len - done);
+      if (ret <= 0) {
+        if (ret < 0 && errno == EINTR) continue;
+        break;
+      }
+      done += ret;
+    }
+    close(fd);
+  }
+
+  return done == len ? 0 : -1;
+}
+
+static void random_reseed(random_state_t* st) {
+  uint8_t seed[32];
+
+  if (random_seed_bytes(seed, sizeof(seed)) != 0) {
+    FPRINTF_ERROR("Unable to seed the random number generator\n");
+    abort();
+  }
+
+  RijndaelKeyScheduleCtx(&st->aes, seed);
+  memcpy(st->counter, &seed[16], sizeof(st->counter));
+  memset(seed, 0, sizeof(seed));
+
+  st->available = 0;
+  st->generated = 0;
+  st->seeded    = 1;
+}
+
+static void random_refill(random_state_t* st) {
+  uint8_t ctr[RANDOM_BLOCKS][16];
+  uint8_t out[RANDOM_BLOCKS][16];
+  int i, j;
+
+  if (!st->seeded || st->generated >= RANDOM_RESEED_BYTES) random_reseed(st);
+
+  for (i = 0; i < RANDOM_BLOCKS; i++) {
+    /*
+     * big endian increment of the 128 bit counter
+     */
+    for (j = 15; j >= 0; j--)
+      if (++st->counter[j] != 0) break;
+    memcpy(ctr[i], st->counter, 16);
+  }
+
+  RijndaelEncryptCtxN(&st->aes, RANDOM_BLOCKS, (const uint8_t(*)[16]) ctr, out);
+
+  RijndaelKeyScheduleCtx(&st->aes, out[0]);
+  memcpy(st->buffer, out[1], sizeof(st->buffer));
+  memset(out, 0, sizeof(out));
+
+  st->available = sizeof(st->buffer);
+  st->generated += sizeof(st->buffer);
+}
+
 void random_init(void) {
-  pthread_mutex_init(&random_state.lock, NULL);
   if (hss_config.random_bool > 0) {
-    mpz_t number;
-    mpz_init(number);
-    gmp_randinit_default(random_state.state);
-    struct timeval t1;
-    gettimeofday(&t1, NULL);
-    srand(t1.tv_usec * t1.tv_sec);
+    /*
+     * the calling thread is seeded now, the other threads are seeded
+     * the first time they ask for a random value
+     */
+    random_reseed(&random_state);
     FPRINTF_DEBUG("Initialized random\n");
   } else {
-    srand(1);
     FPRINTF_DEBUG("Initialized pseudo-random\n");
   }
 }
@@ -60,27 +147,42 @@ void random_init(void) {
 */
 void generate_random(uint8_t* random_p, ssize_t length) {
   if (hss_config.random_bool > 0) {
-    random_t random_nb;
-    mpz_init_set_ui(random_nb, 0);
-    pthread_mutex_lock(&random_state.lock);
-    mpz_urandomb(random_nb, random_state.state, 8 * length);
-    pthread_mutex_unlock(&random_state.lock);
-    mpz_export(random_p, NULL, 1, length, 0, 0, random_nb);
-    int r = 0, mask = 0, shift;
-    for (int i = 0; i < length; i++) {
-      if ((i % sizeof(i)) == 0) r = rand();
-      shift       = 8 * (i % sizeof(i));
-      mask        = 0xFF << shift;
-      random_p[i] = (r & mask) >> shift;
+    random_state_t* st = &random_state;
+
+    while (length > 0) {
+      size_t n;
+
+      if (st->available == 0) random_refill(st);
+
+      n = (size_t) length < st->available ? (size_t) length : st->available;
+      memcpy(
+          random_p, (uint8_t*) st->buffer + sizeof(st->buffer) - st->available,
+          n);
+      memset(
+          (uint8_t*) st->buffer + sizeof(st->buffer) - st->available, 0, n);
+      st->available -= n;
+      random_p += n;
+      length -= n;
     }
     FPRINTF_DEBUG("Generated random\n");
   } else {
-    pthread_mutex_lock(&random_state.lock);
+    uint8_t delta = __atomic_fetch_add(&no_random_delta, 1, __ATOMIC_RELAXED);
+
     for (int i = 0; i < length; i++) {
-      random_p[i] = i + no_random_delta;
+      random_p[i] = i + delta;
     }
-    no_random_delta += 1;
-    pthread_mutex_unlock(&random_state.lock);
     FPRINTF_DEBUG("Generated pseudo-random\n");
   }
 }
+
+/* Generate count random numbers of length bytes each, stored one after the
+   other in random_p.
+*/
+void generate_random_n(uint8_t* random_p, ssize_t length, int count) {
+  if (hss_config.random_bool > 0) {
+    generate_random(random_p, length * count);
+  } else {
+    for (int i = 0; i < count; i++)
+      generate_random(&random_p[i * length], length);
+  }
+}
@@ -17,16 +17,25 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <gmp.h>
 
+#if !defined(HSSSEC_NO_AESNI) && defined(__GNUC__) &&                          \
+    (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AESNI 1
+#include <wmmintrin.h>
+#else
+#define HAVE_AESNI 0
+#endif
+
 #include "auc.h"
 #include "log.h"
 
 typedef uint8_t u8;
 typedef uint32_t u32;
 
-/*-------------------- Rijndael round subkeys ---------------------*/
-u8 roundKeys[11][4][4];
+/*------ Round subkeys used by the legacy (context-less) API ------*/
+static __thread rijndael_ctx_t legacy_ctx;
 
 /*--------------------- Rijndael S box table ----------------------*/
 u8 S[256] = {
@@ -71,24 +80,43 @@ u8 Xtime[256] = {
     251, 249, 255, 253, 243, 241, 247, 245, 235, 233, 239, 237, 227, 225, 231,
     229};
 
+/*-------------------------------------------------------------------
+   Returns non-zero when the CPU implements the AES-NI instructions.
+   The answer is computed once and cached, all callers racing on the
+   first call compute the same value.
+  -----------------------------------------------------------------*/
+static int rijndael_aesni_supported(void) {
+#if HAVE_AESNI
+  static volatile int supported = -1;
+
+  if (supported < 0) {
+    __builtin_cpu_init();
+    supported = __builtin_cpu_supports("aes") ? 1 : 0;
+    FPRINTF_DEBUG(
+        "Rijndael: using %s implementation\n", supported ? "AES-NI" : "table");
+  }
+  return supported;
+#else
+  return 0;
+#endif
+}
+
 /*-------------------------------------------------------------------
    Rijndael key schedule function. Takes 16-byte key and creates
-   all Rijndael's internal subkeys ready for encryption.
+   all Rijndael's internal subkeys ready for encryption, storing them
+   in the caller supplied context. The round keys are kept in byte
+   order so that both the table and the AES-NI implementations can
+   use them directly.
   -----------------------------------------------------------------*/
-void RijndaelKeySchedule(const u8 key[16]) {
+void RijndaelKeyScheduleCtx(rijndael_ctx_t* ctx, const u8 key[16]) {
+  u8 rk[11][4][4];
   u8 roundConst;
   int i, j;
 
-  FPRINTF_DEBUG(
-      "RijndaelKeySchedule: K "
-      "%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X\n",
-      key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7], key[8],
-      key[9], key[10], key[11], key[12], key[13], key[14], key[15]);
-
   /*
    * first round key equals key
    */
-  for (i = 0; i < 16; i++) roundKeys[0][i & 0x03][i >> 2] = key[i];
+  for (i = 0; i < 16; i++) rk[0][i & 0x03][i >> 2] = key[i];
 
   roundConst = 1;
 
@@ -96,16 +124,15 @@ void RijndaelKeySchedule(const u8 key[16]) {
    * now calculate round keys
    */
   for (i = 1; i < 11; i++) {
-    roundKeys[i][0][0] =
-        S[roundKeys[i - 1][1][3]] ^ roundKeys[i - 1][0][0] ^ roundConst;
-    roundKeys[i][1][0] = S[roundKeys[i - 1][2][3]] ^ roundKeys[i - 1][1][0];
-    roundKeys[i][2][0] = S[roundKeys[i - 1][3][3]] ^ roundKeys[i - 1][2][0];
-    roundKeys[i][3][0] = S[roundKeys[i - 1][0][3]] ^ roundKeys[i - 1][3][0];
+    rk[i][0][0] = S[rk[i - 1][1][3]] ^ rk[i - 1][0][0] ^ roundConst;
+    rk[i][1][0] = S[rk[i - 1][2][3]] ^ rk[i - 1][1][0];
+    rk[i][2][0] = S[rk[i - 1][3][3]] ^ rk[i - 1][2][0];
+    rk[i][3][0] = S[rk[i - 1][0][3]] ^ rk[i - 1][3][0];
 
     for (j = 0; j < 4; j++) {
-      roundKeys[i][j][1] = roundKeys[i - 1][j][1] ^ roundKeys[i][j][0];
-      roundKeys[i][j][2] = roundKeys[i - 1][j][2] ^ roundKeys[i][j][1];
-      roundKeys[i][j][3] = roundKeys[i - 1][j][3] ^ roundKeys[i][j][2];
+      rk[i][j][1] = rk[i - 1][j][1] ^ rk[i][j][0];
+      rk[i][j][2] = rk[i - 1][j][2] ^ rk[i][j][1];
+      rk[i][j][3] = rk[i - 1][j][3] ^ rk[i][j][2];
     }
 
     /*
@@ -114,15 +141,38 @@ void RijndaelKeySchedule(const u8 key[16]) {
     roundConst = Xtime[roundConst];
   }
 
+  for (i = 0; i < 11; i++)
+    for (j = 0; j < 16; j++) ctx->round_keys[i][j] = rk[i][j & 0x03][j >> 2];
+
+  ctx->aesni = rijndael_aesni_supported();
+
+  /*
+   * do not leave key material on the stack
+   */
+  memset(rk, 0, sizeof(rk));
+
   return;
+} /* end of function RijndaelKeyScheduleCtx */
+
+/*-------------------------------------------------------------------
+   Legacy key schedule function, the subkeys are stored in a per
+   thread context used by RijndaelEncrypt().
+  -----------------------------------------------------------------*/
+void RijndaelKeySchedule(const u8 key[16]) {
+  FPRINTF_DEBUG(
+      "RijndaelKeySchedule: K "
+      "%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X\n",
+      key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7], key[8],
+      key[9], key[10], key[11], key[12], key[13], key[14], key[15]);
+
+  RijndaelKeyScheduleCtx(&legacy_ctx, key);
 } /* end of function RijndaelKeySchedule */
 
 /* Round key addition function */
-void KeyAdd(u8 state[4][4], u8 roundKeys[11][4][4], int round) {
-  int i, j;
+void KeyAdd(u8 state[4][4], const u8 roundKeys[11][16], int round) {
+  int i;
 
-  for (i = 0; i < 4; i++)
-    for (j = 0; j < 4; j++) state[i][j] ^= roundKeys[round][i][j];
+  for (i = 0; i < 16; i++) state[i & 0x3][i >> 2] ^= roundKeys[round][i];
 
   return;
 }
@@ -197,11 +247,12 @@ void MixColumn(u8 state[4][4]) {
 }
 
 /*-------------------------------------------------------------------
-   Rijndael encryption function. Takes 16-byte input and creates
-   16-byte output (using round keys already derived from 16-byte
-   key).
+   Table based Rijndael encryption function. Takes 16-byte input and
+   creates 16-byte output (using round keys already derived from
+   16-byte key).
   -----------------------------------------------------------------*/
-void RijndaelEncrypt(const u8 input[16], u8 output[16]) {
+static void RijndaelEncryptTable(
+    const rijndael_ctx_t* ctx, const u8 input[16], u8 output[16]) {
   u8 state[4][4];
   int i, r;
 
@@ -213,7 +264,7 @@ void RijndaelEncrypt(const u8 input[16], u8 output[16]) {
   /*
    * add first round_key
    */
-  KeyAdd(state, roundKeys, 0);
+  KeyAdd(state, ctx->round_keys, 0);
 
   /*
    * do lots of full rounds
@@ -222,7 +273,7 @@ void RijndaelEncrypt(const u8 input[16], u8 output[16]) {
     ByteSub(state);
     ShiftRow(state);
     MixColumn(state);
-    KeyAdd(state, roundKeys, r);
+    KeyAdd(state, ctx->round_keys, r);
   }
 
   /*
@@ -230,7 +281,7 @@ void RijndaelEncrypt(const u8 input[16], u8 output[16]) {
    */
   ByteSub(state);
   ShiftRow(state);
-  KeyAdd(state, roundKeys, r);
+  KeyAdd(state, ctx->round_keys, r);
 
   /*
    * produce output byte string from state array
@@ -240,4 +291,105 @@ void RijndaelEncrypt(const u8 input[16], u8 output[16]) {
   }
 
   return;
+} /* end of function RijndaelEncryptTable */
+
+#if HAVE_AESNI
+/*-------------------------------------------------------------------
+   AES-NI Rijndael encryption function, only called when the CPU
+   supports the instructions (see rijndael_aesni_supported()).
+  -----------------------------------------------------------------*/
+__attribute__((target("aes,sse2"))) static void RijndaelEncryptAesni(
+    const rijndael_ctx_t* ctx, const u8 input[16], u8 output[16]) {
+  __m128i state;
+  int r;
+
+  state = _mm_loadu_si128((const __m128i*) input);
+  state = _mm_xor_si128(
+      state, _mm_load_si128((const __m128i*) ctx->round_keys[0]));
+
+  for (r = 1; r <= 9; r++)
+    state = _mm_aesenc_si128(
+        state, _mm_load_si128((const __m128i*) ctx->round_keys[r]));
+
+  state = _mm_aesenclast_si128(
+      state, _mm_load_si128((const __m128i*) ctx->round_keys[10]));
+
+  _mm_storeu_si128((__m128i*) output, state);
+} /* end of function RijndaelEncryptAesni */
+#endif
+
+#if HAVE_AESNI
+/*-------------------------------------------------------------------
+   AES-NI multi-block encryption. Up to four independent blocks are
+   pushed through each round together so that the latency of one
+   AESENC is hidden behind the others.
+  -----------------------------------------------------------------*/
+__attribute__((target("aes,sse2"))) static void RijndaelEncryptAesniN(
+    const rijndael_ctx_t* ctx, int n, const u8 input[][16], u8 output[][16]) {
+  __m128i state[4];
+  __m128i rk;
+  int i, b, cnt, r;
+
+  for (i = 0; i < n; i += 4) {
+    cnt = (n - i) < 4 ? (n - i) : 4;
+
+    rk = _mm_load_si128((const __m128i*) ctx->round_keys[0]);
+    for (b = 0; b < cnt; b++)
+      state[b] = _mm_xor_si128(
+          _mm_loadu_si128((const __m128i*) input[i + b]), rk);
+
+    for (r = 1; r <= 9; r++) {
+      rk = _mm_load_si128((const __m128i*) ctx->round_keys[r]);
+      for (b = 0; b < cnt; b++) state[b] = _mm_aesenc_si128(state[b], rk);
+    }
+
+    rk = _mm_load_si128((const __m128i*) ctx->round_keys[10]);
+    for (b = 0; b < cnt; b++) {
+      state[b] = _mm_aesenclast_si128(state[b], rk);
+      _mm_storeu_si128((__m128i*) output[i + b], state[b]);
+    }
+  }
+} /* end of function RijndaelEncryptAesniN */
+#endif
+
+/*-------------------------------------------------------------------
+   Rijndael encryption function. Takes 16-byte input and creates
+   16-byte output using the round keys held by the context. The
+   context is only read, so it may be shared between threads.
+  -----------------------------------------------------------------*/
+void RijndaelEncryptCtx(
+    const rijndael_ctx_t* ctx, const u8 input[16], u8 output[16]) {
+#if HAVE_AESNI
+  if (ctx->aesni) {
+    RijndaelEncryptAesni(ctx, input, output);
+    return;
+  }
+#endif
+  RijndaelEncryptTable(ctx, input, output);
+} /* end of function RijndaelEncryptCtx */
+
+/*-------------------------------------------------------------------
+   Encrypts n independent 16-byte blocks with the same key. On
+   AES-NI capable CPUs the blocks are interleaved, otherwise they
+   are encrypted one after the other.
+  -----------------------------------------------------------------*/
+void RijndaelEncryptCtxN(
+    const rijndael_ctx_t* ctx, int n, const u8 input[][16], u8 output[][16]) {
+  int i;
+
+#if HAVE_AESNI
+  if (ctx->aesni) {
+    RijndaelEncryptAesniN(ctx, n, input, output);
+    return;
+  }
+#endif
+  for (i = 0; i < n; i++) RijndaelEncryptTable(ctx, input[i], output[i]);
+} /* end of function RijndaelEncryptCtxN */
+
+/*-------------------------------------------------------------------
+   Legacy encryption function, uses the round keys derived by the
+   last RijndaelKeySchedule() call made from the calling thread.
+  -----------------------------------------------------------------*/
+void RijndaelEncrypt(const u8 input[16], u8 output[16]) {
+  RijndaelEncryptCtx(&legacy_ctx, input, output);
 } /* end of function RijndaelEncrypt */
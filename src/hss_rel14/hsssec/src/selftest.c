@@ -0,0 +1,208 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "auc.h"
+
+/*-------------------------------------------------------------------
+   Milenage known answer test, test sets 1 to 6 of 3GPP TS 35.208
+   section 4.3.
+  -----------------------------------------------------------------*/
+typedef struct milenage_test_set_s {
+  const char* k;
+  const char* rand;
+  const char* sqn;
+  const char* amf;
+  const char* op;
+  const char* opc;
+  const char* f1;
+  const char* f1star;
+  const char* f2;
+  const char* f3;
+  const char* f4;
+  const char* f5;
+  const char* f5star;
+} milenage_test_set_t;
+
+static const milenage_test_set_t test_sets[] = {
+    {"465b5ce8b199b49faa5f0a2ee238a6bc", "23553cbe9637a89d218ae64dae47bf35",
+     "ff9bb4d0b607", "b9b9", "cdc202d5123e20f62b6d676ac72cb318",
+     "cd63cb71954a9f4e48a5994e37a02baf", "4a9ffac354dfafb3",
+     "01cfaf9ec4e871e9", "a54211d5e3ba50bf",
+     "b40ba9a3c58b2a05bbf0d987b21bf8cb", "f769bcd751044604127672711c6d3441",
+     "aa689c648370", "451e8beca43b"},
+    {"fec86ba6eb707ed08905757b1bb44b8f", "9f7c8d021accf4db213ccff0c7f71a6a",
+     "9d0277595ffc", "725c", "dbc59adcb6f9a0ef735477b7fadf8374",
+     "1006020f0a478bf6b699f15c062e42b3", "9cabc3e99baf7281",
+     "95814ba2b3044324", "8011c48c0c214ed2",
+     "5dbdbb2954e8f3cde665b046179a5098", "59a92d3b476a0443487055cf88b2307b",
+     "33484dc2136b", "deacdd848cc6"},
+    {"9e5944aea94b81165c82fbf9f32db751", "ce83dbc54ac0274a157c17f80d017bd6",
+     "0b604a81eca8", "9e09", "223014c5806694c007ca1eeef57f004f",
+     "a64a507ae1a2a98bb88eb4210135dc87", "74a58220cba84c49",
+     "ac2cc74a96871837", "f365cd683cd92e96",
+     "e203edb3971574f5a94b0d61b816345d", "0c4524adeac041c4dd830d20854fc46b",
+     "f0b9c08ad02e", "6085a86c6f63"},
+    {"4ab1deb05ca6ceb051fc98e77d026a84", "74b0cd6031a1c8339b2b6ce2b8c4a186",
+     "e880a1b580b6", "9f07", "2d16c5cd1fdf6b22383584e3bef2a8d8",
+     "dcf07cbd51855290b92a07a9891e523e", "49e785dd12626ef2",
+     "9e85790336bb3fa2", "5860fc1bce351e7e",
+     "7657766b373d1c2138f307e3de9242f9", "1c42e960d89b8fa99f2744e0708ccb53",
+     "31e11a609118", "fe2555e54aa9"},
+    {"6c38a116ac280c454f59332ee35c8c4f", "ee6466bc96202c5a557abbeff8babf63",
+     "414b98222181", "4464", "1ba00a1a7c6700ac8c3ff3e96ad08725",
+     "3803ef5363b947c6aaa225e58fae3934", "078adfb488241a57",
+     "80246b8d0186bcf1", "16c8233f05a0ac28",
+     "3f8c7587fe8e4b233af676aede30ba3b", "a7466cc1e6b2a1337d49d3b66e95d7b4",
+     "45b0f69ab06c", "1f53cd2b1113"},
+    {"2d609d4db0ac5bf0d2c0de267014de0d", "194aa756013896b74b4a2a3b0af4539e",
+     "6bf69438c2e4", "5f67", "460a48385427aa39264aac8efc9e73e8",
+     "c35a0ab0bcbfc9252caff15f24efbde0", "bd07d3003b9e5cc3",
+     "bcb6c2fcad152250", "8c25a16cd918a1df",
+     "4cd0846020f8fa0731dd47cbdc6be411", "88ab80a415f15c73711254a1d388f696",
+     "7e6455f34cf3", "dc6dd01e8f15"},
+};
+
+#define TEST_SETS (sizeof(test_sets) / sizeof(test_sets[0]))
+
+/* more challenges than one batch of milenage_f1_f2345_n() */
+#define TEST_BATCH 9
+
+static void from_hex(uint8_t* dst, const char* hex) {
+  unsigned int byte;
+
+  for (; hex[0] && hex[1]; hex += 2) {
+    sscanf(hex, "%2x", &byte);
+    *dst++ = (uint8_t) byte;
+  }
+}
+
+/* index is the position in a batch, -1 for the single challenge calls */
+static int check(
+    int set, const char* path, const char* name, int index,
+    uint8_t const* got, const char* expected) {
+  uint8_t exp[16];
+  size_t len = strlen(expected) / 2;
+
+  from_hex(exp, expected);
+  if (memcmp(got, exp, len) == 0) return 0;
+
+  if (index < 0)
+    printf("  FAIL set %d %s %s\n", set, path, name);
+  else
+    printf("  FAIL set %d %s %s, batch entry %d\n", set, path, name, index);
+  return 1;
+}
+
+static int milenage_test_set(
+    int set, const milenage_test_set_t* ts, int aesni) {
+  const char* path = aesni ? "aes-ni" : "table";
+  milenage_ctx_t ctx;
+  uint8_t k[16], op[16], opc[16], _rand[16], sqn[6], amf[2];
+  uint8_t mac_a[8], mac_s[8], res[8], ck[16], ik[16], ak[6], ak_s[6];
+  uint8_t rand_n[TEST_BATCH][16], mac_a_n[TEST_BATCH][8];
+  uint8_t res_n[TEST_BATCH][8], ck_n[TEST_BATCH][16];
+  uint8_t ik_n[TEST_BATCH][16], ak_n[TEST_BATCH][6];
+  int failed = 0;
+  int b, i;
+
+  from_hex(k, ts->k);
+  from_hex(op, ts->op);
+  from_hex(_rand, ts->rand);
+  from_hex(sqn, ts->sqn);
+  from_hex(amf, ts->amf);
+
+  /*
+   * OPc = E[OP]K XOR OP, computed with the path under test and then
+   * used in place of OP
+   */
+  milenage_init(&ctx, op, k);
+  ctx.rijndael.aesni = aesni;
+  RijndaelEncryptCtx(&ctx.rijndael, op, opc);
+  for (i = 0; i < 16; i++) opc[i] ^= op[i];
+  failed += check(set, path, "OPc", -1, opc, ts->opc);
+
+  memcpy(ctx.opc, opc, sizeof(ctx.opc));
+
+  milenage_f1(&ctx, _rand, sqn, amf, mac_a);
+  milenage_f1star(&ctx, _rand, sqn, amf, mac_s);
+  milenage_f2345(&ctx, _rand, res, ck, ik, ak);
+  milenage_f5star(&ctx, _rand, ak_s);
+
+  failed += check(set, path, "f1", -1, mac_a, ts->f1);
+  failed += check(set, path, "f1*", -1, mac_s, ts->f1star);
+  failed += check(set, path, "f2", -1, res, ts->f2);
+  failed += check(set, path, "f3", -1, ck, ts->f3);
+  failed += check(set, path, "f4", -1, ik, ts->f4);
+  failed += check(set, path, "f5", -1, ak, ts->f5);
+  failed += check(set, path, "f5*", -1, ak_s, ts->f5star);
+
+  /*
+   * the batched path used by generate_vectors()
+   */
+  for (b = 0; b < TEST_BATCH; b++) memcpy(rand_n[b], _rand, 16);
+
+  milenage_f1_f2345_n(
+      &ctx, TEST_BATCH, (const uint8_t(*)[16]) rand_n, sqn, amf, mac_a_n,
+      res_n, ck_n, ik_n, ak_n);
+
+  for (b = 0; b < TEST_BATCH; b++) {
+    failed += check(set, path, "f1", b, mac_a_n[b], ts->f1);
+    failed += check(set, path, "f2", b, res_n[b], ts->f2);
+    failed += check(set, path, "f3", b, ck_n[b], ts->f3);
+    failed += check(set, path, "f4", b, ik_n[b], ts->f4);
+    failed += check(set, path, "f5", b, ak_n[b], ts->f5);
+  }
+
+  milenage_clear(&ctx);
+
+  printf("  %s set %d %s\n", failed ? "FAIL" : "ok  ", set, path);
+
+  return failed;
+}
+
+/*-------------------------------------------------------------------
+   Runs the TS 35.208 test sets against the table implementation of
+   Rijndael and, when the CPU supports it, against the AES-NI one.
+   Returns the number of values that did not match.
+  -----------------------------------------------------------------*/
+int milenage_self_test(void) {
+  rijndael_ctx_t probe;
+  uint8_t zero[16];
+  int failed = 0;
+  size_t i;
+
+  memset(zero, 0, sizeof(zero));
+  RijndaelKeyScheduleCtx(&probe, zero);
+
+  printf(
+      "Milenage self test: TS 35.208 test sets 1-%d, AES-NI %s\n",
+      (int) TEST_SETS, probe.aesni ? "available" : "not available");
+
+  for (i = 0; i < TEST_SETS; i++) {
+    failed += milenage_test_set(i + 1, &test_sets[i], 0);
+    if (probe.aesni) failed += milenage_test_set(i + 1, &test_sets[i], 1);
+  }
+
+  printf("Milenage self test %s\n", failed ? "FAILED" : "passed");
+
+  return failed;
+} /* end of function milenage_self_test */
@@ -41,6 +41,7 @@ uint8_t* sqn_ms_derive(
   uint8_t* sqn_ms                      = NULL;
   uint8_t amf[2]                       = {0, 0};
   int i                                = 0;
+  milenage_ctx_t ctx;
 
   conc_sqn_ms = &auts[16];
   mac_s       = &auts[6 + 16];
@@ -53,7 +54,8 @@ uint8_t* sqn_ms_derive(
   /*
    * Derive AK from key and rand
    */
-  f5star(opc, key, rand_p, ak);
+  milenage_init(&ctx, opc, key);
+  milenage_f5star(&ctx, rand_p, ak);
 
   for (i = 0; i < 6; i++) {
     sqn_ms[i] = ak[i] ^ conc_sqn_ms[i];
@@ -65,7 +67,8 @@ uint8_t* sqn_ms_derive(
   print_buffer("sqn_ms_derive() AK     : ", ak, 6);
   print_buffer("sqn_ms_derive() SQN_MS : ", sqn_ms, 6);
   print_buffer("sqn_ms_derive() MAC_S  : ", mac_s, 8);
-  f1star(opc, key, rand_p, sqn_ms, amf, mac_s_computed);
+  milenage_f1star(&ctx, rand_p, sqn_ms, amf, mac_s_computed);
+  milenage_clear(&ctx);
   print_buffer("MAC_S +: ", mac_s_computed, 8);
 
   if (memcmp(mac_s_computed, mac_s, 8) != 0) {
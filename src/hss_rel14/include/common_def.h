@@ -27,6 +27,7 @@
 #define VENDOR_3GPP (10415)
 
 #define DIAMETER_SUCCESS (2001)
+#define DIAMETER_TOO_BUSY (3004)
 #define DIAMETER_UNABLE_TO_COMPLY (5012)
 
 #define DIAMETER_ERROR_USER_UNKNOWN (5001)
@@ -20,8 +20,12 @@
 #include <stdexcept>
 #include <list>
 #include <string>
+#include <unordered_map>
 
+#include "fdjson.h"
 #include "scassandra.h"
+#include "spool.h"
+#include "ssync.h"
 
 #define MME_IDENTITY_PRESENT (1U)
 #define MME_SUPPORTED_FEATURES_PRESENT (1U << 1)
@@ -29,6 +33,9 @@
 #define SV_PRESENT (1U << 3)
 #define UE_SRVCC_PRESENT (1U << 4)
 
+// the number of compiled monitoring event configurations kept in memory
+#define DAEVENT_ENCODINGS_MAX (65536)
+
 #define KEY_LENGTH (16)
 #define SQN_LENGTH (6)
 #define RAND_LENGTH (16)
@@ -56,6 +63,8 @@ class DAEvent {
  public:
   DAEvent() { init(); }
 
+  SPOOL_ALLOCATOR(DAEvent)
+
   void init() {
     scef_id.clear();
     scef_ref_id = 0;
@@ -84,6 +93,8 @@ class DAEventList : public std::list<DAEvent*> {
 struct DAEventId {
   std::string scef_id;
   uint32_t scef_ref_id;
+
+  SPOOL_ALLOCATOR(DAEventId)
 };
 
 struct DAMmeIdentity {
@@ -126,6 +137,99 @@ struct DAImsiSec {
   uint8_t opc[OPC_LENGTH];
 };
 
+#define DACACHE_SHARDS (16)
+
+// Write-through cache of the users_imsi columns read by AIR and ULR. It is only
+// correct when this process is the only writer of users_imsi: a row changed by
+// another HSS sharing the keyspace, or provisioned directly in Cassandra, is
+// not seen until its entry expires, and an SQN advanced elsewhere can be handed
+// out again. The cache is therefore disabled unless a cachesize is configured.
+//
+// The cache is sharded by IMSI, each shard bounded and evicted in LRU order,
+// and entries expire after the configured TTL. An entry whose SQN update is
+// still in flight is neither evicted nor expired so that a concurrent reload
+// from the database can never move the cached SQN backwards. The subscription
+// profile of an entry is kept compiled alongside it until the entry is evicted.
+// A compiled profile is only used for the exact text it was compiled from, so a
+// reload that returns a changed profile recompiles it.
+class DACache {
+ public:
+  DACache();
+  ~DACache();
+
+  void init(uint32_t capacity, uint32_t ttl);
+  bool enabled() { return m_capacity > 0; }
+  void clear();
+
+  // a miss returns the generation of the entry, the value read from the
+  // database is only stored if no update or invalidation happened since
+  bool getImsiSec(
+      const std::string& imsi, DAImsiSec& sec, uint64_t& generation);
+  void putImsiSec(
+      const std::string& imsi, const DAImsiSec& sec, uint64_t generation);
+  // returns true if the entry was pinned, updateRandSqnComplete() must then
+  // be called once the update has completed
+  bool updateRandSqn(
+      const std::string& imsi, const uint8_t* rand, const uint8_t* sqn);
+  void updateRandSqnComplete(const std::string& imsi);
+  void invalidateImsiSec(const std::string& imsi);
+
+  // same as getImsiSec()/putImsiSec(), a location update or purge since the
+  // miss keeps the value read from being stored
+  bool getImsiInfo(
+      const std::string& imsi, DAImsiInfo& info, uint64_t& generation);
+  void putImsiInfo(
+      const std::string& imsi, const DAImsiInfo& info, uint64_t generation);
+  void updateLocation(
+      const DAImsiInfo& location, uint32_t present_flags,
+      int32_t idmmeidentity);
+  void purgeUE(const std::string& imsi);
+
+  // subscription_data compiled into AVPs, compiled on the first call and
+  // kept with the entry of imsi, NULL if the profile does not compile
+  FDJsonEncodingPtr getSubscriptionEncoding(
+      const std::string& imsi, const std::string& subscription_data,
+      void (*errfunc)(const char*));
+
+ private:
+  struct Entry {
+    std::string imsi;
+
+    bool sec_valid;
+    int64_t sec_expires;
+    uint32_t sec_pending;
+    uint64_t sec_generation;
+    DAImsiSec sec;
+
+    bool info_valid;
+    int64_t info_expires;
+    uint64_t info_generation;
+    DAImsiInfo info;
+    FDJsonEncodingPtr info_subscription;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  struct Shard {
+    Shard() : generation(0) {}
+
+    SMutex mutex;
+    uint64_t generation;  // the last generation assigned in the shard
+    EntryList lru;
+    std::unordered_map<std::string, EntryList::iterator> index;
+  };
+
+  Shard& shard(const std::string& imsi);
+  Entry* find(Shard& s, const std::string& imsi);
+  Entry& insert(Shard& s, const std::string& imsi);
+  int64_t expires();
+
+  uint32_t m_capacity;
+  uint32_t m_shardcapacity;
+  int64_t m_ttl;
+  Shard m_shards[DACACHE_SHARDS];
+};
+
 class DataAccess {
  public:
   DataAccess();
@@ -148,6 +252,20 @@ class DataAccess {
 
   void disconnect();
 
+  DACache& cache() { return m_cache; }
+
+  bool getMetrics(CassMetrics& metrics) { return m_db.getMetrics(metrics); }
+
+  // the monitoring event configuration of the event compiled into AVPs, the
+  // compiled form is cached by event id until the event is added or deleted
+  FDJsonEncodingPtr getEventEncoding(
+      const DAEvent& event, void (*errfunc)(const char*));
+  // adds users_imsi.subscription_data to msg, from the profile compiled in
+  // the subscriber cache when it is enabled
+  int addSubscriptionData(
+      const std::string& imsi, const std::string& subscription_data,
+      msg_or_avp* msg, void (*errfunc)(const char*));
+
   bool addEvent(DAEvent& event);
 
   bool getEvent(const char* scef_id, uint32_t scef_ref_id, DAEvent& event);
@@ -155,6 +273,14 @@ class DataAccess {
       const std::string& scef_id, uint32_t scef_ref_id, DAEvent& event) {
     return getEvent(scef_id.c_str(), scef_ref_id, event);
   }
+  bool getEvent(
+      const char* scef_id, uint32_t scef_ref_id, DAEventList& events,
+      CassFutureCallback cb, void* data);
+  bool getEvent(
+      const std::string& scef_id, uint32_t scef_ref_id, DAEventList& events,
+      CassFutureCallback cb, void* data) {
+    return getEvent(scef_id.c_str(), scef_ref_id, events, cb, data);
+  }
 
   bool getEvents(
       const char* scef_id, std::list<uint32_t> scef_ref_ids,
@@ -197,6 +323,9 @@ class DataAccess {
   bool getImsiFromMsisdn(const std::string& msisdn, std::string& imsi) {
     return getImsiFromMsisdn(msisdn.c_str(), imsi);
   }
+  bool getImsiFromMsisdn(
+      int64_t msisdn, std::string& imsi, CassFutureCallback cb, void* data);
+  bool getImsiFromMsisdnData(SCassFuture& future, std::string& imsi);
 
   bool getMsisdnFromImsi(const char* imsi, std::string& msisdn);
   bool getMsisdnFromImsi(const std::string& imsi, std::string& msisdn) {
@@ -221,6 +350,13 @@ class DataAccess {
   void getEventIdsFromExtId(const std::string& extid, DAEventIdList& el) {
     getEventIdsFromExtId(extid.c_str(), el);
   }
+  bool getEventIdsFromExtId(
+      const char* extid, DAEventIdList& el, CassFutureCallback cb, void* data);
+  bool getEventIdsFromExtId(
+      const std::string& extid, DAEventIdList& el, CassFutureCallback cb,
+      void* data) {
+    return getEventIdsFromExtId(extid.c_str(), el, cb, data);
+  }
 
   bool getEventIdsFromExtIds(
       const char* extid, DAEventIdList& el, CassFutureCallback cb, void* data);
@@ -241,11 +377,20 @@ class DataAccess {
   bool updateOpc(std::string& imsi, std::string& opc);
 
   bool purgeUE(std::string& imsi);
+  bool purgeUE(const std::string& imsi, CassFutureCallback cb, void* data);
+  bool purgeUEData(SCassFuture& future, const std::string& imsi);
 
   bool getMmeIdentityFromImsi(std::string& imsi, DAMmeIdentity& mmeid);
+  bool getMmeIdentityFromImsi(
+      const std::string& imsi, int32_t& mme_id, CassFutureCallback cb,
+      void* data);
+  bool getMmeIdentityFromImsiData(SCassFuture& future, int32_t& mme_id);
 
   bool getMmeIdentity(std::string& mme_id, DAMmeIdentity& mmeid);
   bool getMmeIdentity(int32_t mme_id, DAMmeIdentity& mmeid);
+  bool getMmeIdentity(
+      int32_t mme_id, DAMmeIdentity& mmeid, CassFutureCallback cb, void* data);
+  bool getMmeIdentityData(SCassFuture& future, DAMmeIdentity& mmeid);
 
   bool getLatestIdentity(
       const char* table_name, int64_t& id, CassFutureCallback cb, void* data);
@@ -278,9 +423,11 @@ class DataAccess {
       void* data);
   bool getImsiSecData(SCassFuture& future, DAImsiSec& imsisec);
 
+  // pinned is set before the update is issued, the callback has to call
+  // DACache::updateRandSqnComplete() when it is true
   bool updateRandSqn(
       const std::string& imsi, uint8_t* rand_p, uint8_t* sqn, bool inc_sqn,
-      CassFutureCallback cb, void* data);
+      CassFutureCallback cb, void* data, bool& pinned);
 
   bool incSqn(std::string& imsi, uint8_t* sqn);
 
@@ -316,7 +463,36 @@ class DataAccess {
   // imsi.c_str() ); }
 
  private:
+  // statements prepared once at connect() and bound on each request
+  enum PreparedStatement {
+    psGetEvent,
+    psGetExtIdsFromImsi,
+    psGetImsiInfo,
+    psGetEventIdsFromMsisdn,
+    psGetEventIdsFromExtId,
+    psGetMmeIdentityFromImsi,
+    psGetMmeIdentity,
+    psGetMmeIdFromHost,
+    psPurgeUE,
+    psGetImsiSec,
+    psUpdateRandSqn,
+    psGetImsiFromMsisdn,
+    // one updateLocation statement per IMEI/SV/MME identity combination
+    psUpdateLocation,
+    psMax = psUpdateLocation + 8
+  };
+
+  void prepareStatements();
+  bool checkBind(
+      SCassStatement& stmt, int ps, const char* func, bool async);
+
+  static std::string eventKey(const char* scef_id, uint32_t scef_ref_id);
+
   SCassandra m_db;
+  DACache m_cache;
+  FDJsonCache m_eventencodings;
+  SCassPrepared m_prepared[psMax];
+  std::string m_queries[psMax];
 };
 
 #endif /* __DATAACCESS_H */
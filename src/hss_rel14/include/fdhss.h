@@ -25,6 +25,7 @@
 #include "sthread.h"
 #include "stimer.h"
 #include "stime.h"
+#include "stimerwheel.h"
 #include "statshss.h"
 #include "soss.h"
 #include "logger.h"
@@ -33,15 +34,19 @@
 
 #include "worker.h"
 
-const uint16_t GUARD_TIMEOUT       = ETM_USER + 1;
+const uint16_t HANDLE_GROUP_START  = ETM_USER + 1;
 const uint16_t HANDLE_MME_RESPONSE = ETM_USER + 2;
-const uint16_t HANDLE_CIA_SENT     = ETM_USER + 3;
+const uint16_t HANDLE_IMSI_INFO    = ETM_USER + 3;
+
+// resolution of the guard timers of the group reports
+const long RIRREACTOR_TICK = 100;
 
 const int MME_DOWN        = 100;
 const int IMSI_NOT_ACTIVE = 101;
 
 namespace s6t {
 class Application;
+class ConfigurationInformationRequestExtractor;
 class MonitoringEventConfigurationExtractorList;
 }  // namespace s6t
 namespace s6as6d {
@@ -69,7 +74,14 @@ typedef std::map<std::pair<std::string, uint32_t>, std::vector<ImsiStatus> >
 
 typedef struct hss_config_s hss_config_t;
 
-class HandleMmeResponseEvtMsg : public SEventThreadMessage {
+class RIRBuilderEvtMsg : public SEventThreadMessage {
+ public:
+  RIRBuilderEvtMsg(uint16_t id) : SEventThreadMessage(id), m_builder(NULL) {}
+
+  RIRBuilder* m_builder;
+};
+
+class HandleMmeResponseEvtMsg : public RIRBuilderEvtMsg {
  public:
   HandleMmeResponseEvtMsg(
       EvenStatusMap* mme_response, std::string& imsi, int imsi_reachable,
@@ -83,6 +95,18 @@ class HandleMmeResponseEvtMsg : public SEventThreadMessage {
   HandleMmeResponseEvtMsg();
 };
 
+// the users_imsi row of one IMSI of a group, read from a Cassandra callback
+class HandleImsiInfoEvtMsg : public RIRBuilderEvtMsg {
+ public:
+  HandleImsiInfoEvtMsg(const std::string& imsi)
+      : RIRBuilderEvtMsg(HANDLE_IMSI_INFO), m_imsi(imsi) {}
+  std::string m_imsi;
+  DAImsiInfo m_info;
+
+ private:
+  HandleImsiInfoEvtMsg();
+};
+
 class MonitoringConfEventStatus {
  public:
   MonitoringConfEventStatus(bool is_remove);
@@ -134,14 +158,197 @@ class ImsiImeiData {
   std::string new_imei_sv;
 };
 
+// the lanes of the HSS worker queue, so that a flood of one kind of request
+// does not delay the others
+enum HSSQueueLane {
+  hss_lane_auth,      // AIR, the attach of the UE waits for it
+  hss_lane_location,  // ULR, PUR and SRR
+  hss_lane_event,     // CIR and NIR, monitoring event configuration
+  hss_lane_max
+};
+
 class HSSWorkerQueue : public QueueManager {
  public:
   HSSWorkerQueue();
   ~HSSWorkerQueue();
 
-  void addProcessor(QueueProcessor* processor);
+  static const char* laneName(int lane);
+
+  // answers the request with DIAMETER_TOO_BUSY and returns false when the
+  // queue is full, the request is released in that case
+  bool admit(FDMessageRequest* req, StatType stat);
+
+  // the milliseconds a peer waits for an answer, 0 for no deadline
+  void setBudget(long budget) { m_budget = (stimer_t) budget * 1000000; }
+
+  // marks an expired request as abandoned and counts it, the caller drops
+  // it without an answer
+  void abandonProcessor(QueueProcessor* processor);
+  uint64_t abandoned() {
+    return __atomic_load_n(&m_abandoned, __ATOMIC_RELAXED);
+  }
+
+  void addProcessor(QueueProcessor* processor, HSSQueueLane lane);
   void startProcessor();
-  void finishProcessor();
+  void finishProcessor(QueueProcessor* processor);
+
+ private:
+  stimer_t m_budget;
+  uint64_t m_abandoned;
+};
+
+// DOIC (RFC 7683) constants
+#define DOIC_OLR_DEFAULT_ALGO (1)
+#define DOIC_HOST_REPORT (0)
+// seconds an OC-OLR stays valid, the RFC 7683 default
+#define DOIC_VALIDITY (30)
+// milliseconds between two evaluations of the load
+#define DOIC_INTERVAL (1000)
+// the reduction is advertised in steps of this many percent
+#define DOIC_STEP (5)
+// the share of the concurrency limit in use below which there is no overload
+#define DOIC_UTILISATION (0.8)
+
+// the load of the HSS an overload report is computed from
+struct HSSLoadSignals {
+  size_t queuedepth;
+  int queuemax;
+  int active;
+  int limit;
+  uint64_t dblatency;  // moving average of a Cassandra query, microseconds
+  uint64_t dbtarget;   // the acceptable Cassandra latency, 0 to ignore it
+};
+
+// The DOIC reporting node of the HSS.  The answers to requests that carry
+// OC-Supported-Features get OC-Supported-Features and, while the HSS is
+// overloaded, an OC-OLR host report asking the MME to drop a share of its
+// traffic (loss algorithm).  The share is re-evaluated at most every
+// DOIC_INTERVAL ms by the thread building an answer, the sequence number is
+// only incremented when the advertised reduction changes.  Once the overload
+// is over an OC-OLR with a validity of 0 is sent for DOIC_VALIDITY seconds.
+class HSSOverloadReporter {
+ public:
+  HSSOverloadReporter();
+  ~HSSOverloadReporter();
+
+  // looks up the DOIC AVPs, reporting stays off until this is called
+  void init(uint64_t dbtarget);
+
+  bool enabled() { return m_oc_olr != NULL; }
+
+  // folds the latency of a completed Cassandra query into the average
+  void registerDbLatency(uint64_t usec);
+
+  // adds the DOIC AVPs to the answer if the request asked for them
+  void addReport(FDMessageAnswer& ans);
+
+  // re-evaluates the report, returns true when it changed
+  bool update(const HSSLoadSignals& signals, int64_t now);
+
+  uint32_t reduction() { return (uint32_t)(report() & 0xff); }
+  uint64_t sequence() { return report() >> 16; }
+
+  // the reduction in percent that matches the signals
+  static uint32_t computeReduction(const HSSLoadSignals& signals);
+
+  // drives a synthetic overload through update() and checks the advertised
+  // reduction, returns false and logs to stdout on a mismatch
+  static bool selfTest();
+
+ private:
+  // the report packs the reduction (bits 0-7), whether an OC-OLR is sent
+  // (bit 8), whether it ends the overload (bit 9) and the sequence number
+  // (bits 16-63), so that it is read atomically without a lock
+  enum { REPORT_OLR = 0x100, REPORT_END = 0x200 };
+
+  uint64_t report() { return __atomic_load_n(&m_report, __ATOMIC_RELAXED); }
+  void refresh();
+
+  uint64_t m_report;
+  uint64_t m_dblatency;
+  uint64_t m_dbtarget;
+  int64_t m_updated;
+  int64_t m_expires;
+  int64_t m_refreshed;
+
+  FDDictionaryEntryAVP* m_oc_supported_features;
+  FDDictionaryEntryAVP* m_oc_feature_vector;
+  FDDictionaryEntryAVP* m_oc_olr;
+  FDDictionaryEntryAVP* m_oc_sequence_number;
+  FDDictionaryEntryAVP* m_oc_report_type;
+  FDDictionaryEntryAVP* m_oc_reduction_percentage;
+  FDDictionaryEntryAVP* m_oc_validity_duration;
+};
+
+// Runs the handler of a request that still uses the blocking DataAccess
+// methods on an HSS worker thread.  The freeDiameter thread that received
+// the request only queues the processor, so a slow query holds up a worker
+// and not the dispatch of other requests.  The processor is deleted and the
+// next queued processor started once process() returns.
+class HSSRequestProcessor : public QueueProcessor {
+ public:
+  HSSRequestProcessor(FDMessageRequest* req, StatType stat)
+      : m_req(req), m_stat(stat) {}
+  virtual ~HSSRequestProcessor() {}
+
+  void triggerNextPhase();
+  static void processRequest(HSSRequestProcessor* pthis);
+
+ protected:
+  // the handler owns the request, as in FDCommandRequest::process()
+  virtual int process(FDMessageRequest* req) = 0;
+
+ private:
+  FDMessageRequest* m_req;
+  StatType m_stat;
+};
+
+class HSSRequestStateProcessor : public WorkProcessor {
+ public:
+  HSSRequestStateProcessor(HSSRequestProcessor* processor)
+      : m_processor(processor) {}
+  virtual ~HSSRequestStateProcessor() {}
+
+  SPOOL_ALLOCATOR(HSSRequestStateProcessor)
+
+  void process() { HSSRequestProcessor::processRequest(m_processor); }
+
+ private:
+  HSSRequestProcessor* m_processor;
+};
+
+class RIRReactor : public SEventThread {
+ public:
+  RIRReactor();
+  virtual ~RIRReactor();
+
+  void onInit();
+  void onQuit();
+  void onTimer(SEventThread::Timer& t);
+  void dispatch(SEventThreadMessage& msg);
+
+  STimerWheel& getWheel() { return m_wheel; }
+  long getGroups() { return m_groups; }
+
+ private:
+  SEventThread::Timer m_tick;
+  STimerWheel m_wheel;
+  long m_groups;
+};
+
+class RIREngine {
+ public:
+  RIREngine();
+  ~RIREngine();
+
+  void init(int threads);
+  void shutdown();
+
+  void start(RIRBuilder* builder);
+
+ private:
+  std::vector<RIRReactor*> m_reactors;
+  long m_next;
 };
 
 class FDHss {
@@ -166,6 +373,10 @@ class FDHss {
       s6t::MonitoringEventConfigurationExtractorList& cir_monevtcfg,
       std::string& imsi, FDMessageRequest* cir_req, EvenStatusMap* evt_map,
       RIRBuilder* rir_builder);
+  int sendINSDRreq(
+      s6t::MonitoringEventConfigurationExtractorList& cir_monevtcfg,
+      std::string& imsi, FDMessageRequest* cir_req, EvenStatusMap* evt_map,
+      DAImsiInfo& imsi_info, RIRBuilder* rir_builder);
 
   void sendRIR_ChangeImsiImeiSvAssn(ImsiImeiData& data);
 
@@ -175,6 +386,8 @@ class FDHss {
   DataAccess& getDb() { return m_dbobj; }
   WorkerManager& getWorkMgr() { return m_wrkmgr; }
   HSSWorkerQueue& getWorkerQueue() { return m_workerqueue; }
+  HSSOverloadReporter& getOverloadReporter() { return m_overload; }
+  RIREngine& getRIREngine() { return m_rirengine; }
 
   void buildCfgStatusAvp(
       FDAvp& mon_evt_cfg_status, MonitoringConfEventStatus& status);
@@ -192,35 +405,62 @@ class FDHss {
   OssEndpoint<Logger>* m_ossendpoint;
   WorkerManager m_wrkmgr;
   HSSWorkerQueue m_workerqueue;
+  HSSOverloadReporter m_overload;
+  RIREngine m_rirengine;
 };
 
 extern FDHss fdHss;
 
-class RIRBuilder : public SEventThread {
+// Aggregates the IDA results of a group CIR into RIR messages.  A builder is
+// a plain state object that lives on one RIRReactor for its whole life, so
+// every event of the group is handled by the same thread without locking.
+// The users of the group are read asynchronously and the reactor sends the
+// IDR of each one as its row comes back, the reactor never waits on
+// Cassandra.
+class RIRBuilder : public STimerWheel::Entry {
+  friend class RIRReactor;
+  friend class RIREngine;
+
  public:
   RIRBuilder(
-      int nb_ida_proc, EvenStatusMap* hss_insert_status,
-      std::string& destination_host, std::string& destination_realm);
+      FDMessageRequest* cir_req, FDMessageAnswer* cia, DAImsiList& list_imsi,
+      EvenStatusMap* hss_insert_status, std::string& destination_host,
+      std::string& destination_realm);
   virtual ~RIRBuilder();
-  void onInit();
-  void onQuit();
-  void onTimer(SEventThread::Timer& t);
+
   void setInterval(long interval) { m_interval = interval; }
-  void dispatch(SEventThreadMessage& msg);
+
+  // these methods can be called from any thread
+  void postMessage(uint16_t message);
+  void postMessage(RIRBuilderEvtMsg* msg);
 
  private:
+  static void onImsiInfo(CassFuture* future, void* data);
+
+  bool start();
+  bool handleImsiInfo(HandleImsiInfoEvtMsg& msg);
+  bool handleMmeResponse(HandleMmeResponseEvtMsg& msg);
+  void sendCIA();
+  bool complete();
+  void onExpired();
   void sendRIR();
 
+  RIRReactor* m_reactor;
+  FDMessageRequest* m_cir_req;
+  FDMessageAnswer* m_cia;
+  DAImsiList m_list_imsi;
+  s6t::ConfigurationInformationRequestExtractor* m_cir;
+  int m_nb_info_pending;  // # of users_imsi lookups outstanding
+
   long m_interval;
   int m_nb_ida_proc;
-  SEventThread::Timer m_idletimer;
+  bool m_rirsent;
 
   std::string m_destination_host;
   std::string m_destination_realm;
 
   EvenStatusMap* m_hss_insert_status;
   EventImsiStatus imsi_status_map;
-  bool m_ciasent;
 };
 
 #endif
@@ -61,6 +61,10 @@ class Options {
   }
   static const unsigned& getcassioqueuesize() { return m_cassioqueuesize; }
   static const unsigned& getcassiothreads() { return m_cassiothreads; }
+  // 0 disables the users_imsi cache, which requires this process to be the
+  // only writer of users_imsi (see DACache)
+  static const unsigned& getcachesize() { return m_cachesize; }
+  static const unsigned& getcachettl() { return m_cachettl; }
 
   static bool getrandvector() { return m_randvector; }
   static bool getroamallow() { return m_roamallow; }
@@ -76,6 +80,23 @@ class Options {
   static const std::string& getsynchauts() { return m_synchauts; }
   static const int& getnumworkers() { return m_numworkers; }
   static const int& getconcurrent() { return m_concurrent; }
+  static const int& getconcurrentmin() { return m_concurrentmin; }
+  static const int& getconcurrentmax() { return m_concurrentmax; }
+  static const int& getqueuemax() { return m_queuemax; }
+  static const int& getlatencytarget() { return m_latencytarget; }
+  static bool getdoic() { return m_doic; }
+  static const int& getdoicdblatency() { return m_doicdblatency; }
+  static bool getdoictest() { return m_doictest; }
+  static bool getmilenagetest() { return m_milenagetest; }
+  static const int& getrequestbudget() { return m_requestbudget; }
+  static const int& getauthweight() { return m_authweight; }
+  static const int& getauthshare() { return m_authshare; }
+  static const int& getlocationweight() { return m_locationweight; }
+  static const int& getlocationshare() { return m_locationshare; }
+  static const int& geteventweight() { return m_eventweight; }
+  static const int& geteventshare() { return m_eventshare; }
+  static bool getworkstealing() { return m_workstealing; }
+  static const int& getrirthreads() { return m_rirthreads; }
 
   static void fillhssconfig(hss_config_t* hss_config_p);
 
@@ -145,6 +166,25 @@ class Options {
   static unsigned m_cassmaxconnections;
   static unsigned m_cassioqueuesize;
   static unsigned m_cassiothreads;
+  static unsigned m_cachesize;
+  static unsigned m_cachettl;
+  static bool m_workstealing;
+  static int m_rirthreads;
+  static int m_concurrentmin;
+  static int m_concurrentmax;
+  static int m_queuemax;
+  static int m_latencytarget;
+  static bool m_doic;
+  static int m_doicdblatency;
+  static bool m_doictest;
+  static bool m_milenagetest;
+  static int m_requestbudget;
+  static int m_authweight;
+  static int m_authshare;
+  static int m_locationweight;
+  static int m_locationshare;
+  static int m_eventweight;
+  static int m_eventshare;
   static bool m_randvector;
   static bool m_roamallow;
   static std::string m_optkey;
@@ -20,6 +20,7 @@
 #include "s6as6d.h"
 #include "fdhss.h"
 #include "worker.h"
+#include "spool.h"
 
 extern "C" {
 #include "hss_config.h"
@@ -30,6 +31,11 @@ extern "C" {
 
 #define AUTH_MAX_EUTRAN_VECTORS 6
 
+// inline arena space for the DatabaseAction objects of a request
+#define ULRPROCESSOR_ARENA (256)
+#define AIRPROCESSOR_ARENA (64)
+#define PURPROCESSOR_ARENA (128)
+
 class DataAccess;
 
 namespace s6t {
@@ -69,6 +75,10 @@ class Application : public ApplicationBase {
       s6t::MonitoringEventConfigurationExtractorList& cir_monevtcfg,
       std::string& imsi, FDMessageRequest* cir_req, EvenStatusMap* evt_map,
       RIRBuilder* rir_builder);
+  int sendINSDRreq(
+      s6t::MonitoringEventConfigurationExtractorList& cir_monevtcfg,
+      std::string& imsi, FDMessageRequest* cir_req, EvenStatusMap* evt_map,
+      DAImsiInfo& imsi_info, RIRBuilder* rir_builder);
   bool sendDESDRreq(FDPeer& peer);
   bool sendPUURreq(FDPeer& peer);
   bool sendRERreq(FDPeer& peer);
@@ -122,42 +132,6 @@ class IDRRreq : public INSDRreq {
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-#define DB_OP_COMPLETE_EXECUTED(__executed, __item)                            \
-  { atomic_or_fetch(__executed, __item); }
-
-#define DB_OP_COMPLETE_RESULT(__result, __item, __success)                     \
-  {                                                                            \
-    if (__success)                                                             \
-      atomic_or_fetch(__result, __item);                                       \
-    else                                                                       \
-      atomic_and_fetch(__result, !__item);                                     \
-  }
-
-#define DB_OP_COMPLETE(_item, _executed, _result, _success)                    \
-  {                                                                            \
-    DB_OP_COMPLETE_RESULT(_result, _item, _success)                            \
-    DB_OP_COMPLETE_EXECUTED(_executed, _item)                                  \
-  }
-
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-
-class DatabaseAction {
- public:
-  DatabaseAction(uint32_t action) : m_action(action) {}
-
-  virtual ~DatabaseAction() {}
-
-  uint16_t getAction() { return m_action; }
-
- private:
-  DatabaseAction();
-  uint32_t m_action;
-};
-
-////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-
 #define ULRSTATE_BASE (WORKER_EVENT + 100)
 #define ULRSTATE_PHASEFINAL (ULRSTATE_BASE + 0)
 #define ULRSTATE_PHASE1 (ULRSTATE_BASE + 1)
@@ -181,6 +155,8 @@ class ULRProcessor : public QueueProcessor {
       s6as6d::Dictionary& dict);
   virtual ~ULRProcessor();
 
+  SPOOL_ALLOCATOR(ULRProcessor)
+
   bool phaseReady(int phase, uint32_t adjustment = 0);
   void triggerNextPhase();
   static void processNextPhase(ULRProcessor* pthis);
@@ -197,7 +173,11 @@ class ULRProcessor : public QueueProcessor {
 
  private:
   static void on_ulr_callback(CassFuture* f, void* data);
+  void postNextPhase();
+  void sendAnswer();
 
+  void getEventIdsMsisdn();
+  void eventIdsComplete();
   void getEvents();
 
   void getImsiInfo(SCassFuture& future);
@@ -209,14 +189,15 @@ class ULRProcessor : public QueueProcessor {
   void updateImsiInfo(SCassFuture& future);
 
   s6as6d::UpdateLocationRequestExtractor m_ulr;
-  SMutex m_mutex;
-  SMutex m_lstmutex;
+  SFastMutex m_mutex;
+  SFastMutex m_lstmutex;
   FDMessageAnswer m_ans;
   s6as6d::Application& m_app;
   s6as6d::Dictionary& m_dict;
   long m_perf_timer;
   std::string m_imsi;
   DAImsiInfo m_orig_info;
+  uint64_t m_infogeneration;  // the cache generation m_orig_info was read at
   DAImsiInfo m_new_info;
   uint32_t m_present_flags;
   uint8_t m_plmn_id[4];
@@ -232,10 +213,15 @@ class ULRProcessor : public QueueProcessor {
 
   int m_nextphase;
   uint32_t m_msgissued;
-  uint32_t m_dbexecuted;   // bit mask that shows which queries are complete
-  uint32_t m_dbresult;     // query result bit mask
-  uint32_t m_dbissued;     // # of queries in flight
-  uint32_t m_dbevtissued;  // # of event queries in flight
+  uint32_t m_dbexecuted;    // bit mask that shows which queries are complete
+  uint32_t m_dbresult;      // query result bit mask
+  uint32_t m_dbissued;      // # of queries in flight
+  uint32_t m_dbevtissued;   // # of event queries in flight
+  uint32_t m_evtidpending;  // # of event id lookups outstanding
+
+  stimer_t m_compute;  // time spent building the answer
+
+  SArena<ULRPROCESSOR_ARENA> m_arena;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -245,6 +231,8 @@ class ULRStateProcessor : public WorkProcessor {
   ULRStateProcessor(uint16_t state, ULRProcessor* ulrproc);
   virtual ~ULRStateProcessor();
 
+  SPOOL_ALLOCATOR(ULRStateProcessor)
+
   void process();
 
   uint16_t getState() { return m_state; }
@@ -289,6 +277,8 @@ class AIRProcessor : public QueueProcessor {
       s6as6d::Dictionary& dict);
   virtual ~AIRProcessor();
 
+  SPOOL_ALLOCATOR(AIRProcessor)
+
   bool phaseReady(int phase, uint32_t adjustment = 0);
   void triggerNextPhase();
   static void processNextPhase(AIRProcessor* pthis);
@@ -301,16 +291,20 @@ class AIRProcessor : public QueueProcessor {
 
  private:
   static void on_air_callback(CassFuture* f, void* data);
+  void postNextPhase();
+  void sendAnswer();
 
   void getImsiSec(SCassFuture& future);
   void updateImsi(SCassFuture& future);
 
   s6as6d::AuthenticationInformationRequestExtractor m_air;
-  SMutex m_mutex;
+  SFastMutex m_mutex;
   FDMessageAnswer m_ans;
   s6as6d::Application& m_app;
   s6as6d::Dictionary& m_dict;
   DAImsiSec m_sec;
+  uint64_t m_secgeneration;  // the cache generation m_sec was read at
+  bool m_sqnpinned;          // the SQN update pinned the cache entry
   std::string m_imsi;
   uint64_t m_uimsi;
   auc_vector_t m_vector[AUTH_MAX_EUTRAN_VECTORS];
@@ -327,6 +321,10 @@ class AIRProcessor : public QueueProcessor {
   uint32_t m_dbresult;     // query result bit mask
   uint32_t m_dbissued;     // # of queries in flight
   uint32_t m_dbevtissued;  // # of event queries in flight
+
+  stimer_t m_compute;  // time spent building the answer
+
+  SArena<AIRPROCESSOR_ARENA> m_arena;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -336,6 +334,8 @@ class AIRStateProcessor : public WorkProcessor {
   AIRStateProcessor(uint16_t state, AIRProcessor* ulrproc);
   virtual ~AIRStateProcessor();
 
+  SPOOL_ALLOCATOR(AIRStateProcessor)
+
   void process();
 
   uint16_t getState() { return m_state; }
@@ -361,4 +361,99 @@ class AIRDatabaseAction : public DatabaseAction {
   AIRProcessor& m_airproc;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+#define PURSTATE_BASE (WORKER_EVENT + 300)
+#define PURSTATE_PHASEFINAL (PURSTATE_BASE + 0)
+#define PURSTATE_PHASE1 (PURSTATE_BASE + 1)
+#define PURSTATE_PHASE2 (PURSTATE_BASE + 2)
+#define PURSTATE_PHASE3 (PURSTATE_BASE + 3)
+#define PURSTATE_PHASE4 (PURSTATE_BASE + 4)
+
+#define PURDB_GET_MMEID_IMSI 0x00000001
+#define PURDB_GET_MMEIDENTITY 0x00000002
+#define PURDB_PURGE_UE 0x00000004
+
+class PURProcessor : public QueueProcessor {
+ public:
+  PURProcessor(
+      FDMessageRequest& req, s6as6d::Application& app,
+      s6as6d::Dictionary& dict);
+  virtual ~PURProcessor();
+
+  SPOOL_ALLOCATOR(PURProcessor)
+
+  bool phaseReady(int phase, uint32_t adjustment = 0);
+  void triggerNextPhase();
+  static void processNextPhase(PURProcessor* pthis);
+
+  void phase1();
+  void phase2();
+  void phase3();
+  void phase4();
+
+  int getNextPhase() { return m_nextphase; }
+
+ private:
+  static void on_pur_callback(CassFuture* f, void* data);
+  void postNextPhase();
+  void sendAnswer(int result_code, bool experimental);
+
+  void getMmeIdFromImsi(SCassFuture& future);
+  void getMmeIdentity(SCassFuture& future);
+  void purgeUE(SCassFuture& future);
+
+  s6as6d::PurgeUeRequestExtractor m_pur;
+  SFastMutex m_mutex;
+  FDMessageAnswer m_ans;
+  s6as6d::Application& m_app;
+  s6as6d::Dictionary& m_dict;
+  std::string m_imsi;
+  int32_t m_mme_id;
+  DAMmeIdentity m_mmeid;
+
+  int m_nextphase;
+  uint32_t m_msgissued;
+  uint32_t m_dbexecuted;  // bit mask that shows which queries are complete
+  uint32_t m_dbresult;    // query result bit mask
+  uint32_t m_dbissued;    // # of queries in flight
+
+  SArena<PURPROCESSOR_ARENA> m_arena;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class PURStateProcessor : public WorkProcessor {
+ public:
+  PURStateProcessor(uint16_t state, PURProcessor* purproc);
+  virtual ~PURStateProcessor();
+
+  SPOOL_ALLOCATOR(PURStateProcessor)
+
+  void process();
+
+  uint16_t getState() { return m_state; }
+  PURProcessor* getProcessor() { return m_processor; }
+
+ private:
+  uint16_t m_state;
+  PURProcessor* m_processor;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class PURDatabaseAction : public DatabaseAction {
+ public:
+  PURDatabaseAction(uint16_t action, PURProcessor& purproc)
+      : DatabaseAction(action), m_purproc(purproc) {}
+
+  virtual ~PURDatabaseAction() {}
+
+  PURProcessor& getProcessor() { return m_purproc; }
+
+ private:
+  PURProcessor& m_purproc;
+};
+
 #endif  // __S6AS6D_IMPL_H
@@ -18,6 +18,12 @@
 #define __S6C_IMPL_H
 
 #include "s6c.h"
+#include "fdhss.h"
+#include "worker.h"
+#include "spool.h"
+
+// inline arena space for the DatabaseAction objects of a request
+#define SRRPROCESSOR_ARENA (128)
 
 class DataAccess;
 
@@ -62,4 +68,101 @@ class Application : public ApplicationBase {
 
 }  // namespace s6c
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+#define SRRSTATE_BASE (WORKER_EVENT + 400)
+#define SRRSTATE_PHASEFINAL (SRRSTATE_BASE + 0)
+#define SRRSTATE_PHASE1 (SRRSTATE_BASE + 1)
+#define SRRSTATE_PHASE2 (SRRSTATE_BASE + 2)
+#define SRRSTATE_PHASE3 (SRRSTATE_BASE + 3)
+#define SRRSTATE_PHASE4 (SRRSTATE_BASE + 4)
+
+#define SRRDB_GET_IMSI_MSISDN 0x00000001
+#define SRRDB_GET_IMSI_INFO 0x00000002
+#define SRRDB_GET_MMEIDENTITY 0x00000004
+
+class SRRProcessor : public QueueProcessor {
+ public:
+  SRRProcessor(
+      FDMessageRequest& req, s6c::Application& app, s6c::Dictionary& dict);
+  virtual ~SRRProcessor();
+
+  SPOOL_ALLOCATOR(SRRProcessor)
+
+  bool phaseReady(int phase, uint32_t adjustment = 0);
+  void triggerNextPhase();
+  static void processNextPhase(SRRProcessor* pthis);
+
+  void phase1();
+  void phase2();
+  void phase3();
+  void phase4();
+
+  int getNextPhase() { return m_nextphase; }
+
+ private:
+  static void on_srr_callback(CassFuture* f, void* data);
+  void postNextPhase();
+  void setResult(int result_code, bool experimental);
+  void sendAnswer();
+
+  void getImsiFromMsisdn(SCassFuture& future);
+  void getImsiInfo(SCassFuture& future);
+  void getMmeIdentity(SCassFuture& future);
+
+  s6c::SendRoutingInfoForSmRequestExtractor m_srr;
+  SFastMutex m_mutex;
+  FDMessageAnswer m_ans;
+  s6c::Application& m_app;
+  s6c::Dictionary& m_dict;
+  std::string m_msisdn;
+  std::string m_imsi;
+  int32_t m_sm_delivery_not_intended;
+  DAImsiInfo m_info;
+  DAMmeIdentity m_mmeid;
+
+  int m_nextphase;
+  uint32_t m_msgissued;
+  uint32_t m_dbexecuted;  // bit mask that shows which queries are complete
+  uint32_t m_dbresult;    // query result bit mask
+  uint32_t m_dbissued;    // # of queries in flight
+
+  SArena<SRRPROCESSOR_ARENA> m_arena;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class SRRStateProcessor : public WorkProcessor {
+ public:
+  SRRStateProcessor(uint16_t state, SRRProcessor* srrproc);
+  virtual ~SRRStateProcessor();
+
+  SPOOL_ALLOCATOR(SRRStateProcessor)
+
+  void process();
+
+  uint16_t getState() { return m_state; }
+  SRRProcessor* getProcessor() { return m_processor; }
+
+ private:
+  uint16_t m_state;
+  SRRProcessor* m_processor;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class SRRDatabaseAction : public DatabaseAction {
+ public:
+  SRRDatabaseAction(uint16_t action, SRRProcessor& srrproc)
+      : DatabaseAction(action), m_srrproc(srrproc) {}
+
+  virtual ~SRRDatabaseAction() {}
+
+  SRRProcessor& getProcessor() { return m_srrproc; }
+
+ private:
+  SRRProcessor& m_srrproc;
+};
+
 #endif  // __S6C_IMPL_H
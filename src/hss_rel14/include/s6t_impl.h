@@ -20,6 +20,7 @@
 #ifdef __cplusplus
 
 #include "s6t.h"
+#include "fdhss.h"
 
 class DataAccess;
 
@@ -62,6 +63,36 @@ class Application : public ApplicationBase {
   DataAccess& m_dbobj;
 };
 
+// The CIR and NIR handlers run on the HSS workers (see HSSRequestProcessor),
+// COIRcmd::process() and NIIRcmd::process() only queue them.
+class CIRProcessor : public HSSRequestProcessor {
+ public:
+  CIRProcessor(FDMessageRequest* req, Application& app)
+      : HSSRequestProcessor(req, stat_hss_cir), m_app(app) {}
+
+  SPOOL_ALLOCATOR(CIRProcessor)
+
+ protected:
+  int process(FDMessageRequest* req);
+
+ private:
+  Application& m_app;
+};
+
+class NIRProcessor : public HSSRequestProcessor {
+ public:
+  NIRProcessor(FDMessageRequest* req, Application& app)
+      : HSSRequestProcessor(req, stat_hss_nir), m_app(app) {}
+
+  SPOOL_ALLOCATOR(NIRProcessor)
+
+ protected:
+  int process(FDMessageRequest* req);
+
+ private:
+  Application& m_app;
+};
+
 }  // namespace s6t
 
 #endif
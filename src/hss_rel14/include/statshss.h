@@ -19,6 +19,16 @@
 
 #include "sstats.h"
 #include "stimer.h"
+#include "satomic.h"
+#include "timer.h"
+
+enum StatCacheType {
+  stat_cache_imsi_sec,
+  stat_cache_imsi_info,
+  stat_cache_event_config,
+  stat_cache_subscription,
+  stat_cache_max
+};
 
 class StatsHss : public SStats {
  public:
@@ -32,12 +42,20 @@ class StatsHss : public SStats {
     return *m_singleton;
   }
   void getSerializedStat(std::string& stats);
+  void getMetrics(std::string& metrics);
   void dispatchDerived(SEventThreadMessage& msg);
   void resetStats();
   void processStatResult(StatResultMessage& stat);
   void processStatAttemp(StatAttempMessage& stat);
   void processStatGetLive(StatLive& msg);
 
+  void registerCacheResult(StatCacheType type, bool hit) {
+    if (hit)
+      atomic_inc_fetch(m_cache_hits[type]);
+    else
+      atomic_inc_fetch(m_cache_misses[type]);
+  }
+
  private:
   StatsHss();
 
@@ -53,6 +71,26 @@ class StatsHss : public SStats {
   StatCollector m_srr_collector;
 
   uint32_t m_max_codes_tracked;
+
+  uint64_t m_cache_hits[stat_cache_max];
+  uint64_t m_cache_misses[stat_cache_max];
+};
+
+// Records the time between its construction and destruction as the total
+// latency of a request that is answered by its handler before it returns.
+class StatsHssTimer {
+ public:
+  StatsHssTimer(StatType type)
+      : m_type(type), m_start(STIMER_GET_CURRENT_TIME) {}
+  ~StatsHssTimer() {
+    StatsHss::singleton().registerLatency(
+        m_type, stat_phase_total,
+        (uint64_t)(STIMER_GET_CURRENT_TIME - m_start) / 1000);
+  }
+
+ private:
+  StatType m_type;
+  stimer_t m_start;
 };
 
 #endif /* HSS_SRC_STATSHSS_H_ */
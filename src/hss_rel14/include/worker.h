@@ -17,38 +17,110 @@
 #ifndef __WORKER_H
 #define __WORKER_H
 
+#include <deque>
 #include <queue>
+#include <vector>
 
 #include "ssync.h"
+#include "spool.h"
 #include "squeue.h"
 #include "sthread.h"
 #include "scassandra.h"
+#include "timer.h"
 
 #define WORKER_SHUTDOWN 99
 #define WORKER_EVENT 100
 
+#define WORKER_YIELDS 16
+
 class WorkerMessage;
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Per-worker run queue used by the work-stealing scheduler.  The owning
+// worker takes messages from the front (oldest first) and idle workers
+// steal from the back.
+class WorkerDeque {
+ public:
+  WorkerDeque() : m_mutex(true), m_size(0) {}
+  ~WorkerDeque() {}
+
+  void push(WorkerMessage* msg) {
+    SMutexLock l(m_mutex);
+    m_deque.push_back(msg);
+    __atomic_store_n(&m_size, m_deque.size(), __ATOMIC_RELEASE);
+  }
+
+  WorkerMessage* pop() { return take(true); }
+  WorkerMessage* steal() { return take(false); }
+
+ private:
+  WorkerMessage* take(bool front) {
+    // skip the lock when there is nothing to take
+    if (__atomic_load_n(&m_size, __ATOMIC_ACQUIRE) == 0) return NULL;
+
+    SMutexLock l(m_mutex);
+    if (m_deque.empty()) return NULL;
+
+    WorkerMessage* msg;
+    if (front) {
+      msg = m_deque.front();
+      m_deque.pop_front();
+    } else {
+      msg = m_deque.back();
+      m_deque.pop_back();
+    }
+    __atomic_store_n(&m_size, m_deque.size(), __ATOMIC_RELEASE);
+
+    return msg;
+  }
+
+  SFastMutex m_mutex;
+  std::deque<WorkerMessage*> m_deque;
+  size_t m_size;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 class WorkerManager {
  public:
   WorkerManager();
   ~WorkerManager();
 
-  bool init(int numWorkers);
+  bool init(int numWorkers, bool workStealing = false);
 
-  bool addWork(WorkerMessage* msg);
+  // affinity is the index of the worker that should preferably process the
+  // message, -1 for no preference; it is only used by the work-stealing
+  // scheduler and is overridden when called from a worker thread
+  bool addWork(WorkerMessage* msg, int affinity = -1);
 
-  WorkerMessage* getWork();
+  WorkerMessage* getWork(int worker);
 
   void waitForShutdown();
 
   void threadShutdown();
 
+  void bindWorker(int worker);
+  int currentWorker();
+
+  bool workStealing() { return m_workstealing; }
+
+  // the shared queue's backlog beyond its ring, see SQueue
+  uint32_t overflowDepth() { return m_queue.overflowDepth(); }
+  uint64_t spills() { return m_queue.spills(); }
+
  private:
   SMutex m_mutex;
   SEvent m_shutdown;
   SQueue m_queue;
   int m_numWorkers;
+
+  bool m_workstealing;
+  std::vector<WorkerDeque*> m_deques;
+  SSemaphore m_ready;
+  uint32_t m_next;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -71,6 +143,8 @@ class WorkerMessage : public SQueueMessage {
   WorkerMessage(uint16_t id);
   virtual ~WorkerMessage();
 
+  SPOOL_ALLOCATOR(WorkerMessage)
+
   WorkProcessor* getProcessor() { return m_processor; }
 
  private:
@@ -84,7 +158,7 @@ class WorkerMessage : public SQueueMessage {
 
 class WorkerThread : public SThread {
  public:
-  WorkerThread(WorkerManager& mgr);
+  WorkerThread(WorkerManager& mgr, int index);
   ~WorkerThread();
 
   unsigned long threadProc(void* arg);
@@ -93,61 +167,311 @@ class WorkerThread : public SThread {
   WorkerThread();
 
   WorkerManager& m_mgr;
+  int m_index;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+// adaptive limit of the QueueManager, see QueueManager::adapt()
+#define QUEUEMANAGER_WINDOW_MIN (10)
+#define QUEUEMANAGER_BACKOFF (0.9)
+#define QUEUEMANAGER_LANES (4)
+
+// Admits at most concurrent() entries at a time, the others wait in a FIFO
+// queue per lane that may be bounded as a whole with setMaxQueue().  When
+// setConcurrent() is given a range the limit follows the latency of the
+// completed entries.  Entries are started from the lanes by smooth weighted
+// round robin, a lane that already holds its share of the limit is skipped.
 class QueueManager {
  public:
-  QueueManager() : m_concurrent(10), m_active(0), m_pending(0) {}
+  QueueManager()
+      : m_mutex(true),
+        m_concurrent(10),
+        m_active(0),
+        m_pending(0),
+        m_maxqueue(0),
+        m_rejected(0),
+        m_limit(10),
+        m_min(10),
+        m_max(10),
+        m_target(0),
+        m_windowsum(0),
+        m_windowcount(0) {
+    m_lanes[0].weight = 1;
+  }
 
   ~QueueManager() {}
 
-  int setConcurrent(int concurrent) { return m_concurrent = concurrent; }
+  // the initial limit, it adapts between min and max when max is larger
+  // than min and a latency target is set
+  int setConcurrent(int concurrent, int min = 0, int max = 0) {
+    SMutexLock l(m_mutex);
+    m_min   = min > 0 && min < concurrent ? min : concurrent;
+    m_max   = max > concurrent ? max : concurrent;
+    m_limit = concurrent;
+    return m_concurrent = concurrent;
+  }
+
+  // the mean latency of the entries, in microseconds, the limit is lowered
+  // above and raised below, 0 for a fixed limit
+  void setLatencyTarget(uint64_t target) { m_target = target; }
 
-  size_t queueDepth() { return m_queue.size(); }
+  // the number of entries that may wait, 0 for no limit
+  void setMaxQueue(int maxqueue) { m_maxqueue = maxqueue; }
+
+  // a lane gets weight starts out of the total weight of the lanes that have
+  // entries waiting and holds at most share percent of the limit (but at
+  // least one entry), lane 0 has a weight of 1 and a share of 100 until set
+  void setLane(int lane, int weight, int share) {
+    SMutexLock l(m_mutex);
+    m_lanes[lane].weight = weight;
+    m_lanes[lane].share  = share;
+  }
+
+  // the most entries of a lane that may be active at once whatever the
+  // limit, 0 for no cap.  It is meant for a lane whose entries hold a worker
+  // thread until they complete, their latency is also left out of adapt()
+  // since it measures the handler rather than the backend.
+  void setLaneMax(int lane, int max) {
+    SMutexLock l(m_mutex);
+    m_lanes[lane].max = max;
+  }
+
+  int concurrent() { return __atomic_load_n(&m_concurrent, __ATOMIC_RELAXED); }
+  int active() { return __atomic_load_n(&m_active, __ATOMIC_RELAXED); }
+  int maxQueue() { return m_maxqueue; }
+  size_t queueDepth() { return __atomic_load_n(&m_pending, __ATOMIC_RELAXED); }
+
+  int active(int lane) {
+    return __atomic_load_n(&m_lanes[lane].active, __ATOMIC_RELAXED);
+  }
+  size_t queueDepth(int lane) {
+    return __atomic_load_n(&m_lanes[lane].pending, __ATOMIC_RELAXED);
+  }
+  uint64_t rejected() { return __atomic_load_n(&m_rejected, __ATOMIC_RELAXED); }
+
+  // checked before an entry is added, a full queue counts a rejection.  The
+  // bound is not exact, entries added concurrently may exceed it slightly.
+  bool full() {
+    if (m_maxqueue <= 0 ||
+        __atomic_load_n(&m_pending, __ATOMIC_RELAXED) < m_maxqueue)
+      return false;
+
+    __atomic_add_fetch(&m_rejected, 1, __ATOMIC_RELAXED);
+    return true;
+  }
 
  protected:
-  void addEntry(void* data) {
+  void addEntry(void* data, int lane = 0) {
     SMutexLock l(m_mutex);
-    m_queue.push(data);
+    m_lanes[lane].queue.push(data);
+    m_lanes[lane].pending++;
     m_pending++;
   }
 
-  void* startMessage() {
-    void* data = NULL;
-
+  // returns the next entry to start and its lane, NULL if there is none or
+  // the limit is reached
+  void* startMessage(int& lane) {
     SMutexLock l(m_mutex);
-    if (m_active < m_concurrent && m_pending > 0) {
-      data = m_queue.front();
-      m_queue.pop();
-      m_pending--;
-      m_active++;
+    if (m_active >= m_concurrent || m_pending == 0) return NULL;
+
+    Lane* next = NULL;
+    int total  = 0;
+    for (int i = 0; i < QUEUEMANAGER_LANES; i++) {
+      Lane& ln = m_lanes[i];
+      if (ln.weight <= 0 || ln.pending == 0) continue;
+
+      int budget = m_concurrent * ln.share / 100;
+      if (ln.active >= (budget > 0 ? budget : 1)) continue;
+      if (ln.max > 0 && ln.active >= ln.max) continue;
+
+      ln.current += ln.weight;
+      total += ln.weight;
+      if (!next || ln.current > next->current) {
+        next = &ln;
+        lane = i;
+      }
     }
 
+    if (!next) return NULL;
+
+    next->current -= total;
+
+    void* data = next->queue.front();
+    next->queue.pop();
+    next->pending--;
+    next->active++;
+    m_pending--;
+    m_active++;
+
     return data;
   }
 
-  void finishMessage() {
+  // latency is the number of microseconds the entry was active
+  void finishMessage(uint64_t latency, int lane = 0) {
     SMutexLock l(m_mutex);
+    m_lanes[lane].active--;
     m_active--;
+    if (m_target > 0 && m_max > m_min && m_lanes[lane].max == 0)
+      adapt(latency);
   }
 
  private:
-  SMutex m_mutex;
-  std::queue<void*> m_queue;
+  // AIMD, called with the lock held.  Once per window of about limit
+  // completions the mean latency of the window is compared to the target,
+  // above it the limit is cut by QUEUEMANAGER_BACKOFF and below it the
+  // limit grows by one, provided at least half of it is in use.
+  void adapt(uint64_t latency) {
+    int window = m_concurrent > QUEUEMANAGER_WINDOW_MIN ?
+                     m_concurrent :
+                     QUEUEMANAGER_WINDOW_MIN;
+
+    m_windowsum += latency;
+    if (++m_windowcount < window) return;
+
+    uint64_t mean = m_windowsum / m_windowcount;
+    m_windowsum   = 0;
+    m_windowcount = 0;
+
+    if (mean > m_target)
+      m_limit *= QUEUEMANAGER_BACKOFF;
+    else if (m_active >= m_limit / 2)
+      m_limit += 1;
+
+    if (m_limit < m_min) m_limit = m_min;
+    if (m_limit > m_max) m_limit = m_max;
+
+    __atomic_store_n(&m_concurrent, (int) m_limit, __ATOMIC_RELAXED);
+  }
+
+  struct Lane {
+    Lane()
+        : pending(0), active(0), weight(0), share(100), max(0), current(0) {}
+
+    std::queue<void*> queue;
+    int pending;
+    int active;
+    int weight;
+    int share;
+    int max;
+    int current;
+  };
+
+  SFastMutex m_mutex;
+  Lane m_lanes[QUEUEMANAGER_LANES];
   int m_concurrent;
   int m_active;
   int m_pending;
+  int m_maxqueue;
+  uint64_t m_rejected;
+
+  double m_limit;
+  int m_min;
+  int m_max;
+  uint64_t m_target;
+  uint64_t m_windowsum;
+  int m_windowcount;
 };
 
 class QueueProcessor {
  public:
-  QueueProcessor() {}
+  QueueProcessor()
+      : m_affinity(-1),
+        m_lane(0),
+        m_received(STIMER_GET_CURRENT_TIME),
+        m_started(0),
+        m_deadline(0),
+        m_abandoned(false) {}
   ~QueueProcessor() {}
 
   virtual void triggerNextPhase() = 0;
+
+  // the worker that last processed a phase of this request
+  int getAffinity() { return m_affinity; }
+  void setAffinity(int worker) { m_affinity = worker; }
+
+  // the QueueManager lane the request waits in
+  int getLane() { return m_lane; }
+  void setLane(int lane) { m_lane = lane; }
+
+  // when the request was handed to the HSS (STIMER_GET_CURRENT_TIME)
+  stimer_t getReceived() { return m_received; }
+
+  // when the worker queue admitted the request
+  stimer_t getStarted() { return m_started; }
+  void setStarted(stimer_t started) { m_started = started; }
+
+  // the time after which the peer no longer waits for the answer, 0 if the
+  // request has no deadline
+  stimer_t getDeadline() { return m_deadline; }
+  void setDeadline(stimer_t deadline) { m_deadline = deadline; }
+  bool expired() {
+    return m_deadline != 0 && STIMER_GET_CURRENT_TIME >= m_deadline;
+  }
+
+  // set once the request is dropped without an answer, the queries that
+  // are still to be issued for it can be skipped
+  bool isAbandoned() {
+    return __atomic_load_n(&m_abandoned, __ATOMIC_RELAXED);
+  }
+  void setAbandoned() {
+    __atomic_store_n(&m_abandoned, true, __ATOMIC_RELAXED);
+  }
+
+ private:
+  int m_affinity;
+  int m_lane;
+  stimer_t m_received;
+  stimer_t m_started;
+  stimer_t m_deadline;
+  bool m_abandoned;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+#define DB_OP_COMPLETE_EXECUTED(__executed, __item)                            \
+  { atomic_or_fetch(__executed, __item); }
+
+#define DB_OP_COMPLETE_RESULT(__result, __item, __success)                     \
+  {                                                                            \
+    if (__success)                                                             \
+      atomic_or_fetch(__result, __item);                                       \
+    else                                                                       \
+      atomic_and_fetch(__result, ~__item);                                     \
+  }
+
+#define DB_OP_COMPLETE(_item, _executed, _result, _success)                    \
+  {                                                                            \
+    DB_OP_COMPLETE_RESULT(_result, _item, _success)                            \
+    DB_OP_COMPLETE_EXECUTED(_executed, _item)                                  \
+  }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// DatabaseAction objects are allocated from the arena of the processor that
+// issued the query (new (m_arena) ...) and are released with it, they are
+// never deleted individually.
+class DatabaseAction {
+ public:
+  DatabaseAction(uint32_t action)
+      : m_action(action), m_issued(STIMER_GET_CURRENT_TIME) {}
+
+  virtual ~DatabaseAction() {}
+
+  uint16_t getAction() { return m_action; }
+
+  // the microseconds since the query was issued
+  uint64_t getElapsed() {
+    return (uint64_t)(STIMER_GET_CURRENT_TIME - m_issued) / 1000;
+  }
+
+ private:
+  DatabaseAction();
+  uint32_t m_action;
+  stimer_t m_issued;
 };
 
 #endif
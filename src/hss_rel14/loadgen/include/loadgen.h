@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LOADGEN_H
+#define __LOADGEN_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "shistogram.h"
+#include "ssync.h"
+#include "sthread.h"
+
+#include "s6as6d_impl.h"
+#include "timer.h"
+
+enum LoadCommand { lcAIR, lcULR, lcPUR, lcMAX };
+
+// An IMSI working through the configured command sequence.  Only one
+// request is outstanding for a session at a time.
+struct LoadSession {
+  std::string imsi;
+  size_t step;
+};
+
+struct LoadCommandStats {
+  LoadCommandStats()
+      : sent(0), success(0), failed(0), errors(0), reported(0) {}
+
+  uint64_t sent;     // requests sent
+  uint64_t success;  // answers with DIAMETER_SUCCESS
+  uint64_t failed;   // answers with any other result
+  uint64_t errors;   // requests that could not be sent
+  uint64_t reported;  // answers received as of the last interim report
+
+  SHistogram latency;   // request to answer in microseconds
+  SHistogram interval;  // latency since the last interim report
+
+  std::map<uint32_t, uint64_t> results;  // failed result codes, under m_mutex
+};
+
+class LoadGenerator;
+
+// Sends the requests, pacing them when a rate is configured
+class LoadDispatcher : public SThread {
+ public:
+  LoadDispatcher(LoadGenerator& lg) : m_lg(lg) {}
+
+  unsigned long threadProc(void* arg);
+
+ private:
+  LoadGenerator& m_lg;
+};
+
+class LoadGenerator {
+  friend class LoadDispatcher;
+
+ public:
+  LoadGenerator();
+  ~LoadGenerator();
+
+  bool init();
+  void uninit();
+
+  // sends requests until the duration or the number of requests is reached
+  // or stop() is called, then waits for the outstanding answers
+  void run();
+  void stop();
+
+  // called by the answer handlers on the freeDiameter threads
+  void complete(
+      LoadSession& session, LoadCommand cmd, uint32_t result,
+      int64_t latency);
+
+  static const char* commandName(LoadCommand cmd);
+
+ private:
+  bool parseCommands();
+  void nextImsi(LoadSession& session);
+  bool waitForPeer(int seconds);
+
+  void dispatch();
+  void send(LoadSession& session);
+  void ready(LoadSession& session);
+
+  void report(bool final);
+
+  FDEngine m_diameter;
+  s6as6d::Application* m_s6a;
+
+  std::vector<LoadCommand> m_commands;
+  std::vector<LoadSession> m_sessions;
+
+  uint64_t m_imsifirst;
+  uint64_t m_imsinext;
+  int m_imsilen;
+
+  SMutex m_mutex;
+  std::deque<LoadSession*> m_ready;
+  SSemaphore m_readysem;
+
+  bool m_stop;
+  uint64_t m_sent;         // total requests sent
+  uint64_t m_outstanding;  // requests waiting for an answer
+  uint64_t m_late;         // sends that fell behind the configured rate
+
+  stimer_t m_start;
+  stimer_t m_lastreport;
+  LoadCommandStats m_stats[lcMAX];
+};
+
+#endif  // #define __LOADGEN_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __OPTIONS_H
+#define __OPTIONS_H
+
+#include <stdint.h>
+#include <string>
+
+class Options {
+ public:
+  static bool parse(int argc, char** argv);
+
+  static const std::string& originHost() { return singleton().m_originhost; }
+  static const std::string& originRealm() { return singleton().m_originrealm; }
+  static const std::string& diameterConfiguration() {
+    return singleton().m_fdcfg;
+  }
+  static const std::string& hssHost() { return singleton().m_hsshost; }
+  static const std::string& hssRealm() { return singleton().m_hssrealm; }
+
+  static const std::string& imsiFirst() { return singleton().m_imsifirst; }
+  static const int imsiCount() { return singleton().m_imsicount; }
+  static const std::string& visitedPlmn() { return singleton().m_plmn; }
+  static const std::string& commands() { return singleton().m_commands; }
+  static const int vectors() { return singleton().m_vectors; }
+
+  static const int rate() { return singleton().m_rate; }
+  static const int concurrency() { return singleton().m_concurrency; }
+  static const int duration() { return singleton().m_duration; }
+  static const int requests() { return singleton().m_requests; }
+  static const int reportFrequency() { return singleton().m_reportfreq; }
+
+ private:
+  enum OptionsSelected {
+    opt_jsoncfg     = 0x00000001,
+    opt_originhost  = 0x00000002,
+    opt_originrealm = 0x00000004,
+    opt_fdcfg       = 0x00000008,
+    opt_hsshost     = 0x00000010,
+    opt_hssrealm    = 0x00000020,
+    opt_imsifirst   = 0x00000040,
+    opt_imsicount   = 0x00000080,
+    opt_plmn        = 0x00000100,
+    opt_commands    = 0x00000200,
+    opt_vectors     = 0x00000400,
+    opt_rate        = 0x00000800,
+    opt_concurrency = 0x00001000,
+    opt_duration    = 0x00002000,
+    opt_requests    = 0x00004000,
+    opt_reportfreq  = 0x00008000
+  };
+
+  static Options* m_singleton;
+  static Options& singleton() {
+    if (!m_singleton) m_singleton = new Options();
+    return *m_singleton;
+  }
+  static void help();
+
+  Options();
+  ~Options();
+
+  bool parseInputOptions(int argc, char** argv);
+  bool parseJson();
+  bool validateOptions();
+
+  int m_options;
+
+  std::string m_jsoncfg;
+  std::string m_originhost;
+  std::string m_originrealm;
+  std::string m_fdcfg;
+  std::string m_hsshost;
+  std::string m_hssrealm;
+
+  std::string m_imsifirst;
+  int m_imsicount;
+  std::string m_plmn;
+  std::string m_commands;
+  int m_vectors;
+
+  int m_rate;
+  int m_concurrency;
+  int m_duration;
+  int m_requests;
+  int m_reportfreq;
+};
+
+#endif  // #define __OPTIONS_H
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __S6AS6D_IMPL_H
+#define __S6AS6D_IMPL_H
+
+#include "s6as6d.h"
+
+class LoadGenerator;
+struct LoadSession;
+
+namespace s6as6d {
+
+// The MME side of the s6a/s6d application.  Sends the requests generated by
+// the LoadGenerator and answers the requests the HSS may send back.
+class Application : public ApplicationBase {
+ public:
+  Application(LoadGenerator& lg);
+  ~Application();
+
+  LoadGenerator& loadGenerator() { return m_lg; }
+
+  bool sendAUIRreq(LoadSession& session);
+  bool sendUPLRreq(LoadSession& session);
+  bool sendPUURreq(LoadSession& session);
+
+ private:
+  void registerHandlers();
+
+  CALRcmd m_cmd_calr;
+  INSDRcmd m_cmd_insdr;
+  DESDRcmd m_cmd_desdr;
+
+  LoadGenerator& m_lg;
+  uint8_t m_plmn[3];
+};
+
+// Requests that carry the load session so the answer can be attributed
+class LoadAUIRreq : public AUIRreq {
+ public:
+  LoadAUIRreq(Application& app, LoadSession& session)
+      : AUIRreq(app), m_session(session) {}
+
+  void processAnswer(FDMessageAnswer& ans);
+
+ private:
+  LoadSession& m_session;
+};
+
+class LoadUPLRreq : public UPLRreq {
+ public:
+  LoadUPLRreq(Application& app, LoadSession& session)
+      : UPLRreq(app), m_session(session) {}
+
+  void processAnswer(FDMessageAnswer& ans);
+
+ private:
+  LoadSession& m_session;
+};
+
+class LoadPUURreq : public PUURreq {
+ public:
+  LoadPUURreq(Application& app, LoadSession& session)
+      : PUURreq(app), m_session(session) {}
+
+  void processAnswer(FDMessageAnswer& ans);
+
+ private:
+  LoadSession& m_session;
+};
+
+}  // namespace s6as6d
+
+#endif  // __S6AS6D_IMPL_H
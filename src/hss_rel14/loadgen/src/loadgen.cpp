@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <iostream>
+#include <sstream>
+
+#include "satomic.h"
+#include "sutility.h"
+
+#include "loadgen.h"
+#include "options.h"
+
+// the dispatcher gives up on catching up with the configured rate once it
+// falls this far behind, rather than sending a burst
+#define LOADGEN_MAX_LAG (10000000)  // 10ms
+
+// how long to wait for the outstanding answers once the run is over
+#define LOADGEN_DRAIN_TIMEOUT (5000)  // ms
+
+#define LOADGEN_PEER_TIMEOUT (30)  // seconds
+
+unsigned long LoadDispatcher::threadProc(void* arg) {
+  m_lg.dispatch();
+  return 0;
+}
+
+LoadGenerator::LoadGenerator()
+    : m_s6a(NULL),
+      m_imsifirst(0),
+      m_imsinext(0),
+      m_imsilen(0),
+      m_stop(false),
+      m_sent(0),
+      m_outstanding(0),
+      m_late(0),
+      m_start(0),
+      m_lastreport(0) {
+  m_readysem.init(0, 0);
+}
+
+LoadGenerator::~LoadGenerator() {}
+
+const char* LoadGenerator::commandName(LoadCommand cmd) {
+  switch (cmd) {
+    case lcAIR:
+      return "AIR";
+    case lcULR:
+      return "ULR";
+    case lcPUR:
+      return "PUR";
+    default:
+      return "???";
+  }
+}
+
+bool LoadGenerator::parseCommands() {
+  std::stringstream ss(Options::commands());
+  std::string cmd;
+
+  m_commands.clear();
+
+  while (std::getline(ss, cmd, ',')) {
+    if (cmd == "air" || cmd == "AIR")
+      m_commands.push_back(lcAIR);
+    else if (cmd == "ulr" || cmd == "ULR")
+      m_commands.push_back(lcULR);
+    else if (cmd == "pur" || cmd == "PUR")
+      m_commands.push_back(lcPUR);
+    else {
+      std::cout << "Unrecognized command [" << cmd << "]" << std::endl;
+      return false;
+    }
+  }
+
+  if (m_commands.empty()) {
+    std::cout << "No commands configured" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool LoadGenerator::init() {
+  if (!parseCommands()) return false;
+
+  m_imsifirst = strtoull(Options::imsiFirst().c_str(), NULL, 10);
+  m_imsilen   = Options::imsiFirst().size();
+
+  // set the diameter configuration file
+  m_diameter.setConfigFile(Options::diameterConfiguration());
+
+  // initialize diameter
+  if (!m_diameter.init()) return false;
+
+  try {
+    m_s6a = new s6as6d::Application(*this);
+    FDDictionaryEntryVendor vnd3gpp(m_s6a->getDict().app());
+    m_diameter.advertiseSupport(m_s6a->getDict().app(), vnd3gpp, 1, 0);
+  } catch (FDException& e) {
+    std::cout << "FDException initializing the s6a interface - " << e.what()
+              << std::endl;
+    return false;
+  }
+
+  if (!m_diameter.start()) return false;
+
+  return waitForPeer(LOADGEN_PEER_TIMEOUT);
+}
+
+void LoadGenerator::uninit() {
+  m_diameter.uninit();
+
+  if (m_s6a) {
+    delete m_s6a;
+    m_s6a = NULL;
+  }
+}
+
+bool LoadGenerator::waitForPeer(int seconds) {
+  FDPeer peer;
+  peer.setDiameterId((DiamId_t) Options::hssHost().c_str());
+
+  std::cout << "Waiting for the connection to " << Options::hssHost()
+            << std::endl;
+
+  for (int i = 0; i < seconds * 10; i++) {
+    try {
+      if (peer.isOpen()) return true;
+    } catch (FDException& e) {
+      // the peer is not known until freeDiameter has read the configuration
+    }
+    SThread::sleep(100);
+  }
+
+  std::cout << "Timed out waiting for the connection to " << Options::hssHost()
+            << std::endl;
+
+  return false;
+}
+
+void LoadGenerator::nextImsi(LoadSession& session) {
+  char buf[32];
+  uint64_t idx = atomic_fetch_inc(m_imsinext) % Options::imsiCount();
+
+  snprintf(
+      buf, sizeof(buf), "%0*llu", m_imsilen,
+      (unsigned long long) (m_imsifirst + idx));
+
+  session.imsi = buf;
+  session.step = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+void LoadGenerator::run() {
+  LoadDispatcher dispatcher(*this);
+
+  m_sessions.resize(Options::concurrency());
+  for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+    nextImsi(*it);
+    ready(*it);
+  }
+
+  std::cout << "Sending " << Options::commands() << " for "
+            << Options::imsiCount() << " IMSI's starting at "
+            << Options::imsiFirst() << ", concurrency "
+            << Options::concurrency() << ", rate ";
+  if (Options::rate())
+    std::cout << Options::rate() << "/s";
+  else
+    std::cout << "unlimited";
+  std::cout << std::endl;
+
+  m_start = m_lastreport = STIMER_GET_CURRENT_TIME;
+
+  stimer_t end = m_start + ((stimer_t) Options::duration()) * 1000000000;
+  stimer_t freq = ((stimer_t) Options::reportFrequency()) * 1000000000;
+
+  dispatcher.init(NULL);
+
+  while (!__atomic_load_n(&m_stop, __ATOMIC_ACQUIRE)) {
+    SThread::sleep(100);
+
+    stimer_t now = STIMER_GET_CURRENT_TIME;
+
+    if (now >= end) stop();
+    if (now - m_lastreport >= freq) report(false);
+  }
+
+  dispatcher.join();
+
+  // give the answers still in flight a chance to arrive
+  for (int i = 0; i < LOADGEN_DRAIN_TIMEOUT / 100; i++) {
+    if (__atomic_load_n(&m_outstanding, __ATOMIC_ACQUIRE) == 0) break;
+    SThread::sleep(100);
+  }
+
+  report(true);
+}
+
+void LoadGenerator::stop() {
+  __atomic_store_n(&m_stop, true, __ATOMIC_RELEASE);
+
+  // wake the dispatcher if it is waiting for a session
+  m_readysem.increment();
+}
+
+void LoadGenerator::dispatch() {
+  stimer_t interval = Options::rate() ? 1000000000 / Options::rate() : 0;
+  stimer_t next     = STIMER_GET_CURRENT_TIME;
+  uint64_t limit    = Options::requests();
+
+  while (!__atomic_load_n(&m_stop, __ATOMIC_ACQUIRE)) {
+    if (interval) {
+      stimer_t now = STIMER_GET_CURRENT_TIME;
+      if (next > now) {
+        struct timespec ts;
+        ts.tv_sec  = (next - now) / 1000000000;
+        ts.tv_nsec = (next - now) % 1000000000;
+        nanosleep(&ts, NULL);
+      }
+    }
+
+    m_readysem.decrement();
+
+    if (__atomic_load_n(&m_stop, __ATOMIC_ACQUIRE)) break;
+
+    LoadSession* session;
+    {
+      SMutexLock l(m_mutex);
+      session = m_ready.front();
+      m_ready.pop_front();
+    }
+
+    if (interval) {
+      // no session was free when the request was due, either the
+      // concurrency is too low for the rate or the HSS is falling behind
+      stimer_t now = STIMER_GET_CURRENT_TIME;
+      if (now - next > interval) atomic_inc_fetch(m_late);
+      next = now - next > LOADGEN_MAX_LAG ? now + interval : next + interval;
+    }
+
+    send(*session);
+
+    if (limit && __atomic_load_n(&m_sent, __ATOMIC_RELAXED) >= limit) stop();
+  }
+}
+
+void LoadGenerator::send(LoadSession& session) {
+  LoadCommand cmd = m_commands[session.step];
+  bool sent       = false;
+
+  atomic_inc_fetch(m_outstanding);
+  atomic_inc_fetch(m_sent);
+  atomic_inc_fetch(m_stats[cmd].sent);
+
+  switch (cmd) {
+    case lcAIR:
+      sent = m_s6a->sendAUIRreq(session);
+      break;
+    case lcULR:
+      sent = m_s6a->sendUPLRreq(session);
+      break;
+    case lcPUR:
+      sent = m_s6a->sendPUURreq(session);
+      break;
+    default:
+      break;
+  }
+
+  if (!sent) {
+    atomic_dec_fetch(m_outstanding);
+    atomic_inc_fetch(m_stats[cmd].errors);
+
+    // back off so that a lost connection does not turn into a busy loop
+    SThread::sleep(1);
+    ready(session);
+  }
+}
+
+void LoadGenerator::ready(LoadSession& session) {
+  {
+    SMutexLock l(m_mutex);
+    m_ready.push_back(&session);
+  }
+  m_readysem.increment();
+}
+
+void LoadGenerator::complete(
+    LoadSession& session, LoadCommand cmd, uint32_t result, int64_t latency) {
+  LoadCommandStats& stats = m_stats[cmd];
+
+  stats.latency.record(latency);
+  stats.interval.record(latency);
+
+  if (result == ER_DIAMETER_SUCCESS) {
+    atomic_inc_fetch(stats.success);
+  } else {
+    atomic_inc_fetch(stats.failed);
+    SMutexLock l(m_mutex);
+    stats.results[result]++;
+  }
+
+  // move on to the next command, or the next IMSI at the end of the sequence
+  if (++session.step >= m_commands.size()) nextImsi(session);
+
+  if (!__atomic_load_n(&m_stop, __ATOMIC_ACQUIRE)) ready(session);
+
+  atomic_dec_fetch(m_outstanding);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+void LoadGenerator::report(bool final) {
+  stimer_t now     = STIMER_GET_CURRENT_TIME;
+  double elapsed   = (now - (final ? m_start : m_lastreport)) / 1000000000.0;
+  uint64_t total   = 0;
+  uint64_t answers = 0;
+
+  if (elapsed <= 0) elapsed = 1;
+
+  printf(
+      "\n%s %.1fs\n", final ? "Final report, elapsed" : "Interim report at",
+      (now - m_start) / 1000000000.0);
+  printf(
+      "%-4s %10s %10s %10s %8s %10s %10s %10s %10s %10s\n", "cmd", "sent",
+      "success", "failed", "errors", "tps", "p50(us)", "p99(us)", "p999(us)",
+      "max(us)");
+
+  for (int i = 0; i < lcMAX; i++) {
+    LoadCommandStats& s = m_stats[i];
+    SHistogram& h       = final ? s.latency : s.interval;
+    uint64_t success    = __atomic_load_n(&s.success, __ATOMIC_RELAXED);
+    uint64_t failed     = __atomic_load_n(&s.failed, __ATOMIC_RELAXED);
+    uint64_t answered   = success + failed;
+
+    if (__atomic_load_n(&s.sent, __ATOMIC_RELAXED) == 0) continue;
+
+    printf(
+        "%-4s %10llu %10llu %10llu %8llu %10.1f %10llu %10llu %10llu %10llu\n",
+        commandName((LoadCommand) i), (unsigned long long) s.sent,
+        (unsigned long long) success, (unsigned long long) failed,
+        (unsigned long long) s.errors,
+        (final ? answered : answered - s.reported) / elapsed,
+        (unsigned long long) h.percentile(50.0),
+        (unsigned long long) h.percentile(99.0),
+        (unsigned long long) h.percentile(99.9), (unsigned long long) h.max());
+
+    total += answered;
+    answers += final ? answered : answered - s.reported;
+    s.reported = answered;
+
+    // the interval histogram is reset while the answers keep coming in,
+    // a few samples may land on either side of the boundary
+    if (!final) s.interval.reset();
+  }
+
+  printf(
+      "all  %llu answers, %.1f tps", (unsigned long long) total,
+      answers / elapsed);
+  if (Options::rate())
+    printf(", %llu late sends", (unsigned long long) m_late);
+  printf("\n");
+
+  if (final) {
+    SMutexLock l(m_mutex);
+    for (int i = 0; i < lcMAX; i++) {
+      for (auto it = m_stats[i].results.begin();
+           it != m_stats[i].results.end(); ++it)
+        printf(
+            "%-4s result %u returned %llu times\n",
+            commandName((LoadCommand) i), it->first,
+            (unsigned long long) it->second);
+    }
+  }
+
+  fflush(stdout);
+
+  m_lastreport = now;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <signal.h>
+#include <iostream>
+
+#include "fd.h"
+#include "serror.h"
+
+#include "loadgen.h"
+#include "options.h"
+
+LoadGenerator loadgen;
+
+void handler(int signo, siginfo_t* pinfo, void* pcontext) {
+  // end the run early, the final report is still produced
+  loadgen.stop();
+}
+
+void initHandler() {
+  struct sigaction sa;
+
+  sa.sa_flags     = SA_SIGINFO;
+  sa.sa_sigaction = handler;
+  sigemptyset(&sa.sa_mask);
+  int signo = SIGINT;
+  if (sigaction(signo, &sa, NULL) == -1)
+    SError::throwRuntimeExceptionWithErrno("Unable to register signal handler");
+}
+
+int main(int argc, char** argv) {
+  if (!Options::parse(argc, argv)) {
+    std::cout << "Options::parse() failed" << std::endl;
+    return 1;
+  }
+
+  // initialize the signal handler
+  initHandler();
+
+  // connect to the HSS
+  if (!loadgen.init()) return 1;
+
+  loadgen.run();
+
+  loadgen.uninit();
+
+  return 0;
+}
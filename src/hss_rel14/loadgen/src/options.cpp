@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <freeDiameter/freeDiameter-host.h>
+
+#include "options.h"
+
+#define RAPIDJSON_NAMESPACE lgrapidjson
+#include "rapidjson/filereadstream.h"
+#include "rapidjson/document.h"
+
+Options* Options::m_singleton = NULL;
+
+Options::Options()
+    : m_options(0),
+      m_imsifirst("001010000000001"),
+      m_imsicount(200),
+      m_commands("air,ulr"),
+      m_vectors(1),
+      m_rate(0),
+      m_concurrency(100),
+      m_duration(30),
+      m_requests(0),
+      m_reportfreq(5) {}
+
+Options::~Options() {}
+
+void Options::help() {
+  std::cout
+      << std::endl
+      << "Usage:  loadgen -j jsoncfg [OPTIONS]..." << std::endl
+      << "  -h, --help                   Print help and exit" << std::endl
+      << "  -j, --jsoncfg filename       The JSON configuration file."
+      << std::endl
+      << "  -s, --originhost host        "
+         "The diameter origin host (a provisioned MME)."
+      << std::endl
+      << "  -r, --originrealm realm      The diameter origin realm."
+      << std::endl
+      << "  -c, --fdcfg filename         Read the freeDiameter configuration "
+         "from this file"
+      << std::endl
+      << "                               instead of the default location "
+         "(" DEFAULT_CONF_PATH "/" FD_DEFAULT_CONF_FILENAME ")."
+      << std::endl
+      << "  -a, --hsshost host           The diameter host for the HSS."
+      << std::endl
+      << "  -b, --hssrealm realm         The diameter realm for the HSS."
+      << std::endl
+      << "  -i, --imsifirst imsi         The first IMSI of the range."
+      << std::endl
+      << "  -u, --imsicount number       The number of IMSI's in the range."
+      << std::endl
+      << "  -p, --plmn plmn              The visited PLMN (MCC+MNC digits)."
+      << std::endl
+      << "  -m, --commands list          "
+         "The commands sent for each IMSI (air,ulr,pur)."
+      << std::endl
+      << "  -v, --vectors number         "
+         "The number of vectors requested by an AIR."
+      << std::endl
+      << "  -t, --rate rate              "
+         "The request rate per second, 0 for no limit."
+      << std::endl
+      << "  -o, --concurrency number     "
+         "The number of IMSI's with a request in flight."
+      << std::endl
+      << "  -d, --duration seconds       The length of the run in seconds."
+      << std::endl
+      << "  -e, --requests number        "
+         "Stop after this many requests, 0 for no limit."
+      << std::endl
+      << "  -f, --reportfreq seconds     "
+         "The interim report frequency in seconds."
+      << std::endl;
+}
+
+bool Options::parse(int argc, char** argv) {
+  bool ret = true;
+
+  ret = singleton().parseInputOptions(argc, argv);
+
+  if (ret && !singleton().m_jsoncfg.empty()) {
+    ret &= singleton().parseJson();
+  }
+
+  ret &= singleton().validateOptions();
+
+  return ret;
+}
+
+bool Options::parseInputOptions(int argc, char** argv) {
+  int c;
+  int option_index = 0;
+  bool result      = true;
+
+  struct option long_options[] = {
+      {"help", no_argument, NULL, 'h'},
+      {"jsoncfg", required_argument, NULL, 'j'},
+      {"originhost", required_argument, NULL, 's'},
+      {"originrealm", required_argument, NULL, 'r'},
+      {"fdcfg", required_argument, NULL, 'c'},
+      {"hsshost", required_argument, NULL, 'a'},
+      {"hssrealm", required_argument, NULL, 'b'},
+      {"imsifirst", required_argument, NULL, 'i'},
+      {"imsicount", required_argument, NULL, 'u'},
+      {"plmn", required_argument, NULL, 'p'},
+      {"commands", required_argument, NULL, 'm'},
+      {"vectors", required_argument, NULL, 'v'},
+      {"rate", required_argument, NULL, 't'},
+      {"concurrency", required_argument, NULL, 'o'},
+      {"duration", required_argument, NULL, 'd'},
+      {"requests", required_argument, NULL, 'e'},
+      {"reportfreq", required_argument, NULL, 'f'},
+      {NULL, 0, NULL, 0}};
+
+  // Loop on arguments
+  while (1) {
+    c = getopt_long(
+        argc, argv, "hj:s:r:c:a:b:i:u:p:m:v:t:o:d:e:f:", long_options,
+        &option_index);
+    if (c == -1) break;  // Exit from the loop.
+
+    switch (c) {
+      case 'h': {
+        help();
+        exit(0);
+      }
+      case 'j': {
+        m_jsoncfg = optarg;
+        m_options |= opt_jsoncfg;
+        break;
+      }
+      case 's': {
+        m_originhost = optarg;
+        m_options |= opt_originhost;
+        break;
+      }
+      case 'r': {
+        m_originrealm = optarg;
+        m_options |= opt_originrealm;
+        break;
+      }
+      case 'c': {
+        m_fdcfg = optarg;
+        m_options |= opt_fdcfg;
+        break;
+      }
+      case 'a': {
+        m_hsshost = optarg;
+        m_options |= opt_hsshost;
+        break;
+      }
+      case 'b': {
+        m_hssrealm = optarg;
+        m_options |= opt_hssrealm;
+        break;
+      }
+      case 'i': {
+        m_imsifirst = optarg;
+        m_options |= opt_imsifirst;
+        break;
+      }
+      case 'u': {
+        m_imsicount = atoi(optarg);
+        m_options |= opt_imsicount;
+        break;
+      }
+      case 'p': {
+        m_plmn = optarg;
+        m_options |= opt_plmn;
+        break;
+      }
+      case 'm': {
+        m_commands = optarg;
+        m_options |= opt_commands;
+        break;
+      }
+      case 'v': {
+        m_vectors = atoi(optarg);
+        m_options |= opt_vectors;
+        break;
+      }
+      case 't': {
+        m_rate = atoi(optarg);
+        m_options |= opt_rate;
+        break;
+      }
+      case 'o': {
+        m_concurrency = atoi(optarg);
+        m_options |= opt_concurrency;
+        break;
+      }
+      case 'd': {
+        m_duration = atoi(optarg);
+        m_options |= opt_duration;
+        break;
+      }
+      case 'e': {
+        m_requests = atoi(optarg);
+        m_options |= opt_requests;
+        break;
+      }
+      case 'f': {
+        m_reportfreq = atoi(optarg);
+        m_options |= opt_reportfreq;
+        break;
+      }
+      case '?': {
+        // getopt_long() has already reported the problem
+        result = false;
+        break;
+      }
+      default: {
+        std::cout << "Unrecognized option [" << c << "]" << std::endl;
+        result = false;
+      }
+    }
+  }
+
+  return result;
+}
+
+bool Options::parseJson() {
+  char buf[2048];
+
+  FILE* fp = fopen(m_jsoncfg.c_str(), "r");
+  if (!fp) {
+    std::cout << "Unable to open the json config file [" << m_jsoncfg << "]"
+              << std::endl;
+    return false;
+  }
+  RAPIDJSON_NAMESPACE::FileReadStream is(fp, buf, sizeof(buf));
+  RAPIDJSON_NAMESPACE::Document doc;
+  doc.ParseStream<0>(is);
+  fclose(fp);
+
+  if (!doc.IsObject()) {
+    std::cout << "Error parsing the json config file [" << m_jsoncfg << "]"
+              << std::endl;
+    return false;
+  }
+
+  if (doc.HasMember("common")) {
+    const RAPIDJSON_NAMESPACE::Value& commonSection = doc["common"];
+    if (!(m_options & opt_originhost) &&
+        commonSection.HasMember("originhost")) {
+      if (!commonSection["originhost"].IsString()) {
+        std::cout << "Error parsing json value: [originhost]" << std::endl;
+        return false;
+      }
+      m_originhost = commonSection["originhost"].GetString();
+      m_options |= opt_originhost;
+    }
+    if (!(m_options & opt_originrealm) &&
+        commonSection.HasMember("originrealm")) {
+      if (!commonSection["originrealm"].IsString()) {
+        std::cout << "Error parsing json value: [originrealm]" << std::endl;
+        return false;
+      }
+      m_originrealm = commonSection["originrealm"].GetString();
+      m_options |= opt_originrealm;
+    }
+    if (!(m_options & opt_fdcfg) && commonSection.HasMember("fdcfg")) {
+      if (!commonSection["fdcfg"].IsString()) {
+        std::cout << "Error parsing json value: [fdcfg]" << std::endl;
+        return false;
+      }
+      m_fdcfg = commonSection["fdcfg"].GetString();
+      m_options |= opt_fdcfg;
+    }
+  }
+
+  if (doc.HasMember("loadgen")) {
+    const RAPIDJSON_NAMESPACE::Value& lgSection = doc["loadgen"];
+    if (!(m_options & opt_hsshost) && lgSection.HasMember("hsshost")) {
+      if (!lgSection["hsshost"].IsString()) {
+        std::cout << "Error parsing json value: [hsshost]" << std::endl;
+        return false;
+      }
+      m_hsshost = lgSection["hsshost"].GetString();
+      m_options |= opt_hsshost;
+    }
+    if (!(m_options & opt_hssrealm) && lgSection.HasMember("hssrealm")) {
+      if (!lgSection["hssrealm"].IsString()) {
+        std::cout << "Error parsing json value: [hssrealm]" << std::endl;
+        return false;
+      }
+      m_hssrealm = lgSection["hssrealm"].GetString();
+      m_options |= opt_hssrealm;
+    }
+    if (!(m_options & opt_imsifirst) && lgSection.HasMember("imsifirst")) {
+      if (!lgSection["imsifirst"].IsString()) {
+        std::cout << "Error parsing json value: [imsifirst]" << std::endl;
+        return false;
+      }
+      m_imsifirst = lgSection["imsifirst"].GetString();
+      m_options |= opt_imsifirst;
+    }
+    if (!(m_options & opt_imsicount) && lgSection.HasMember("imsicount")) {
+      if (!lgSection["imsicount"].IsInt()) {
+        std::cout << "Error parsing json value: [imsicount]" << std::endl;
+        return false;
+      }
+      m_imsicount = lgSection["imsicount"].GetInt();
+      m_options |= opt_imsicount;
+    }
+    if (!(m_options & opt_plmn) && lgSection.HasMember("plmn")) {
+      if (!lgSection["plmn"].IsString()) {
+        std::cout << "Error parsing json value: [plmn]" << std::endl;
+        return false;
+      }
+      m_plmn = lgSection["plmn"].GetString();
+      m_options |= opt_plmn;
+    }
+    if (!(m_options & opt_commands) && lgSection.HasMember("commands")) {
+      if (!lgSection["commands"].IsString()) {
+        std::cout << "Error parsing json value: [commands]" << std::endl;
+        return false;
+      }
+      m_commands = lgSection["commands"].GetString();
+      m_options |= opt_commands;
+    }
+    if (!(m_options & opt_vectors) && lgSection.HasMember("vectors")) {
+      if (!lgSection["vectors"].IsInt()) {
+        std::cout << "Error parsing json value: [vectors]" << std::endl;
+        return false;
+      }
+      m_vectors = lgSection["vectors"].GetInt();
+      m_options |= opt_vectors;
+    }
+    if (!(m_options & opt_rate) && lgSection.HasMember("rate")) {
+      if (!lgSection["rate"].IsInt()) {
+        std::cout << "Error parsing json value: [rate]" << std::endl;
+        return false;
+      }
+      m_rate = lgSection["rate"].GetInt();
+      m_options |= opt_rate;
+    }
+    if (!(m_options & opt_concurrency) &&
+        lgSection.HasMember("concurrency")) {
+      if (!lgSection["concurrency"].IsInt()) {
+        std::cout << "Error parsing json value: [concurrency]" << std::endl;
+        return false;
+      }
+      m_concurrency = lgSection["concurrency"].GetInt();
+      m_options |= opt_concurrency;
+    }
+    if (!(m_options & opt_duration) && lgSection.HasMember("duration")) {
+      if (!lgSection["duration"].IsInt()) {
+        std::cout << "Error parsing json value: [duration]" << std::endl;
+        return false;
+      }
+      m_duration = lgSection["duration"].GetInt();
+      m_options |= opt_duration;
+    }
+    if (!(m_options & opt_requests) && lgSection.HasMember("requests")) {
+      if (!lgSection["requests"].IsInt()) {
+        std::cout << "Error parsing json value: [requests]" << std::endl;
+        return false;
+      }
+      m_requests = lgSection["requests"].GetInt();
+      m_options |= opt_requests;
+    }
+    if (!(m_options & opt_reportfreq) &&
+        lgSection.HasMember("reportfreq")) {
+      if (!lgSection["reportfreq"].IsInt()) {
+        std::cout << "Error parsing json value: [reportfreq]" << std::endl;
+        return false;
+      }
+      m_reportfreq = lgSection["reportfreq"].GetInt();
+      m_options |= opt_reportfreq;
+    }
+  }
+
+  return true;
+}
+
+bool Options::validateOptions() {
+  bool result = (m_options & opt_originhost) && (m_options & opt_originrealm) &&
+                (m_options & opt_fdcfg) && (m_options & opt_hsshost) &&
+                (m_options & opt_hssrealm);
+
+  if (!result) {
+    std::cout << "The origin host/realm, HSS host/realm and the diameter "
+                 "configuration file are required"
+              << std::endl;
+    return false;
+  }
+
+  if (m_imsifirst.empty() || m_imsifirst.size() > 15 ||
+      m_imsifirst.find_first_not_of("0123456789") != std::string::npos) {
+    std::cout << "Invalid first IMSI [" << m_imsifirst << "]" << std::endl;
+    return false;
+  }
+
+  // the visited PLMN defaults to the MCC and a 2 digit MNC from the IMSI
+  if (m_plmn.empty()) m_plmn = m_imsifirst.substr(0, 5);
+
+  if ((m_plmn.size() != 5 && m_plmn.size() != 6) ||
+      m_plmn.find_first_not_of("0123456789") != std::string::npos) {
+    std::cout << "Invalid visited PLMN [" << m_plmn << "]" << std::endl;
+    return false;
+  }
+
+  if (m_imsicount < 1 || m_concurrency < 1 || m_vectors < 1 ||
+      m_rate < 0 || m_duration < 1 || m_requests < 0 || m_reportfreq < 1) {
+    std::cout << "The IMSI count, concurrency, vectors, duration and report "
+                 "frequency must be positive, the rate and number of "
+                 "requests can not be negative"
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
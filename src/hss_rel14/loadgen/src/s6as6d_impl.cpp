@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <iostream>
+
+#include "sutility.h"
+
+#include "loadgen.h"
+#include "options.h"
+#include "s6as6d_impl.h"
+
+#define ULR_FLAGS_S6AS6D_INDICATOR (1 << 1)
+#define ULR_FLAGS_INITIAL_ATTACH (1 << 5)
+
+#define RAT_TYPE_EUTRAN (1004)
+
+namespace s6as6d {
+
+// encodes the MCC and MNC digits as a 3 byte PLMN identity (TS 24.008)
+static void encodePlmn(const std::string& plmn, uint8_t* buf) {
+  uint8_t d[6];
+
+  for (size_t i = 0; i < plmn.size() && i < sizeof(d); i++)
+    d[i] = plmn[i] - '0';
+
+  buf[0] = (d[1] << 4) | d[0];
+  buf[1] = ((plmn.size() == 6 ? d[5] : 0x0f) << 4) | d[2];
+  buf[2] = (d[4] << 4) | d[3];
+}
+
+// returns the Result-Code or the Experimental-Result-Code of an answer
+static uint32_t resultCode(
+    FDExtractorAvp& result_code, ExperimentalResultExtractor& experimental) {
+  uint32_t u32 = 0;
+
+  if (!result_code.get(u32))
+    experimental.experimental_result_code.get(u32);
+
+  return u32;
+}
+
+Application::Application(LoadGenerator& lg)
+    : ApplicationBase(),
+      m_cmd_calr(*this),
+      m_cmd_insdr(*this),
+      m_cmd_desdr(*this),
+      m_lg(lg) {
+  encodePlmn(Options::visitedPlmn(), m_plmn);
+  registerHandlers();
+}
+
+Application::~Application() {}
+
+void Application::registerHandlers() {
+  // the HSS may send these to the MME, answer them so that the HSS does
+  // not time out and retry while under load
+  std::cout << "Registering s6as6d command handlers" << std::endl;
+  registerHandler(m_cmd_calr);
+  registerHandler(m_cmd_insdr);
+  registerHandler(m_cmd_desdr);
+}
+
+// the common header of an MME originated request
+static void addHeader(
+    FDMessageRequest& s, Dictionary& dict, const std::string& sessionid,
+    const std::string& imsi) {
+  s.add(dict.avpSessionId(), sessionid);
+  s.add(dict.avpAuthSessionState(), 1);  // NO_STATE_MAINTAINED
+  s.addOrigin();
+  s.add(dict.avpDestinationHost(), Options::hssHost());
+  s.add(dict.avpDestinationRealm(), Options::hssRealm());
+  s.add(dict.avpUserName(), imsi);
+}
+
+bool Application::sendAUIRreq(LoadSession& session) {
+  LoadAUIRreq* s = new LoadAUIRreq(*this, session);
+
+  try {
+    addHeader(*s, getDict(), s->getSessionId(), session.imsi);
+
+    FDAvp reai(getDict().avpRequestedEutranAuthenticationInfo());
+    reai.add(
+        getDict().avpNumberOfRequestedVectors(), (uint32_t) Options::vectors());
+    reai.add(getDict().avpImmediateResponsePreferred(), (uint32_t) 0);
+    s->add(reai);
+
+    s->add(getDict().avpVisitedPlmnId(), m_plmn, sizeof(m_plmn));
+
+    s->send();
+  } catch (FDException& ex) {
+    std::cout << SUtility::currentTime() << " - EXCEPTION - " << ex.what()
+              << std::endl;
+    delete s;
+    s = NULL;
+  }
+
+  // DO NOT free the request, it is deleted by the framework after the
+  // answer is received and processed
+  return s != NULL;
+}
+
+bool Application::sendUPLRreq(LoadSession& session) {
+  LoadUPLRreq* s = new LoadUPLRreq(*this, session);
+
+  try {
+    addHeader(*s, getDict(), s->getSessionId(), session.imsi);
+
+    s->add(getDict().avpRatType(), RAT_TYPE_EUTRAN);
+    s->add(
+        getDict().avpUlrFlags(),
+        (uint32_t)(ULR_FLAGS_S6AS6D_INDICATOR | ULR_FLAGS_INITIAL_ATTACH));
+    s->add(getDict().avpVisitedPlmnId(), m_plmn, sizeof(m_plmn));
+
+    s->send();
+  } catch (FDException& ex) {
+    std::cout << SUtility::currentTime() << " - EXCEPTION - " << ex.what()
+              << std::endl;
+    delete s;
+    s = NULL;
+  }
+
+  return s != NULL;
+}
+
+bool Application::sendPUURreq(LoadSession& session) {
+  LoadPUURreq* s = new LoadPUURreq(*this, session);
+
+  try {
+    addHeader(*s, getDict(), s->getSessionId(), session.imsi);
+    s->send();
+  } catch (FDException& ex) {
+    std::cout << SUtility::currentTime() << " - EXCEPTION - " << ex.what()
+              << std::endl;
+    delete s;
+    s = NULL;
+  }
+
+  return s != NULL;
+}
+
+void LoadAUIRreq::processAnswer(FDMessageAnswer& ans) {
+  int64_t latency = m_timer.MicroSeconds();
+  AuthenticationInformationAnswerExtractor aia(
+      ans, getApplication().getDict());
+
+  getApplication().loadGenerator().complete(
+      m_session, lcAIR, resultCode(aia.result_code, aia.experimental_result),
+      latency);
+}
+
+void LoadUPLRreq::processAnswer(FDMessageAnswer& ans) {
+  int64_t latency = m_timer.MicroSeconds();
+  UpdateLocationAnswerExtractor ula(ans, getApplication().getDict());
+
+  getApplication().loadGenerator().complete(
+      m_session, lcULR, resultCode(ula.result_code, ula.experimental_result),
+      latency);
+}
+
+void LoadPUURreq::processAnswer(FDMessageAnswer& ans) {
+  int64_t latency = m_timer.MicroSeconds();
+  PurgeUeAnswerExtractor pua(ans, getApplication().getDict());
+
+  getApplication().loadGenerator().complete(
+      m_session, lcPUR, resultCode(pua.result_code, pua.experimental_result),
+      latency);
+}
+
+// answers a request from the HSS with DIAMETER_SUCCESS
+static int answerSuccess(Application& app, FDMessageRequest* req) {
+  FDMessageAnswer ans(req);
+
+  ans.addOrigin();
+  ans.add(app.getDict().avpAuthSessionState(), 1);
+  ans.add(app.getDict().avpResultCode(), ER_DIAMETER_SUCCESS);
+  ans.send();
+
+  return 0;
+}
+
+// The generated request classes need answer handlers even though the load
+// generator only sends the derived requests above
+
+void UPLRreq::processAnswer(FDMessageAnswer& ans) {}
+void CALRreq::processAnswer(FDMessageAnswer& ans) {}
+void AUIRreq::processAnswer(FDMessageAnswer& ans) {}
+void INSDRreq::processAnswer(FDMessageAnswer& ans) {}
+void DESDRreq::processAnswer(FDMessageAnswer& ans) {}
+void PUURreq::processAnswer(FDMessageAnswer& ans) {}
+void RERreq::processAnswer(FDMessageAnswer& ans) {}
+
+int CALRcmd::process(FDMessageRequest* req) {
+  return answerSuccess(m_app, req);
+}
+
+int INSDRcmd::process(FDMessageRequest* req) {
+  return answerSuccess(m_app, req);
+}
+
+int DESDRcmd::process(FDMessageRequest* req) {
+  return answerSuccess(m_app, req);
+}
+
+// the load generator does not act as an HSS
+int UPLRcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int AUIRcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int PUURcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+int RERcmd::process(FDMessageRequest* req) {
+  return -1;
+}
+
+}  // namespace s6as6d
@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <functional>
+
+#include "dataaccess.h"
+#include "common_def.h"
+#include "statshss.h"
+#include "timer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+DACache::DACache() : m_capacity(0), m_shardcapacity(0), m_ttl(0) {}
+
+DACache::~DACache() {}
+
+void DACache::init(uint32_t capacity, uint32_t ttl) {
+  clear();
+
+  m_capacity      = capacity;
+  m_shardcapacity = (capacity + DACACHE_SHARDS - 1) / DACACHE_SHARDS;
+  m_ttl           = ((int64_t) ttl) * 1000000000;
+}
+
+void DACache::clear() {
+  for (int i = 0; i < DACACHE_SHARDS; i++) {
+    SMutexLock l(m_shards[i].mutex);
+    m_shards[i].index.clear();
+    m_shards[i].lru.clear();
+  }
+}
+
+DACache::Shard& DACache::shard(const std::string& imsi) {
+  return m_shards[std::hash<std::string>()(imsi) % DACACHE_SHARDS];
+}
+
+int64_t DACache::expires() {
+  return STIMER_GET_CURRENT_TIME + m_ttl;
+}
+
+DACache::Entry* DACache::find(Shard& s, const std::string& imsi) {
+  auto it = s.index.find(imsi);
+
+  if (it == s.index.end()) return NULL;
+
+  // move to the front of the LRU list
+  s.lru.splice(s.lru.begin(), s.lru, it->second);
+
+  return &*it->second;
+}
+
+DACache::Entry& DACache::insert(Shard& s, const std::string& imsi) {
+  Entry* e = find(s, imsi);
+
+  if (e) return *e;
+
+  // evict the least recently used entries, skipping any entry that has an
+  // SQN update outstanding
+  auto it = s.lru.end();
+  while (s.index.size() >= m_shardcapacity && it != s.lru.begin()) {
+    --it;
+    if (it->sec_pending == 0) {
+      s.index.erase(it->imsi);
+      it = s.lru.erase(it);
+    }
+  }
+
+  s.lru.emplace_front();
+  e                  = &s.lru.front();
+  e->imsi            = imsi;
+  e->sec_valid       = false;
+  e->sec_expires     = 0;
+  e->sec_pending     = 0;
+  e->sec_generation  = ++s.generation;
+  e->info_valid      = false;
+  e->info_expires    = 0;
+  e->info_generation = ++s.generation;
+  e->info_subscription.reset();
+
+  s.index[imsi] = s.lru.begin();
+
+  return *e;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+bool DACache::getImsiSec(
+    const std::string& imsi, DAImsiSec& sec, uint64_t& generation) {
+  generation = 0;
+
+  if (!enabled()) return false;
+
+  bool hit = false;
+  Shard& s = shard(imsi);
+
+  {
+    SMutexLock l(s.mutex);
+    Entry& e = insert(s, imsi);
+
+    if (e.sec_valid) {
+      // an entry with an outstanding SQN update is newer than the database
+      if (e.sec_pending > 0 || e.sec_expires > STIMER_GET_CURRENT_TIME) {
+        memcpy(&sec, &e.sec, sizeof(sec));
+        hit = true;
+      } else {
+        e.sec_valid = false;
+      }
+    }
+
+    generation = e.sec_generation;
+  }
+
+  StatsHss::singleton().registerCacheResult(stat_cache_imsi_sec, hit);
+
+  return hit;
+}
+
+void DACache::putImsiSec(
+    const std::string& imsi, const DAImsiSec& sec, uint64_t generation) {
+  if (!enabled()) return;
+
+  Shard& s = shard(imsi);
+  SMutexLock l(s.mutex);
+  Entry* e = find(s, imsi);
+
+  // the SQN was updated or invalidated after it was read, or the entry was
+  // evicted and may have been, so what was read can be stale
+  if (!e || e->sec_generation != generation) return;
+
+  // the database may not have the outstanding SQN update yet
+  if (e->sec_pending > 0) return;
+
+  // a valid entry is at least as recent as what was just read
+  if (e->sec_valid) return;
+
+  memcpy(&e->sec, &sec, sizeof(e->sec));
+  e->sec_valid   = true;
+  e->sec_expires = expires();
+}
+
+bool DACache::updateRandSqn(
+    const std::string& imsi, const uint8_t* rand, const uint8_t* sqn) {
+  if (!enabled()) return false;
+
+  Shard& s = shard(imsi);
+  SMutexLock l(s.mutex);
+  Entry& e = insert(s, imsi);
+
+  // a read that is in progress may return the previous SQN, and so may one
+  // that is started before the update completes
+  e.sec_generation = ++s.generation;
+  e.sec_pending++;
+
+  // key and OPc are unknown without a cached entry, let the next read load it
+  if (!e.sec_valid) return true;
+
+  memcpy(e.sec.rand, rand, sizeof(e.sec.rand));
+  memcpy(e.sec.sqn, sqn, sizeof(e.sec.sqn));
+  e.sec_expires = expires();
+
+  return true;
+}
+
+void DACache::updateRandSqnComplete(const std::string& imsi) {
+  if (!enabled()) return;
+
+  Shard& s = shard(imsi);
+  SMutexLock l(s.mutex);
+  Entry* e = find(s, imsi);
+
+  if (e && e->sec_pending > 0) e->sec_pending--;
+}
+
+void DACache::invalidateImsiSec(const std::string& imsi) {
+  if (!enabled()) return;
+
+  Shard& s = shard(imsi);
+  SMutexLock l(s.mutex);
+  Entry* e = find(s, imsi);
+
+  if (e) {
+    e->sec_valid      = false;
+    e->sec_generation = ++s.generation;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+bool DACache::getImsiInfo(
+    const std::string& imsi, DAImsiInfo& info, uint64_t& generation) {
+  generation = 0;
+
+  if (!enabled()) return false;
+
+  bool hit = false;
+  Shard& s = shard(imsi);
+
+  {
+    SMutexLock l(s.mutex);
+    Entry& e = insert(s, imsi);
+
+    if (e.info_valid) {
+      if (e.info_expires > STIMER_GET_CURRENT_TIME) {
+        info = e.info;
+        hit  = true;
+      } else {
+        e.info_valid = false;
+      }
+    }
+
+    generation = e.info_generation;
+  }
+
+  StatsHss::singleton().registerCacheResult(stat_cache_imsi_info, hit);
+
+  return hit;
+}
+
+void DACache::putImsiInfo(
+    const std::string& imsi, const DAImsiInfo& info, uint64_t generation) {
+  if (!enabled()) return;
+
+  Shard& s = shard(imsi);
+  SMutexLock l(s.mutex);
+  Entry* e = find(s, imsi);
+
+  // the location was updated or the UE purged after it was read, or the
+  // entry was evicted and may have been, so what was read can be stale
+  if (!e || e->info_generation != generation) return;
+
+  // a valid entry is at least as recent as what was just read
+  if (e->info_valid) return;
+
+  e->info         = info;
+  e->info_valid   = true;
+  e->info_expires = expires();
+
+  // the compiled profile outlives a reload that returns the same profile
+  if (e->info_subscription &&
+      e->info_subscription->getSource() != info.subscription_data)
+    e->info_subscription.reset();
+}
+
+void DACache::updateLocation(
+    const DAImsiInfo& location, uint32_t present_flags,
+    int32_t idmmeidentity) {
+  if (!enabled()) return;
+
+  Shard& s = shard(location.imsi);
+  SMutexLock l(s.mutex);
+  Entry* e = find(s, location.imsi);
+
+  if (!e) return;
+
+  // a read that is in progress may return the previous location
+  e->info_generation = ++s.generation;
+
+  if (!e->info_valid) return;
+
+  if (FLAG_IS_SET(present_flags, IMEI_PRESENT)) e->info.imei = location.imei;
+
+  if (FLAG_IS_SET(present_flags, SV_PRESENT))
+    e->info.imei_sv = location.imei_sv;
+
+  if (FLAG_IS_SET(present_flags, MME_IDENTITY_PRESENT)) {
+    e->info.mme_id   = idmmeidentity;
+    e->info.mmehost  = location.mmehost;
+    e->info.mmerealm = location.mmerealm;
+  }
+
+  e->info.ms_ps_status   = "ATTACHED";
+  e->info.visited_plmnid = location.visited_plmnid;
+  e->info_expires        = expires();
+}
+
+void DACache::purgeUE(const std::string& imsi) {
+  if (!enabled()) return;
+
+  Shard& s = shard(imsi);
+  SMutexLock l(s.mutex);
+  Entry* e = find(s, imsi);
+
+  if (!e) return;
+
+  e->info_generation = ++s.generation;
+
+  if (e->info_valid) e->info.ms_ps_status = "PURGED";
+}
+
+FDJsonEncodingPtr DACache::getSubscriptionEncoding(
+    const std::string& imsi, const std::string& subscription_data,
+    void (*errfunc)(const char*)) {
+  FDJsonEncodingPtr cached;
+  Shard& s = shard(imsi);
+
+  {
+    SMutexLock l(s.mutex);
+    Entry* e = find(s, imsi);
+
+    if (e && e->info_subscription &&
+        e->info_subscription->getSource() == subscription_data)
+      cached = e->info_subscription;
+  }
+
+  StatsHss::singleton().registerCacheResult(
+      stat_cache_subscription, (bool) cached);
+
+  if (cached) return cached;
+
+  // compiled outside of the lock, an entry evicted in the meantime is not
+  // brought back for it
+  std::shared_ptr<FDJsonEncoding> enc(new FDJsonEncoding());
+  if (enc->compile(subscription_data.c_str(), errfunc) != FDJSON_SUCCESS)
+    return FDJsonEncodingPtr();
+
+  SMutexLock l(s.mutex);
+  Entry* e = find(s, imsi);
+
+  if (e) e->info_subscription = enc;
+
+  return enc;
+}
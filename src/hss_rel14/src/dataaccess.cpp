@@ -26,6 +26,7 @@
 #include "util.h"
 #include "logger.h"
 #include "options.h"
+#include "statshss.h"
 
 extern "C" {
 #include "auc.h"
@@ -56,6 +57,29 @@ void convert_ascii_to_binary(
           future.errorCode(), #_col));                                         \
   }
 
+#define UPDATE_LOCATION_IMEI (1)
+#define UPDATE_LOCATION_SV (2)
+#define UPDATE_LOCATION_MME (4)
+
+// indexed by DataAccess::PreparedStatement up to psUpdateLocation
+static const char* prepared_queries[] = {
+    "SELECT * FROM events WHERE scef_id=? AND scef_ref_id=?",
+    "SELECT extid FROM extid_imsi_xref WHERE imsi=?",
+    "SELECT imsi, mmehost, mmerealm, ms_ps_status, subscription_data, msisdn, "
+    "visited_plmnid, access_restriction, mmeidentity_idmmeidentity "
+    "FROM users_imsi WHERE imsi=?",
+    "SELECT scef_id, scef_ref_id FROM events_msisdn WHERE msisdn=? "
+    "ORDER BY scef_id, scef_ref_id",
+    "SELECT scef_id, scef_ref_id FROM events_extid WHERE extid=?",
+    "SELECT mmeidentity_idmmeidentity FROM vhss.users_imsi WHERE imsi=?",
+    "SELECT mmehost,mmerealm,mmeisdn FROM vhss.mmeidentity "
+    "WHERE idmmeidentity=?",
+    "SELECT idmmeidentity FROM vhss.mmeidentity_host WHERE mmehost=?",
+    "UPDATE vhss.users_imsi SET ms_ps_status='PURGED' WHERE imsi=?",
+    "SELECT key,sqn,rand,OPc FROM vhss.users_imsi WHERE imsi=?",
+    "UPDATE vhss.users_imsi SET rand=?, sqn=? WHERE imsi=?",
+    "SELECT imsi FROM msisdn_imsi WHERE msisdn=?"};
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -87,7 +111,7 @@ DAEventList::~DAEventList() {
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-DataAccess::DataAccess() {}
+DataAccess::DataAccess() : m_eventencodings(DAEVENT_ENCODINGS_MAX) {}
 
 DataAccess::~DataAccess() {
   disconnect();
@@ -124,18 +148,105 @@ void DataAccess::connect() {
   m_db.setMaxConnectionsPerHost(Options::getcassmaxconnections());
   m_db.setIOQueueSize(Options::getcassioqueuesize());
   m_db.setIONumberThreads(Options::getcassiothreads());
+
+  prepareStatements();
+
+  m_cache.init(Options::getcachesize(), Options::getcachettl());
+
+  if (m_cache.enabled())
+    Logger::system().startup(
+        "DataAccess::%s - users_imsi cache of %u entries enabled, this HSS "
+        "must be the only writer of users_imsi",
+        __func__, Options::getcachesize());
 }
 
 void DataAccess::disconnect() {
+  for (int i = 0; i < psMax; i++) m_prepared[i] = (const CassPrepared*) NULL;
   m_db.disconnect();
 }
 
+void DataAccess::prepareStatements() {
+  for (int i = 0; i < psUpdateLocation; i++) m_queries[i] = prepared_queries[i];
+
+  for (int i = 0; i < psMax - psUpdateLocation; i++) {
+    std::stringstream ss;
+    ss << "UPDATE vhss.users_imsi SET ";
+    if (i & UPDATE_LOCATION_IMEI) ss << "imei=?,";
+    if (i & UPDATE_LOCATION_SV) ss << "imei_sv=?,";
+    if (i & UPDATE_LOCATION_MME)
+      ss << "mmeidentity_idmmeidentity=?,mmehost=?,mmerealm=?,";
+    ss << "ms_ps_status='ATTACHED',visited_plmnid=? WHERE imsi=?";
+    m_queries[psUpdateLocation + i] = ss.str();
+  }
+
+  for (int i = 0; i < psMax; i++) {
+    SCassFuture future = m_db.prepare(m_queries[i]);
+
+    future.wait();
+
+    if (future.errorCode() != CASS_OK) {
+      throw DAException(SUtility::string_format(
+          "DataAccess::%s - Error %d preparing [%s]", __func__,
+          future.errorCode(), m_queries[i].c_str()));
+    }
+
+    m_prepared[i] = future.prepared();
+  }
+}
+
+// a value that could not be bound fails the query the same way an error
+// executing it does, by throwing or, for an asynchronous query, by logging
+// it and returning false
+bool DataAccess::checkBind(
+    SCassStatement& stmt, int ps, const char* func, bool async) {
+  if (stmt.bindError() == CASS_OK) return true;
+
+  std::string msg = SUtility::string_format(
+      "DataAccess::%s - Error %d binding [%s]", func, stmt.bindError(),
+      m_queries[ps].c_str());
+
+  if (!async) throw DAException(msg);
+
+  Logger::system().error("%s", msg.c_str());
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+std::string DataAccess::eventKey(const char* scef_id, uint32_t scef_ref_id) {
+  return SUtility::string_format("%s:%u", scef_id, scef_ref_id);
+}
+
+FDJsonEncodingPtr DataAccess::getEventEncoding(
+    const DAEvent& event, void (*errfunc)(const char*)) {
+  bool hit;
+  FDJsonEncodingPtr enc = m_eventencodings.get(
+      eventKey(event.scef_id.c_str(), event.scef_ref_id), event.mec_json,
+      errfunc, hit);
+
+  StatsHss::singleton().registerCacheResult(stat_cache_event_config, hit);
+
+  return enc;
+}
+
+int DataAccess::addSubscriptionData(
+    const std::string& imsi, const std::string& subscription_data,
+    msg_or_avp* msg, void (*errfunc)(const char*)) {
+  if (!m_cache.enabled())
+    return fdJsonAddAvps(subscription_data.c_str(), msg, errfunc);
+
+  FDJsonEncodingPtr enc =
+      m_cache.getSubscriptionEncoding(imsi, subscription_data, errfunc);
+
+  return enc ? enc->addTo(msg, errfunc) : FDJSON_JSON_PARSING_ERROR;
+}
+
 bool DataAccess::addEvent(DAEvent& event) {
   std::stringstream ss;
 
+  m_eventencodings.erase(eventKey(event.scef_id.c_str(), event.scef_ref_id));
+
   // insert the event
   {
     ss << "INSERT INTO events ("
@@ -210,20 +321,19 @@ bool DataAccess::addEvent(DAEvent& event) {
 
 bool DataAccess::getEvent(
     const char* scef_id, uint32_t scef_ref_id, DAEvent& event) {
-  std::stringstream ss;
-
-  ss << "SELECT * FROM events WHERE "
-     << "scef_id = '" << scef_id << "' "
-     << "AND scef_ref_id = " << scef_ref_id;
+  SCassStatement stmt(m_prepared[psGetEvent]);
+  stmt.bind(0, scef_id);
+  stmt.bind(1, (int64_t) scef_ref_id);
 
-  SCassStatement stmt(ss.str().c_str());
+  checkBind(stmt, psGetEvent, __func__, false);
 
   SCassFuture future = m_db.execute(stmt);
 
   if (future.errorCode() != CASS_OK) {
     throw DAException(SUtility::string_format(
-        "DataAccess::%s - Error %d executing [%s]", __func__,
-        future.errorCode(), ss.str().c_str()));
+        "DataAccess::%s - Error %d executing [%s] scef_id=%s scef_ref_id=%u",
+        __func__, future.errorCode(), m_queries[psGetEvent].c_str(), scef_id,
+        scef_ref_id));
   }
 
   SCassResult res = future.result();
@@ -246,6 +356,22 @@ bool DataAccess::getEvent(
   return false;
 }
 
+bool DataAccess::getEvent(
+    const char* scef_id, uint32_t scef_ref_id, DAEventList& events,
+    CassFutureCallback cb, void* data) {
+  SCassStatement stmt(m_prepared[psGetEvent]);
+  stmt.bind(0, scef_id);
+  stmt.bind(1, (int64_t) scef_ref_id);
+
+  if (!checkBind(stmt, psGetEvent, __func__, cb != NULL)) return false;
+
+  SCassFuture future = m_db.execute(stmt);
+
+  if (cb) return future.setCallback(cb, data);
+
+  return getEventsData(future, events);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -317,6 +443,8 @@ void DataAccess::deleteEvent(const char* scef_id, uint32_t scef_ref_id) {
 
   if (!getEvent(scef_id, scef_ref_id, event)) return;
 
+  m_eventencodings.erase(eventKey(scef_id, scef_ref_id));
+
   {
     ss << "DELETE FROM events WHERE "
        << "scef_id = '" << scef_id << "' "
@@ -515,11 +643,10 @@ bool DataAccess::getExtIdsFromImsiData(
 
 bool DataAccess::getExtIdsFromImsi(
     const char* imsi, DAExtIdList& extids, CassFutureCallback cb, void* data) {
-  std::stringstream ss;
+  SCassStatement stmt(m_prepared[psGetExtIdsFromImsi]);
+  stmt.bind(0, imsi);
 
-  ss << "SELECT extid FROM extid_imsi_xref WHERE imsi = '" << imsi << "'";
-
-  SCassStatement stmt(ss.str().c_str());
+  if (!checkBind(stmt, psGetExtIdsFromImsi, __func__, cb != NULL)) return false;
 
   SCassFuture future = m_db.execute(stmt);
 
@@ -585,6 +712,42 @@ bool DataAccess::getImsiFromMsisdn(const char* msisdn, std::string& imsi) {
   return false;
 }
 
+bool DataAccess::getImsiFromMsisdn(
+    int64_t msisdn, std::string& imsi, CassFutureCallback cb, void* data) {
+  Logger::system().debug("DataAccess::%s - msisdn=%" PRId64, __func__, msisdn);
+
+  SCassStatement stmt(m_prepared[psGetImsiFromMsisdn]);
+  stmt.bind(0, msisdn);
+
+  if (!checkBind(stmt, psGetImsiFromMsisdn, __func__, cb != NULL)) return false;
+
+  SCassFuture future = m_db.execute(stmt);
+
+  if (cb) return future.setCallback(cb, data);
+
+  return getImsiFromMsisdnData(future, imsi);
+}
+
+bool DataAccess::getImsiFromMsisdnData(SCassFuture& future, std::string& imsi) {
+  if (future.errorCode() != CASS_OK) {
+    Logger::system().error(
+        "DataAccess::%s - Error %d executing getImsiFromMsisdn()", __func__,
+        future.errorCode());
+    return false;
+  }
+
+  SCassResult res = future.result();
+
+  SCassRow row = res.firstRow();
+
+  if (row.valid()) {
+    GET_EVENT_DATA(row, imsi, imsi);
+    return true;
+  }
+
+  return false;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////
 
@@ -675,14 +838,10 @@ bool DataAccess::getImsiInfoData(SCassFuture& future, DAImsiInfo& info) {
 
 bool DataAccess::getImsiInfo(
     const char* imsi, DAImsiInfo& info, CassFutureCallback cb, void* data) {
-  std::stringstream ss;
+  SCassStatement stmt(m_prepared[psGetImsiInfo]);
+  stmt.bind(0, imsi);
 
-  ss << "SELECT imsi, mmehost, mmerealm, ms_ps_status, subscription_data, "
-        "msisdn, visited_plmnid, access_restriction, mmeidentity_idmmeidentity "
-        "FROM users_imsi where imsi = '"
-     << imsi << "' ;";
-
-  SCassStatement stmt(ss.str().c_str());
+  if (!checkBind(stmt, psGetImsiInfo, __func__, cb != NULL)) return false;
 
   SCassFuture future = m_db.execute(stmt);
 
@@ -722,12 +881,11 @@ bool DataAccess::getEventIdsFromMsisdnData(
 
 bool DataAccess::getEventIdsFromMsisdn(
     int64_t msisdn, DAEventIdList& eil, CassFutureCallback cb, void* data) {
-  std::stringstream ss;
-
-  ss << "SELECT scef_id, scef_ref_id FROM events_msisdn WHERE msisdn = "
-     << msisdn << " order by scef_id, scef_ref_id";
+  SCassStatement stmt(m_prepared[psGetEventIdsFromMsisdn]);
+  stmt.bind(0, msisdn);
 
-  SCassStatement stmt(ss.str().c_str());
+  if (!checkBind(stmt, psGetEventIdsFromMsisdn, __func__, cb != NULL))
+    return false;
 
   SCassFuture future = m_db.execute(stmt);
 
@@ -749,19 +907,17 @@ bool DataAccess::getEventIdsFromMsisdn(
 ////////////////////////////////////////////////////////////////////////////////
 
 void DataAccess::getEventIdsFromExtId(const char* extid, DAEventIdList& eil) {
-  std::stringstream ss;
-
-  ss << "SELECT scef_id, scef_ref_id FROM events_extid WHERE extid = '" << extid
-     << "'";
+  SCassStatement stmt(m_prepared[psGetEventIdsFromExtId]);
+  stmt.bind(0, extid);
 
-  SCassStatement stmt(ss.str().c_str());
+  checkBind(stmt, psGetEventIdsFromExtId, __func__, false);
 
   SCassFuture future = m_db.execute(stmt);
 
   if (future.errorCode() != CASS_OK) {
     throw DAException(SUtility::string_format(
-        "DataAccess::%s - Error %d executing [%s]", __func__,
-        future.errorCode(), ss.str().c_str()));
+        "DataAccess::%s - Error %d executing [%s] extid=%s", __func__,
+        future.errorCode(), m_queries[psGetEventIdsFromExtId].c_str(), extid));
   }
 
   SCassResult res = future.result();
@@ -779,6 +935,21 @@ void DataAccess::getEventIdsFromExtId(const char* extid, DAEventIdList& eil) {
   }
 }
 
+bool DataAccess::getEventIdsFromExtId(
+    const char* extid, DAEventIdList& el, CassFutureCallback cb, void* data) {
+  SCassStatement stmt(m_prepared[psGetEventIdsFromExtId]);
+  stmt.bind(0, extid);
+
+  if (!checkBind(stmt, psGetEventIdsFromExtId, __func__, cb != NULL))
+    return false;
+
+  SCassFuture future = m_db.execute(stmt);
+
+  if (cb) return future.setCallback(cb, data);
+
+  return getEventIdsFromExtIdsData(future, el);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -938,45 +1109,118 @@ bool DataAccess::updateOpc(std::string& imsi, std::string& opc) {
         "DataAcces::%s - Error %d executing [%s]", __func__, future.errorCode(),
         ss.str().c_str()));
 
+  m_cache.invalidateImsiSec(imsi);
+
   return true;
 }
 
 bool DataAccess::purgeUE(std::string& imsi) {
   if (imsi.empty()) return false;
 
-  std::stringstream ss;
-  ss << "UPDATE vhss.users_imsi SET ms_ps_status='PURGED' WHERE imsi='" << imsi
-     << "';";
-  Logger::system().debug(ss.str());
+  Logger::system().debug("DataAccess::%s - imsi=%s", __func__, imsi.c_str());
 
-  SCassStatement stmt(ss.str().c_str());
+  SCassStatement stmt(m_prepared[psPurgeUE]);
+  stmt.bind(0, imsi);
+
+  checkBind(stmt, psPurgeUE, __func__, false);
 
   SCassFuture future = m_db.execute(stmt);
 
   if (future.errorCode() != CASS_OK)
     throw DAException(SUtility::string_format(
-        "DataAcces::%s - Error %d executing [%s]", __func__, future.errorCode(),
-        ss.str().c_str()));
+        "DataAcces::%s - Error %d executing [%s] imsi=%s", __func__,
+        future.errorCode(), m_queries[psPurgeUE].c_str(), imsi.c_str()));
+
+  m_cache.purgeUE(imsi);
 
   return true;
 }
 
+bool DataAccess::purgeUE(
+    const std::string& imsi, CassFutureCallback cb, void* data) {
+  Logger::system().debug("DataAccess::%s - imsi=%s", __func__, imsi.c_str());
+
+  SCassStatement stmt(m_prepared[psPurgeUE]);
+  stmt.bind(0, imsi);
+
+  if (!checkBind(stmt, psPurgeUE, __func__, cb != NULL)) return false;
+
+  SCassFuture future = m_db.execute(stmt);
+
+  if (cb) return future.setCallback(cb, data);
+
+  return purgeUEData(future, imsi);
+}
+
+// the cached copy of the user is only dropped once the update completed
+bool DataAccess::purgeUEData(SCassFuture& future, const std::string& imsi) {
+  if (future.errorCode() != CASS_OK) {
+    Logger::system().error(
+        "DataAccess::%s - Error %d executing purgeUE() imsi=%s", __func__,
+        future.errorCode(), imsi.c_str());
+    return false;
+  }
+
+  m_cache.purgeUE(imsi);
+
+  return true;
+}
+
+bool DataAccess::getMmeIdentityFromImsi(
+    const std::string& imsi, int32_t& mme_id, CassFutureCallback cb,
+    void* data) {
+  Logger::system().debug("DataAccess::%s - imsi=%s", __func__, imsi.c_str());
+
+  SCassStatement stmt(m_prepared[psGetMmeIdentityFromImsi]);
+  stmt.bind(0, imsi);
+
+  if (!checkBind(stmt, psGetMmeIdentityFromImsi, __func__, cb != NULL))
+    return false;
+
+  SCassFuture future = m_db.execute(stmt);
+
+  if (cb) return future.setCallback(cb, data);
+
+  return getMmeIdentityFromImsiData(future, mme_id);
+}
+
+bool DataAccess::getMmeIdentityFromImsiData(
+    SCassFuture& future, int32_t& mme_id) {
+  if (future.errorCode() != CASS_OK) {
+    Logger::system().error(
+        "DataAccess::%s - Error %d executing getMmeIdentityFromImsi()",
+        __func__, future.errorCode());
+    return false;
+  }
+
+  SCassResult res = future.result();
+
+  SCassRow row = res.firstRow();
+
+  if (row.valid()) {
+    GET_EVENT_DATA(row, mmeidentity_idmmeidentity, mme_id);
+    return true;
+  }
+
+  return false;
+}
+
 bool DataAccess::getMmeIdentityFromImsi(
     std::string& imsi, DAMmeIdentity& mmeid) {
-  std::stringstream ss;
+  Logger::system().debug("DataAccess::%s - imsi=%s", __func__, imsi.c_str());
 
-  ss << "SELECT mmeidentity_idmmeidentity FROM vhss.users_imsi WHERE imsi = '"
-     << imsi << "';";
-  Logger::system().debug(ss.str());
+  SCassStatement stmt(m_prepared[psGetMmeIdentityFromImsi]);
+  stmt.bind(0, imsi);
 
-  SCassStatement stmt(ss.str().c_str());
+  checkBind(stmt, psGetMmeIdentityFromImsi, __func__, false);
 
   SCassFuture future = m_db.execute(stmt);
 
   if (future.errorCode() != CASS_OK) {
     throw DAException(SUtility::string_format(
-        "DataAccess::%s - Error %d executing [%s]", __func__,
-        future.errorCode(), ss.str().c_str()));
+        "DataAccess::%s - Error %d executing [%s] imsi=%s", __func__,
+        future.errorCode(), m_queries[psGetMmeIdentityFromImsi].c_str(),
+        imsi.c_str()));
   }
 
   SCassResult res = future.result();
@@ -1025,21 +1269,57 @@ bool DataAccess::getMmeIdentity(std::string& mme_id, DAMmeIdentity& mmeid) {
 }
 
 bool DataAccess::getMmeIdentity(int32_t mme_id, DAMmeIdentity& mmeid) {
-  std::stringstream ss;
+  Logger::system().debug("DataAccess::%s - mme_id=%d", __func__, mme_id);
 
-  ss << "SELECT mmehost,mmerealm,mmeisdn FROM vhss.mmeidentity WHERE "
-        "idmmeidentity="
-     << mme_id << ";";
-  Logger::system().debug(ss.str());
+  SCassStatement stmt(m_prepared[psGetMmeIdentity]);
+  stmt.bind(0, mme_id);
 
-  SCassStatement stmt(ss.str().c_str());
+  checkBind(stmt, psGetMmeIdentity, __func__, false);
 
   SCassFuture future = m_db.execute(stmt);
 
   if (future.errorCode() != CASS_OK) {
     throw DAException(SUtility::string_format(
-        "DataAccess::%s - Error %d executing [%s]", __func__,
-        future.errorCode(), ss.str().c_str()));
+        "DataAccess::%s - Error %d executing [%s] mme_id=%d", __func__,
+        future.errorCode(), m_queries[psGetMmeIdentity].c_str(), mme_id));
+  }
+
+  SCassResult res = future.result();
+
+  SCassRow row = res.firstRow();
+
+  if (row.valid()) {
+    GET_EVENT_DATA(row, mmehost, mmeid.mme_host);
+    GET_EVENT_DATA(row, mmerealm, mmeid.mme_realm);
+    GET_EVENT_DATA(row, mmeisdn, mmeid.mme_isdn);
+    return true;
+  }
+
+  return false;
+}
+
+bool DataAccess::getMmeIdentity(
+    int32_t mme_id, DAMmeIdentity& mmeid, CassFutureCallback cb, void* data) {
+  Logger::system().debug("DataAccess::%s - mme_id=%d", __func__, mme_id);
+
+  SCassStatement stmt(m_prepared[psGetMmeIdentity]);
+  stmt.bind(0, mme_id);
+
+  if (!checkBind(stmt, psGetMmeIdentity, __func__, cb != NULL)) return false;
+
+  SCassFuture future = m_db.execute(stmt);
+
+  if (cb) return future.setCallback(cb, data);
+
+  return getMmeIdentityData(future, mmeid);
+}
+
+bool DataAccess::getMmeIdentityData(SCassFuture& future, DAMmeIdentity& mmeid) {
+  if (future.errorCode() != CASS_OK) {
+    Logger::system().error(
+        "DataAccess::%s - Error %d executing getMmeIdentity()", __func__,
+        future.errorCode());
+    return false;
   }
 
   SCassResult res = future.result();
@@ -1139,13 +1419,12 @@ bool DataAccess::getMmeIdFromHostData(SCassFuture& future, int32_t& mmeid) {
 
 bool DataAccess::getMmeIdFromHost(
     std::string& host, int32_t& mmeid, CassFutureCallback cb, void* data) {
-  std::stringstream ss;
+  Logger::system().debug("DataAccess::%s - host=%s", __func__, host.c_str());
 
-  ss << "SELECT idmmeidentity FROM vhss.mmeidentity_host WHERE mmehost='"
-     << host << "';";
-  Logger::system().debug(ss.str());
+  SCassStatement stmt(m_prepared[psGetMmeIdFromHost]);
+  stmt.bind(0, host);
 
-  SCassStatement stmt(ss.str());
+  if (!checkBind(stmt, psGetMmeIdFromHost, __func__, cb != NULL)) return false;
 
   SCassFuture future = m_db.execute(stmt);
 
@@ -1219,33 +1498,38 @@ bool DataAccess::addMmeIdentity2(
 bool DataAccess::updateLocation(
     DAImsiInfo& location, uint32_t present_flags, int32_t idmmeidentity,
     CassFutureCallback cb, void* data) {
-  std::stringstream ss;
-  ss << "UPDATE vhss.users_imsi SET ";
+  int variant = 0;
 
-  if (FLAG_IS_SET(present_flags, IMEI_PRESENT)) {
-    ss << "imei='" << location.imei << "',";
-  }
+  if (FLAG_IS_SET(present_flags, IMEI_PRESENT))
+    variant |= UPDATE_LOCATION_IMEI;
+  if (FLAG_IS_SET(present_flags, SV_PRESENT)) variant |= UPDATE_LOCATION_SV;
+  if (FLAG_IS_SET(present_flags, MME_IDENTITY_PRESENT))
+    variant |= UPDATE_LOCATION_MME;
 
-  if (FLAG_IS_SET(present_flags, SV_PRESENT)) {
-    ss << "imeisv='" << location.imei_sv << "',";
-  }
+  Logger::system().debug(
+      "DataAccess::%s - imsi=%s present_flags=0x%x", __func__,
+      location.imsi.c_str(), present_flags);
 
-  if (FLAG_IS_SET(present_flags, MME_IDENTITY_PRESENT)) {
-    ss << "mmeidentity_idmmeidentity=" << idmmeidentity << ",";
-    ss << "mmehost='" << location.mmehost << "',";
-    ss << "mmerealm='" << location.mmerealm << "',";
-  }
+  SCassStatement stmt(m_prepared[psUpdateLocation + variant]);
+  size_t idx = 0;
 
-  ss << "ms_ps_status='"
-     << "ATTACHED"
-     << "',";
-  ss << "visited_plmnid='" << location.visited_plmnid << "' ";
+  if (variant & UPDATE_LOCATION_IMEI) stmt.bind(idx++, location.imei);
 
-  ss << "WHERE imsi='" << location.imsi << "';";
+  if (variant & UPDATE_LOCATION_SV) stmt.bind(idx++, location.imei_sv);
 
-  Logger::system().debug(ss.str());
+  if (variant & UPDATE_LOCATION_MME) {
+    stmt.bind(idx++, idmmeidentity);
+    stmt.bind(idx++, location.mmehost);
+    stmt.bind(idx++, location.mmerealm);
+  }
 
-  SCassStatement stmt(ss.str().c_str());
+  stmt.bind(idx++, location.visited_plmnid);
+  stmt.bind(idx++, location.imsi);
+
+  if (!checkBind(stmt, psUpdateLocation + variant, __func__, cb != NULL))
+    return false;
+
+  m_cache.updateLocation(location, present_flags, idmmeidentity);
 
   SCassFuture future = m_db.execute(stmt);
 
@@ -1253,8 +1537,9 @@ bool DataAccess::updateLocation(
 
   if (future.errorCode() != CASS_OK)
     throw DAException(SUtility::string_format(
-        "DataAcces::%s - Error %d executing [%s]", __func__, future.errorCode(),
-        ss.str().c_str()));
+        "DataAcces::%s - Error %d executing [%s] imsi=%s", __func__,
+        future.errorCode(), m_queries[psUpdateLocation + variant].c_str(),
+        location.imsi.c_str()));
 
   return true;
 }
@@ -1262,44 +1547,7 @@ bool DataAccess::updateLocation(
 bool DataAccess::updateLocation(
     DAImsiInfo& location, uint32_t present_flags, CassFutureCallback cb,
     void* data) {
-  std::stringstream ss;
-  ss << "UPDATE vhss.users_imsi SET ";
-
-  if (FLAG_IS_SET(present_flags, IMEI_PRESENT)) {
-    ss << "imei='" << location.imei << "',";
-  }
-
-  if (FLAG_IS_SET(present_flags, SV_PRESENT)) {
-    ss << "imeisv='" << location.imei_sv << "',";
-  }
-
-  if (FLAG_IS_SET(present_flags, MME_IDENTITY_PRESENT)) {
-    ss << "mmeidentity_idmmeidentity=" << location.mme_id << ",";
-    ss << "mmehost='" << location.mmehost << "',";
-    ss << "mmerealm='" << location.mmerealm << "',";
-  }
-
-  ss << "ms_ps_status='"
-     << "ATTACHED"
-     << "',";
-  ss << "visited_plmnid='" << location.visited_plmnid << "' ";
-
-  ss << "WHERE imsi='" << location.imsi << "';";
-
-  Logger::system().debug(ss.str());
-
-  SCassStatement stmt(ss.str().c_str());
-
-  SCassFuture future = m_db.execute(stmt);
-
-  if (cb) return future.setCallback(cb, data);
-
-  if (future.errorCode() != CASS_OK)
-    throw DAException(SUtility::string_format(
-        "DataAcces::%s - Error %d executing [%s]", __func__, future.errorCode(),
-        ss.str().c_str()));
-
-  return true;
+  return updateLocation(location, present_flags, location.mme_id, cb, data);
 }
 
 bool DataAccess::getImsiSecData(SCassFuture& future, DAImsiSec& imsisec) {
@@ -1347,14 +1595,12 @@ bool DataAccess::getImsiSecData(SCassFuture& future, DAImsiSec& imsisec) {
 bool DataAccess::getImsiSec(
     const std::string& imsi, DAImsiSec& imsisec, CassFutureCallback cb,
     void* data) {
-  std::stringstream ss;
-
-  ss << "SELECT key,sqn,rand,OPc FROM vhss.users_imsi WHERE imsi='" << imsi
-     << "';";
+  Logger::system().debug("DataAccess::%s - imsi=%s", __func__, imsi.c_str());
 
-  Logger::system().debug(ss.str());
+  SCassStatement stmt(m_prepared[psGetImsiSec]);
+  stmt.bind(0, imsi);
 
-  SCassStatement stmt(ss.str().c_str());
+  if (!checkBind(stmt, psGetImsiSec, __func__, cb != NULL)) return false;
 
   SCassFuture future = m_db.execute(stmt);
 
@@ -1365,7 +1611,7 @@ bool DataAccess::getImsiSec(
 
 bool DataAccess::updateRandSqn(
     const std::string& imsi, uint8_t* rand_p, uint8_t* sqn, bool inc_sqn,
-    CassFutureCallback cb, void* data) {
+    CassFutureCallback cb, void* data, bool& pinned) {
   SqnU64Union eu;
 
   SQN_TO_U64(sqn, eu);
@@ -1378,22 +1624,40 @@ bool DataAccess::updateRandSqn(
   //   Utility::bytes2hex(eu.u8,8,'.') << " eu.u64=" << eu.u64 << " rand=[" <<
   //   rand << "]" << std::endl;
 
-  std::stringstream ss;
-  ss << "UPDATE vhss.users_imsi SET rand='" << rand << "', sqn=" << eu.u64
-     << " WHERE imsi='" << imsi << "';";
-  Logger::system().debug(ss.str());
-  std::cout << ss.str() << std::endl;
+  Logger::system().debug(
+      "DataAccess::%s - imsi=%s rand=%s sqn=%" PRIu64, __func__, imsi.c_str(),
+      rand.c_str(), eu.u64);
 
-  SCassStatement stmt(ss.str().c_str());
+  SCassStatement stmt(m_prepared[psUpdateRandSqn]);
+  stmt.bind(0, rand);
+  stmt.bind(1, (int64_t) eu.u64);
+  stmt.bind(2, imsi);
+
+  pinned = false;
+
+  if (!checkBind(stmt, psUpdateRandSqn, __func__, cb != NULL)) return false;
+
+  // write through to the cache before the update is issued, the entry stays
+  // pinned until updateRandSqnComplete() so a reload can not return the
+  // previous SQN
+  uint8_t cache_sqn[SQN_LENGTH];
+  U64_TO_SQN(eu, cache_sqn);
+  pinned = m_cache.updateRandSqn(imsi, rand_p, cache_sqn);
 
   SCassFuture future = m_db.execute(stmt);
 
-  if (cb) return future.setCallback(cb, data);
+  if (cb) {
+    if (future.setCallback(cb, data)) return true;
+    if (pinned) m_cache.updateRandSqnComplete(imsi);
+    return false;
+  }
+
+  if (pinned) m_cache.updateRandSqnComplete(imsi);
 
   if (future.errorCode() != CASS_OK)
     throw DAException(SUtility::string_format(
-        "DataAcces::%s - Error %d executing [%s]", __func__, future.errorCode(),
-        ss.str().c_str()));
+        "DataAcces::%s - Error %d executing [%s] imsi=%s", __func__,
+        future.errorCode(), m_queries[psUpdateRandSqn].c_str(), imsi.c_str()));
 
   return true;
 }
@@ -1419,6 +1683,8 @@ bool DataAccess::incSqn(std::string& imsi, uint8_t* sqn) {
         "DataAcces::%s - Error %d executing [%s]", __func__, future.errorCode(),
         ss.str().c_str()));
 
+  m_cache.invalidateImsiSec(imsi);
+
   return true;
 }
 
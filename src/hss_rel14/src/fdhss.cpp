@@ -27,6 +27,7 @@
 #include "s6c_impl.h"
 #include "dataaccess.h"
 #include "common_def.h"
+#include "satomic.h"
 #include "msg_event.h"
 
 #include "resthandler.h"
@@ -38,21 +39,347 @@ extern "C" {
 #include "aucpp.h"
 }
 
-HSSWorkerQueue::HSSWorkerQueue() {}
+HSSWorkerQueue::HSSWorkerQueue() : m_budget(0), m_abandoned(0) {}
 
 HSSWorkerQueue::~HSSWorkerQueue() {}
 
-void HSSWorkerQueue::addProcessor(QueueProcessor* processor) {
-  addEntry(processor);
+bool HSSWorkerQueue::admit(FDMessageRequest* req, StatType stat) {
+  if (!full()) return true;
+
+  try {
+    FDMessageAnswer ans(req);
+    ans.setResultCode("DIAMETER_TOO_BUSY");
+    fdHss.getOverloadReporter().addReport(ans);
+    ans.send();
+  } catch (FDException& ex) {
+    Logger::system().error("HSSWorkerQueue::%s - %s", __func__, ex.what());
+  }
+  delete req;
+
+  StatsHss::singleton().registerStatResult(stat, 0, DIAMETER_TOO_BUSY);
+
+  return false;
+}
+
+const char* HSSWorkerQueue::laneName(int lane) {
+  static const char* names[] = {"auth", "location", "event"};
+  return lane >= 0 && lane < hss_lane_max ? names[lane] : "unknown";
+}
+
+void HSSWorkerQueue::addProcessor(
+    QueueProcessor* processor, HSSQueueLane lane) {
+  processor->setLane(lane);
+  if (m_budget > 0) processor->setDeadline(processor->getReceived() + m_budget);
+  addEntry(processor, lane);
+}
+
+void HSSWorkerQueue::abandonProcessor(QueueProcessor* processor) {
+  processor->setAbandoned();
+  __atomic_add_fetch(&m_abandoned, 1, __ATOMIC_RELAXED);
 }
 
+// the limit may have grown since the last call, so start as many as it
+// allows
 void HSSWorkerQueue::startProcessor() {
-  QueueProcessor* processor = (QueueProcessor*) startMessage();
-  if (processor) processor->triggerNextPhase();
+  QueueProcessor* processor;
+  int lane;
+
+  while ((processor = (QueueProcessor*) startMessage(lane))) {
+    processor->setStarted(STIMER_GET_CURRENT_TIME);
+    processor->triggerNextPhase();
+  }
+}
+
+void HSSWorkerQueue::finishProcessor(QueueProcessor* processor) {
+  finishMessage(
+      (uint64_t)(STIMER_GET_CURRENT_TIME - processor->getStarted()) / 1000,
+      processor->getLane());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+HSSOverloadReporter::HSSOverloadReporter()
+    : m_report(0),
+      m_dblatency(0),
+      m_dbtarget(0),
+      m_updated(0),
+      m_expires(0),
+      m_refreshed(0),
+      m_oc_supported_features(NULL),
+      m_oc_feature_vector(NULL),
+      m_oc_olr(NULL),
+      m_oc_sequence_number(NULL),
+      m_oc_report_type(NULL),
+      m_oc_reduction_percentage(NULL),
+      m_oc_validity_duration(NULL) {}
+
+HSSOverloadReporter::~HSSOverloadReporter() {
+  delete m_oc_supported_features;
+  delete m_oc_feature_vector;
+  delete m_oc_olr;
+  delete m_oc_sequence_number;
+  delete m_oc_report_type;
+  delete m_oc_reduction_percentage;
+  delete m_oc_validity_duration;
+}
+
+void HSSOverloadReporter::init(uint64_t dbtarget) {
+  m_dbtarget = dbtarget;
+
+  // a sequence number derived from the time keeps increasing across
+  // restarts, the reports are updated less than once a second
+  m_report = ((uint64_t)(STIMER_GET_CURRENT_TIME / 1000000000)) << 16;
+
+  m_oc_supported_features = new FDDictionaryEntryAVP("OC-Supported-Features");
+  m_oc_feature_vector     = new FDDictionaryEntryAVP("OC-Feature-Vector");
+  m_oc_sequence_number    = new FDDictionaryEntryAVP("OC-Sequence-Number");
+  m_oc_report_type        = new FDDictionaryEntryAVP("OC-Report-Type");
+  m_oc_reduction_percentage =
+      new FDDictionaryEntryAVP("OC-Reduction-Percentage");
+  m_oc_validity_duration = new FDDictionaryEntryAVP("OC-Validity-Duration");
+  m_oc_olr               = new FDDictionaryEntryAVP("OC-OLR");
+}
+
+void HSSOverloadReporter::registerDbLatency(uint64_t usec) {
+  if (!enabled()) return;
+
+  // moving average over about 16 queries, a sample lost to a concurrent
+  // update does not matter
+  int64_t avg = (int64_t) __atomic_load_n(&m_dblatency, __ATOMIC_RELAXED);
+  avg += ((int64_t) usec - avg) / 16;
+  __atomic_store_n(&m_dblatency, (uint64_t) avg, __ATOMIC_RELAXED);
+}
+
+void HSSOverloadReporter::addReport(FDMessageAnswer& ans) {
+  if (!enabled()) return;
+
+  struct msg* req = NULL;
+  struct avp* sf  = NULL;
+  struct avp* fv  = NULL;
+
+  if (fd_msg_answ_getq(ans.getMsg(), &req) != 0 || req == NULL ||
+      fd_msg_search_avp(req, m_oc_supported_features->getEntry(), &sf) != 0 ||
+      sf == NULL)
+    return;
+
+  // the loss algorithm is the only one supported, it is implied when the
+  // MME does not send a feature vector
+  if (fd_avp_search_avp(sf, m_oc_feature_vector->getEntry(), &fv) == 0 &&
+      fv != NULL) {
+    struct avp_hdr* hdr = NULL;
+    if (fd_msg_avp_hdr(fv, &hdr) != 0 || hdr->avp_value == NULL ||
+        !(hdr->avp_value->u64 & DOIC_OLR_DEFAULT_ALGO))
+      return;
+  }
+
+  refresh();
+
+  uint64_t r = report();
+
+  try {
+    FDAvpMember features[] = {FDAvpMember(
+        *m_oc_feature_vector, (uint64_t) DOIC_OLR_DEFAULT_ALGO)};
+    ans.add(*m_oc_supported_features, features, 1);
+
+    if (r & REPORT_OLR) {
+      FDAvpMember olr[] = {
+          FDAvpMember(*m_oc_sequence_number, (uint64_t)(r >> 16)),
+          FDAvpMember(*m_oc_report_type, (int32_t) DOIC_HOST_REPORT),
+          FDAvpMember(*m_oc_reduction_percentage, (uint32_t)(r & 0xff)),
+          FDAvpMember(
+              *m_oc_validity_duration,
+              (uint32_t)(r & REPORT_END ? 0 : DOIC_VALIDITY))};
+      ans.add(*m_oc_olr, olr, 4);
+    }
+  } catch (FDException& ex) {
+    Logger::system().error(
+        "HSSOverloadReporter::%s - %s", __func__, ex.what());
+  }
+}
+
+// called for every answer, only the thread that claims the interval reads
+// the signals and updates the report
+void HSSOverloadReporter::refresh() {
+  int64_t now  = STIMER_GET_CURRENT_TIME / 1000000;
+  int64_t last = __atomic_load_n(&m_updated, __ATOMIC_RELAXED);
+
+  if (now - last < DOIC_INTERVAL ||
+      !__atomic_compare_exchange_n(
+          &m_updated, &last, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return;
+
+  HSSWorkerQueue& q = fdHss.getWorkerQueue();
+  HSSLoadSignals s;
+
+  s.queuedepth = q.queueDepth();
+  s.queuemax   = q.maxQueue();
+  s.active     = q.active();
+  s.limit      = q.concurrent();
+  s.dblatency  = __atomic_load_n(&m_dblatency, __ATOMIC_RELAXED);
+  s.dbtarget   = m_dbtarget;
+
+  if (update(s, now))
+    Logger::system().info(
+        "HSSOverloadReporter::%s - reduction %u%% sequence %llu queue %lu "
+        "active %d/%d cassandra %lluus",
+        __func__, reduction(), (unsigned long long) sequence(),
+        (unsigned long) s.queuedepth, s.active, s.limit,
+        (unsigned long long) s.dblatency);
+}
+
+bool HSSOverloadReporter::update(const HSSLoadSignals& signals, int64_t now) {
+  uint64_t cur       = report();
+  uint32_t reduction = computeReduction(signals);
+  uint64_t next      = 0;
+
+  if (reduction > 0)
+    next = REPORT_OLR | reduction;
+  else if ((cur & REPORT_OLR) && now < m_expires)
+    next = REPORT_OLR | REPORT_END;
+
+  // an MME ignores an OC-OLR it has already seen, so an ongoing overload is
+  // re-issued with a new sequence number before the last one expires
+  if ((cur & 0xffff) == next &&
+      !(reduction > 0 && now - m_refreshed >= DOIC_VALIDITY * 1000 / 2))
+    return false;
+
+  if (reduction > 0) {
+    m_refreshed = now;
+    m_expires   = now + DOIC_VALIDITY * 1000;
+  }
+
+  __atomic_store_n(
+      &m_report, (((cur >> 16) + 1) << 16) | next, __ATOMIC_RELAXED);
+
+  return true;
+}
+
+uint32_t HSSOverloadReporter::computeReduction(const HSSLoadSignals& s) {
+  double pressure = 0;
+
+  // the share of the queue bound in use, or of the admitted requests that
+  // are waiting when the queue is not bounded
+  if (s.queuedepth > 0) {
+    if (s.queuemax > 0)
+      pressure = (double) s.queuedepth / s.queuemax;
+    else
+      pressure = (double) s.queuedepth / (s.queuedepth + s.limit);
+  }
+
+  // the share of the Cassandra latency above the acceptable latency, only
+  // while the workers are busy since less traffic does not help a database
+  // that is slow for other reasons
+  if (s.dbtarget > 0 && s.dblatency > s.dbtarget && s.limit > 0 &&
+      s.active >= s.limit * DOIC_UTILISATION) {
+    double excess = 1.0 - (double) s.dbtarget / s.dblatency;
+    if (excess > pressure) pressure = excess;
+  }
+
+  if (pressure >= 1.0) return 100;
+
+  return (uint32_t)(pressure * 100 / DOIC_STEP + 0.5) * DOIC_STEP;
+}
+
+bool HSSOverloadReporter::selfTest() {
+  struct Step {
+    const char* name;
+    int64_t at;  // ms
+    size_t queuedepth;
+    int active;
+    uint64_t dblatency;
+    uint32_t reduction;
+    bool olr;
+    bool end;
+  };
+
+  // queuemax 1000, limit 100 and a Cassandra target of 10ms
+  static const Step steps[] = {
+      {"idle", 0, 0, 10, 2000, 0, false, false},
+      {"busy", 1000, 0, 100, 8000, 0, false, false},
+      {"queue building", 2000, 100, 100, 8000, 10, true, false},
+      {"queue half full", 3000, 500, 100, 9000, 50, true, false},
+      {"queue full", 4000, 1000, 100, 9000, 100, true, false},
+      {"queue full, unchanged", 5000, 1000, 100, 9000, 100, true, false},
+      {"queue full, re-issued", 20000, 1000, 100, 9000, 100, true, false},
+      {"cassandra slow", 21000, 0, 100, 20000, 50, true, false},
+      {"cassandra slow, no load", 22000, 0, 10, 20000, 0, true, true},
+      {"recovered", 30000, 0, 10, 2000, 0, true, true},
+      {"report expired", 52000, 0, 10, 2000, 0, false, false},
+  };
+
+  HSSOverloadReporter r;
+  bool ok       = true;
+  uint64_t prev = r.sequence();
+
+  std::cout << "DOIC self test: queuemax 1000, limit 100, cassandra target "
+               "10000us"
+            << std::endl;
+
+  for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+    const Step& st = steps[i];
+    HSSLoadSignals s;
+
+    s.queuedepth = st.queuedepth;
+    s.queuemax   = 1000;
+    s.active     = st.active;
+    s.limit      = 100;
+    s.dblatency  = st.dblatency;
+    s.dbtarget   = 10000;
+
+    bool changed = r.update(s, st.at);
+    uint64_t rep = r.report();
+    bool olr     = (rep & REPORT_OLR) != 0;
+    bool end     = (rep & REPORT_END) != 0;
+    bool match   = r.reduction() == st.reduction && olr == st.olr &&
+                 end == st.end && changed == (r.sequence() != prev);
+
+    std::cout << (match ? "  ok   " : "  FAIL ") << st.name << ": queue "
+              << st.queuedepth << " active " << st.active << " cassandra "
+              << st.dblatency << "us -> reduction " << r.reduction() << "%"
+              << (olr ? (end ? " (end)" : "") : " (no OC-OLR)") << " sequence "
+              << r.sequence() << std::endl;
+
+    ok   = ok && match;
+    prev = r.sequence();
+  }
+
+  std::cout << "DOIC self test " << (ok ? "passed" : "FAILED") << std::endl;
+
+  return ok;
 }
 
-void HSSWorkerQueue::finishProcessor() {
-  finishMessage();
+////////////////////////////////////////////////////////////////////////////////
+
+void HSSRequestProcessor::triggerNextPhase() {
+  fdHss.getWorkMgr().addWork(
+      new WorkerMessage(WORKER_EVENT, new HSSRequestStateProcessor(this)),
+      getAffinity());
+}
+
+void HSSRequestProcessor::processRequest(HSSRequestProcessor* pthis) {
+  StatsHss::singleton().registerLatency(
+      pthis->m_stat, stat_phase_queue,
+      (uint64_t)(STIMER_GET_CURRENT_TIME - pthis->getReceived()) / 1000);
+
+  // the peer has given up on the request while it was queued
+  if (pthis->expired()) {
+    fdHss.getWorkerQueue().abandonProcessor(pthis);
+    delete pthis->m_req;
+  } else {
+    try {
+      pthis->process(pthis->m_req);
+    } catch (std::exception& ex) {
+      Logger::system().error(
+          "HSSRequestProcessor::%s - EXCEPTION - %s", __func__, ex.what());
+    } catch (...) {
+      Logger::system().error(
+          "HSSRequestProcessor::%s - unknown exception", __func__);
+    }
+  }
+
+  fdHss.getWorkerQueue().finishProcessor(pthis);
+  delete pthis;
+  fdHss.getWorkerQueue().startProcessor();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -136,6 +463,10 @@ bool FDHss::init(hss_config_t* hss_config_p) {
     m_s6aapp = new s6as6d::Application(m_dbobj);
     m_s6capp = new s6c::Application(m_dbobj);
 
+    // report overload to the MME's that support DOIC
+    if (Options::getdoic())
+      m_overload.init((uint64_t) Options::getdoicdblatency() * 1000);
+
     // advertise support for the accounting application
     FDDictionaryEntryVendor vnd3gpp(m_s6tapp->getDict().app());
     m_diameter.advertiseSupport(m_s6tapp->getDict().app(), vnd3gpp, 1, 0);
@@ -144,6 +475,9 @@ bool FDHss::init(hss_config_t* hss_config_p) {
 
     fd_peer_validate_register(s6a_peer_validate);
 
+    // the group CIR's are processed on the RIR reactors
+    m_rirengine.init(Options::getrirthreads());
+
     // TODO get the list of peers from the database
     char* mme    = std::getenv("MME_IDENTITY");
     FDPeer* peer = new FDPeer(mme ? mme : (char*) "mme.localdomain");
@@ -199,9 +533,35 @@ bool FDHss::init(hss_config_t* hss_config_p) {
   HookEvent::init(&StatsHss::singleton(), m_s6tapp, m_s6aapp, m_s6capp);
 
   //
-  // set the ULR queue concurrent value
+  // set the worker queue concurrent value, it adapts between concurrentmin
+  // and concurrentmax to keep the mean latency below latencytarget (ms)
+  //
+  m_workerqueue.setConcurrent(
+      Options::getconcurrent(), Options::getconcurrentmin(),
+      Options::getconcurrentmax());
+  m_workerqueue.setLatencyTarget(Options::getlatencytarget() * 1000);
+  m_workerqueue.setMaxQueue(Options::getqueuemax());
+  m_workerqueue.setBudget(Options::getrequestbudget());
+
+  //
+  // by default the authentication lane is served first and may use the
+  // whole limit, the monitoring events, which fan out to the MME's, at most
+  // half of it
   //
-  m_workerqueue.setConcurrent(Options::getconcurrent());
+  m_workerqueue.setLane(
+      hss_lane_auth, Options::getauthweight(), Options::getauthshare());
+  m_workerqueue.setLane(
+      hss_lane_location, Options::getlocationweight(),
+      Options::getlocationshare());
+  m_workerqueue.setLane(
+      hss_lane_event, Options::geteventweight(), Options::geteventshare());
+
+  //
+  // CIR and NIR run their queries synchronously on a worker thread, keep
+  // at least half of the workers free for the AIR and ULR phases
+  //
+  int workers = Options::getnumworkers();
+  m_workerqueue.setLaneMax(hss_lane_event, workers > 1 ? workers / 2 : 1);
 
   //
   // starts the stats
@@ -233,6 +593,8 @@ void FDHss::shutdown() {
 
   m_diameter.uninit(false);
 
+  m_rirengine.shutdown();
+
   if (StatsHss::singleton().isRunning()) {
     StatsHss::singleton().quit();
   }
@@ -251,6 +613,14 @@ int FDHss::sendINSDRreq(
       cir_monevtcfg, imsi, cir_req, evt_map, rir_builder);
 }
 
+int FDHss::sendINSDRreq(
+    s6t::MonitoringEventConfigurationExtractorList& cir_monevtcfg,
+    std::string& imsi, FDMessageRequest* cir_req, EvenStatusMap* evt_map,
+    DAImsiInfo& imsi_info, RIRBuilder* rir_builder) {
+  return m_s6aapp->sendINSDRreq(
+      cir_monevtcfg, imsi, cir_req, evt_map, imsi_info, rir_builder);
+}
+
 void FDHss::buildCfgStatusAvp(
     FDAvp& mon_evt_cfg_status, MonitoringConfEventStatus& status) {
   mon_evt_cfg_status.add(m_s6tapp->getDict().avpScefId(), status.scef_id);
@@ -337,8 +707,9 @@ bool FDHss::synchFix() {
     eu.u64 += 32;
     U64_TO_SQN(eu, sqn);
 
+    bool pinned;
     result = m_dbobj.updateRandSqn(
-        Options::getsynchimsi(), rand, sqn, false, NULL, NULL);
+        Options::getsynchimsi(), rand, sqn, false, NULL, NULL, pinned);
 
     free(sqn);
   } else {
@@ -455,33 +826,269 @@ void MonitoringConfEventStatus::forceLongTerm(bool is_long_tem) {
   type_set     = true;
 }
 
+///////////////////
+/// RIRREACTOR
+///////////////////
+RIRReactor::RIRReactor() : m_wheel(RIRREACTOR_TICK), m_groups(0) {}
+
+RIRReactor::~RIRReactor() {}
+
+void RIRReactor::onInit() {
+  // a single timer per reactor drives the guard timers of all of its groups
+  m_tick.setInterval(RIRREACTOR_TICK);
+  m_tick.setOneShot(false);
+  initTimer(m_tick);
+  m_tick.start();
+}
+
+void RIRReactor::onQuit() {
+  m_tick.stop();
+}
+
+void RIRReactor::onTimer(SEventThread::Timer& t) {
+  if (t.getId() == m_tick.getId()) m_wheel.advance();
+}
+
+void RIRReactor::dispatch(SEventThreadMessage& msg) {
+  RIRBuilder* builder = ((RIRBuilderEvtMsg&) msg).m_builder;
+  bool done           = false;
+
+  if (msg.getId() == HANDLE_GROUP_START) {
+    m_groups++;
+    done = builder->start();
+  } else if (msg.getId() == HANDLE_IMSI_INFO) {
+    done = builder->handleImsiInfo((HandleImsiInfoEvtMsg&) msg);
+  } else if (msg.getId() == HANDLE_MME_RESPONSE) {
+    done = builder->handleMmeResponse((HandleMmeResponseEvtMsg&) msg);
+  }
+
+  if (done) {
+    m_groups--;
+    delete builder;
+  }
+}
+
+///////////////////
+/// RIRENGINE
+///////////////////
+RIREngine::RIREngine() : m_next(0) {}
+
+RIREngine::~RIREngine() {
+  shutdown();
+}
+
+void RIREngine::init(int threads) {
+  if (threads < 1) threads = 1;
+
+  for (int i = 0; i < threads; i++) {
+    RIRReactor* r = new RIRReactor();
+    r->init(NULL);
+    m_reactors.push_back(r);
+  }
+}
+
+void RIREngine::shutdown() {
+  for (std::vector<RIRReactor*>::iterator it = m_reactors.begin();
+       it != m_reactors.end(); ++it) {
+    (*it)->quit();
+    (*it)->join();
+    delete *it;
+  }
+  m_reactors.clear();
+}
+
+void RIREngine::start(RIRBuilder* builder) {
+  // all of the events of a group are handled by the reactor it starts on
+  long n             = atomic_fetch_inc(m_next);
+  builder->m_reactor = m_reactors[n % m_reactors.size()];
+  builder->postMessage(HANDLE_GROUP_START);
+}
+
 ///////////////////
 /// RIRBUILDER
 ///////////////////
 RIRBuilder::RIRBuilder(
-    int nb_ida_proc, EvenStatusMap* hss_insert_status,
-    std::string& destination_host, std::string& destination_realm)
-    : m_interval(0),
-      m_nb_ida_proc(nb_ida_proc),
+    FDMessageRequest* cir_req, FDMessageAnswer* cia, DAImsiList& list_imsi,
+    EvenStatusMap* hss_insert_status, std::string& destination_host,
+    std::string& destination_realm)
+    : m_reactor(NULL),
+      m_cir_req(cir_req),
+      m_cia(cia),
+      m_list_imsi(list_imsi),
+      m_cir(NULL),
+      m_nb_info_pending(0),
+      m_interval(0),
+      m_nb_ida_proc(list_imsi.size()),
+      m_rirsent(false),
       m_destination_host(destination_host),
       m_destination_realm(destination_realm),
-      m_hss_insert_status(hss_insert_status),
-      m_ciasent(false) {}
+      m_hss_insert_status(hss_insert_status) {}
 
-RIRBuilder::~RIRBuilder() {}
+RIRBuilder::~RIRBuilder() {
+  if (m_cir != NULL) delete m_cir;
+  if (m_cia != NULL) delete m_cia;
+  if (m_cir_req != NULL) delete m_cir_req;
+  if (m_hss_insert_status != NULL) delete m_hss_insert_status;
+}
+
+void RIRBuilder::postMessage(uint16_t message) {
+  postMessage(new RIRBuilderEvtMsg(message));
+}
+
+void RIRBuilder::postMessage(RIRBuilderEvtMsg* msg) {
+  msg->m_builder = this;
+  m_reactor->postMessage(msg);
+}
+
+// runs on a Cassandra I/O thread
+void RIRBuilder::onImsiInfo(CassFuture* future, void* data) {
+  SCassFuture f(future, true);
+  HandleImsiInfoEvtMsg* msg = (HandleImsiInfoEvtMsg*) data;
+
+  // a user that can not be read is reported as not active
+  try {
+    fdHss.getDb().getImsiInfoData(f, msg->m_info);
+  } catch (DAException& ex) {
+    Logger::system().error("RIRBuilder::%s - %s", __func__, ex.what());
+  }
 
-void RIRBuilder::onInit() {
-  m_idletimer.setInterval(m_interval);
-  m_idletimer.setOneShot(false);
-  initTimer(m_idletimer);
-  m_idletimer.start();
+  msg->m_builder->postMessage(msg);
 }
-void RIRBuilder::onQuit() {}
 
-void RIRBuilder::onTimer(SEventThread::Timer& t) {
-  if (t.getId() == m_idletimer.getId()) {
-    postMessage(GUARD_TIMEOUT);
+bool RIRBuilder::start() {
+  // the monitoring event configuration refers to the AVP's of the CIR, so
+  // the IDR's are all sent before the CIA releases the request
+  m_cir = new s6t::ConfigurationInformationRequestExtractor(
+      *m_cir_req, fdHss.gets6tApp()->getDict());
+  m_nb_info_pending = m_list_imsi.size();
+
+  // the results are queued behind this message, so none of them is handled
+  // before the loop completes
+  for (DAImsiList::iterator it_imsi = m_list_imsi.begin();
+       it_imsi != m_list_imsi.end(); ++it_imsi) {
+    HandleImsiInfoEvtMsg* msg = new HandleImsiInfoEvtMsg(*it_imsi);
+    msg->m_builder            = this;
+
+    if (!fdHss.getDb().getImsiInfo(*it_imsi, msg->m_info, onImsiInfo, msg))
+      postMessage(msg);
   }
+  m_list_imsi.clear();
+
+  if (m_nb_info_pending == 0) sendCIA();
+
+  return complete();
+}
+
+bool RIRBuilder::handleImsiInfo(HandleImsiInfoEvtMsg& msg) {
+  fdHss.sendINSDRreq(
+      m_cir->monitoring_event_configuration, msg.m_imsi, m_cir_req,
+      m_hss_insert_status, msg.m_info, this);
+
+  if (--m_nb_info_pending == 0) sendCIA();
+
+  return complete();
+}
+
+void RIRBuilder::sendCIA() {
+  delete m_cir;
+  m_cir = NULL;
+
+  m_cia->send();
+  delete m_cia;
+  m_cia = NULL;
+  delete m_cir_req;
+  m_cir_req = NULL;
+
+  if (m_interval > 0) m_reactor->getWheel().schedule(*this, m_interval);
+}
+
+bool RIRBuilder::handleMmeResponse(
+    HandleMmeResponseEvtMsg& mme_response_msg) {
+  --m_nb_ida_proc;
+
+  ////////////////////////////////////////////////
+  ////////////////////////////////////////////////
+  // m_hss_insert_status contains the global result
+  // of db operations for long term events see s6t_impl.cpp
+  //
+  // mme_response_msg.m_mme_response contains the result
+  // of mme operations for one shot events for a given
+  // imsi
+  //
+  // We need to build a structure grouped by imsi containing
+  // for each imsi: the long term db operations result (coming from
+  // m_hss_insert_status) and the one shot mme operations results
+  // coming from mme_response_msg.m_mme_response
+  ////////////////////////////////////////////////
+  ////////////////////////////////////////////////
+
+  for (EvenStatusMap::iterator it_hss_result = m_hss_insert_status->begin();
+       it_hss_result != m_hss_insert_status->end(); ++it_hss_result) {
+    MonitoringConfEventStatus mixed_cfg = it_hss_result->second;
+
+    // Update the shorterm with the result coming from mme
+    if (!it_hss_result->second.isLongTermEvt()) {
+      if (mme_response_msg.m_mme_response != NULL) {
+        // There was a response coming from mme
+        EvenStatusMap::iterator iter_mmeres =
+            mme_response_msg.m_mme_response->find(it_hss_result->first);
+
+        if (iter_mmeres != mme_response_msg.m_mme_response->end()) {
+          mixed_cfg.result = iter_mmeres->second.result;
+        }
+      } else {
+        // it is a simulated mme response because the mme was down or the ue
+        // was unreachable
+        if (mme_response_msg.m_imsi_reachable == MME_DOWN) {
+          mixed_cfg.result = DIAMETER_UNABLE_TO_COMPLY;
+        } else {
+          mixed_cfg.result = DIAMETER_UNABLE_TO_COMPLY;
+        }
+      }
+    }
+
+    ////////////////////////////
+    ////////////////////////////
+    // Fill the final structure from where the RIR will be built
+    ////////////////////////////
+    ////////////////////////////
+    ImsiStatus imsi_status(
+        mme_response_msg.m_imsi, mixed_cfg, mme_response_msg.m_imsi_reachable,
+        mme_response_msg.m_msisdn);
+    std::pair<std::string, uint32_t> ascef_id = it_hss_result->first;
+
+    EventImsiStatus::iterator imsi_statusiter = imsi_status_map.find(ascef_id);
+    if (imsi_statusiter != imsi_status_map.end()) {
+      imsi_statusiter->second.push_back(imsi_status);
+    } else {
+      std::vector<ImsiStatus> list_imsi;
+      list_imsi.push_back(imsi_status);
+      imsi_status_map[ascef_id] = list_imsi;
+    }
+  }
+
+  if (mme_response_msg.m_mme_response != NULL) {
+    delete mme_response_msg.m_mme_response;
+    mme_response_msg.m_mme_response = NULL;
+  }
+
+  return complete();
+}
+
+bool RIRBuilder::complete() {
+  if (m_cia != NULL || m_nb_ida_proc > 0) return false;
+
+  cancel();
+
+  if (!imsi_status_map.empty() || !m_rirsent) sendRIR();
+
+  return true;
+}
+
+void RIRBuilder::onExpired() {
+  if (!imsi_status_map.empty()) sendRIR();
+
+  m_reactor->getWheel().schedule(*this, m_interval);
 }
 
 void RIRBuilder::sendRIR() {
@@ -556,108 +1163,17 @@ void RIRBuilder::sendRIR() {
   s->dump();
 
   s->send();
-}
 
-void RIRBuilder::dispatch(SEventThreadMessage& msg) {
-  if (msg.getId() == GUARD_TIMEOUT) {
-    sendRIR();
-  } else if (msg.getId() == HANDLE_MME_RESPONSE) {
-    HandleMmeResponseEvtMsg& mme_response_msg = (HandleMmeResponseEvtMsg&) msg;
-
-    --m_nb_ida_proc;
-
-    ////////////////////////////////////////////////
-    ////////////////////////////////////////////////
-    // m_hss_insert_status contains the global result
-    // of db operations for long term events see s6t_impl.cpp
-    //
-    // mme_response_msg.m_mme_response contains the result
-    // of mme operations for one shot events for a given
-    // imsi
-    //
-    // We need to build a structure grouped by imsi containing
-    // for each imsi: the long term db operations result (coming from
-    // m_hss_insert_status) and the one shot mme operations results
-    // coming from mme_response_msg.m_mme_response
-    ////////////////////////////////////////////////
-    ////////////////////////////////////////////////
-
-    for (EvenStatusMap::iterator it_hss_result = m_hss_insert_status->begin();
-         it_hss_result != m_hss_insert_status->end(); ++it_hss_result) {
-      MonitoringConfEventStatus mixed_cfg = it_hss_result->second;
-
-      // Update the shorterm with the result coming from mme
-      if (!it_hss_result->second.isLongTermEvt()) {
-        if (mme_response_msg.m_mme_response != NULL) {
-          // There was a response coming from mme
-          EvenStatusMap::iterator iter_mmeres =
-              mme_response_msg.m_mme_response->find(it_hss_result->first);
-
-          if (iter_mmeres != mme_response_msg.m_mme_response->end()) {
-            mixed_cfg.result = iter_mmeres->second.result;
-          }
-        } else {
-          // it is a simulated mme response because the mme was down or the ue
-          // was unreachable
-          if (mme_response_msg.m_imsi_reachable == MME_DOWN) {
-            mixed_cfg.result = DIAMETER_UNABLE_TO_COMPLY;
-          } else {
-            mixed_cfg.result = DIAMETER_UNABLE_TO_COMPLY;
-          }
-        }
-      }
-
-      ////////////////////////////
-      ////////////////////////////
-      // Fill the final structure from where the RIR will be built
-      ////////////////////////////
-      ////////////////////////////
-      ImsiStatus imsi_status(
-          mme_response_msg.m_imsi, mixed_cfg, mme_response_msg.m_imsi_reachable,
-          mme_response_msg.m_msisdn);
-      std::pair<std::string, uint32_t> ascef_id = it_hss_result->first;
-
-      EventImsiStatus::iterator imsi_statusiter =
-          imsi_status_map.find(ascef_id);
-      if (imsi_statusiter != imsi_status_map.end()) {
-        imsi_statusiter->second.push_back(imsi_status);
-      } else {
-        std::vector<ImsiStatus> list_imsi;
-        list_imsi.push_back(imsi_status);
-        imsi_status_map[ascef_id] = list_imsi;
-      }
-    }
-
-    if (mme_response_msg.m_mme_response != NULL) {
-      delete mme_response_msg.m_mme_response;
-      mme_response_msg.m_mme_response = NULL;
-    }
-
-    if (m_nb_ida_proc == 0 && m_ciasent) {
-      sendRIR();
-      if (m_hss_insert_status != NULL) {
-        delete m_hss_insert_status;
-        m_hss_insert_status = NULL;
-      }
-      quit();
-    }
-  } else if (msg.getId() == HANDLE_CIA_SENT) {
-    m_ciasent = true;
-    if (m_nb_ida_proc == 0) {
-      sendRIR();
-      if (m_hss_insert_status != NULL) {
-        delete m_hss_insert_status;
-        m_hss_insert_status = NULL;
-      }
-      quit();
-    }
-  }
+  // the reports are only sent once, a later RIR for the group carries the
+  // results received since this one
+  imsi_status_map.clear();
+  m_rirsent = true;
 }
 
 HandleMmeResponseEvtMsg::HandleMmeResponseEvtMsg(
     EvenStatusMap* mme_response, std::string& imsi, int imsi_reachable,
     std::string& msisdn)
-    : SEventThreadMessage(HANDLE_MME_RESPONSE),
+    : RIRBuilderEvtMsg(HANDLE_MME_RESPONSE),
       m_mme_response(mme_response),
       m_imsi(imsi),
       m_imsi_reachable(imsi_reachable),
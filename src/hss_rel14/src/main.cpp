@@ -172,10 +172,16 @@ int main(int argc, char** argv) {
   memset(&hss_config, 0, sizeof(hss_config_t));
   Options::fillhssconfig(&hss_config);
 
-  fdHss.getWorkMgr().init(Options::getnumworkers());
+  fdHss.getWorkMgr().init(
+      Options::getnumworkers(), Options::getworkstealing());
 
   random_init();
 
+  if (Options::getdoictest())
+    return HSSOverloadReporter::selfTest() ? 0 : 1;
+
+  if (Options::getmilenagetest()) return milenage_self_test() == 0 ? 0 : 1;
+
   fdHss.initdb(&hss_config);
 
   if (Options::getonlyloadkey()) {
@@ -55,6 +55,8 @@ unsigned Options::m_casscoreconnections = 1;
 unsigned Options::m_cassmaxconnections  = 2;
 unsigned Options::m_cassioqueuesize     = 8192;
 unsigned Options::m_cassiothreads       = 1;
+unsigned Options::m_cachesize           = 0;
+unsigned Options::m_cachettl            = 60;
 bool Options::m_randvector;
 bool Options::m_roamallow;
 std::string Options::m_optkey;
@@ -69,6 +71,23 @@ std::string Options::m_synchimsi;
 std::string Options::m_synchauts;
 int Options::m_numworkers;
 int Options::m_concurrent;
+bool Options::m_workstealing = false;
+int Options::m_rirthreads    = 2;
+int Options::m_concurrentmin = 0;
+int Options::m_concurrentmax = 0;
+int Options::m_queuemax      = 0;
+int Options::m_latencytarget = 0;
+bool Options::m_doic         = false;
+int Options::m_doicdblatency = 10;
+bool Options::m_doictest     = false;
+bool Options::m_milenagetest = false;
+int Options::m_requestbudget = 0;
+int Options::m_authweight     = 4;
+int Options::m_authshare      = 100;
+int Options::m_locationweight = 2;
+int Options::m_locationshare  = 80;
+int Options::m_eventweight    = 1;
+int Options::m_eventshare     = 50;
 uint32_t Options::m_statsfrequency;
 
 void Options::help() {
@@ -116,6 +135,12 @@ void Options::help() {
       << std::endl
       << "      --concurrent num         The number of concurrent transactions "
          "to process"
+      << std::endl
+      << "      --doictest               Check the DOIC overload reports "
+         "against a synthetic overload and exit"
+      << std::endl
+      << "      --milenagetest           Check Milenage against the TS 35.208 "
+         "test sets and exit"
       << std::endl;
 }
 
@@ -228,6 +253,149 @@ bool Options::parseJson() {
       }
       m_cassiothreads = hssSection["cassiothreads"].GetUint();
     }
+    if (hssSection.HasMember("cachesize")) {
+      if (!hssSection["cachesize"].IsInt()) {
+        std::cout << "Error parsing json value: [cachesize]" << std::endl;
+        return false;
+      }
+      m_cachesize = hssSection["cachesize"].GetUint();
+    }
+    if (hssSection.HasMember("cachettl")) {
+      if (!hssSection["cachettl"].IsInt()) {
+        std::cout << "Error parsing json value: [cachettl]" << std::endl;
+        return false;
+      }
+      m_cachettl = hssSection["cachettl"].GetUint();
+    }
+    if (hssSection.HasMember("workstealing")) {
+      if (!hssSection["workstealing"].IsBool()) {
+        std::cout << "Error parsing json value: [workstealing]" << std::endl;
+        return false;
+      }
+      m_workstealing = hssSection["workstealing"].GetBool();
+    }
+    if (hssSection.HasMember("rirthreads")) {
+      if (!hssSection["rirthreads"].IsInt()) {
+        std::cout << "Error parsing json value: [rirthreads]" << std::endl;
+        return false;
+      }
+      m_rirthreads = hssSection["rirthreads"].GetInt();
+    }
+    if (hssSection.HasMember("concurrentmin")) {
+      if (!hssSection["concurrentmin"].IsInt()) {
+        std::cout << "Error parsing json value: [concurrentmin]" << std::endl;
+        return false;
+      }
+      m_concurrentmin = hssSection["concurrentmin"].GetInt();
+    }
+    if (hssSection.HasMember("concurrentmax")) {
+      if (!hssSection["concurrentmax"].IsInt()) {
+        std::cout << "Error parsing json value: [concurrentmax]" << std::endl;
+        return false;
+      }
+      m_concurrentmax = hssSection["concurrentmax"].GetInt();
+    }
+    if (hssSection.HasMember("queuemax")) {
+      if (!hssSection["queuemax"].IsInt()) {
+        std::cout << "Error parsing json value: [queuemax]" << std::endl;
+        return false;
+      }
+      m_queuemax = hssSection["queuemax"].GetInt();
+    }
+    if (hssSection.HasMember("latencytarget")) {
+      if (!hssSection["latencytarget"].IsInt()) {
+        std::cout << "Error parsing json value: [latencytarget]" << std::endl;
+        return false;
+      }
+      m_latencytarget = hssSection["latencytarget"].GetInt();
+    }
+    if (hssSection.HasMember("doic")) {
+      if (!hssSection["doic"].IsBool()) {
+        std::cout << "Error parsing json value: [doic]" << std::endl;
+        return false;
+      }
+      m_doic = hssSection["doic"].GetBool();
+    }
+    if (hssSection.HasMember("doicdblatency")) {
+      if (!hssSection["doicdblatency"].IsInt()) {
+        std::cout << "Error parsing json value: [doicdblatency]" << std::endl;
+        return false;
+      }
+      m_doicdblatency = hssSection["doicdblatency"].GetInt();
+    }
+    if (hssSection.HasMember("requestbudget")) {
+      if (!hssSection["requestbudget"].IsInt()) {
+        std::cout << "Error parsing json value: [requestbudget]" << std::endl;
+        return false;
+      }
+      m_requestbudget = hssSection["requestbudget"].GetInt();
+    }
+    if (hssSection.HasMember("authweight")) {
+      if (!hssSection["authweight"].IsInt()) {
+        std::cout << "Error parsing json value: [authweight]" << std::endl;
+        return false;
+      }
+      m_authweight = hssSection["authweight"].GetInt();
+      if (m_authweight < 1) {
+        std::cout << "Invalid json value: [authweight]" << std::endl;
+        return false;
+      }
+    }
+    if (hssSection.HasMember("authshare")) {
+      if (!hssSection["authshare"].IsInt()) {
+        std::cout << "Error parsing json value: [authshare]" << std::endl;
+        return false;
+      }
+      m_authshare = hssSection["authshare"].GetInt();
+      if (m_authshare < 1 || m_authshare > 100) {
+        std::cout << "Invalid json value: [authshare]" << std::endl;
+        return false;
+      }
+    }
+    if (hssSection.HasMember("locationweight")) {
+      if (!hssSection["locationweight"].IsInt()) {
+        std::cout << "Error parsing json value: [locationweight]" << std::endl;
+        return false;
+      }
+      m_locationweight = hssSection["locationweight"].GetInt();
+      if (m_locationweight < 1) {
+        std::cout << "Invalid json value: [locationweight]" << std::endl;
+        return false;
+      }
+    }
+    if (hssSection.HasMember("locationshare")) {
+      if (!hssSection["locationshare"].IsInt()) {
+        std::cout << "Error parsing json value: [locationshare]" << std::endl;
+        return false;
+      }
+      m_locationshare = hssSection["locationshare"].GetInt();
+      if (m_locationshare < 1 || m_locationshare > 100) {
+        std::cout << "Invalid json value: [locationshare]" << std::endl;
+        return false;
+      }
+    }
+    if (hssSection.HasMember("eventweight")) {
+      if (!hssSection["eventweight"].IsInt()) {
+        std::cout << "Error parsing json value: [eventweight]" << std::endl;
+        return false;
+      }
+      m_eventweight = hssSection["eventweight"].GetInt();
+      if (m_eventweight < 1) {
+        std::cout << "Invalid json value: [eventweight]" << std::endl;
+        return false;
+      }
+    }
+    if (hssSection.HasMember("eventshare")) {
+      if (!hssSection["eventshare"].IsInt()) {
+        std::cout << "Error parsing json value: [eventshare]" << std::endl;
+        return false;
+      }
+      m_eventshare = hssSection["eventshare"].GetInt();
+      if (m_eventshare < 1 || m_eventshare > 100) {
+        std::cout << "Invalid json value: [eventshare]" << std::endl;
+        return false;
+      }
+    }
     if (!(options & randvector) && hssSection.HasMember("randv")) {
       if (!hssSection["randv"].IsBool()) {
         std::cout << "Error parsing json value: [randv]" << std::endl;
@@ -451,6 +619,8 @@ bool Options::parseInputOptions(int argc, char** argv) {
       {"synchauts", required_argument, NULL, 'y'},
       {"numworkers", required_argument, NULL, 'z'},
       {"concurrent", required_argument, NULL, 'A'},
+      {"doictest", no_argument, NULL, 'G'},
+      {"milenagetest", no_argument, NULL, 'M'},
 
       {"roamallow", no_argument, NULL, 'w'},
 
@@ -596,6 +766,14 @@ bool Options::parseInputOptions(int argc, char** argv) {
         options |= concurrent;
         break;
       }
+      case 'G': {
+        m_doictest = true;
+        break;
+      }
+      case 'M': {
+        m_milenagetest = true;
+        break;
+      }
       case 'C': {
         m_casscoreconnections = atoi(optarg);
         break;
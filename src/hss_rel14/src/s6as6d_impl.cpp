@@ -16,6 +16,7 @@
 
 #include <string>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include "logger.h"
 #include "s6as6d_impl.h"
@@ -223,8 +224,10 @@ void UPLRreq::processAnswer(FDMessageAnswer& ans) {
 void display_error_message(const char* err_msg) {}
 
 int UPLRcmd::process(FDMessageRequest* req) {
+  if (!fdHss.getWorkerQueue().admit(req, stat_hss_ulr)) return 0;
+
   ULRProcessor* p = new ULRProcessor(*req, m_app, m_app.getDict());
-  fdHss.getWorkerQueue().addProcessor(p);
+  fdHss.getWorkerQueue().addProcessor(p, hss_lane_location);
   fdHss.getWorkerQueue().startProcessor();
   return 0;
 }
@@ -325,8 +328,10 @@ void AUIRreq::processAnswer(FDMessageAnswer& ans) {
 // AUIR Command (cmd) member function
 
 int AUIRcmd::process(FDMessageRequest* req) {
+  if (!fdHss.getWorkerQueue().admit(req, stat_hss_air)) return 0;
+
   AIRProcessor* p = new AIRProcessor(*req, m_app, m_app.getDict());
-  fdHss.getWorkerQueue().addProcessor(p);
+  fdHss.getWorkerQueue().addProcessor(p, hss_lane_auth);
   fdHss.getWorkerQueue().startProcessor();
   return 0;
 }
@@ -539,6 +544,16 @@ int Application::sendINSDRreq(
   DAImsiInfo imsi_info;
   // 1.get the subscription data from database
   m_dbobj.getImsiInfo((char*) imsi.c_str(), imsi_info, NULL, NULL);
+  return sendINSDRreq(
+      cir_monevtcfg, imsi, cir_req, evt_map, imsi_info, rir_builder);
+}
+
+// Same as above for a user that has already been read, a group CIR reads its
+// users asynchronously from the RIR reactor
+int Application::sendINSDRreq(
+    s6t::MonitoringEventConfigurationExtractorList& cir_monevtcfg,
+    std::string& imsi, FDMessageRequest* cir_req, EvenStatusMap* evt_map,
+    DAImsiInfo& imsi_info, RIRBuilder* rir_builder) {
   bool imsi_attached = (imsi_info.ms_ps_status == "ATTACHED");
   FDPeer peer;
   peer.setDiameterId((DiamId_t) imsi_info.mmehost.c_str());
@@ -594,6 +609,15 @@ int Application::sendINSDRreq(
     s = NULL;
   }
 
+  // no IDA will come back for this imsi, count it as unreachable so the
+  // group still completes
+  if (!s && rir_builder) {
+    HandleMmeResponseEvtMsg* e = new HandleMmeResponseEvtMsg(
+        NULL, imsi, MME_DOWN, imsi_info.str_msisdn);
+    rir_builder->postMessage(e);
+    return true;
+  }
+
   // DO NOT free the newly created INSDRreq object!!
   // It will be deleted by the framework after the
   // answer is received and processed.
@@ -751,77 +775,11 @@ void PUURreq::processAnswer(FDMessageAnswer& ans) {
 
 // Function invoked when a PUUR Command is received
 int PUURcmd::process(FDMessageRequest* req) {
-  std::string s;
-  std::string imsi;
-  uint32_t u32;
-  DAMmeIdentity mme_id;
-  int result_code   = ER_DIAMETER_SUCCESS;
-  bool experimental = false;
-
-  FDMessageAnswer ans(req);
-  ans.addOrigin();
-  s6as6d::PurgeUeRequestExtractor pur(*req, m_app.getDict());
-
-  do {
-    pur.auth_session_state.get(u32);
-    ans.add(m_app.getDict().avpAuthSessionState(), u32);
-
-    pur.user_name.get(imsi);
-    if (imsi.size() > IMSI_LENGTH) {
-      result_code = ER_DIAMETER_INVALID_AVP_VALUE;
-      break;
-    }
-
-    if (pur.pur_flags.get(u32)) {
-      if (FLAG_IS_SET(u32, PUR_UE_PURGED_IN_SGSN)) {
-        result_code = ER_DIAMETER_INVALID_AVP_VALUE;
-        break;
-      }
-    }
-
-    if (!m_app.dataaccess().getMmeIdentityFromImsi(imsi, mme_id)) {
-      experimental = true;
-      result_code  = DIAMETER_ERROR_USER_UNKNOWN;
-      break;
-    }
+  if (!fdHss.getWorkerQueue().admit(req, stat_hss_pur)) return 0;
 
-    if (!m_app.dataaccess().purgeUE(imsi)) {
-      experimental = true;
-      result_code  = DIAMETER_ERROR_USER_UNKNOWN;
-      break;
-    }
-
-    // Get host and realm
-    pur.origin_host.get(s);
-    if (mme_id.mme_host != s) {
-      result_code  = DIAMETER_ERROR_UNKNOWN_SERVING_NODE;
-      experimental = true;
-    }
-
-    pur.origin_realm.get(s);
-    if (mme_id.mme_realm != s) {
-      result_code  = DIAMETER_ERROR_UNKNOWN_SERVING_NODE;
-      experimental = true;
-    }
-    ans.add(m_app.getDict().avpPuaFlags(), 1);
-
-  } while (false);
-
-  // Handle errors
-  if (DIAMETER_ERROR_IS_VENDOR(result_code) && experimental) {
-    FDAvp experimental_result(m_app.getDict().avpExperimentalResult());
-    experimental_result.add(m_app.getDict().avpVendorId(), VENDOR_3GPP);
-    experimental_result.add(
-        m_app.getDict().avpExperimentalResultCode(), result_code);
-    ans.add(experimental_result);
-    StatsHss::singleton().registerStatResult(
-        stat_hss_pur, VENDOR_3GPP, result_code);
-  } else {
-    ans.add(m_app.getDict().avpResultCode(), result_code);
-    StatsHss::singleton().registerStatResult(stat_hss_pur, 0, result_code);
-  }
-
-  ans.send();
+  PURProcessor* p = new PURProcessor(*req, m_app, m_app.getDict());
+  fdHss.getWorkerQueue().addProcessor(p, hss_lane_location);
+  fdHss.getWorkerQueue().startProcessor();
   return 0;
 }
 
@@ -899,14 +857,15 @@ void ULRStateProcessor::process() {
 ULRProcessor::ULRProcessor(
     FDMessageRequest& req, s6as6d::Application& app, s6as6d::Dictionary& dict)
     : m_ulr(req, dict), m_ans(&req), m_app(app), m_dict(dict) {
-  m_perf_timer    = 0;
-  m_present_flags = 0;
-  m_plmn_len      = sizeof(m_plmn_id);
-  m_3count        = 0;
-  m_3aSuccess     = false;
-  m_3bSuccess     = false;
-  m_mmeidentity   = -1;
-  m_ulrflags      = 0;
+  m_perf_timer     = 0;
+  m_infogeneration = 0;
+  m_present_flags  = 0;
+  m_plmn_len       = sizeof(m_plmn_id);
+  m_3count         = 0;
+  m_3aSuccess      = false;
+  m_3bSuccess      = false;
+  m_mmeidentity    = -1;
+  m_ulrflags       = 0;
 
   m_nextphase   = ULRSTATE_PHASE1;
   m_msgissued   = 0;
@@ -914,6 +873,15 @@ ULRProcessor::ULRProcessor(
   m_dbresult    = -1;
   m_dbissued    = 0;
   m_dbevtissued = 0;
+  m_compute     = 0;
+
+  // one for the msisdn lookup and one for the external identifier lookups
+  m_evtidpending = 2;
+
+  // the request is extracted by the constructor of m_ulr
+  StatsHss::singleton().registerLatency(
+      stat_hss_ulr, stat_phase_decode,
+      (uint64_t)(STIMER_GET_CURRENT_TIME - getReceived()) / 1000);
 }
 
 ULRProcessor::~ULRProcessor() {}
@@ -923,6 +891,10 @@ ULRProcessor::~ULRProcessor() {}
 void ULRProcessor::on_ulr_callback(CassFuture* future, void* data) {
   SCassFuture f(future, true);
   ULRDatabaseAction* action = (ULRDatabaseAction*) data;
+
+  uint64_t elapsed = action->getElapsed();
+  StatsHss::singleton().registerLatency(stat_hss_ulr, stat_phase_db, elapsed);
+  fdHss.getOverloadReporter().registerDbLatency(elapsed);
 #ifdef TRACK_EXECUTION
   const char* actions[] = {
       "ULRDB_GET_IMSI_INFO",      "ULRDB_GET_EXT_IDS",
@@ -979,17 +951,39 @@ void ULRProcessor::on_ulr_callback(CassFuture* future, void* data) {
     }
   }
 
-  SMutexLock l(action->getProcessor().m_mutex, false);
-
-  if (l.acquire(false)) action->getProcessor().triggerNextPhase();
-
+  // always post the next phase, a worker that is running the phases right
+  // now may already have looked at m_dbexecuted.  The message is counted
+  // before the query so that the processor can not be released under it.
+  atomic_inc_fetch(action->getProcessor().m_msgissued);
   atomic_dec_fetch(action->getProcessor().m_dbissued);
+  action->getProcessor().postNextPhase();
 }
 
 void ULRProcessor::triggerNextPhase() {
   atomic_inc_fetch(m_msgissued);
-  fdHss.getWorkMgr().addWork(new WorkerMessage(
-      WORKER_EVENT, new ULRStateProcessor(m_nextphase, this)));
+  postNextPhase();
+}
+
+void ULRProcessor::postNextPhase() {
+  fdHss.getWorkMgr().addWork(
+      new WorkerMessage(WORKER_EVENT, new ULRStateProcessor(m_nextphase, this)),
+      getAffinity());
+}
+
+void ULRProcessor::sendAnswer() {
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+
+  fdHss.getOverloadReporter().addReport(m_ans);
+  m_ans.send();
+
+  stimer_t now = STIMER_GET_CURRENT_TIME;
+  StatsHss::singleton().registerLatency(
+      stat_hss_ulr, stat_phase_send, (uint64_t)(now - start) / 1000);
+  StatsHss::singleton().registerLatency(
+      stat_hss_ulr, stat_phase_total, (uint64_t)(now - getReceived()) / 1000);
+  if (m_compute > 0)
+    StatsHss::singleton().registerLatency(
+        stat_hss_ulr, stat_phase_compute, (uint64_t) m_compute / 1000);
 }
 
 bool ULRProcessor::phaseReady(int phase, uint32_t adjustment) {
@@ -1014,8 +1008,9 @@ bool ULRProcessor::phaseReady(int phase, uint32_t adjustment) {
       break;
     }
     case ULRSTATE_PHASE3: {
-      ready = FLAG_IS_SET(m_ulrflags, ULR_SKIP_SUBSCRIBER_DATA) ||
-              (m_dbexecuted & ULRDB_GET_EVNTS_EVNTIDS);
+      // the events are also needed for the roaming status report, so wait
+      // for them even when the subscriber data is skipped
+      ready = m_dbexecuted & ULRDB_GET_EVNTS_EVNTIDS;
       break;
     }
     case ULRSTATE_PHASE4: {
@@ -1056,11 +1051,29 @@ void ULRProcessor::processNextPhase(ULRProcessor* pthis) {
   {
     SMutexLock l(pthis->m_mutex, false);
 
-    // check to see if there is already a worker processing
-    if (!l.acquire(false)) return;
+    // another worker is running the phases, hand the message (and its count
+    // in m_msgissued) back to that worker instead of waiting for the lock
+    if (!l.acquire(false)) {
+      pthis->postNextPhase();
+      return;
+    }
 
     atomic_dec_fetch(pthis->m_msgissued);
 
+    pthis->setAffinity(fdHss.getWorkMgr().currentWorker());
+
+    // the MME has given up on the request, drop it before the answer is
+    // sent.  The final phase waits for the queries already issued, the
+    // location update is only issued after the answer.  The unsent answer
+    // is freed with the processor, which also frees the request it was
+    // created from.
+    if (pthis->m_nextphase >= ULRSTATE_PHASE1 &&
+        pthis->m_nextphase <= ULRSTATE_PHASE3 && pthis->expired()) {
+      fdHss.getWorkerQueue().abandonProcessor(pthis);
+      pthis->m_ans.discard();
+      pthis->m_nextphase = ULRSTATE_PHASEFINAL;
+    }
+
     while (pthis && pthis->phaseReady(pthis->m_nextphase)) {
 #ifdef TRACK_EXECUTION
       printf(
@@ -1104,9 +1117,9 @@ void ULRProcessor::processNextPhase(ULRProcessor* pthis) {
   }
 
   if (deleteProc) {
+    fdHss.getWorkerQueue().finishProcessor(deleteProc);
     delete deleteProc;
     deleteProc = NULL;
-    fdHss.getWorkerQueue().finishProcessor();
     fdHss.getWorkerQueue().startProcessor();
   }
 }
@@ -1115,6 +1128,19 @@ void ULRProcessor::processNextPhase(ULRProcessor* pthis) {
 
 void ULRProcessor::getImsiInfo(SCassFuture& future) {
   bool success = m_app.dataaccess().getImsiInfoData(future, m_orig_info);
+
+  if (success)
+    m_app.dataaccess().cache().putImsiInfo(
+        m_new_info.imsi, m_orig_info, m_infogeneration);
+
+  // there is no point in looking up the events of an abandoned request
+  if (success && !isAbandoned()) {
+    getEventIdsMsisdn();
+  } else {
+    DB_OP_COMPLETE(ULRDB_GET_EVNTIDS_MSISDN, m_dbexecuted, m_dbresult, false);
+    eventIdsComplete();
+  }
+
   DB_OP_COMPLETE(ULRDB_GET_IMSI_INFO, m_dbexecuted, m_dbresult, success);
 }
 
@@ -1122,127 +1148,112 @@ void ULRProcessor::getExternalIds(SCassFuture& future) {
   bool success = m_app.dataaccess().getExtIdsFromImsiData(future, m_extIdLst);
   DB_OP_COMPLETE(ULRDB_GET_EXT_IDS, m_dbexecuted, m_dbresult, success);
 
-  if (success) {
-    bool first = true;
-    std::stringstream ss;
+  if (success && !isAbandoned()) {
+    // look up the event id's for all of the external identifiers at once,
+    // this stage keeps its own count until every query has been issued
+    atomic_add_fetch(m_evtidpending, m_extIdLst.size());
 
     for (auto it = m_extIdLst.begin(); it != m_extIdLst.end(); ++it) {
-      if (first)
-        first = false;
-      else
-        ss << ",";
-      ss << "'" << *it << "'";
+      atomic_inc_fetch(m_dbissued);
+      if (!m_app.dataaccess().getEventIdsFromExtId(
+              *it, m_evtIdLst, on_ulr_callback,
+              new (m_arena)
+                  ULRDatabaseAction(ULRDB_GET_EVNTIDS_EXTIDS, *this))) {
+        DB_OP_COMPLETE_RESULT(m_dbresult, ULRDB_GET_EVNTIDS_EXTIDS, false);
+        atomic_dec_fetch(m_dbissued);
+        eventIdsComplete();
+      }
     }
+  } else {
+    DB_OP_COMPLETE_RESULT(m_dbresult, ULRDB_GET_EVNTIDS_EXTIDS, false);
+  }
 
-    atomic_inc_fetch(m_dbissued);
-    success = m_app.dataaccess().getEventIdsFromExtIds(
-        ss.str(), m_evtIdLst, on_ulr_callback,
-        new ULRDatabaseAction(ULRDB_GET_EVNTIDS_EXTIDS, *this));
-    if (!success) {
-      DB_OP_COMPLETE(ULRDB_GET_EVNTIDS_EXTIDS, m_dbexecuted, m_dbresult, false);
-      DB_OP_COMPLETE(ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, false);
-      atomic_dec_fetch(m_dbissued);
-      return;
-    }
+  eventIdsComplete();
+}
 
-  } else {
-    DB_OP_COMPLETE(ULRDB_GET_EVNTIDS_EXTIDS, m_dbexecuted, m_dbresult, success);
+void ULRProcessor::getEventIdsMsisdn() {
+  atomic_inc_fetch(m_dbissued);
+  bool success = m_app.dataaccess().getEventIdsFromMsisdn(
+      m_orig_info.msisdn, m_evtIdLst, on_ulr_callback,
+      new (m_arena) ULRDatabaseAction(ULRDB_GET_EVNTIDS_MSISDN, *this));
+  if (!success) {
+    DB_OP_COMPLETE(ULRDB_GET_EVNTIDS_MSISDN, m_dbexecuted, m_dbresult, false);
+    atomic_dec_fetch(m_dbissued);
+    eventIdsComplete();
   }
 }
 
 void ULRProcessor::getEventIdsMsisdn(SCassFuture& future) {
-  bool getevents = false;
+  bool success;
 
   {
     SMutexLock l(m_lstmutex);
-    bool success =
-        m_app.dataaccess().getEventIdsFromMsisdnData(future, m_evtIdLst);
-    DB_OP_COMPLETE(ULRDB_GET_EVNTIDS_MSISDN, m_dbexecuted, m_dbresult, success);
-
-    // if the database operation failed, mark the ULRDB_GET_EVNTS_EVNTIDS
-    // as complete and failed also, otherwise of both  ULRDB_GET_EVNTIDS_MSISDN
-    // and ULRDB_GET_EVNTIDS_EXTIDS are complete and successful, issue the query
-    // to get the events
-
-    if (m_dbexecuted & (ULRDB_GET_EVNTIDS_MSISDN | ULRDB_GET_EVNTIDS_EXTIDS) &&
-        m_dbresult & (ULRDB_GET_EVNTIDS_MSISDN | ULRDB_GET_EVNTIDS_EXTIDS)) {
-      getevents = true;
-    } else {
-      getevents = false;
-    }
+    success = m_app.dataaccess().getEventIdsFromMsisdnData(future, m_evtIdLst);
   }
 
-  if (getevents) getEvents();
+  DB_OP_COMPLETE(ULRDB_GET_EVNTIDS_MSISDN, m_dbexecuted, m_dbresult, success);
+  eventIdsComplete();
 }
 
 void ULRProcessor::getEventIdsExternalIds(SCassFuture& future) {
-  bool getevents = false;
+  bool success;
 
   {
     SMutexLock l(m_lstmutex);
-    bool success =
-        m_app.dataaccess().getEventIdsFromExtIdsData(future, m_evtIdLst);
-    DB_OP_COMPLETE(ULRDB_GET_EVNTIDS_MSISDN, m_dbexecuted, m_dbresult, success);
-
-    // if the database operation failed, mark the ULRDB_GET_EVNTS_EVNTIDS
-    // as complete and failed also, otherwise of both  ULRDB_GET_EVNTIDS_MSISDN
-    // and ULRDB_GET_EVNTIDS_EXTIDS are complete and successful, issue the query
-    // to get the events
-
-    if (m_dbexecuted & (ULRDB_GET_EVNTIDS_MSISDN | ULRDB_GET_EVNTIDS_EXTIDS) &&
-        m_dbresult & (ULRDB_GET_EVNTIDS_MSISDN | ULRDB_GET_EVNTIDS_EXTIDS)) {
-      getevents = true;
-    } else {
-      getevents = false;
-    }
+    success = m_app.dataaccess().getEventIdsFromExtIdsData(future, m_evtIdLst);
   }
 
-  if (getevents) getEvents();
+  if (!success)
+    DB_OP_COMPLETE_RESULT(m_dbresult, ULRDB_GET_EVNTIDS_EXTIDS, false);
+  eventIdsComplete();
 }
 
-void ULRProcessor::getEvents() {
-  bool success        = false;
-  std::string scef_id = "";
-  std::list<uint32_t> scef_ref_ids;
+void ULRProcessor::eventIdsComplete() {
+  // the last event id lookup to finish issues the event queries
+  if (atomic_dec_fetch(m_evtidpending) != 0) return;
 
-  if (m_evtIdLst.size() == 0) {
-    DB_OP_COMPLETE(ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, true);
+  DB_OP_COMPLETE_EXECUTED(m_dbexecuted, ULRDB_GET_EVNTIDS_EXTIDS);
+  getEvents();
+}
+
+void ULRProcessor::getEvents() {
+  if (isAbandoned()) {
+    DB_OP_COMPLETE(ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, false);
     return;
   }
 
-  // sort the event id list
+  // the msisdn and the external identifiers can reference the same event
   m_evtIdLst.sort(DAEventIdList::compare);
-
-  for (auto it = m_evtIdLst.begin(); it != m_evtIdLst.end(); ++it) {
-    if (scef_id != (*it)->scef_id && scef_ref_ids.size() > 0) {
-      // issue the query
-      atomic_inc_fetch(m_dbissued);
-      success = m_app.dataaccess().getEvents(
-          scef_id.c_str(), scef_ref_ids, m_evtLst, on_ulr_callback,
-          new ULRDatabaseAction(ULRDB_GET_EVNTS_EVNTIDS, *this));
-      if (!success) {
-        DB_OP_COMPLETE(
-            ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, false);
-        atomic_dec_fetch(m_dbissued);
-        return;
-      }
-
-      // set for the next scef_id
-      scef_ref_ids.clear();
-      scef_id = (*it)->scef_id;
+  for (auto it = m_evtIdLst.begin(); it != m_evtIdLst.end();) {
+    auto next = std::next(it);
+    if (next != m_evtIdLst.end() && (*it)->scef_id == (*next)->scef_id &&
+        (*it)->scef_ref_id == (*next)->scef_ref_id) {
+      delete *next;
+      m_evtIdLst.erase(next);
+    } else {
+      it = next;
     }
+  }
 
-    scef_ref_ids.push_back((*it)->scef_ref_id);
+  if (m_evtIdLst.empty()) {
+    DB_OP_COMPLETE(ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, true);
+    return;
   }
 
-  if (scef_ref_ids.size() > 0) {
+  // issue all of the event queries concurrently, the count has to be in
+  // place before the first one is issued since a callback can complete
+  // before the loop does
+  m_dbevtissued = m_evtIdLst.size();
+
+  for (auto it = m_evtIdLst.begin(); it != m_evtIdLst.end(); ++it) {
     atomic_inc_fetch(m_dbissued);
-    success = m_app.dataaccess().getEvents(
-        scef_id.c_str(), scef_ref_ids, m_evtLst, on_ulr_callback,
-        new ULRDatabaseAction(ULRDB_GET_EVNTS_EVNTIDS, *this));
-    if (!success) {
-      DB_OP_COMPLETE(ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, false);
+    if (!m_app.dataaccess().getEvent(
+            (*it)->scef_id, (*it)->scef_ref_id, m_evtLst, on_ulr_callback,
+            new (m_arena) ULRDatabaseAction(ULRDB_GET_EVNTS_EVNTIDS, *this))) {
       atomic_dec_fetch(m_dbissued);
+      DB_OP_COMPLETE_RESULT(m_dbresult, ULRDB_GET_EVNTS_EVNTIDS, false);
+      if (atomic_dec_fetch(m_dbevtissued) == 0)
+        DB_OP_COMPLETE_EXECUTED(m_dbexecuted, ULRDB_GET_EVNTS_EVNTIDS);
     }
   }
 }
@@ -1251,13 +1262,14 @@ void ULRProcessor::getEvents(SCassFuture& future) {
   bool success;
 
   {
-    SMutexLock l(m_mutex);
+    SMutexLock l(m_lstmutex);
     success = m_app.dataaccess().getEventsData(future, m_evtLst);
-    if (!success)
-      DB_OP_COMPLETE_RESULT(m_dbresult, ULRDB_GET_EVNTS_EVNTIDS, false);
-    if (atomic_dec_fetch(m_dbevtissued) == 0)
-      DB_OP_COMPLETE_EXECUTED(m_dbexecuted, ULRDB_GET_EVNTS_EVNTIDS);
   }
+
+  if (!success)
+    DB_OP_COMPLETE_RESULT(m_dbresult, ULRDB_GET_EVNTS_EVNTIDS, false);
+  if (atomic_dec_fetch(m_dbevtissued) == 0)
+    DB_OP_COMPLETE_EXECUTED(m_dbexecuted, ULRDB_GET_EVNTS_EVNTIDS);
 }
 
 void ULRProcessor::updateImsiInfo(SCassFuture& future) {
@@ -1292,7 +1304,7 @@ void ULRProcessor::phase1() {
   m_ulr.user_name.get(m_new_info.imsi);
   if (m_new_info.imsi.length() > IMSI_LENGTH) {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1319,61 +1331,58 @@ void ULRProcessor::phase1() {
   //
 
   bool result;
+  bool cached;
 
   m_nextphase = ULRSTATE_PHASE2;
 
-  result = m_app.dataaccess().getImsiInfo(
-      m_new_info.imsi.c_str(), m_orig_info, on_ulr_callback,
-      new ULRDatabaseAction(ULRDB_GET_IMSI_INFO, *this));
+  cached = m_app.dataaccess().cache().getImsiInfo(
+      m_new_info.imsi, m_orig_info, m_infogeneration);
+
+  // the event id's for the msisdn are looked up once the msisdn is known,
+  // either here from the cache or from the getImsiInfo() callback
+  if (cached) {
+    DB_OP_COMPLETE(ULRDB_GET_IMSI_INFO, m_dbexecuted, m_dbresult, true);
+    getEventIdsMsisdn();
+    result = true;
+  } else {
+    atomic_inc_fetch(m_dbissued);
+    result = m_app.dataaccess().getImsiInfo(
+        m_new_info.imsi.c_str(), m_orig_info, on_ulr_callback,
+        new (m_arena) ULRDatabaseAction(ULRDB_GET_IMSI_INFO, *this));
+    if (!result) atomic_dec_fetch(m_dbissued);
+  }
 
   if (result) {
     atomic_inc_fetch(m_dbissued);
     result = m_app.dataaccess().getExtIdsFromImsi(
         m_new_info.imsi.c_str(), m_extIdLst, on_ulr_callback,
-        new ULRDatabaseAction(ULRDB_GET_EXT_IDS, *this));
+        new (m_arena) ULRDatabaseAction(ULRDB_GET_EXT_IDS, *this));
     if (!result) {
       DB_OP_COMPLETE(ULRDB_GET_EXT_IDS, m_dbexecuted, m_dbresult, result);
-      DB_OP_COMPLETE(
-          ULRDB_GET_EVNTIDS_EXTIDS, m_dbexecuted, m_dbresult, result);
-      DB_OP_COMPLETE(ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, result);
       atomic_dec_fetch(m_dbissued);
+      eventIdsComplete();
     }
   } else {
     DB_OP_COMPLETE(ULRDB_GET_IMSI_INFO, m_dbexecuted, m_dbresult, result);
   }
 
-  if (result) {
-    atomic_inc_fetch(m_dbissued);
-    result = m_app.dataaccess().getEventIdsFromMsisdn(
-        m_new_info.msisdn, m_evtIdLst, on_ulr_callback,
-        new ULRDatabaseAction(ULRDB_GET_EVNTIDS_MSISDN, *this));
-    if (!result) {
-      DB_OP_COMPLETE(
-          ULRDB_GET_EVNTIDS_MSISDN, m_dbexecuted, m_dbresult, result);
-      DB_OP_COMPLETE(ULRDB_GET_EVNTS_EVNTIDS, m_dbexecuted, m_dbresult, result);
-      atomic_dec_fetch(m_dbissued);
-    }
-  }
-
   if (result) {
     atomic_inc_fetch(m_dbissued);
     result = m_app.dataaccess().getMmeIdFromHost(
         m_new_info.mmehost, m_mmeidentity, on_ulr_callback,
-        new ULRDatabaseAction(ULRDB_GET_MMEID_HOST, *this));
+        new (m_arena) ULRDatabaseAction(ULRDB_GET_MMEID_HOST, *this));
     if (!result) {
       DB_OP_COMPLETE(ULRDB_GET_MMEID_HOST, m_dbexecuted, m_dbresult, result);
       atomic_dec_fetch(m_dbissued);
     }
   }
 
-  if (result) {
-    atomic_inc_fetch(m_dbissued);
-  } else {
+  if (!result) {
     FDAvp er(m_dict.avpExperimentalResult());
     er.add(m_dict.avpVendorId(), VENDOR_3GPP);
     er.add(m_dict.avpExperimentalResultCode(), DIAMETER_ERROR_USER_UNKNOWN);
     m_ans.add(er);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, VENDOR_3GPP, DIAMETER_ERROR_USER_UNKNOWN);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1391,7 +1400,7 @@ void ULRProcessor::phase2() {
     er.add(m_dict.avpVendorId(), VENDOR_3GPP);
     er.add(m_dict.avpExperimentalResultCode(), DIAMETER_ERROR_USER_UNKNOWN);
     m_ans.add(er);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, VENDOR_3GPP, DIAMETER_ERROR_USER_UNKNOWN);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1405,7 +1414,7 @@ void ULRProcessor::phase2() {
   if (u32 != 1004 ||
       FLAG_IS_SET(m_orig_info.access_restriction, E_UTRAN_NOT_ALLOWED)) {
     m_ans.add(m_dict.avpResultCode(), DIAMETER_ERROR_RAT_NOT_ALLOWED);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, VENDOR_3GPP, DIAMETER_ERROR_RAT_NOT_ALLOWED);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1416,7 +1425,7 @@ void ULRProcessor::phase2() {
 
   if (FLAG_IS_SET(u32, ULR_SINGLE_REGISTRATION_IND)) {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1424,7 +1433,7 @@ void ULRProcessor::phase2() {
   }
   if (!FLAG_IS_SET(u32, ULR_S6A_S6D_INDICATOR)) {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1432,7 +1441,7 @@ void ULRProcessor::phase2() {
   }
   if (FLAG_IS_SET(u32, ULR_NODE_TYPE_IND)) {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1450,7 +1459,7 @@ void ULRProcessor::phase2() {
             m_dict.avpExperimentalResultCode(),
             DIAMETER_ERROR_UNKNOWN_SERVING_NODE);
         m_ans.add(er);
-        m_ans.send();
+        sendAnswer();
         StatsHss::singleton().registerStatResult(
             stat_hss_ulr, VENDOR_3GPP, DIAMETER_ERROR_UNKNOWN_SERVING_NODE);
         m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1463,7 +1472,7 @@ void ULRProcessor::phase2() {
             m_dict.avpExperimentalResultCode(),
             DIAMETER_ERROR_UNKNOWN_SERVING_NODE);
         m_ans.add(er);
-        m_ans.send();
+        sendAnswer();
         StatsHss::singleton().registerStatResult(
             stat_hss_ulr, VENDOR_3GPP, DIAMETER_ERROR_UNKNOWN_SERVING_NODE);
         m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1476,7 +1485,7 @@ void ULRProcessor::phase2() {
           m_dict.avpExperimentalResultCode(),
           DIAMETER_ERROR_UNKNOWN_SERVING_NODE);
       m_ans.add(er);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_ulr, VENDOR_3GPP, DIAMETER_ERROR_UNKNOWN_SERVING_NODE);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1486,7 +1495,7 @@ void ULRProcessor::phase2() {
 
   if (!ULR_PAD_VALID(u32)) {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1496,7 +1505,7 @@ void ULRProcessor::phase2() {
   if (m_ulr.visited_plmn_id.get(m_plmn_id, m_plmn_len)) {
     if (m_plmn_len != 3) {
       m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1507,7 +1516,7 @@ void ULRProcessor::phase2() {
     }
   } else {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1517,7 +1526,7 @@ void ULRProcessor::phase2() {
   if (m_ulr.terminal_information.imei.get(m_new_info.imei)) {
     if (m_new_info.imei.length() > IMEI_LENGTH) {
       m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1528,7 +1537,7 @@ void ULRProcessor::phase2() {
   if (m_ulr.terminal_information.software_version.get(m_new_info.imei_sv)) {
     if (m_new_info.imei_sv.size() != SV_LENGTH) {
       m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1538,7 +1547,7 @@ void ULRProcessor::phase2() {
   }
   if (m_ulr.terminal_information.tgpp2_meid.get(s)) {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_ulr, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1576,16 +1585,20 @@ void ULRProcessor::phase2() {
   if (!FLAG_IS_SET(m_ulrflags, ULR_SKIP_SUBSCRIBER_DATA)) {
     ULR_TIMER_SET(ulr4, m_perf_timer);
 
-    if (fdJsonAddAvps(
-            m_orig_info.subscription_data.c_str(), m_ans.getMsg(),
-            &s6as6d::display_error_message) != 0) {
+    stimer_t start = STIMER_GET_CURRENT_TIME;
+    int res        = m_app.dataaccess().addSubscriptionData(
+        m_new_info.imsi, m_orig_info.subscription_data, m_ans.getMsg(),
+        &s6as6d::display_error_message);
+    m_compute += STIMER_GET_CURRENT_TIME - start;
+
+    if (res != 0) {
       FDAvp er(m_dict.avpExperimentalResult());
       er.add(m_dict.avpVendorId(), VENDOR_3GPP);
       er.add(
           m_dict.avpExperimentalResultCode(),
           DIAMETER_ERROR_UNKNOWN_EPS_SUBSCRIPTION);
       m_ans.add(er);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_ulr, VENDOR_3GPP, DIAMETER_ERROR_UNKNOWN_EPS_SUBSCRIPTION);
       printf("%s:%d - ULRProcessor::phase2() aborting\n", __FILE__, __LINE__);
@@ -1598,39 +1611,28 @@ void ULRProcessor::phase2() {
 }
 
 void ULRProcessor::phase3() {
+  // the events were fetched concurrently by the phase 1 queries
   if (!FLAG_IS_SET(m_ulrflags, ULR_SKIP_SUBSCRIBER_DATA)) {
-    for (DAExtIdList::iterator it = m_extIdLst.begin(); it != m_extIdLst.end();
-         ++it) {
-      m_app.dataaccess().getEventIdsFromExtId(*it, m_evtIdLst);
-    }
-
-    // get the events associated with the event id's
-    for (DAEventIdList::iterator it = m_evtIdLst.begin();
-         it != m_evtIdLst.end(); ++it) {
-      DAEvent* e = new DAEvent();
-
-      if (m_app.dataaccess().getEvent((*it)->scef_id, (*it)->scef_ref_id, *e))
-        m_evtLst.push_back(e);
-      else
-        delete e;
-    }
-
     if (!m_evtLst.empty()) {
+      stimer_t start = STIMER_GET_CURRENT_TIME;
       s6as6d::UpdateLocationAnswerExtractor ula(m_ans, m_dict);
       FDAvp sd(
           m_dict.avpSubscriptionData(),
           (struct avp*) ula.subscription_data.getReference(), false);
       for (DAEventList::iterator it = m_evtLst.begin(); it != m_evtLst.end();
            ++it) {
-        sd.addJson((*it)->mec_json);
+        FDJsonEncodingPtr mec = m_app.dataaccess().getEventEncoding(
+            **it, &s6as6d::display_error_message);
+        if (mec) mec->addTo(sd.getAvp(), &s6as6d::display_error_message);
       }
+      m_compute += STIMER_GET_CURRENT_TIME - start;
     }
   }
 
   ULR_TIMER_SET(ulr6, m_perf_timer);
 
   m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_SUCCESS);
-  m_ans.send();
+  sendAnswer();
 
   StatsHss::singleton().registerStatResult(
       stat_hss_ulr, 0, ER_DIAMETER_SUCCESS);
@@ -1724,7 +1726,7 @@ void ULRProcessor::phase4() {
   atomic_inc_fetch(m_dbissued);
   bool success = m_app.dataaccess().updateLocation(
       m_new_info, m_present_flags, m_mmeidentity, on_ulr_callback,
-      new ULRDatabaseAction(ULRDB_UPDATE_IMSI, *this));
+      new (m_arena) ULRDatabaseAction(ULRDB_UPDATE_IMSI, *this));
   if (!success) {
     DB_OP_COMPLETE(ULRDB_UPDATE_IMSI, m_dbexecuted, m_dbresult, false);
     atomic_dec_fetch(m_dbissued);
@@ -1762,12 +1764,21 @@ AIRProcessor::AIRProcessor(
   m_auts_len    = sizeof(m_auts);
   m_auts_set    = false;
 
+  m_secgeneration = 0;
+  m_sqnpinned     = false;
+
   m_nextphase   = AIRSTATE_PHASE1;
   m_msgissued   = 0;
   m_dbexecuted  = 0;
   m_dbresult    = -1;
   m_dbissued    = 0;
   m_dbevtissued = 0;
+  m_compute     = 0;
+
+  // the request is extracted by the constructor of m_air
+  StatsHss::singleton().registerLatency(
+      stat_hss_air, stat_phase_decode,
+      (uint64_t)(STIMER_GET_CURRENT_TIME - getReceived()) / 1000);
 }
 
 AIRProcessor::~AIRProcessor() {}
@@ -1777,6 +1788,10 @@ AIRProcessor::~AIRProcessor() {}
 void AIRProcessor::on_air_callback(CassFuture* future, void* data) {
   SCassFuture f(future, true);
   AIRDatabaseAction* action = (AIRDatabaseAction*) data;
+
+  uint64_t elapsed = action->getElapsed();
+  StatsHss::singleton().registerLatency(stat_hss_air, stat_phase_db, elapsed);
+  fdHss.getOverloadReporter().registerDbLatency(elapsed);
 #ifdef TRACK_EXECUTION
   const char* actions[] = {"AIRDB_GET_IMSI_SEC", "AIRDB_UPDATE_IMSI",
                            "UNKNOWN"};
@@ -1800,17 +1815,39 @@ void AIRProcessor::on_air_callback(CassFuture* future, void* data) {
     }
   }
 
-  SMutexLock l(action->getProcessor().m_mutex, false);
-
-  if (l.acquire(false)) action->getProcessor().triggerNextPhase();
-
+  // always post the next phase, a worker that is running the phases right
+  // now may already have looked at m_dbexecuted.  The message is counted
+  // before the query so that the processor can not be released under it.
+  atomic_inc_fetch(action->getProcessor().m_msgissued);
   atomic_dec_fetch(action->getProcessor().m_dbissued);
+  action->getProcessor().postNextPhase();
 }
 
 void AIRProcessor::triggerNextPhase() {
   atomic_inc_fetch(m_msgissued);
-  fdHss.getWorkMgr().addWork(new WorkerMessage(
-      WORKER_EVENT, new AIRStateProcessor(m_nextphase, this)));
+  postNextPhase();
+}
+
+void AIRProcessor::postNextPhase() {
+  fdHss.getWorkMgr().addWork(
+      new WorkerMessage(WORKER_EVENT, new AIRStateProcessor(m_nextphase, this)),
+      getAffinity());
+}
+
+void AIRProcessor::sendAnswer() {
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+
+  fdHss.getOverloadReporter().addReport(m_ans);
+  m_ans.send();
+
+  stimer_t now = STIMER_GET_CURRENT_TIME;
+  StatsHss::singleton().registerLatency(
+      stat_hss_air, stat_phase_send, (uint64_t)(now - start) / 1000);
+  StatsHss::singleton().registerLatency(
+      stat_hss_air, stat_phase_total, (uint64_t)(now - getReceived()) / 1000);
+  if (m_compute > 0)
+    StatsHss::singleton().registerLatency(
+        stat_hss_air, stat_phase_compute, (uint64_t) m_compute / 1000);
 }
 
 bool AIRProcessor::phaseReady(int phase, uint32_t adjustment) {
@@ -1860,11 +1897,26 @@ void AIRProcessor::processNextPhase(AIRProcessor* pthis) {
   {
     SMutexLock l(pthis->m_mutex, false);
 
-    // check to see if there is already a worker processing
-    if (!l.acquire(false)) return;
+    // another worker is running the phases, hand the message (and its count
+    // in m_msgissued) back to that worker instead of waiting for the lock
+    if (!l.acquire(false)) {
+      pthis->postNextPhase();
+      return;
+    }
 
     atomic_dec_fetch(pthis->m_msgissued);
 
+    pthis->setAffinity(fdHss.getWorkMgr().currentWorker());
+
+    // see ULRProcessor::processNextPhase(), the new rand and sqn are not
+    // stored since they were never sent
+    if (pthis->m_nextphase >= AIRSTATE_PHASE1 &&
+        pthis->m_nextphase <= AIRSTATE_PHASE2 && pthis->expired()) {
+      fdHss.getWorkerQueue().abandonProcessor(pthis);
+      pthis->m_ans.discard();
+      pthis->m_nextphase = AIRSTATE_PHASEFINAL;
+    }
+
     while (pthis && pthis->phaseReady(pthis->m_nextphase)) {
 #ifdef TRACK_EXECUTION
       printf(
@@ -1900,8 +1952,8 @@ void AIRProcessor::processNextPhase(AIRProcessor* pthis) {
   }
 
   if (deleteProc) {
+    fdHss.getWorkerQueue().finishProcessor(deleteProc);
     delete deleteProc;
-    fdHss.getWorkerQueue().finishProcessor();
     fdHss.getWorkerQueue().startProcessor();
   }
 }
@@ -1910,11 +1962,14 @@ void AIRProcessor::processNextPhase(AIRProcessor* pthis) {
 
 void AIRProcessor::getImsiSec(SCassFuture& future) {
   bool success = m_app.dataaccess().getImsiSecData(future, m_sec);
+  if (success)
+    m_app.dataaccess().cache().putImsiSec(m_imsi, m_sec, m_secgeneration);
   DB_OP_COMPLETE(AIRDB_GET_IMSI_SEC, m_dbexecuted, m_dbresult, success);
 }
 
 void AIRProcessor::updateImsi(SCassFuture& future) {
   bool success = future.errorCode() == CASS_OK;
+  if (m_sqnpinned) m_app.dataaccess().cache().updateRandSqnComplete(m_imsi);
   DB_OP_COMPLETE(AIRDB_UPDATE_IMSI, m_dbexecuted, m_dbresult, success);
 
   if (!success) {
@@ -1937,7 +1992,7 @@ void AIRProcessor::phase1() {
   m_air.user_name.get(m_imsi);
   if (m_imsi.length() > IMSI_LENGTH) {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_air, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1953,7 +2008,7 @@ void AIRProcessor::phase1() {
     eutran_avp_found = true;
     if (m_num_vectors > AUTH_MAX_EUTRAN_VECTORS) {
       m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_air, 0, ER_DIAMETER_INVALID_AVP_VALUE);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1975,7 +2030,7 @@ void AIRProcessor::phase1() {
       er.add(
           m_dict.avpExperimentalResultCode(), DIAMETER_ERROR_RAT_NOT_ALLOWED);
       m_ans.add(er);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_air, VENDOR_3GPP, DIAMETER_ERROR_RAT_NOT_ALLOWED);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -1989,7 +2044,7 @@ void AIRProcessor::phase1() {
       er.add(
           m_dict.avpExperimentalResultCode(), DIAMETER_ERROR_RAT_NOT_ALLOWED);
       m_ans.add(er);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_air, VENDOR_3GPP, DIAMETER_ERROR_RAT_NOT_ALLOWED);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -2007,7 +2062,7 @@ void AIRProcessor::phase1() {
               m_dict.avpExperimentalResultCode(),
               DIAMETER_ERROR_ROAMING_NOT_ALLOWED);
           m_ans.add(er);
-          m_ans.send();
+          sendAnswer();
           StatsHss::singleton().registerStatResult(
               stat_hss_air, VENDOR_3GPP, DIAMETER_ERROR_ROAMING_NOT_ALLOWED);
           m_nextphase = ULRSTATE_PHASEFINAL;
@@ -2016,7 +2071,7 @@ void AIRProcessor::phase1() {
       }
     } else {
       m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-      m_ans.send();
+      sendAnswer();
       StatsHss::singleton().registerStatResult(
           stat_hss_air, 0, ER_DIAMETER_INVALID_AVP_VALUE);
       m_nextphase = ULRSTATE_PHASEFINAL;
@@ -2024,7 +2079,7 @@ void AIRProcessor::phase1() {
     }
   } else {
     m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_INVALID_AVP_VALUE);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_air, 0, ER_DIAMETER_INVALID_AVP_VALUE);
     m_nextphase = ULRSTATE_PHASEFINAL;
@@ -2033,9 +2088,11 @@ void AIRProcessor::phase1() {
 
   m_nextphase = AIRSTATE_PHASE2;
 
-  if (m_app.dataaccess().getImsiSec(
-          m_imsi, m_sec, on_air_callback,
-          new AIRDatabaseAction(AIRDB_GET_IMSI_SEC, *this))) {
+  if (m_app.dataaccess().cache().getImsiSec(m_imsi, m_sec, m_secgeneration)) {
+    DB_OP_COMPLETE(AIRDB_GET_IMSI_SEC, m_dbexecuted, m_dbresult, true);
+  } else if (m_app.dataaccess().getImsiSec(
+                 m_imsi, m_sec, on_air_callback,
+                 new (m_arena) AIRDatabaseAction(AIRDB_GET_IMSI_SEC, *this))) {
     atomic_inc_fetch(m_dbissued);
   } else {
     FDAvp er(m_dict.avpExperimentalResult());
@@ -2044,7 +2101,7 @@ void AIRProcessor::phase1() {
         m_dict.avpExperimentalResultCode(),
         DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE);
     m_ans.add(er);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_air, VENDOR_3GPP, DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE);
     m_nextphase = AIRSTATE_PHASEFINAL;
@@ -2059,7 +2116,7 @@ void AIRProcessor::phase2() {
         m_dict.avpExperimentalResultCode(),
         DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE);
     m_ans.add(er);
-    m_ans.send();
+    sendAnswer();
     StatsHss::singleton().registerStatResult(
         stat_hss_air, VENDOR_3GPP, DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE);
     m_nextphase = AIRSTATE_PHASEFINAL;
@@ -2088,33 +2145,36 @@ void AIRProcessor::phase2() {
     }
   }
 
-  for (uint32_t i = 0; i < m_num_vectors; i++) {
-    generate_random_cpp(m_vector[i].rand, RAND_LENGTH);
-    generate_vector_cpp(
-        m_sec.opc, m_uimsi, m_sec.key, m_plmn_id, m_sec.sqn, &m_vector[i]);
-  }
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+
+  // generate all of the requested vectors in a single pass
+  generate_vectors_cpp(
+      m_sec.opc, m_sec.key, m_plmn_id, m_sec.sqn, m_num_vectors, m_vector);
 
   memcpy(m_sec.rand, m_vector[0].rand, sizeof(m_sec.rand));
 
   for (uint32_t i = 0; i < m_num_vectors; i++) {
     FDAvp authentication_info(m_dict.avpAuthenticationInfo());
-    FDAvp eurtran_vector(m_dict.avpEUtranVector());
-
-    eurtran_vector.add(
-        m_dict.avpRand(), m_vector[i].rand, sizeof(m_vector[i].rand));
-    eurtran_vector.add(
-        m_dict.avpXres(), m_vector[i].xres, sizeof(m_vector[i].xres));
-    eurtran_vector.add(
-        m_dict.avpAutn(), m_vector[i].autn, sizeof(m_vector[i].autn));
-    eurtran_vector.add(
-        m_dict.avpKasme(), m_vector[i].kasme, sizeof(m_vector[i].kasme));
-
-    authentication_info.add(eurtran_vector);
+    FDAvpMember eutran_vector[] = {
+        FDAvpMember(
+            m_dict.avpRand(), m_vector[i].rand, sizeof(m_vector[i].rand)),
+        FDAvpMember(
+            m_dict.avpXres(), m_vector[i].xres, sizeof(m_vector[i].xres)),
+        FDAvpMember(
+            m_dict.avpAutn(), m_vector[i].autn, sizeof(m_vector[i].autn)),
+        FDAvpMember(
+            m_dict.avpKasme(), m_vector[i].kasme, sizeof(m_vector[i].kasme))};
+
+    authentication_info.add(
+        m_dict.avpEUtranVector(), eutran_vector,
+        sizeof(eutran_vector) / sizeof(eutran_vector[0]));
     m_ans.add(authentication_info);
   }
 
+  m_compute += STIMER_GET_CURRENT_TIME - start;
+
   m_ans.add(m_dict.avpResultCode(), ER_DIAMETER_SUCCESS);
-  m_ans.send();
+  sendAnswer();
   StatsHss::singleton().registerStatResult(
       stat_hss_air, 0, ER_DIAMETER_SUCCESS);
 
@@ -2123,7 +2183,9 @@ void AIRProcessor::phase2() {
   // combine the rand and sqn updates into a single database update
   if (m_app.dataaccess().updateRandSqn(
           m_imsi, m_vector[m_num_vectors - 1].rand, m_sec.sqn, true,
-          on_air_callback, new AIRDatabaseAction(AIRDB_UPDATE_IMSI, *this))) {
+          on_air_callback,
+          new (m_arena) AIRDatabaseAction(AIRDB_UPDATE_IMSI, *this),
+          m_sqnpinned)) {
     atomic_inc_fetch(m_dbissued);
   } else {
     m_nextphase = AIRSTATE_PHASEFINAL;
@@ -2133,3 +2195,316 @@ void AIRProcessor::phase2() {
 void AIRProcessor::phase3() {
   m_nextphase = AIRSTATE_PHASEFINAL;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+PURStateProcessor::PURStateProcessor(uint16_t state, PURProcessor* purproc)
+    : m_state(state), m_processor(purproc) {}
+
+PURStateProcessor::~PURStateProcessor() {}
+
+void PURStateProcessor::process() {
+  if (!m_processor) return;
+
+  PURProcessor::processNextPhase(m_processor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+PURProcessor::PURProcessor(
+    FDMessageRequest& req, s6as6d::Application& app, s6as6d::Dictionary& dict)
+    : m_pur(req, dict), m_ans(&req), m_app(app), m_dict(dict) {
+  m_mme_id = 0;
+
+  m_nextphase  = PURSTATE_PHASE1;
+  m_msgissued  = 0;
+  m_dbexecuted = 0;
+  m_dbresult   = -1;
+  m_dbissued   = 0;
+
+  // the request is extracted by the constructor of m_pur
+  StatsHss::singleton().registerLatency(
+      stat_hss_pur, stat_phase_decode,
+      (uint64_t)(STIMER_GET_CURRENT_TIME - getReceived()) / 1000);
+}
+
+PURProcessor::~PURProcessor() {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PURProcessor::on_pur_callback(CassFuture* future, void* data) {
+  SCassFuture f(future, true);
+  PURDatabaseAction* action = (PURDatabaseAction*) data;
+
+  uint64_t elapsed = action->getElapsed();
+  StatsHss::singleton().registerLatency(stat_hss_pur, stat_phase_db, elapsed);
+  fdHss.getOverloadReporter().registerDbLatency(elapsed);
+
+  switch (action->getAction()) {
+    case PURDB_GET_MMEID_IMSI: {
+      action->getProcessor().getMmeIdFromImsi(f);
+      break;
+    }
+    case PURDB_GET_MMEIDENTITY: {
+      action->getProcessor().getMmeIdentity(f);
+      break;
+    }
+    case PURDB_PURGE_UE: {
+      action->getProcessor().purgeUE(f);
+      break;
+    }
+  }
+
+  // see AIRProcessor::on_air_callback()
+  atomic_inc_fetch(action->getProcessor().m_msgissued);
+  atomic_dec_fetch(action->getProcessor().m_dbissued);
+  action->getProcessor().postNextPhase();
+}
+
+void PURProcessor::triggerNextPhase() {
+  atomic_inc_fetch(m_msgissued);
+  postNextPhase();
+}
+
+void PURProcessor::postNextPhase() {
+  fdHss.getWorkMgr().addWork(
+      new WorkerMessage(WORKER_EVENT, new PURStateProcessor(m_nextphase, this)),
+      getAffinity());
+}
+
+void PURProcessor::sendAnswer(int result_code, bool experimental) {
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+
+  if (DIAMETER_ERROR_IS_VENDOR(result_code) && experimental) {
+    FDAvp er(m_dict.avpExperimentalResult());
+    er.add(m_dict.avpVendorId(), VENDOR_3GPP);
+    er.add(m_dict.avpExperimentalResultCode(), result_code);
+    m_ans.add(er);
+    StatsHss::singleton().registerStatResult(
+        stat_hss_pur, VENDOR_3GPP, result_code);
+  } else {
+    m_ans.add(m_dict.avpResultCode(), result_code);
+    StatsHss::singleton().registerStatResult(stat_hss_pur, 0, result_code);
+  }
+
+  fdHss.getOverloadReporter().addReport(m_ans);
+  m_ans.send();
+
+  stimer_t now = STIMER_GET_CURRENT_TIME;
+  StatsHss::singleton().registerLatency(
+      stat_hss_pur, stat_phase_send, (uint64_t)(now - start) / 1000);
+  StatsHss::singleton().registerLatency(
+      stat_hss_pur, stat_phase_total, (uint64_t)(now - getReceived()) / 1000);
+
+  m_nextphase = PURSTATE_PHASEFINAL;
+}
+
+bool PURProcessor::phaseReady(int phase, uint32_t adjustment) {
+  bool ready = false;
+
+  switch (phase) {
+    case PURSTATE_PHASE1: {
+      ready = true;
+      break;
+    }
+    case PURSTATE_PHASE2: {
+      ready = m_dbexecuted & PURDB_GET_MMEID_IMSI;
+      break;
+    }
+    case PURSTATE_PHASE3: {
+      ready = m_dbexecuted & PURDB_GET_MMEIDENTITY;
+      break;
+    }
+    case PURSTATE_PHASE4: {
+      ready = m_dbexecuted & PURDB_PURGE_UE;
+      break;
+    }
+    case PURSTATE_PHASEFINAL: {
+      ready = ((m_dbissued - adjustment) <= 0 && m_msgissued == 0);
+      break;
+    }
+  }
+
+  return ready;
+}
+
+void PURProcessor::processNextPhase(PURProcessor* pthis) {
+  PURProcessor* deleteProc = NULL;
+
+  {
+    SMutexLock l(pthis->m_mutex, false);
+
+    // see AIRProcessor::processNextPhase()
+    if (!l.acquire(false)) {
+      pthis->postNextPhase();
+      return;
+    }
+
+    atomic_dec_fetch(pthis->m_msgissued);
+
+    pthis->setAffinity(fdHss.getWorkMgr().currentWorker());
+
+    // see ULRProcessor::processNextPhase(), a purge that was already issued
+    // still completes, only its answer is dropped
+    if (pthis->m_nextphase >= PURSTATE_PHASE1 &&
+        pthis->m_nextphase <= PURSTATE_PHASE4 && pthis->expired()) {
+      fdHss.getWorkerQueue().abandonProcessor(pthis);
+      pthis->m_ans.discard();
+      pthis->m_nextphase = PURSTATE_PHASEFINAL;
+    }
+
+    while (pthis && pthis->phaseReady(pthis->m_nextphase)) {
+      switch (pthis->m_nextphase) {
+        case PURSTATE_PHASE1: {
+          pthis->phase1();
+          break;
+        }
+        case PURSTATE_PHASE2: {
+          pthis->phase2();
+          break;
+        }
+        case PURSTATE_PHASE3: {
+          pthis->phase3();
+          break;
+        }
+        case PURSTATE_PHASE4: {
+          pthis->phase4();
+          break;
+        }
+        case PURSTATE_PHASEFINAL: {
+          deleteProc = pthis;
+          pthis      = NULL;
+          break;
+        }
+        default: {
+          Logger::s6as6d().warn(
+              "Unrecognized PURSTATE (%u)", pthis->m_nextphase);
+          pthis = NULL;
+          break;
+        }
+      }
+    }
+  }
+
+  if (deleteProc) {
+    fdHss.getWorkerQueue().finishProcessor(deleteProc);
+    delete deleteProc;
+    fdHss.getWorkerQueue().startProcessor();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PURProcessor::getMmeIdFromImsi(SCassFuture& future) {
+  bool success =
+      m_app.dataaccess().getMmeIdentityFromImsiData(future, m_mme_id);
+  DB_OP_COMPLETE(PURDB_GET_MMEID_IMSI, m_dbexecuted, m_dbresult, success);
+}
+
+void PURProcessor::getMmeIdentity(SCassFuture& future) {
+  bool success = m_app.dataaccess().getMmeIdentityData(future, m_mmeid);
+  DB_OP_COMPLETE(PURDB_GET_MMEIDENTITY, m_dbexecuted, m_dbresult, success);
+}
+
+void PURProcessor::purgeUE(SCassFuture& future) {
+  bool success = m_app.dataaccess().purgeUEData(future, m_imsi);
+  DB_OP_COMPLETE(PURDB_PURGE_UE, m_dbexecuted, m_dbresult, success);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PURProcessor::phase1() {
+  uint32_t u32;
+
+  m_ans.addOrigin();
+
+  m_pur.auth_session_state.get(u32);
+  m_ans.add(m_dict.avpAuthSessionState(), u32);
+
+  m_pur.user_name.get(m_imsi);
+  if (m_imsi.size() > IMSI_LENGTH) {
+    sendAnswer(ER_DIAMETER_INVALID_AVP_VALUE, false);
+    return;
+  }
+
+  if (m_pur.pur_flags.get(u32)) {
+    if (FLAG_IS_SET(u32, PUR_UE_PURGED_IN_SGSN)) {
+      sendAnswer(ER_DIAMETER_INVALID_AVP_VALUE, false);
+      return;
+    }
+  }
+
+  m_nextphase = PURSTATE_PHASE2;
+
+  if (m_app.dataaccess().getMmeIdentityFromImsi(
+          m_imsi, m_mme_id, on_pur_callback,
+          new (m_arena) PURDatabaseAction(PURDB_GET_MMEID_IMSI, *this))) {
+    atomic_inc_fetch(m_dbissued);
+  } else {
+    sendAnswer(DIAMETER_ERROR_USER_UNKNOWN, true);
+  }
+}
+
+void PURProcessor::phase2() {
+  if (!(m_dbresult & PURDB_GET_MMEID_IMSI)) {
+    sendAnswer(DIAMETER_ERROR_USER_UNKNOWN, true);
+    return;
+  }
+
+  m_nextphase = PURSTATE_PHASE3;
+
+  if (m_app.dataaccess().getMmeIdentity(
+          m_mme_id, m_mmeid, on_pur_callback,
+          new (m_arena) PURDatabaseAction(PURDB_GET_MMEIDENTITY, *this))) {
+    atomic_inc_fetch(m_dbissued);
+  } else {
+    sendAnswer(DIAMETER_ERROR_USER_UNKNOWN, true);
+  }
+}
+
+void PURProcessor::phase3() {
+  if (!(m_dbresult & PURDB_GET_MMEIDENTITY)) {
+    sendAnswer(DIAMETER_ERROR_USER_UNKNOWN, true);
+    return;
+  }
+
+  m_nextphase = PURSTATE_PHASE4;
+
+  if (m_app.dataaccess().purgeUE(
+          m_imsi, on_pur_callback,
+          new (m_arena) PURDatabaseAction(PURDB_PURGE_UE, *this))) {
+    atomic_inc_fetch(m_dbissued);
+  } else {
+    sendAnswer(DIAMETER_ERROR_USER_UNKNOWN, true);
+  }
+}
+
+void PURProcessor::phase4() {
+  std::string s;
+  int result_code   = ER_DIAMETER_SUCCESS;
+  bool experimental = false;
+
+  if (!(m_dbresult & PURDB_PURGE_UE)) {
+    sendAnswer(DIAMETER_ERROR_USER_UNKNOWN, true);
+    return;
+  }
+
+  // the UE is purged even if the request did not come from the serving MME
+  m_pur.origin_host.get(s);
+  if (m_mmeid.mme_host != s) {
+    result_code  = DIAMETER_ERROR_UNKNOWN_SERVING_NODE;
+    experimental = true;
+  }
+
+  m_pur.origin_realm.get(s);
+  if (m_mmeid.mme_realm != s) {
+    result_code  = DIAMETER_ERROR_UNKNOWN_SERVING_NODE;
+    experimental = true;
+  }
+
+  m_ans.add(m_dict.avpPuaFlags(), 1);
+
+  sendAnswer(result_code, experimental);
+}
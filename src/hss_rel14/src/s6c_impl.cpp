@@ -21,6 +21,7 @@
 #include "dataaccess.h"
 #include "s6c_impl.h"
 #include "statshss.h"
+#include "satomic.h"
 
 namespace s6c {
 
@@ -105,183 +106,11 @@ void SERIFSRreq::processAnswer(FDMessageAnswer& ans) {
 #define SRR_FLAGS_SINGLE_ATTEMPT_DELIVERY 4
 
 int SERIFSRcmd::process(FDMessageRequest* req) {
-  SendRoutingInfoForSmRequestExtractor srr(*req, getDict());
-  std::string msisdn;
-  std::string imsi;
-  int sm_delivery_not_intended = -1;
-  DAImsiInfo info;
-  DAMmeIdentity mmeid;
-  uint32_t srr_flags;
-
-  //
-  // start populating the answer
-  //
-  FDMessageAnswer ans(req);
-  FDAvp vsai(getDict().avpVendorSpecificApplicationId());
-  vsai.add(getDict().avpVendorId(), getDict().vnd3GPP().getId());
-  vsai.add(getDict().avpAuthApplicationId(), getDict().app().getId());
-  ans.add(vsai);
-  ans.add(srr.auth_session_state);
-  ans.addOrigin();
-
-  //
-  // get the MSISDN or IMSI
-  //
-  if (srr.msisdn.exists()) {
-    uint8_t data[MAX_MSISDN_LENGTH];
-    size_t len = sizeof(data);
-
-    srr.msisdn.get(data, len);
-
-    FDUtility::tbcd2str(data, len, msisdn);
-  } else if (srr.user_name.exists()) {
-    srr.user_name.get(imsi);
-  } else {
-    ans.add(getDict().avpResultCode(), 5005);  // DIAMETER_MISSING_AVP
-    FDAvp fa(getDict().avpFailedAvp());
-    fa.add(getDict().avpMsisdn(), "");
-    ans.add(fa);
-    ans.send();
-    StatsHss::singleton().registerStatResult(stat_hss_srr, 0, 5005);
-    return 0;
-  }
-
-  //
-  // get SM-Delivery-Not-Intended
-  //
-  srr.sm_delivery_not_intended.get(sm_delivery_not_intended);
-
-  //
-  // get SRR-Flags
-  //
-  srr.srr_flags.get(srr_flags);
-
-  //
-  // check to see if the msisdn exists
-  //
-  if (!msisdn.empty()) {
-    if (!getApplication().getDbObj().getImsiFromMsisdn(msisdn, imsi)) {
-      FDAvp er(getDict().avpExperimentalResult());
-      er.add(getDict().avpVendorId(), getDict().vnd3GPP().getId());
-      er.add(
-          getDict().avpExperimentalResultCode(),
-          5001);  // DIAMETER_ERROR_USER_UNKNOWN
-      ans.send();
-      StatsHss::singleton().registerStatResult(
-          stat_hss_srr, getDict().vnd3GPP().getId(), 5001);
-      return 0;
-    }
-  }
-
-  //
-  // lookup the imsi
-  //
-  if (!getApplication().getDbObj().getImsiInfo(imsi, info, NULL, NULL)) {
-    FDAvp er(getDict().avpExperimentalResult());
-    er.add(getDict().avpVendorId(), getDict().vnd3GPP().getId());
-    er.add(
-        getDict().avpExperimentalResultCode(),
-        5001);  // DIAMETER_ERROR_USER_UNKNOWN
-    ans.add(er);
-    ans.send();
-    StatsHss::singleton().registerStatResult(
-        stat_hss_srr, getDict().vnd3GPP().getId(), 5001);
-    return 0;
-  }
-
-  //
-  // lookup the mme info
-  //
-  if (!getApplication().getDbObj().getMmeIdentity(info.mme_id, mmeid)) {
-    FDAvp er(getDict().avpExperimentalResult());
-    er.add(getDict().avpVendorId(), getDict().vnd3GPP().getId());
-    er.add(
-        getDict().avpExperimentalResultCode(),
-        5001);  // DIAMETER_ERROR_USER_UNKNOWN
-    ans.add(er);
-    ans.send();
-    StatsHss::singleton().registerStatResult(
-        stat_hss_srr, getDict().vnd3GPP().getId(), 5001);
-    return 0;
-  }
-
-  //
-  // check for an attachd session
-  //
-  if (info.ms_ps_status != "ATTACHED") {
-    FDAvp er(getDict().avpExperimentalResult());
-    er.add(getDict().avpVendorId(), getDict().vnd3GPP().getId());
-    er.add(
-        getDict().avpExperimentalResultCode(),
-        5550);  // DIAMETER_ERROR_ABSENT_USER
-    ans.add(er);
-    ans.send();
-    StatsHss::singleton().registerStatResult(
-        stat_hss_srr, getDict().vnd3GPP().getId(), 5550);
-    return 0;
-  }
-
-  //
-  // add the Result-Code
-  //
-  ans.add(getDict().avpResultCode(), 2001);  // DIAMETER_SUCCESS
-  StatsHss::singleton().registerStatResult(stat_hss_srr, 0, 2001);
-
-  //
-  // add the User-Name AVP
-  //
-  switch (sm_delivery_not_intended) {
-    case 1:  // ONLY_MCC_MNC_REQUESTED
-    {
-      //
-      // THIS IS NOT CORRECT.  The MCC/MNC needs to be added to the database
-      // and retrieved from there.
-      //
-      ans.add(
-          getDict().avpUserName(),
-          info.imsi.substr(0, info.imsi.length() == 14 ? 5 : 6));
-      break;
-    }
-    case -1:  // SM-Delivery-Not-Intended AVP not present in request
-    case 0:   // ONLY_IMSI_REQUESTED
-    {
-      ans.add(getDict().avpUserName(), info.imsi);
-      break;
-    }
-  }
-
-  //
-  // add the Serving-Node
-  //
-  if (sm_delivery_not_intended == -1) {
-    FDAvp sn(getDict().avpServingNode());
-    sn.add(getDict().avpMmeName(), info.mmehost);
-    sn.add(getDict().avpMmeRealm(), info.mmerealm);
-
-    uint8_t buf[MAX_MSISDN_LENGTH];
-    size_t len = FDUtility::str2tbcd(mmeid.mme_isdn, buf, sizeof(buf));
-    sn.add(getDict().avpMmeNumberForMtSms(), buf, len);
-
-    ans.add(sn);
-  }
-
-  //
-  // add the User-Identifier if needed
-  //
-  if (msisdn != info.str_msisdn) {
-    FDAvp ui(getDict().avpUserIdentifier());
-    uint8_t buf[MAX_MSISDN_LENGTH];
-    size_t len = FDUtility::str2tbcd(info.str_msisdn, buf, sizeof(buf));
-    ui.add(getDict().avpMsisdn(), buf, len);
-
-    ans.add(ui);
-  }
-
-  //
-  // send the answer
-  //
-  ans.send();
+  if (!fdHss.getWorkerQueue().admit(req, stat_hss_srr)) return 0;
 
+  SRRProcessor* p = new SRRProcessor(*req, m_app, getDict());
+  fdHss.getWorkerQueue().addProcessor(p, hss_lane_location);
+  fdHss.getWorkerQueue().startProcessor();
   return 0;
 }
 
@@ -392,3 +221,397 @@ int RESDSRcmd::process(FDMessageRequest* req) {
 }
 
 }  // namespace s6c
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+SRRStateProcessor::SRRStateProcessor(uint16_t state, SRRProcessor* srrproc)
+    : m_state(state), m_processor(srrproc) {}
+
+SRRStateProcessor::~SRRStateProcessor() {}
+
+void SRRStateProcessor::process() {
+  if (!m_processor) return;
+
+  SRRProcessor::processNextPhase(m_processor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+SRRProcessor::SRRProcessor(
+    FDMessageRequest& req, s6c::Application& app, s6c::Dictionary& dict)
+    : m_srr(req, dict), m_ans(&req), m_app(app), m_dict(dict) {
+  m_sm_delivery_not_intended = -1;
+
+  m_nextphase  = SRRSTATE_PHASE1;
+  m_msgissued  = 0;
+  m_dbexecuted = 0;
+  m_dbresult   = -1;
+  m_dbissued   = 0;
+
+  // the request is extracted by the constructor of m_srr
+  StatsHss::singleton().registerLatency(
+      stat_hss_srr, stat_phase_decode,
+      (uint64_t)(STIMER_GET_CURRENT_TIME - getReceived()) / 1000);
+}
+
+SRRProcessor::~SRRProcessor() {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SRRProcessor::on_srr_callback(CassFuture* future, void* data) {
+  SCassFuture f(future, true);
+  SRRDatabaseAction* action = (SRRDatabaseAction*) data;
+
+  uint64_t elapsed = action->getElapsed();
+  StatsHss::singleton().registerLatency(stat_hss_srr, stat_phase_db, elapsed);
+  fdHss.getOverloadReporter().registerDbLatency(elapsed);
+
+  switch (action->getAction()) {
+    case SRRDB_GET_IMSI_MSISDN: {
+      action->getProcessor().getImsiFromMsisdn(f);
+      break;
+    }
+    case SRRDB_GET_IMSI_INFO: {
+      action->getProcessor().getImsiInfo(f);
+      break;
+    }
+    case SRRDB_GET_MMEIDENTITY: {
+      action->getProcessor().getMmeIdentity(f);
+      break;
+    }
+  }
+
+  // see AIRProcessor::on_air_callback()
+  atomic_inc_fetch(action->getProcessor().m_msgissued);
+  atomic_dec_fetch(action->getProcessor().m_dbissued);
+  action->getProcessor().postNextPhase();
+}
+
+void SRRProcessor::triggerNextPhase() {
+  atomic_inc_fetch(m_msgissued);
+  postNextPhase();
+}
+
+void SRRProcessor::postNextPhase() {
+  fdHss.getWorkMgr().addWork(
+      new WorkerMessage(WORKER_EVENT, new SRRStateProcessor(m_nextphase, this)),
+      getAffinity());
+}
+
+void SRRProcessor::setResult(int result_code, bool experimental) {
+  if (experimental) {
+    FDAvp er(m_dict.avpExperimentalResult());
+    er.add(m_dict.avpVendorId(), m_dict.vnd3GPP().getId());
+    er.add(m_dict.avpExperimentalResultCode(), result_code);
+    m_ans.add(er);
+    StatsHss::singleton().registerStatResult(
+        stat_hss_srr, m_dict.vnd3GPP().getId(), result_code);
+  } else {
+    m_ans.add(m_dict.avpResultCode(), result_code);
+    StatsHss::singleton().registerStatResult(stat_hss_srr, 0, result_code);
+  }
+}
+
+void SRRProcessor::sendAnswer() {
+  stimer_t start = STIMER_GET_CURRENT_TIME;
+
+  fdHss.getOverloadReporter().addReport(m_ans);
+  m_ans.send();
+
+  stimer_t now = STIMER_GET_CURRENT_TIME;
+  StatsHss::singleton().registerLatency(
+      stat_hss_srr, stat_phase_send, (uint64_t)(now - start) / 1000);
+  StatsHss::singleton().registerLatency(
+      stat_hss_srr, stat_phase_total, (uint64_t)(now - getReceived()) / 1000);
+
+  m_nextphase = SRRSTATE_PHASEFINAL;
+}
+
+bool SRRProcessor::phaseReady(int phase, uint32_t adjustment) {
+  bool ready = false;
+
+  switch (phase) {
+    case SRRSTATE_PHASE1: {
+      ready = true;
+      break;
+    }
+    case SRRSTATE_PHASE2: {
+      ready = m_dbexecuted & SRRDB_GET_IMSI_MSISDN;
+      break;
+    }
+    case SRRSTATE_PHASE3: {
+      ready = m_dbexecuted & SRRDB_GET_IMSI_INFO;
+      break;
+    }
+    case SRRSTATE_PHASE4: {
+      ready = m_dbexecuted & SRRDB_GET_MMEIDENTITY;
+      break;
+    }
+    case SRRSTATE_PHASEFINAL: {
+      ready = ((m_dbissued - adjustment) <= 0 && m_msgissued == 0);
+      break;
+    }
+  }
+
+  return ready;
+}
+
+void SRRProcessor::processNextPhase(SRRProcessor* pthis) {
+  SRRProcessor* deleteProc = NULL;
+
+  {
+    SMutexLock l(pthis->m_mutex, false);
+
+    // see AIRProcessor::processNextPhase()
+    if (!l.acquire(false)) {
+      pthis->postNextPhase();
+      return;
+    }
+
+    atomic_dec_fetch(pthis->m_msgissued);
+
+    pthis->setAffinity(fdHss.getWorkMgr().currentWorker());
+
+    // see ULRProcessor::processNextPhase()
+    if (pthis->m_nextphase >= SRRSTATE_PHASE1 &&
+        pthis->m_nextphase <= SRRSTATE_PHASE4 && pthis->expired()) {
+      fdHss.getWorkerQueue().abandonProcessor(pthis);
+      pthis->m_ans.discard();
+      pthis->m_nextphase = SRRSTATE_PHASEFINAL;
+    }
+
+    while (pthis && pthis->phaseReady(pthis->m_nextphase)) {
+      switch (pthis->m_nextphase) {
+        case SRRSTATE_PHASE1: {
+          pthis->phase1();
+          break;
+        }
+        case SRRSTATE_PHASE2: {
+          pthis->phase2();
+          break;
+        }
+        case SRRSTATE_PHASE3: {
+          pthis->phase3();
+          break;
+        }
+        case SRRSTATE_PHASE4: {
+          pthis->phase4();
+          break;
+        }
+        case SRRSTATE_PHASEFINAL: {
+          deleteProc = pthis;
+          pthis      = NULL;
+          break;
+        }
+        default: {
+          Logger::s6c().warn("Unrecognized SRRSTATE (%u)", pthis->m_nextphase);
+          pthis = NULL;
+          break;
+        }
+      }
+    }
+  }
+
+  if (deleteProc) {
+    fdHss.getWorkerQueue().finishProcessor(deleteProc);
+    delete deleteProc;
+    fdHss.getWorkerQueue().startProcessor();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SRRProcessor::getImsiFromMsisdn(SCassFuture& future) {
+  bool success = m_app.getDbObj().getImsiFromMsisdnData(future, m_imsi);
+  DB_OP_COMPLETE(SRRDB_GET_IMSI_MSISDN, m_dbexecuted, m_dbresult, success);
+}
+
+void SRRProcessor::getImsiInfo(SCassFuture& future) {
+  bool success = m_app.getDbObj().getImsiInfoData(future, m_info);
+  DB_OP_COMPLETE(SRRDB_GET_IMSI_INFO, m_dbexecuted, m_dbresult, success);
+}
+
+void SRRProcessor::getMmeIdentity(SCassFuture& future) {
+  bool success = m_app.getDbObj().getMmeIdentityData(future, m_mmeid);
+  DB_OP_COMPLETE(SRRDB_GET_MMEIDENTITY, m_dbexecuted, m_dbresult, success);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void SRRProcessor::phase1() {
+  //
+  // start populating the answer
+  //
+  FDAvp vsai(m_dict.avpVendorSpecificApplicationId());
+  vsai.add(m_dict.avpVendorId(), m_dict.vnd3GPP().getId());
+  vsai.add(m_dict.avpAuthApplicationId(), m_dict.app().getId());
+  m_ans.add(vsai);
+  m_ans.add(m_srr.auth_session_state);
+  m_ans.addOrigin();
+
+  //
+  // get the MSISDN or IMSI
+  //
+  if (m_srr.msisdn.exists()) {
+    uint8_t data[MAX_MSISDN_LENGTH];
+    size_t len = sizeof(data);
+
+    m_srr.msisdn.get(data, len);
+
+    FDUtility::tbcd2str(data, len, m_msisdn);
+  } else if (m_srr.user_name.exists()) {
+    m_srr.user_name.get(m_imsi);
+  } else {
+    setResult(5005, false);  // DIAMETER_MISSING_AVP
+    FDAvp fa(m_dict.avpFailedAvp());
+    fa.add(m_dict.avpMsisdn(), "");
+    m_ans.add(fa);
+    sendAnswer();
+    return;
+  }
+
+  //
+  // get SM-Delivery-Not-Intended
+  //
+  m_srr.sm_delivery_not_intended.get(m_sm_delivery_not_intended);
+
+  m_nextphase = SRRSTATE_PHASE2;
+
+  //
+  // check to see if the msisdn exists
+  //
+  if (m_msisdn.empty()) {
+    DB_OP_COMPLETE(SRRDB_GET_IMSI_MSISDN, m_dbexecuted, m_dbresult, true);
+  } else if (m_app.getDbObj().getImsiFromMsisdn(
+                 strtoll(m_msisdn.c_str(), NULL, 10), m_imsi, on_srr_callback,
+                 new (m_arena)
+                     SRRDatabaseAction(SRRDB_GET_IMSI_MSISDN, *this))) {
+    atomic_inc_fetch(m_dbissued);
+  } else {
+    setResult(5001, true);  // DIAMETER_ERROR_USER_UNKNOWN
+    sendAnswer();
+  }
+}
+
+void SRRProcessor::phase2() {
+  if (!(m_dbresult & SRRDB_GET_IMSI_MSISDN)) {
+    setResult(5001, true);  // DIAMETER_ERROR_USER_UNKNOWN
+    sendAnswer();
+    return;
+  }
+
+  m_nextphase = SRRSTATE_PHASE3;
+
+  //
+  // lookup the imsi
+  //
+  if (m_app.getDbObj().getImsiInfo(
+          m_imsi, m_info, on_srr_callback,
+          new (m_arena) SRRDatabaseAction(SRRDB_GET_IMSI_INFO, *this))) {
+    atomic_inc_fetch(m_dbissued);
+  } else {
+    setResult(5001, true);  // DIAMETER_ERROR_USER_UNKNOWN
+    sendAnswer();
+  }
+}
+
+void SRRProcessor::phase3() {
+  if (!(m_dbresult & SRRDB_GET_IMSI_INFO)) {
+    setResult(5001, true);  // DIAMETER_ERROR_USER_UNKNOWN
+    sendAnswer();
+    return;
+  }
+
+  m_nextphase = SRRSTATE_PHASE4;
+
+  //
+  // lookup the mme info
+  //
+  if (m_app.getDbObj().getMmeIdentity(
+          m_info.mme_id, m_mmeid, on_srr_callback,
+          new (m_arena) SRRDatabaseAction(SRRDB_GET_MMEIDENTITY, *this))) {
+    atomic_inc_fetch(m_dbissued);
+  } else {
+    setResult(5001, true);  // DIAMETER_ERROR_USER_UNKNOWN
+    sendAnswer();
+  }
+}
+
+void SRRProcessor::phase4() {
+  if (!(m_dbresult & SRRDB_GET_MMEIDENTITY)) {
+    setResult(5001, true);  // DIAMETER_ERROR_USER_UNKNOWN
+    sendAnswer();
+    return;
+  }
+
+  //
+  // check for an attachd session
+  //
+  if (m_info.ms_ps_status != "ATTACHED") {
+    setResult(5550, true);  // DIAMETER_ERROR_ABSENT_USER
+    sendAnswer();
+    return;
+  }
+
+  //
+  // add the Result-Code
+  //
+  setResult(2001, false);  // DIAMETER_SUCCESS
+
+  //
+  // add the User-Name AVP
+  //
+  switch (m_sm_delivery_not_intended) {
+    case 1:  // ONLY_MCC_MNC_REQUESTED
+    {
+      //
+      // THIS IS NOT CORRECT.  The MCC/MNC needs to be added to the database
+      // and retrieved from there.
+      //
+      m_ans.add(
+          m_dict.avpUserName(),
+          m_info.imsi.substr(0, m_info.imsi.length() == 14 ? 5 : 6));
+      break;
+    }
+    case -1:  // SM-Delivery-Not-Intended AVP not present in request
+    case 0:   // ONLY_IMSI_REQUESTED
+    {
+      m_ans.add(m_dict.avpUserName(), m_info.imsi);
+      break;
+    }
+  }
+
+  //
+  // add the Serving-Node
+  //
+  if (m_sm_delivery_not_intended == -1) {
+    FDAvp sn(m_dict.avpServingNode());
+    sn.add(m_dict.avpMmeName(), m_info.mmehost);
+    sn.add(m_dict.avpMmeRealm(), m_info.mmerealm);
+
+    uint8_t buf[MAX_MSISDN_LENGTH];
+    size_t len = FDUtility::str2tbcd(m_mmeid.mme_isdn, buf, sizeof(buf));
+    sn.add(m_dict.avpMmeNumberForMtSms(), buf, len);
+
+    m_ans.add(sn);
+  }
+
+  //
+  // add the User-Identifier if needed
+  //
+  if (m_msisdn != m_info.str_msisdn) {
+    FDAvp ui(m_dict.avpUserIdentifier());
+    uint8_t buf[MAX_MSISDN_LENGTH];
+    size_t len = FDUtility::str2tbcd(m_info.str_msisdn, buf, sizeof(buf));
+    ui.add(m_dict.avpMsisdn(), buf, len);
+
+    m_ans.add(ui);
+  }
+
+  //
+  // send the answer
+  //
+  sendAnswer();
+}
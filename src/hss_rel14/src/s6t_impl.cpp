@@ -317,16 +317,6 @@ int processSimpleImsi(
 int processMultiImsi(
     FDMessageRequest* req, DAImsiList& list_imsi,
     s6t::ConfigurationInformationRequestExtractor& cir, Application& m_app) {
-  // For group imsi, a CIA is sent straight away and the results will be
-  // reported on the RIR
-  FDMessageAnswer ans(req);
-  ans.addOrigin();
-  ans.add(m_app.getDict().avpAuthSessionState(), 1);
-  ans.add(m_app.getDict().avpResultCode(), ER_DIAMETER_SUCCESS);
-  uint32_t flag_cia = 0;
-  FLAGS_SET(flag_cia, GROUP_CONFIGURATION_IN_PROGRESS);
-  ans.add(m_app.getDict().avpCiaFlags(), flag_cia);
-
   std::string origin_host;
   cir.origin_host.get(origin_host);
 
@@ -337,30 +327,28 @@ int processMultiImsi(
   EvenStatusMap* hss_db_rst = new EvenStatusMap();
   processHssDb(cir, 0, hss_db_rst, m_app);
 
-  RIRBuilder* rir_builder =
-      new RIRBuilder(list_imsi.size(), hss_db_rst, origin_host, origin_realm);
+  // For group imsi, a CIA is sent straight away and the results will be
+  // reported on the RIR
+  FDMessageAnswer* ans = new FDMessageAnswer(req);
+  ans->addOrigin();
+  ans->add(m_app.getDict().avpAuthSessionState(), 1);
+  ans->add(m_app.getDict().avpResultCode(), ER_DIAMETER_SUCCESS);
+  uint32_t flag_cia = 0;
+  FLAGS_SET(flag_cia, GROUP_CONFIGURATION_IN_PROGRESS);
+  ans->add(m_app.getDict().avpCiaFlags(), flag_cia);
+
+  // The RIR builder takes ownership of the request and the answer, the IDR's
+  // are sent and the CIA is sent after them from the RIR reactor the group
+  // is assigned to
+  RIRBuilder* rir_builder = new RIRBuilder(
+      req, ans, list_imsi, hss_db_rst, origin_host, origin_realm);
 
   uint32_t time_guard;
   if (cir.group_reporting_guard_timer.get(time_guard)) {
     rir_builder->setInterval(time_guard * 1000);
   }
 
-  rir_builder->init(NULL);
-
-  for (std::list<std::string>::iterator it_imsi = list_imsi.begin();
-       it_imsi != list_imsi.end(); ++it_imsi) {
-    // we need to build an event thread object, send it here and keep and keep
-    // it on the IDRRreq, so it will be available to store the responses.
-    fdHss.sendINSDRreq(
-        cir.monitoring_event_configuration, *it_imsi, req, hss_db_rst,
-        rir_builder);
-  }
-
-  ans.send();
-  delete req;
-
-  // Once the CIA has been sent, we indicate the RIR builder
-  rir_builder->postMessage(HANDLE_CIA_SENT);
+  fdHss.getRIREngine().start(rir_builder);
 
   StatsHss::singleton().registerStatResult(
       stat_hss_cir, 0, ER_DIAMETER_SUCCESS);
@@ -370,6 +358,15 @@ int processMultiImsi(
 
 // Function invoked when a COIR Command is received
 int COIRcmd::process(FDMessageRequest* req) {
+  if (!fdHss.getWorkerQueue().admit(req, stat_hss_cir)) return 0;
+
+  fdHss.getWorkerQueue().addProcessor(
+      new CIRProcessor(req, m_app), hss_lane_event);
+  fdHss.getWorkerQueue().startProcessor();
+  return 0;
+}
+
+int CIRProcessor::process(FDMessageRequest* req) {
   std::string s;
   bool experimental;
   int result_code = ER_DIAMETER_SUCCESS;
@@ -581,6 +578,16 @@ bool checkAPNSubscribed(
 
 // Function invoked when a NIIR Command is received
 int NIIRcmd::process(FDMessageRequest* req) {
+  if (!fdHss.getWorkerQueue().admit(req, stat_hss_nir)) return 0;
+
+  fdHss.getWorkerQueue().addProcessor(
+      new NIRProcessor(req, m_app), hss_lane_event);
+  fdHss.getWorkerQueue().startProcessor();
+  return 0;
+}
+
+int NIRProcessor::process(FDMessageRequest* req) {
+  StatsHssTimer timer(stat_hss_nir);
   std::string s, reqValidTime, origHost, origRealm;
   uint8_t msisdn[MSISDN_LEN];
   char msisdnchar[MSISDN_LEN + 1];
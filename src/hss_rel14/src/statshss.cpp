@@ -19,8 +19,11 @@
 #include <sstream>
 #include <freeDiameter/freeDiameter-host.h>
 #include <freeDiameter/libfdproto.h>
+#include <freeDiameter/libfdcore.h>
 #include <common_def.h>
 
+#include "fdhss.h"
+
 StatsHss* StatsHss::m_singleton = NULL;
 
 StatsHss::StatsHss()
@@ -34,6 +37,11 @@ StatsHss::StatsHss()
       m_rir_collector("rir"),
       m_srr_collector("srr"),
       m_max_codes_tracked(0) {
+  for (int i = 0; i < stat_cache_max; i++) {
+    m_cache_hits[i]   = 0;
+    m_cache_misses[i] = 0;
+  }
+
   m_ulr_collector.registerCode(0, ER_DIAMETER_SUCCESS);
   m_ulr_collector.registerCode(0, ER_DIAMETER_INVALID_AVP_VALUE);
   m_ulr_collector.registerCode(VENDOR_3GPP, DIAMETER_ERROR_USER_UNKNOWN);
@@ -76,6 +84,15 @@ StatsHss::StatsHss()
   m_srr_collector.registerCode(VENDOR_3GPP, DIAMETER_ERROR_USER_UNKNOWN);
   m_srr_collector.registerCode(VENDOR_3GPP, DIAMETER_ERROR_ABSENT_USER);
 
+  registerCollector(stat_hss_ulr, m_ulr_collector);
+  registerCollector(stat_hss_air, m_air_collector);
+  registerCollector(stat_hss_pur, m_pur_collector);
+  registerCollector(stat_hss_cir, m_cir_collector);
+  registerCollector(stat_hss_nir, m_nir_collector);
+  registerCollector(stat_hss_idr, m_idr_collector);
+  registerCollector(stat_hss_rir, m_rir_collector);
+  registerCollector(stat_hss_srr, m_srr_collector);
+
   m_max_codes_tracked = m_ulr_collector.getNbCodesTracked();
   if (m_air_collector.getNbCodesTracked() > m_max_codes_tracked) {
     m_max_codes_tracked = m_air_collector.getNbCodesTracked();
@@ -95,6 +112,9 @@ StatsHss::StatsHss()
   if (m_rir_collector.getNbCodesTracked() > m_max_codes_tracked) {
     m_max_codes_tracked = m_rir_collector.getNbCodesTracked();
   }
+  if (m_srr_collector.getNbCodesTracked() > m_max_codes_tracked) {
+    m_max_codes_tracked = m_srr_collector.getNbCodesTracked();
+  }
 }
 
 StatsHss::~StatsHss() {}
@@ -122,10 +142,123 @@ void StatsHss::getSerializedStat(std::string& stats) {
       << m_rir_collector.serialize(m_max_codes_tracked) << std::endl;
 
   res << now_str << ",S6C,SRR,"
-      << m_rir_collector.serialize(m_max_codes_tracked);
+      << m_srr_collector.serialize(m_max_codes_tracked) << std::endl;
+
+  res << now_str << ",CACHE,IMSI_SEC," << m_cache_hits[stat_cache_imsi_sec]
+      << "," << m_cache_misses[stat_cache_imsi_sec] << std::endl;
+  res << now_str << ",CACHE,IMSI_INFO," << m_cache_hits[stat_cache_imsi_info]
+      << "," << m_cache_misses[stat_cache_imsi_info] << std::endl;
+  res << now_str << ",CACHE,EVENT_CONFIG,"
+      << m_cache_hits[stat_cache_event_config] << ","
+      << m_cache_misses[stat_cache_event_config] << std::endl;
+  res << now_str << ",CACHE,SUBSCRIPTION,"
+      << m_cache_hits[stat_cache_subscription] << ","
+      << m_cache_misses[stat_cache_subscription] << std::endl;
+
+  // limit,depth,rejected,abandoned
+  res << now_str << ",WORKERQUEUE," << fdHss.getWorkerQueue().concurrent()
+      << "," << fdHss.getWorkerQueue().queueDepth() << ","
+      << fdHss.getWorkerQueue().rejected() << ","
+      << fdHss.getWorkerQueue().abandoned();
+
+  // lane,depth,active
+  for (int i = 0; i < hss_lane_max; i++)
+    res << std::endl
+        << now_str << ",WORKERLANE," << HSSWorkerQueue::laneName(i) << ","
+        << fdHss.getWorkerQueue().queueDepth(i) << ","
+        << fdHss.getWorkerQueue().active(i);
+
+  // count,mean,p50,p90,p99,p99.9,max in microseconds
+  std::string latency;
+  serializeLatency(now_str, latency);
+  res << latency;
+
   stats = res.str();
 }
 
+void StatsHss::getMetrics(std::string& metrics) {
+  static const char* cachenames[] = {
+      "imsi_sec", "imsi_info", "event_config", "subscription"};
+  std::stringstream res;
+
+  serializeMetrics("hss", metrics);
+
+  res << "# TYPE hss_cache_hits_total counter\n";
+  for (int i = 0; i < stat_cache_max; i++)
+    res << "hss_cache_hits_total{cache=\"" << cachenames[i] << "\"} "
+        << atomic_add_fetch(m_cache_hits[i], 0) << "\n";
+  res << "# TYPE hss_cache_misses_total counter\n";
+  for (int i = 0; i < stat_cache_max; i++)
+    res << "hss_cache_misses_total{cache=\"" << cachenames[i] << "\"} "
+        << atomic_add_fetch(m_cache_misses[i], 0) << "\n";
+
+  res << "# TYPE hss_worker_queue_depth gauge\n";
+  res << "hss_worker_queue_depth " << fdHss.getWorkerQueue().queueDepth()
+      << "\n";
+  res << "# TYPE hss_worker_lane_depth gauge\n";
+  for (int i = 0; i < hss_lane_max; i++)
+    res << "hss_worker_lane_depth{lane=\"" << HSSWorkerQueue::laneName(i)
+        << "\"} " << fdHss.getWorkerQueue().queueDepth(i) << "\n";
+  res << "# TYPE hss_worker_lane_active gauge\n";
+  for (int i = 0; i < hss_lane_max; i++)
+    res << "hss_worker_lane_active{lane=\"" << HSSWorkerQueue::laneName(i)
+        << "\"} " << fdHss.getWorkerQueue().active(i) << "\n";
+  res << "# TYPE hss_worker_queue_limit gauge\n";
+  res << "hss_worker_queue_limit " << fdHss.getWorkerQueue().concurrent()
+      << "\n";
+  res << "# TYPE hss_worker_queue_rejected_total counter\n";
+  res << "hss_worker_queue_rejected_total "
+      << fdHss.getWorkerQueue().rejected() << "\n";
+  res << "# TYPE hss_worker_queue_abandoned_total counter\n";
+  res << "hss_worker_queue_abandoned_total "
+      << fdHss.getWorkerQueue().abandoned() << "\n";
+  res << "# TYPE hss_work_queue_overflow gauge\n";
+  res << "hss_work_queue_overflow " << fdHss.getWorkMgr().overflowDepth()
+      << "\n";
+  res << "# TYPE hss_work_queue_spills_total counter\n";
+  res << "hss_work_queue_spills_total " << fdHss.getWorkMgr().spills()
+      << "\n";
+  res << "# TYPE hss_doic_reduction_percent gauge\n";
+  res << "hss_doic_reduction_percent "
+      << fdHss.getOverloadReporter().reduction() << "\n";
+
+  CassMetrics cm;
+  if (fdHss.getDb().getMetrics(cm)) {
+    static const double quantiles[] = {0.5, 0.95, 0.99, 0.999};
+    cass_uint64_t values[]          = {
+        cm.requests.median, cm.requests.percentile_95th,
+        cm.requests.percentile_99th, cm.requests.percentile_999th};
+
+    res << "# TYPE hss_cassandra_request_latency_microseconds summary\n";
+    for (int i = 0; i < 4; i++)
+      res << "hss_cassandra_request_latency_microseconds{quantile=\""
+          << quantiles[i] << "\"} " << values[i] << "\n";
+    res << "# TYPE hss_cassandra_connections gauge\n";
+    res << "hss_cassandra_connections " << cm.stats.total_connections << "\n";
+    res << "# TYPE hss_cassandra_timeouts_total counter\n";
+    res << "hss_cassandra_timeouts_total{type=\"connection\"} "
+        << cm.errors.connection_timeouts << "\n";
+    res << "hss_cassandra_timeouts_total{type=\"pending_request\"} "
+        << cm.errors.pending_request_timeouts << "\n";
+    res << "hss_cassandra_timeouts_total{type=\"request\"} "
+        << cm.errors.request_timeouts << "\n";
+  }
+
+  res << "# TYPE hss_diameter_peer_open gauge\n";
+  if (pthread_rwlock_rdlock(&fd_g_peers_rw) == 0) {
+    // the list items are the peer headers themselves
+    struct fd_list* li = fd_g_peers.next;
+    for (; li != &fd_g_peers; li = li->next) {
+      struct peer_hdr* peer = (struct peer_hdr*) li;
+      res << "hss_diameter_peer_open{peer=\"" << peer->info.pi_diamid << "\"} "
+          << (fd_peer_get_state(peer) == STATE_OPEN ? 1 : 0) << "\n";
+    }
+    pthread_rwlock_unlock(&fd_g_peers_rw);
+  }
+
+  metrics += res.str();
+}
+
 void StatsHss::dispatchDerived(SEventThreadMessage& msg) {
   switch (msg.getId()) {
     case STAT_ATTEMPT_MSG:
@@ -221,6 +354,24 @@ void StatsHss::processStatGetLive(StatLive& msg) {
   appendStatObject(arrayObjects, allocator, m_srr_collector);
 
   document.AddMember("stats", arrayObjects, allocator);
+
+  static const char* cachenames[] = {
+      "imsi_sec", "imsi_info", "event_config", "subscription"};
+  RAPIDJSON_NAMESPACE::Value cacheObjects(RAPIDJSON_NAMESPACE::kArrayType);
+  for (int i = 0; i < stat_cache_max; i++) {
+    RAPIDJSON_NAMESPACE::Value cacheObject(RAPIDJSON_NAMESPACE::kObjectType);
+    cacheObject.AddMember(
+        "type", RAPIDJSON_NAMESPACE::StringRef(cachenames[i]), allocator);
+    cacheObject.AddMember("hits", m_cache_hits[i], allocator);
+    cacheObject.AddMember("misses", m_cache_misses[i], allocator);
+    cacheObjects.PushBack(cacheObject, allocator);
+  }
+  document.AddMember("cache", cacheObjects, allocator);
+
+  RAPIDJSON_NAMESPACE::Value latencyObjects(RAPIDJSON_NAMESPACE::kArrayType);
+  appendLatencyObjects(latencyObjects, allocator);
+  document.AddMember("latency", latencyObjects, allocator);
+
   RAPIDJSON_NAMESPACE::StringBuffer strbuf;
   RAPIDJSON_NAMESPACE::Writer<RAPIDJSON_NAMESPACE::StringBuffer> writer(strbuf);
   document.Accept(writer);
@@ -16,16 +16,32 @@
 
 #include "worker.h"
 #include "logger.h"
+#include "satomic.h"
+
+static __thread WorkerManager* t_manager = NULL;
+static __thread int t_worker             = -1;
 
 WorkerManager::WorkerManager() {
-  m_numWorkers = 0;
+  m_numWorkers   = 0;
+  m_workstealing = false;
+  m_next         = 0;
+}
+
+WorkerManager::~WorkerManager() {
+  for (size_t i = 0; i < m_deques.size(); i++) delete m_deques[i];
 }
 
-WorkerManager::~WorkerManager() {}
+bool WorkerManager::init(int numWorkers, bool workStealing) {
+  m_workstealing = workStealing && numWorkers > 0;
+
+  if (m_workstealing) {
+    // every deque has to exist before the first worker starts stealing
+    m_ready.init(0, 0);
+    for (int i = 0; i < numWorkers; i++) m_deques.push_back(new WorkerDeque());
+  }
 
-bool WorkerManager::init(int numWorkers) {
   for (int i = 0; i < numWorkers; i++) {
-    WorkerThread* wt = new WorkerThread(*this);
+    WorkerThread* wt = new WorkerThread(*this, i);
     if (wt) {
       wt->init(NULL);
       m_numWorkers++;
@@ -38,12 +54,53 @@ bool WorkerManager::init(int numWorkers) {
   return true;
 }
 
-bool WorkerManager::addWork(WorkerMessage* msg) {
-  return m_queue.push(msg);
+bool WorkerManager::addWork(WorkerMessage* msg, int affinity) {
+  if (!m_workstealing) return m_queue.push(msg);
+
+  int count  = (int) m_deques.size();
+  int worker = currentWorker();
+
+  // a continuation queued from a worker stays on that worker, otherwise
+  // prefer the worker that last handled the request
+  if (worker < 0) worker = affinity;
+  if (worker < 0 || worker >= count)
+    worker = atomic_fetch_inc(m_next) % count;
+
+  m_deques[worker]->push(msg);
+  m_ready.increment();
+
+  return true;
 }
 
-WorkerMessage* WorkerManager::getWork() {
-  return (WorkerMessage*) m_queue.pop();
+WorkerMessage* WorkerManager::getWork(int worker) {
+  if (!m_workstealing) return (WorkerMessage*) m_queue.pop();
+
+  // the semaphore counts the queued messages, so once it has been
+  // decremented a message is guaranteed to be in one of the deques; yield
+  // a few times before sleeping so a busy producer does not have to wake
+  // this worker through the kernel
+  for (int spins = 0; !m_ready.decrement(false); spins++) {
+    if (spins == WORKER_YIELDS) {
+      m_ready.decrement();
+      break;
+    }
+    SThread::yield();
+  }
+
+  int count = (int) m_deques.size();
+
+  for (;;) {
+    WorkerMessage* msg = m_deques[worker]->pop();
+    if (msg) return msg;
+
+    for (int i = 1; i < count; i++) {
+      msg = m_deques[(worker + i) % count]->steal();
+      if (msg) return msg;
+    }
+
+    // a concurrent thief took the message, scan again
+    SThread::yield();
+  }
 }
 
 void WorkerManager::waitForShutdown() {
@@ -52,8 +109,11 @@ void WorkerManager::waitForShutdown() {
     return;
   }
 
-  for (int i = 0; i < m_numWorkers; i++)
-    m_queue.push(new WorkerMessage(WORKER_SHUTDOWN));
+  // workers decrement m_numWorkers as they exit, so take a copy first
+  int count = m_numWorkers;
+
+  for (int i = 0; i < count; i++)
+    addWork(new WorkerMessage(WORKER_SHUTDOWN), i);
 
   m_shutdown.wait();
 }
@@ -64,6 +124,15 @@ void WorkerManager::threadShutdown() {
   if (m_numWorkers <= 0) m_shutdown.set();
 }
 
+void WorkerManager::bindWorker(int worker) {
+  t_manager = this;
+  t_worker  = worker;
+}
+
+int WorkerManager::currentWorker() {
+  return t_manager == this ? t_worker : -1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -80,15 +149,18 @@ WorkerMessage::~WorkerMessage() {
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-WorkerThread::WorkerThread(WorkerManager& mgr) : SThread(true), m_mgr(mgr) {}
+WorkerThread::WorkerThread(WorkerManager& mgr, int index)
+    : SThread(true), m_mgr(mgr), m_index(index) {}
 
 WorkerThread::~WorkerThread() {}
 
 unsigned long WorkerThread::threadProc(void* arg) {
   WorkerMessage* msg;
 
+  m_mgr.bindWorker(m_index);
+
   for (;;) {
-    msg = m_mgr.getWork();
+    msg = m_mgr.getWork(m_index);
 
     if (msg->getId() == WORKER_SHUTDOWN) {
       delete msg;
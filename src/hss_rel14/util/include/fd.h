@@ -26,6 +26,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 
 #include "freeDiameter/freeDiameter-host.h"
 #include "freeDiameter/libfdcore.h"
@@ -363,6 +364,42 @@ class FDExtractorList;
 class FDExtractorAvp;
 class FDExtractorAvpList;
 
+// A member of a grouped AVP that is appended together with its siblings by
+// FDAvp::add(FDDictionaryEntryAVP&, const FDAvpMember*, size_t).  Only the
+// dictionary entry and the value are held, octet string data is referenced
+// and must stay valid until the grouped AVP has been added.
+class FDAvpMember {
+ public:
+  FDAvpMember(FDDictionaryEntryAVP& de, int32_t v) : m_de(&de) {
+    memset(&m_value, 0, sizeof(m_value));
+    m_value.i32 = v;
+  }
+  FDAvpMember(FDDictionaryEntryAVP& de, uint32_t v) : m_de(&de) {
+    memset(&m_value, 0, sizeof(m_value));
+    m_value.u32 = v;
+  }
+  FDAvpMember(FDDictionaryEntryAVP& de, uint64_t v) : m_de(&de) {
+    memset(&m_value, 0, sizeof(m_value));
+    m_value.u64 = v;
+  }
+  FDAvpMember(FDDictionaryEntryAVP& de, const uint8_t* v, size_t len)
+      : m_de(&de) {
+    m_value.os.data = (uint8_t*) v;
+    m_value.os.len  = len;
+  }
+  FDAvpMember(FDDictionaryEntryAVP& de, const std::string& v) : m_de(&de) {
+    m_value.os.data = (uint8_t*) v.data();
+    m_value.os.len  = v.size();
+  }
+
+  FDDictionaryEntryAVP& getDictionaryEntry() const { return *m_de; }
+  const union avp_value& getValue() const { return m_value; }
+
+ private:
+  FDDictionaryEntryAVP* m_de;
+  union avp_value m_value;
+};
+
 class FDAvp {
   friend FDMessage;
 
@@ -432,6 +469,14 @@ class FDAvp {
     return add(avp);
   }
 
+  // appends a grouped AVP and all of its members in one call, the grouped
+  // AVP is linked to this one only once it is complete
+  FDAvp& add(
+      FDDictionaryEntryAVP& de, const FDAvpMember* members, size_t count) {
+    addGrouped(m_avp, de, members, count);
+    return *this;
+  }
+
   FDAvp& operator=(int32_t v) { return set(v); }
   FDAvp& operator=(int64_t v) { return set(v); }
   FDAvp& operator=(uint32_t v) { return set(v); }
@@ -538,6 +583,10 @@ class FDAvp {
  protected:
   void addTo(msg_or_avp* reference);
 
+  static void addGrouped(
+      msg_or_avp* reference, FDDictionaryEntryAVP& de,
+      const FDAvpMember* members, size_t count);
+
  private:
   void init();
   void assignValue();
@@ -546,7 +595,6 @@ class FDAvp {
   struct avp* m_avp;
   struct avp_hdr* m_avphdr;
   union avp_value m_value;
-  FDBuffer<uint8_t>* m_buf;
   bool m_assigned;
   bool m_dedel;
 };
@@ -617,6 +665,11 @@ class FDMessage {
     avp = v;
     return add(avp);
   }
+  FDMessage& add(
+      FDDictionaryEntryAVP& de, const FDAvpMember* members, size_t count) {
+    FDAvp::addGrouped(m_msg, de, members, count);
+    return *this;
+  }
 
   FDMessage& add(FDExtractor& e);
   FDMessage& add(FDExtractorList& el);
@@ -720,7 +773,16 @@ class FDMessageAnswer : public FDMessage {
   FDMessageAnswer(FDMessageRequest* req);  // used to create and encapsulate a
                                            // FD answer from a request
 
+  // adds the Result-Code named in the dictionary (e.g. "DIAMETER_TOO_BUSY")
+  // along with Origin-Host and Origin-Realm, the E bit is set for protocol
+  // errors
+  FDMessageAnswer& setResultCode(const char* rescode);
+
   FDMessageAnswer& send();
+
+  // an answer that will never be sent is freed when this object is
+  // destroyed, along with the request it was created from
+  void discard() { setMsgDelete(true); }
 };
 
 class FDMessageRequest : public FDMessage {
@@ -769,6 +831,10 @@ class FDCommandRequest : public FDCommand {
   virtual int process(FDMessageRequest* req) = 0;
 };
 
+// number of child entries an FDExtractor holds inline before spilling the
+// remainder into a vector, most grouped AVPs have fewer children than this
+#define FDEXTRACTOR_ENTRIES (8)
+
 #define FDISREQUEST(hdr)                                                       \
   ((hdr->msg_flags & CMD_FLAG_REQUEST) == CMD_FLAG_REQUEST)
 #define FDISANSWER(hdr)                                                        \
@@ -988,9 +1054,19 @@ class FDExtractor : public FDExtractorBase {
   void resolve();
 
  private:
+  struct Entry {
+    vendor_id_t vendor;
+    avp_code_t code;
+    FDExtractorBase* base;
+  };
+
+  Entry* find(vendor_id_t vendor, avp_code_t code);
+
   FDExtractor* m_parent;
   msg_or_avp* m_reference;
-  std::map<FDExtractorKey, FDExtractorBase*> m_entries;
+  Entry m_entries[FDEXTRACTOR_ENTRIES];
+  std::vector<Entry> m_overflow;
+  int m_count;
   int m_index;
 };
 
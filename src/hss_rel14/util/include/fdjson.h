@@ -22,6 +22,78 @@
 #include "freeDiameter/libfdcore.h"
 
 #ifdef __cplusplus
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ssync.h"
+
+class FDJsonCompiler;
+
+// A JSON block compiled into the AVPs it describes.  compile() resolves every
+// member name through the dictionary and converts every value to its Diameter
+// representation once, addTo() then only creates and links the AVPs.  A
+// compiled block is not modified by addTo() and may be added to any number of
+// messages from any number of threads.
+class FDJsonEncoding {
+  friend class FDJsonCompiler;
+
+ public:
+  FDJsonEncoding() {}
+
+  int compile(const char* json, void (*errfunc)(const char*));
+  int addTo(msg_or_avp* reference, void (*errfunc)(const char*)) const;
+
+  const std::string& getSource() const { return m_source; }
+  size_t size() const { return m_nodes.size(); }
+
+ private:
+  struct Node {
+    struct dict_object* entry;
+    const char* name;
+    enum dict_avp_basetype basetype;
+    union avp_value value;
+    size_t offset;  // of an octet string value in m_data
+    uint32_t end;   // index of the node following the last child
+  };
+
+  FDJsonEncoding(const FDJsonEncoding&);
+  FDJsonEncoding& operator=(const FDJsonEncoding&);
+
+  void add(msg_or_avp* reference, uint32_t begin, uint32_t end) const;
+
+  std::string m_source;
+  std::vector<Node> m_nodes;
+  std::string m_data;
+};
+
+typedef std::shared_ptr<const FDJsonEncoding> FDJsonEncodingPtr;
+
+// Compiled JSON blocks cached by key.  An entry is only returned for the JSON
+// it was compiled from, a block that changed underneath its key is compiled
+// again, so a stale entry costs a compile and never a wrong AVP.  Blocks that
+// fail to compile are not cached.
+class FDJsonCache {
+ public:
+  FDJsonCache(size_t capacity) : m_mutex(true), m_capacity(capacity) {}
+
+  FDJsonEncodingPtr get(
+      const std::string& key, const std::string& json,
+      void (*errfunc)(const char*), bool& hit);
+  void erase(const std::string& key);
+  void clear();
+  size_t size();
+
+ private:
+  FDJsonCache(const FDJsonCache&);
+  FDJsonCache& operator=(const FDJsonCache&);
+
+  SFastMutex m_mutex;
+  size_t m_capacity;
+  std::unordered_map<std::string, FDJsonEncodingPtr> m_entries;
+};
+
 void fdJsonGetJSON(
     msg_or_avp* ref, std::string& json, void (*errfunc)(const char*));
 bool fdJsonGetValueOfMember(
@@ -104,6 +104,34 @@ class SCassIterator {
 
 class SCassStatement;
 
+class SCassPrepared {
+  friend SCassStatement;
+
+ public:
+  SCassPrepared();
+  SCassPrepared(const CassPrepared* prepared);
+  ~SCassPrepared();
+
+  // the prepared statement is owned by a single object, it is moved and
+  // never copied
+  SCassPrepared(SCassPrepared&& rval);
+  SCassPrepared& operator=(SCassPrepared&& rval);
+  SCassPrepared& operator=(const CassPrepared* prepared);
+
+  bool valid() { return m_prepared != NULL; }
+
+ protected:
+  const CassPrepared* getPrepared() { return m_prepared; }
+
+ private:
+  SCassPrepared(const SCassPrepared&);
+  SCassPrepared& operator=(const SCassPrepared&);
+
+  void release();
+
+  const CassPrepared* m_prepared;
+};
+
 class SCassResult {
   friend SCassStatement;
 
@@ -151,6 +179,7 @@ class SCassFuture {
 
   CassError errorCode();
   SCassResult result();
+  SCassPrepared prepared();
 
  private:
   SCassFuture();
@@ -170,10 +199,20 @@ class SCassStatement {
   SCassStatement();
   SCassStatement(const char* qry);
   SCassStatement(const std::string& qry);
+  SCassStatement(SCassPrepared& prepared);
   ~SCassStatement();
 
   SCassStatement& query(const char* qry);
   SCassStatement& query(const std::string& qry);
+  SCassStatement& prepared(SCassPrepared& prepared);
+
+  CassError bind(size_t index, const char* v);
+  CassError bind(size_t index, const std::string& v);
+  CassError bind(size_t index, int32_t v);
+  CassError bind(size_t index, int64_t v);
+
+  // the first error returned by bind(), CASS_OK if every value was bound
+  CassError bindError() { return m_binderror; }
 
   CassError setPagingSize(int page_size);
   CassError setPagingState(SCassResult& result);
@@ -183,8 +222,14 @@ class SCassStatement {
   SCassFuture execute(CassSession* session);
 
  private:
+  CassError bound(CassError rc) {
+    if (m_binderror == CASS_OK) m_binderror = rc;
+    return rc;
+  }
+
   std::string m_query;
   CassStatement* m_statement;
+  CassError m_binderror;
 };
 
 class SCassandra {
@@ -195,6 +240,10 @@ class SCassandra {
   SCassFuture execute(SCassStatement& statement) {
     return statement.execute(m_session);
   }
+  SCassFuture prepare(const char* qry) {
+    return SCassFuture(cass_session_prepare(m_session, qry));
+  }
+  SCassFuture prepare(const std::string& qry) { return prepare(qry.c_str()); }
 
   SCassFuture connect();
   void disconnect();
@@ -215,6 +264,13 @@ class SCassandra {
   bool setIONumberThreads(uint32_t num);
   bool setIOQueueSize(uint32_t size);
 
+  // a snapshot of the driver metrics, false when not connected
+  bool getMetrics(CassMetrics& metrics) {
+    if (!m_session) return false;
+    cass_session_get_metrics(m_session, &metrics);
+    return true;
+  }
+
  private:
   void release();
 
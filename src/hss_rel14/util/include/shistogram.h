@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SHISTOGRAM_H
+#define __SHISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// each power of two is divided into 2^SHISTOGRAM_SUBBITS buckets, which
+// bounds the error of a reported value to about 3%
+#define SHISTOGRAM_SUBBITS (5)
+#define SHISTOGRAM_SUBBUCKETS (1 << SHISTOGRAM_SUBBITS)
+#define SHISTOGRAM_BUCKETS ((64 - SHISTOGRAM_SUBBITS + 1) * SHISTOGRAM_SUBBUCKETS)
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Log-linear histogram of unsigned 64 bit values (typically latencies in
+// microseconds).  record() is lock free and may be called from any number of
+// threads, the readers see a consistent enough view for reporting without
+// stopping the writers.
+class SHistogram {
+ public:
+  SHistogram() { reset(); }
+
+  void record(uint64_t value) {
+    __atomic_add_fetch(&m_buckets[bucket(value)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&m_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&m_sum, value, __ATOMIC_RELAXED);
+
+    uint64_t v = __atomic_load_n(&m_min, __ATOMIC_RELAXED);
+    while (value < v && !__atomic_compare_exchange_n(
+                            &m_min, &v, value, true, __ATOMIC_RELAXED,
+                            __ATOMIC_RELAXED))
+      ;
+
+    v = __atomic_load_n(&m_max, __ATOMIC_RELAXED);
+    while (value > v && !__atomic_compare_exchange_n(
+                            &m_max, &v, value, true, __ATOMIC_RELAXED,
+                            __ATOMIC_RELAXED))
+      ;
+  }
+
+  // record() for a histogram that only the calling thread writes, the
+  // readers may still read it at any time
+  void recordLocal(uint64_t value) {
+    increment(m_buckets[bucket(value)], 1);
+    increment(m_count, 1);
+    increment(m_sum, value);
+
+    if (value < m_min) __atomic_store_n(&m_min, value, __ATOMIC_RELAXED);
+    if (value > m_max) __atomic_store_n(&m_max, value, __ATOMIC_RELAXED);
+  }
+
+  void reset() {
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_count = 0;
+    m_sum   = 0;
+    m_min   = UINT64_MAX;
+    m_max   = 0;
+  }
+
+  // adds the contents of another histogram to this one
+  void merge(const SHistogram& h) {
+    for (int i = 0; i < SHISTOGRAM_BUCKETS; i++) {
+      uint64_t n = __atomic_load_n(&h.m_buckets[i], __ATOMIC_RELAXED);
+      if (n) __atomic_add_fetch(&m_buckets[i], n, __ATOMIC_RELAXED);
+    }
+
+    __atomic_add_fetch(&m_count, h.count(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&m_sum, h.sum(), __ATOMIC_RELAXED);
+
+    if (h.count()) {
+      if (h.m_min < m_min) m_min = h.m_min;
+      if (h.m_max > m_max) m_max = h.m_max;
+    }
+  }
+
+  uint64_t count() const { return __atomic_load_n(&m_count, __ATOMIC_RELAXED); }
+  uint64_t sum() const { return __atomic_load_n(&m_sum, __ATOMIC_RELAXED); }
+  uint64_t min() const { return count() ? m_min : 0; }
+  uint64_t max() const { return m_max; }
+  uint64_t mean() const { return count() ? sum() / count() : 0; }
+
+  // returns the value at the given percentile (0.0 - 100.0), reported as the
+  // upper bound of the bucket containing it
+  uint64_t percentile(double pct) const {
+    uint64_t total = count();
+
+    if (total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(pct / 100.0 * total + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < SHISTOGRAM_BUCKETS; i++) {
+      seen += __atomic_load_n(&m_buckets[i], __ATOMIC_RELAXED);
+      if (seen >= rank) {
+        uint64_t v = upperBound(i);
+        return v < m_max ? v : m_max;
+      }
+    }
+
+    return m_max;
+  }
+
+  // the number of values that fall into the bucket and the bucket limits,
+  // used by callers that export the raw distribution
+  uint64_t bucketCount(int i) const {
+    return __atomic_load_n(&m_buckets[i], __ATOMIC_RELAXED);
+  }
+
+  static uint32_t bucket(uint64_t value) {
+    if (value < SHISTOGRAM_SUBBUCKETS) return (uint32_t) value;
+
+    int shift = 63 - __builtin_clzll(value) - SHISTOGRAM_SUBBITS;
+
+    return ((shift + 1) << SHISTOGRAM_SUBBITS) +
+           ((value >> shift) & (SHISTOGRAM_SUBBUCKETS - 1));
+  }
+
+  static uint64_t lowerBound(int bucket) {
+    if (bucket < 2 * SHISTOGRAM_SUBBUCKETS) return bucket;
+
+    int shift = (bucket >> SHISTOGRAM_SUBBITS) - 1;
+
+    return ((uint64_t)((bucket & (SHISTOGRAM_SUBBUCKETS - 1)) |
+                       SHISTOGRAM_SUBBUCKETS))
+           << shift;
+  }
+
+  static uint64_t upperBound(int bucket) {
+    return bucket + 1 < SHISTOGRAM_BUCKETS ? lowerBound(bucket + 1) - 1 :
+                                             UINT64_MAX;
+  }
+
+ private:
+  SHistogram(const SHistogram&);
+  SHistogram& operator=(const SHistogram&);
+
+  static void increment(uint64_t& v, uint64_t n) {
+    __atomic_store_n(
+        &v, __atomic_load_n(&v, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+  }
+
+  uint64_t m_buckets[SHISTOGRAM_BUCKETS];
+  uint64_t m_count;
+  uint64_t m_sum;
+  uint64_t m_min;
+  uint64_t m_max;
+};
+
+#endif  // #define __SHISTOGRAM_H
@@ -130,6 +130,14 @@ class OssRestHandler {
       response.send(Pistache::Http::Code::Internal_Server_Error, "");
     }
   }
+  void getMetrics(
+      const Pistache::Http::Request& request,
+      Pistache::Http::ResponseWriter response) {
+    // scraped periodically, so not written to the audit log
+    std::string res;
+    m_stats->getMetrics(res);
+    response.send(Pistache::Http::Code::Ok, res, MIME(Text, Plain));
+  }
   void updateStatFrequency(
       const Pistache::Http::Request& request,
       Pistache::Http::ResponseWriter response) {
@@ -225,6 +233,10 @@ class OssEndpoint {
         m_router, "/statlive",
         Pistache::Rest::Routes::bind(
             &OssRestHandler<T>::getStatLive, &m_handler));
+    Pistache::Rest::Routes::Get(
+        m_router, "/metrics",
+        Pistache::Rest::Routes::bind(
+            &OssRestHandler<T>::getMetrics, &m_handler));
     Pistache::Rest::Routes::Get(
         m_router, "/ossoptions",
         Pistache::Rest::Routes::bind(
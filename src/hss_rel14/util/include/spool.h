@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SPOOL_H
+#define __SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+
+#include "ssync.h"
+
+#define SPOOL_THREAD_MAX (256)
+#define SPOOL_BATCH (64)
+#define SPOOL_DEPOT_MAX (8192)
+
+#define SARENA_ALIGN(__size) (((__size) + 15) & ~((size_t) 15))
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Free list of fixed size blocks.  Each thread keeps a private list of up to
+// SPOOL_THREAD_MAX blocks and exchanges batches of SPOOL_BATCH blocks with a
+// shared depot, so objects allocated on one thread and freed on another
+// (freeDiameter thread -> worker -> Cassandra I/O thread) find their way back
+// without taking a lock per object.  The memory is never returned to the heap
+// while it stays below SPOOL_DEPOT_MAX blocks.
+template <size_t SIZE>
+class SPool {
+ public:
+  static void* allocate() {
+    Cache& c = t_cache;
+
+    if (!c.head && !refill(c)) {
+      __atomic_add_fetch(&heap(), 1, __ATOMIC_RELAXED);
+      return ::operator new(blockSize());
+    }
+
+    Node* n = c.head;
+    c.head  = n->next;
+    c.count--;
+
+    return n;
+  }
+
+  static void release(void* p) {
+    if (!p) return;
+
+    Cache& c = t_cache;
+    Node* n  = (Node*) p;
+
+    n->next = c.head;
+    c.head  = n;
+
+    if (++c.count > SPOOL_THREAD_MAX) spill(c);
+  }
+
+  // the number of blocks that had to be allocated from the heap
+  static uint64_t heapAllocations() {
+    return __atomic_load_n(&heap(), __ATOMIC_RELAXED);
+  }
+
+ private:
+  struct Node {
+    Node* next;
+  };
+
+  struct Cache {
+    Node* head;
+    uint32_t count;
+  };
+
+  struct Depot {
+    Depot() : head(NULL), count(0) {}
+
+    SMutex mutex;
+    Node* head;
+    uint32_t count;
+  };
+
+  static size_t blockSize() { return SIZE < sizeof(Node) ? sizeof(Node) : SIZE; }
+
+  // the depot is intentionally leaked so that objects released from static
+  // destructors at exit still have somewhere to go
+  static Depot& depot() {
+    static Depot* d = new Depot();
+    return *d;
+  }
+
+  static uint64_t& heap() {
+    static uint64_t h = 0;
+    return h;
+  }
+
+  static Node* detach(Node*& head, uint32_t& count, uint32_t max) {
+    Node* first = head;
+    Node* last  = NULL;
+
+    for (uint32_t i = 0; i < max && head; i++, count--) {
+      last = head;
+      head = head->next;
+    }
+
+    if (last) last->next = NULL;
+
+    return last ? first : NULL;
+  }
+
+  static bool refill(Cache& c) {
+    Depot& d = depot();
+
+    if (__atomic_load_n(&d.count, __ATOMIC_RELAXED) == 0) return false;
+
+    SMutexLock l(d.mutex);
+    uint32_t count = d.count;
+
+    c.head  = detach(d.head, d.count, SPOOL_BATCH);
+    c.count = count - d.count;
+
+    return c.head != NULL;
+  }
+
+  static void spill(Cache& c) {
+    Depot& d     = depot();
+    uint32_t cnt = c.count;
+    Node* batch  = detach(c.head, c.count, SPOOL_BATCH);
+    Node* last   = batch;
+
+    cnt -= c.count;
+    while (last->next) last = last->next;
+
+    {
+      SMutexLock l(d.mutex);
+      if (d.count + cnt <= SPOOL_DEPOT_MAX) {
+        last->next = d.head;
+        d.head     = batch;
+        d.count += cnt;
+        return;
+      }
+    }
+
+    // the depot is full, give the batch back to the heap
+    while (batch) {
+      Node* n = batch;
+      batch   = batch->next;
+      ::operator delete(n);
+    }
+  }
+
+  static __thread Cache t_cache;
+};
+
+template <size_t SIZE>
+__thread typename SPool<SIZE>::Cache SPool<SIZE>::t_cache = {NULL, 0};
+
+// Adds class specific operator new/delete that allocate from the SPool for
+// the size of the class.  Derived classes that do not use the macro
+// themselves fall back to the global heap.
+#define SPOOL_ALLOCATOR(__class)                                               \
+  static void* operator new(size_t size) {                                     \
+    return size == sizeof(__class) ? SPool<sizeof(__class)>::allocate() :      \
+                                     ::operator new(size);                     \
+  }                                                                            \
+  static void operator delete(void* p, size_t size) {                          \
+    if (size == sizeof(__class))                                               \
+      SPool<sizeof(__class)>::release(p);                                      \
+    else                                                                       \
+      ::operator delete(p);                                                    \
+  }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Bump allocator for request scoped objects.  The first SIZE bytes come from
+// storage inside the arena itself, anything beyond that from the heap.  All
+// of the memory is released at once when the arena is destroyed and the
+// destructors of the objects allocated from it are NOT called.  allocate()
+// may be called from several threads at once.
+template <size_t SIZE>
+class SArena {
+ public:
+  SArena() : m_used(0), m_chunks(NULL) {}
+
+  ~SArena() {
+    while (m_chunks) {
+      Chunk* c = m_chunks;
+      m_chunks = c->next;
+      ::operator delete(c);
+    }
+  }
+
+  void* allocate(size_t size) {
+    size = SARENA_ALIGN(size);
+
+    size_t ofs = __atomic_fetch_add(&m_used, size, __ATOMIC_RELAXED);
+    if (ofs + size <= SIZE) return m_buffer + ofs;
+
+    Chunk* c = (Chunk*) ::operator new(SARENA_ALIGN(sizeof(Chunk)) + size);
+
+    c->next = __atomic_load_n(&m_chunks, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(
+        &m_chunks, &c->next, c, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+
+    return (char*) c + SARENA_ALIGN(sizeof(Chunk));
+  }
+
+ private:
+  SArena(const SArena&);
+  SArena& operator=(const SArena&);
+
+  struct Chunk {
+    Chunk* next;
+  };
+
+  alignas(16) char m_buffer[SIZE];
+  size_t m_used;
+  Chunk* m_chunks;
+};
+
+template <size_t SIZE>
+inline void* operator new(size_t size, SArena<SIZE>& arena) {
+  return arena.allocate(size);
+}
+
+// only called if a constructor throws, the arena releases the memory
+template <size_t SIZE>
+inline void operator delete(void* p, SArena<SIZE>& arena) {}
+
+#endif  // #define __SPOOL_H
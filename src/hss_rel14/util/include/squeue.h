@@ -17,10 +17,16 @@
 #ifndef __SQUEUE_H
 #define __SQUEUE_H
 
-#include <queue>
+#include <stdint.h>
+#include <deque>
 
 #include "ssync.h"
 
+#define SQUEUE_DEFAULT_CAPACITY (4096)
+#define SQUEUE_CACHE_LINE (64)
+#define SQUEUE_DEPTH_SAMPLE (63)
+#define SQUEUE_YIELDS (16)
+
 class SQueueMessage {
  public:
   SQueueMessage(uint16_t id);
@@ -35,20 +41,71 @@ class SQueueMessage {
   uint16_t m_id;
 };
 
+// Lock-free multi-producer/multi-consumer ring. Producers and consumers
+// claim slots with a CAS on the enqueue/dequeue positions and consumers only
+// sleep on a futex when the queue is empty.  A push never blocks and never
+// fails: when the ring is full the message spills to a locked overflow list,
+// since threads post to their own queues and would otherwise deadlock.
+//
+// The queue is therefore NOT bounded.  The ring holds capacity() messages
+// and the overflow list grows with the backlog of a slow consumer, limited
+// only by memory.  overflowDepth() and spills() report it, a producer that
+// needs back pressure has to apply it before pushing (the HSS requests are
+// limited by QueueManager before they reach the worker queue).
 class SQueue {
  public:
-  SQueue();
+  SQueue(uint32_t capacity = SQUEUE_DEFAULT_CAPACITY);
   ~SQueue();
 
-  bool push(uint16_t msgid, bool wait = true);
-  bool push(SQueueMessage* msg, bool wait = true);
+  // always returns true, see above
+  bool push(uint16_t msgid);
+  bool push(SQueueMessage* msg);
 
   SQueueMessage* pop(bool wait = true);
 
+  uint32_t capacity() { return m_mask + 1; }
+  uint32_t depth();
+  uint32_t maxDepth() { return m_maxdepth; }
+  uint32_t overflowDepth() {
+    return __atomic_load_n(&m_spilled, __ATOMIC_RELAXED);
+  }
+  uint64_t spills() { return m_spills; }
+  uint64_t popWaits() { return m_popwaits; }
+
  private:
-  SMutex m_mutex;
-  SSemaphore m_sem;
-  std::queue<SQueueMessage*> m_queue;
+  struct Cell {
+    uint64_t seq;
+    SQueueMessage* msg;
+  };
+
+  bool tryPush(SQueueMessage* msg);
+  SQueueMessage* tryPop();
+  SQueueMessage* popOverflow();
+
+  Cell* m_cells;
+  uint32_t m_mask;
+
+  // the positions and futex words are padded onto their own cache lines so
+  // that producers and consumers do not false share
+  char m_pad0[SQUEUE_CACHE_LINE];
+  uint64_t m_enqueue;
+  char m_pad1[SQUEUE_CACHE_LINE - sizeof(uint64_t)];
+  uint64_t m_dequeue;
+  char m_pad2[SQUEUE_CACHE_LINE - sizeof(uint64_t)];
+
+  // bumped after a push when a consumer is waiting, consumers sleep on it
+  // with a futex
+  int m_pushed;
+  int m_popwaiters;
+  char m_pad3[SQUEUE_CACHE_LINE - 2 * sizeof(int)];
+
+  SFastMutex m_mutex;
+  std::deque<SQueueMessage*> m_overflow;
+  uint32_t m_spilled;
+
+  uint32_t m_maxdepth;
+  uint64_t m_spills;
+  uint64_t m_popwaits;
 };
 
 #endif  // #define __SQUEUE_H
@@ -29,6 +29,7 @@
 #include "stimer.h"
 #include "stime.h"
 #include "slogger.h"
+#include "shistogram.h"
 
 #define RAPIDJSON_NAMESPACE fdrapidjson
 #include "rapidjson/document.h"
@@ -58,7 +59,8 @@ enum StatType {
   stat_pcrf_sd_rar,
   stat_pcrf_sd_ccr,
   stat_pcrf_st_tsr,
-  stat_pcrf_st_str
+  stat_pcrf_st_str,
+  stat_type_max
 };
 
 enum StatAttempType {
@@ -68,6 +70,25 @@ enum StatAttempType {
   stat_received_ko
 };
 
+// the latencies tracked for each StatType, in microseconds
+enum StatPhase {
+  stat_phase_total,    // request received to answer sent
+  stat_phase_decode,   // extracting the request
+  stat_phase_db,       // waiting for a database query
+  stat_phase_compute,  // building the answer
+  stat_phase_send,     // encoding and sending the answer
+  stat_phase_queue,    // waiting in the HSS worker queue
+  stat_phase_max
+};
+
+// the counter slots of a StatType: the attempt counters are indexed by
+// StatAttempType, followed by the unknown result codes and then the tracked
+// result codes in the order they were registered
+#define SSTATS_SLOTS (16)
+#define SSTATS_SLOT_UNKNOWN (4)
+#define SSTATS_SLOT_CODES (5)
+#define SSTATS_INSTANCES (4)
+
 class StatCollector {
  public:
   StatCollector(const std::string& name);
@@ -78,6 +99,8 @@ class StatCollector {
   uint32_t getStatValue(uint32_t vendor, uint32_t statcode);
   uint32_t getStatValue(std::pair<uint32_t, uint32_t> key);
   uint32_t getNbCodesTracked();
+  uint32_t getCodeSlot(uint32_t vendor, uint32_t statcode);
+  void load(const uint64_t* slots);
   uint32_t getNbAttempsSent() { return m_attemps_sent; }
   uint32_t getNbSentKo() { return m_sent_ko; }
   uint32_t getNbAttempsRecv() { return m_attemps_recv; }
@@ -99,6 +122,69 @@ class StatCollector {
   std::string m_name;
 };
 
+// Per-thread counter tables.  A thread gets its own table the first time it
+// records a statistic and is the only writer of it, so an increment is a
+// plain load and store without a lock or a locked instruction.  The tables
+// are only summed when the statistics are reported, the tables of threads
+// that have exited are kept so that their counts are not lost.  The latency
+// histograms of a table are allocated the first time the thread records a
+// latency of that type and phase.
+class SStatCounters {
+ public:
+  SStatCounters();
+  ~SStatCounters();
+
+  // false when there are more than SSTATS_INSTANCES sets of counters
+  bool enabled() { return m_id < SSTATS_INSTANCES; }
+
+  void inc(uint32_t type, uint32_t slot) {
+    Shard* s = t_shards[m_id];
+    if (!s) s = attach();
+
+    uint64_t* c = &s->counts[type][slot];
+    __atomic_store_n(
+        c, __atomic_load_n(c, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+  }
+
+  void record(uint32_t type, uint32_t phase, uint64_t value) {
+    Shard* s = t_shards[m_id];
+    if (!s) s = attach();
+
+    SHistogram* h = s->latency[type][phase];
+    if (!h) {
+      h = new SHistogram();
+      __atomic_store_n(&s->latency[type][phase], h, __ATOMIC_RELEASE);
+    }
+
+    h->recordLocal(value);
+  }
+
+  // sums the slots of a type over all of the threads
+  void sum(uint32_t type, uint64_t* slots);
+
+  // merges the latencies of a type and phase of all of the threads into h
+  void merge(uint32_t type, uint32_t phase, SHistogram& h);
+
+ private:
+  SStatCounters(const SStatCounters&);
+  SStatCounters& operator=(const SStatCounters&);
+
+  struct Shard {
+    uint64_t counts[stat_type_max][SSTATS_SLOTS];
+    SHistogram* latency[stat_type_max][stat_phase_max];
+    Shard* next;
+  };
+
+  Shard* attach();
+
+  static uint32_t m_instances;
+  static __thread Shard* t_shards[SSTATS_INSTANCES];
+
+  uint32_t m_id;
+  SMutex m_mutex;
+  Shard* m_shards;
+};
+
 class StatResultMessage : public SEventThreadMessage {
  public:
   StatResultMessage(StatType type, uint32_t vendor, uint32_t code)
@@ -203,15 +289,35 @@ class SStats : public SEventThread {
   virtual void getSerializedStat(std::string& stats){};
   virtual void dispatchDerived(SEventThreadMessage& msg) = 0;
   virtual void resetStats()                              = 0;
+  // statistics of a type that has a collector are counted in per-thread
+  // counters and loaded into the collector when they are reported, the
+  // others are posted to the stats thread
+  void registerCollector(StatType type, StatCollector& collector);
   void registerStatAttemp(StatType type, StatAttempType attempType);
   void registerStatResult(StatType type, uint32_t vendor, uint32_t code);
+  void registerLatency(StatType type, StatPhase phase, uint64_t usec) {
+    if (m_counters.enabled()) m_counters.record(type, phase, usec);
+  }
+  void getLatency(StatType type, StatPhase phase, SHistogram& h);
   void appendStatObject(
       RAPIDJSON_NAMESPACE::Value& arrayObjects,
       RAPIDJSON_NAMESPACE::Document::AllocatorType& allocator,
       StatCollector& collector);
+  void appendLatencyObjects(
+      RAPIDJSON_NAMESPACE::Value& arrayObjects,
+      RAPIDJSON_NAMESPACE::Document::AllocatorType& allocator);
+  void serializeLatency(const std::string& prefix, std::string& output);
+
+  // the statistics in the Prometheus text exposition format, read from the
+  // counters directly so it can be called from any thread
+  virtual void getMetrics(std::string& output) {}
+  void serializeMetrics(const std::string& prefix, std::string& output);
+
+  static const char* getPhaseName(StatPhase phase);
 
  private:
   void addGenerationTimeStamp(std::map<std::string, std::string>& keyValues);
+  void consolidateCounters();
 
   long m_interval;
   SEventThread::Timer m_idletimer;
@@ -222,6 +328,9 @@ class SStats : public SEventThread {
   StatSerializationMode m_serializ_mode;
 
   SLogger* m_statlogger;
+
+  SStatCounters m_counters;
+  StatCollector* m_collectors[stat_type_max];
 };
 
 #endif /* __SSTATS_H_ */
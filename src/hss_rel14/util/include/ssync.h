@@ -22,6 +22,7 @@
 #include <string>
 #include <stdexcept>
 
+#include <pthread.h>
 #include <semaphore.h>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +30,8 @@
 
 class SMutexLock;
 
+// Process shared, recursive mutex.  enter(false) does not wait, it returns
+// false when another thread holds the mutex.
 class SMutex {
   friend SMutexLock;
 
@@ -40,6 +43,8 @@ class SMutex {
   void destroy();
 
  protected:
+  void init(bool shared, int type);
+
   bool enter(bool wait = true);
   void leave();
 
@@ -48,6 +53,17 @@ class SMutex {
   bool mInitialized;
 };
 
+// Process private, non-recursive mutex for the per-request processors and
+// the queues, taking it again from the thread that holds it deadlocks.  The
+// adaptive variant spins for a short while before sleeping in the kernel,
+// which suits locks that are only held for a few instructions.
+class SFastMutex : public SMutex {
+ public:
+  SFastMutex(bool adaptive = false) : SMutex(false) {
+    init(false, adaptive ? PTHREAD_MUTEX_ADAPTIVE_NP : PTHREAD_MUTEX_NORMAL);
+  }
+};
+
 class SMutexLock {
  public:
   SMutexLock(SMutex& mtx, bool acq = true) : mAcquire(acq), mMutex(mtx) {
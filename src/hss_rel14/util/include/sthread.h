@@ -21,6 +21,7 @@
 
 #include "ssync.h"
 #include "squeue.h"
+#include "stimerwheel.h"
 
 class SThread {
  public:
@@ -101,8 +102,14 @@ class SEventThread : public SThread {
   /////////////////////////////////////////////////////////////////////////////
   /////////////////////////////////////////////////////////////////////////////
 
-  class Timer {
+  class TimerService;
+
+  // The timers of every SEventThread share one timer wheel driven by a single
+  // timerfd.  When a timer expires an STimerMessage is posted to the thread
+  // from the timer service thread, never from a signal handler.
+  class Timer : public STimerWheel::Entry {
     friend class SEventThread;
+    friend class TimerService;
 
    protected:
     void init(SEventThread* pThread);
@@ -123,21 +130,12 @@ class SEventThread : public SThread {
    private:
     static long m_nextid;
 
+    void onExpired();
+
     long m_id;
     SEventThread* m_thread;
     bool m_oneshot;
     long m_interval;
-    timer_t m_timer;
-    static void _timerHandler(int signo, siginfo_t* pinfo, void* pcontext);
-  };
-
-  class TimerHandler {
-   public:
-    TimerHandler() { init(); }
-    ~TimerHandler() { uninit(); }
-
-    void init();
-    void uninit();
   };
 
   /////////////////////////////////////////////////////////////////////////////
@@ -178,7 +176,6 @@ class SEventThread : public SThread {
   unsigned long threadProc(void* arg);
   void dispatch();
 
-  static TimerHandler m_th;
   SQueue m_events;
 };
 
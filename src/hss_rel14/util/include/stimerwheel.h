@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2017 Sprint
+ *
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the terms found in the LICENSE file in the root of this source tree.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STIMERWHEEL_H
+#define __STIMERWHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// each level of the wheel has 2^STIMERWHEEL_BITS slots, a tick of the first
+// level is the resolution of the wheel and each slot of the next level covers
+// a full revolution of the level below it
+#define STIMERWHEEL_BITS (8)
+#define STIMERWHEEL_SLOTS (1 << STIMERWHEEL_BITS)
+#define STIMERWHEEL_MASK (STIMERWHEEL_SLOTS - 1)
+#define STIMERWHEEL_LEVELS (4)
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Hierarchical timer wheel.  Scheduling and cancelling an entry are O(1) and
+// advance() does a constant amount of work per elapsed tick, entries on the
+// upper levels are moved down a level once per revolution of the level below.
+// Entries further away than the range of the wheel (2^32 ticks) are parked on
+// the last slot of the top level until they come into range.  The wheel is
+// not thread safe, it is meant to be owned and driven by a single thread or
+// to be protected by a lock held by the caller.
+class STimerWheel {
+ public:
+  class Entry {
+    friend class STimerWheel;
+
+   public:
+    Entry() : m_next(NULL), m_prev(NULL), m_wheel(NULL), m_expires(0) {}
+    virtual ~Entry() { cancel(); }
+
+    bool isArmed() const { return m_wheel != NULL; }
+    void cancel() {
+      if (m_wheel) m_wheel->cancel(*this);
+    }
+
+    // called by advance() once the entry has expired, the entry is no
+    // longer armed and may be rescheduled or deleted from the callback
+    virtual void onExpired() = 0;
+
+   private:
+    Entry(const Entry&);
+    Entry& operator=(const Entry&);
+
+    Entry* m_next;
+    Entry* m_prev;
+    STimerWheel* m_wheel;
+    uint64_t m_expires;
+  };
+
+  // the resolution is in milliseconds
+  STimerWheel(long resolution)
+      : m_resolution((resolution > 0 ? resolution : 1) * 1000000LL),
+        m_current(now() / m_resolution),
+        m_size(0) {}
+
+  ~STimerWheel() {
+    for (int l = 0; l < STIMERWHEEL_LEVELS; l++)
+      for (int i = 0; i < STIMERWHEEL_SLOTS; i++)
+        while (!m_wheel[l][i].empty()) cancel(*m_wheel[l][i].m_next);
+  }
+
+  // arms the entry to expire in the given number of milliseconds, an entry
+  // that is already armed is moved
+  void schedule(Entry& e, long milliseconds) {
+    if (e.m_wheel) e.m_wheel->cancel(e);
+
+    uint64_t expires = (uint64_t)(
+        (now() + milliseconds * 1000000LL + m_resolution - 1) / m_resolution);
+    if (expires < m_current) expires = m_current;
+
+    e.m_expires = expires;
+    e.m_wheel   = this;
+    insert(e);
+    m_size++;
+  }
+
+  void cancel(Entry& e) {
+    if (e.m_wheel != this) return;
+
+    unlink(e);
+    e.m_wheel = NULL;
+    m_size--;
+  }
+
+  // fires every entry that expired up to now, returns the number fired
+  uint32_t advance() { return advance(now()); }
+
+  uint32_t advance(int64_t time) {
+    uint64_t target = (uint64_t)(time / m_resolution);
+
+    if (target < m_current) return 0;
+
+    // nothing to cascade or fire, skip the idle ticks
+    if (m_size == 0) {
+      m_current = target + 1;
+      return 0;
+    }
+
+    Slot expired;
+    for (; m_current <= target; m_current++) {
+      uint32_t idx = m_current & STIMERWHEEL_MASK;
+
+      // at the start of a revolution the next slot of the level above is
+      // spread over the level below
+      if (idx == 0)
+        for (int l = 1; l < STIMERWHEEL_LEVELS && cascade(l) == 0; l++)
+          ;
+
+      Slot& slot = m_wheel[0][idx];
+      while (!slot.empty()) {
+        Entry* e = slot.m_next;
+        unlink(*e);
+        if (e->m_expires <= m_current)
+          link(expired, *e);
+        else
+          insert(*e);
+      }
+    }
+
+    // an entry stays armed on the expired list until its callback is run, so
+    // a callback cancelling an entry that is about to fire still works
+    uint32_t fired = 0;
+    while (!expired.empty()) {
+      Entry* e = expired.m_next;
+      cancel(*e);
+      e->onExpired();
+      fired++;
+    }
+
+    return fired;
+  }
+
+  // the time (see now()) at which advance() should be called next, -1 if the
+  // wheel is empty.  This is either the first occupied slot of the current
+  // revolution of the first level or the start of the next revolution, when
+  // the upper levels are cascaded.
+  int64_t nextExpiry() const {
+    if (m_size == 0) return -1;
+
+    uint64_t tick = m_current;
+    if ((tick & STIMERWHEEL_MASK) == 0) return (int64_t)(tick * m_resolution);
+
+    do {
+      if (!m_wheel[0][tick & STIMERWHEEL_MASK].empty())
+        return (int64_t)(tick * m_resolution);
+    } while (++tick & STIMERWHEEL_MASK);
+
+    return (int64_t)(tick * m_resolution);
+  }
+
+  // the time (see now()) at which an armed entry expires
+  int64_t expiresAt(const Entry& e) const {
+    return (int64_t)(e.m_expires * m_resolution);
+  }
+
+  size_t size() const { return m_size; }
+
+  static int64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((int64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+ private:
+  class Slot : public Entry {
+   public:
+    Slot() {
+      m_next = this;
+      m_prev = this;
+    }
+    ~Slot() {
+      m_next = NULL;
+      m_prev = NULL;
+    }
+    bool empty() const { return m_next == this; }
+    void onExpired() {}
+  };
+
+  STimerWheel(const STimerWheel&);
+  STimerWheel& operator=(const STimerWheel&);
+
+  static void link(Entry& head, Entry& e) {
+    e.m_prev            = head.m_prev;
+    e.m_next            = &head;
+    head.m_prev->m_next = &e;
+    head.m_prev         = &e;
+  }
+
+  static void unlink(Entry& e) {
+    e.m_prev->m_next = e.m_next;
+    e.m_next->m_prev = e.m_prev;
+    e.m_next         = NULL;
+    e.m_prev         = NULL;
+  }
+
+  void insert(Entry& e) {
+    uint64_t expires = e.m_expires < m_current ? m_current : e.m_expires;
+    uint64_t delta   = expires - m_current;
+
+    int level = 0;
+    while (level < STIMERWHEEL_LEVELS - 1 &&
+           delta >= ((uint64_t) 1 << (STIMERWHEEL_BITS * (level + 1))))
+      level++;
+
+    uint64_t range = (uint64_t) 1 << (STIMERWHEEL_BITS * STIMERWHEEL_LEVELS);
+    if (delta >= range) expires = m_current + range - 1;
+
+    link(
+        m_wheel[level]
+               [(expires >> (STIMERWHEEL_BITS * level)) & STIMERWHEEL_MASK],
+        e);
+  }
+
+  // moves the entries of the current slot of a level to the levels below,
+  // returns the index of the slot
+  uint32_t cascade(int level) {
+    uint32_t idx =
+        (m_current >> (STIMERWHEEL_BITS * level)) & STIMERWHEEL_MASK;
+    Slot& slot = m_wheel[level][idx];
+    Slot list;
+
+    while (!slot.empty()) {
+      Entry* e = slot.m_next;
+      unlink(*e);
+      link(list, *e);
+    }
+
+    while (!list.empty()) {
+      Entry* e = list.m_next;
+      unlink(*e);
+      insert(*e);
+    }
+
+    return idx;
+  }
+
+  int64_t m_resolution;
+  uint64_t m_current;
+  size_t m_size;
+  Slot m_wheel[STIMERWHEEL_LEVELS][STIMERWHEEL_SLOTS];
+};
+
+#endif  // #define __STIMERWHEEL_H
@@ -518,7 +518,6 @@ FDAvp::FDAvp(FDDictionaryEntryAVP& de, bool dedel)
     : m_de(&de),
       m_avp(NULL),
       m_avphdr(NULL),
-      m_buf(NULL),
       m_assigned(false),
       m_dedel(dedel) {
   init();
@@ -528,7 +527,6 @@ FDAvp::FDAvp(FDDictionaryEntryAVP& de, struct avp* a, bool dedel)
     : m_de(&de),
       m_avp(a),
       m_avphdr(NULL),
-      m_buf(NULL),
       m_assigned(true),
       m_dedel(dedel) {
   memset(&m_value, 0, sizeof(m_value));
@@ -542,8 +540,6 @@ FDAvp::FDAvp(FDDictionaryEntryAVP& de, struct avp* a, bool dedel)
 }
 
 FDAvp::~FDAvp() {
-  if (m_buf) delete m_buf;
-
   if (!m_assigned && m_avp) fd_msg_free(m_avp);
 
   if (m_dedel) delete m_de;
@@ -758,10 +754,10 @@ bool FDAvp::get(STime& v) {
   return true;
 }
 
+// fd_msg_avp_setvalue() copies octet strings into the AVP, so the converted
+// values below only need to live on the stack until set() returns
 FDAvp& FDAvp::set(int64_t v) {
   if (m_de->getDataType() == DDTTime) {
-    m_buf = new FDBuffer<uint8_t>(sizeof(uint32_t));
-
     union {
       uint32_t u;
       uint8_t u8[sizeof(uint32_t)];
@@ -777,13 +773,10 @@ FDAvp& FDAvp::set(int64_t v) {
     val.u8[1] = val.u8[2];
     val.u8[2] = u8;
 #endif
-    set(val.u8, sizeof(uint32_t));
-    //*((uint32_t*)m_buf->get()) = val.u;
-  } else {
-    m_value.i64 = v;
-    return *this;
+    return set(val.u8, sizeof(uint32_t));
   }
 
+  m_value.i64 = v;
   assignValue();
 
   return *this;
@@ -794,63 +787,50 @@ FDAvp& FDAvp::set(const char* v, size_t len) {
   sSS ss;
 
   if (m_de->getDataType() == DDTAddress) {
+    uint8_t abuf[18];
+
     if (inet_pton(AF_INET, v, &((sSA4*) &ss)->sin_addr) == 1) {
-      m_buf                     = new FDBuffer<uint8_t>(18);
-      *(uint16_t*) m_buf->get() = htons(1);
-      memcpy(m_buf->get() + 2, &((sSA4*) &ss)->sin_addr.s_addr, 4);
-      set(m_buf->get(), 6);
+      *(uint16_t*) abuf = htons(1);
+      memcpy(abuf + 2, &((sSA4*) &ss)->sin_addr.s_addr, 4);
+      return set(abuf, 6);
     } else if (inet_pton(AF_INET6, v, &((sSA6*) &ss)->sin6_addr) == 1) {
-      m_buf                     = new FDBuffer<uint8_t>(18);
-      *(uint16_t*) m_buf->get() = htons(2);
-      memcpy(m_buf->get() + 2, &((sSA6*) &ss)->sin6_addr.s6_addr, 16);
-      set(m_buf->get(), 18);
-    } else {
-      set((uint8_t*) v, rawlen);
+      *(uint16_t*) abuf = htons(2);
+      memcpy(abuf + 2, &((sSA6*) &ss)->sin6_addr.s6_addr, 16);
+      return set(abuf, 18);
     }
-  } else {
-    set((uint8_t*) v, rawlen);
   }
 
-  assignValue();
-
-  return *this;
+  return set((const uint8_t*) v, rawlen);
 }
 
 FDAvp& FDAvp::set(const STime& v) {
-  if (m_de->getDataType() == DDTTime) {
-    m_buf = new FDBuffer<uint8_t>(sizeof(uint32_t));
+  if (m_de->getDataType() != DDTTime)
+    throw FDException(SUtility::string_format(
+        "%s:%d - INFO - Unable to assign STime value to [%s]", __FILE__,
+        __LINE__, m_de->getName()));
 
-    union {
-      uint32_t u;
-      uint8_t u8[sizeof(uint32_t)];
-    } val;
+  union {
+    uint32_t u;
+    uint8_t u8[sizeof(uint32_t)];
+  } val;
 
-    ntp_time_t ntp;
+  ntp_time_t ntp;
 
-    v.getNTPTime(ntp);
+  v.getNTPTime(ntp);
 
-    val.u = ntp.second;  // + 2208988800UL;
+  val.u = ntp.second;  // + 2208988800UL;
 
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-    uint8_t u8;
-    u8        = val.u8[0];
-    val.u8[0] = val.u8[3];
-    val.u8[3] = u8;
-    u8        = val.u8[1];
-    val.u8[1] = val.u8[2];
-    val.u8[2] = u8;
+  uint8_t u8;
+  u8        = val.u8[0];
+  val.u8[0] = val.u8[3];
+  val.u8[3] = u8;
+  u8        = val.u8[1];
+  val.u8[1] = val.u8[2];
+  val.u8[2] = u8;
 #endif
 
-    set(val.u8, sizeof(uint32_t));
-  } else {
-    throw FDException(SUtility::string_format(
-        "%s:%d - INFO - Unable to assign STime value to [%s]", __FILE__,
-        __LINE__, m_de->getName()));
-  }
-
-  assignValue();
-
-  return *this;
+  return set(val.u8, sizeof(uint32_t));
 }
 
 FDAvp FDAvp::getNext(bool& found) {
@@ -918,6 +898,54 @@ void FDAvp::addTo(msg_or_avp* reference) {
   m_assigned = true;
 }
 
+void FDAvp::addGrouped(
+    msg_or_avp* reference, FDDictionaryEntryAVP& de,
+    const FDAvpMember* members, size_t count) {
+  struct avp* grouped;
+  int ret;
+
+  if ((ret = fd_msg_avp_new(de.getEntry(), 0, &grouped)) != 0)
+    throw FDException(SUtility::string_format(
+        "%s:%d - ERROR - Error [%d] creating [%s] AVP", __FILE__, __LINE__, ret,
+        de.getName()));
+
+  try {
+    for (size_t i = 0; i < count; i++) {
+      FDDictionaryEntryAVP& mde = members[i].getDictionaryEntry();
+      union avp_value value     = members[i].getValue();
+      struct avp* a;
+
+      if ((ret = fd_msg_avp_new(mde.getEntry(), 0, &a)) != 0)
+        throw FDException(SUtility::string_format(
+            "%s:%d - ERROR - Error [%d] creating [%s] AVP", __FILE__, __LINE__,
+            ret, mde.getName()));
+
+      // once added the member belongs to the grouped AVP and is released
+      // with it
+      if ((ret = fd_msg_avp_add(grouped, MSG_BRW_LAST_CHILD, a)) != 0) {
+        fd_msg_free(a);
+        throw FDException(SUtility::string_format(
+            "%s:%d - ERROR - Error [%d] adding [%s] AVP", __FILE__, __LINE__,
+            ret, mde.getName()));
+      }
+
+      if (mde.getDataType() != DDTGrouped &&
+          (ret = fd_msg_avp_setvalue(a, &value)) != 0)
+        throw FDException(SUtility::string_format(
+            "%s:%d - ERROR - Error [%d] setting AVP value for [%s]", __FILE__,
+            __LINE__, ret, mde.getName()));
+    }
+
+    if ((ret = fd_msg_avp_add(reference, MSG_BRW_LAST_CHILD, grouped)) != 0)
+      throw FDException(SUtility::string_format(
+          "%s:%d - ERROR - Error [%d] adding [%s] AVP", __FILE__, __LINE__,
+          ret, de.getName()));
+  } catch (...) {
+    fd_msg_free(grouped);
+    throw;
+  }
+}
+
 void FDAvp::init() {
   int ret;
 
@@ -1240,6 +1268,15 @@ FDMessageAnswer::FDMessageAnswer(FDMessageRequest* req)
   req->setMsgDelete(false);
 }
 
+FDMessageAnswer& FDMessageAnswer::setResultCode(const char* rescode) {
+  int ret = fd_msg_rescode_set(getMsg(), (char*) rescode, NULL, NULL, 1);
+  if (ret != 0)
+    throw FDException(SUtility::string_format(
+        "%s:%d - Exception - error setting Result-Code %s ret=%d", __FILE__,
+        __LINE__, rescode, ret));
+  return *this;
+}
+
 FDMessageAnswer& FDMessageAnswer::send() {
   sendAnswer();
   return *this;
@@ -1662,24 +1699,64 @@ FDPeer* FDPeerList::getOpenPeer() {
 ////////////////////////////////////////////////////////////////////////////////
 
 FDExtractor::FDExtractor()
-    : FDExtractorBase(NULL), m_parent(NULL), m_reference(NULL), m_index(1) {}
+    : FDExtractorBase(NULL),
+      m_parent(NULL),
+      m_reference(NULL),
+      m_count(0),
+      m_index(1) {}
 
 FDExtractor::FDExtractor(FDMessage& msg)
     : FDExtractorBase(NULL),
       m_parent(NULL),
       m_reference(msg.getMsg()),
+      m_count(0),
       m_index(1) {}
 
 FDExtractor::FDExtractor(FDExtractor& parent, FDDictionaryEntryAVP& de)
-    : FDExtractorBase(&de), m_parent(&parent), m_reference(NULL), m_index(1) {}
+    : FDExtractorBase(&de),
+      m_parent(&parent),
+      m_reference(NULL),
+      m_count(0),
+      m_index(1) {}
 
 FDExtractor::~FDExtractor() {}
 
 void FDExtractor::add(FDExtractorBase& base) {
-  FDExtractorKey k(
-      base.getDictionaryEntry()->getVendorId(),
-      base.getDictionaryEntry()->getAvpCode());
-  m_entries[k] = &base;
+  vendor_id_t vendor = base.getDictionaryEntry()->getVendorId();
+  avp_code_t code    = base.getDictionaryEntry()->getAvpCode();
+  Entry* e           = find(vendor, code);
+
+  // a second add() for the same AVP replaces the first one
+  if (e) {
+    e->base = &base;
+    return;
+  }
+
+  if (m_count < FDEXTRACTOR_ENTRIES) {
+    e = &m_entries[m_count++];
+  } else {
+    // the first spill reserves room for the largest commands (ULR) so that
+    // the extractor is built with at most one allocation
+    if (m_overflow.empty()) m_overflow.reserve(4 * FDEXTRACTOR_ENTRIES);
+    m_overflow.push_back(Entry());
+    e = &m_overflow.back();
+  }
+
+  e->vendor = vendor;
+  e->code   = code;
+  e->base   = &base;
+}
+
+FDExtractor::Entry* FDExtractor::find(vendor_id_t vendor, avp_code_t code) {
+  for (int i = 0; i < m_count; i++)
+    if (m_entries[i].code == code && m_entries[i].vendor == vendor)
+      return &m_entries[i];
+
+  for (size_t i = 0; i < m_overflow.size(); i++)
+    if (m_overflow[i].code == code && m_overflow[i].vendor == vendor)
+      return &m_overflow[i];
+
+  return NULL;
 }
 
 bool FDExtractor::exists(bool skipResolve) {
@@ -1737,8 +1814,7 @@ void FDExtractor::resolve() {
           __FILE__, __LINE__, ret));
 
     struct avp_hdr* ah;
-    FDExtractorKey key;
-    std::map<FDExtractorKey, FDExtractorBase*>::iterator it;
+    Entry* it;
 
     while (loopavp) {
       // get a pointer to the avp header to access the vendor id and avp code
@@ -1748,22 +1824,18 @@ void FDExtractor::resolve() {
             "%s:%d - ERROR - FDExtractor fd_msg_avp_hdr returned %d", __FILE__,
             __LINE__, ret));
 
-      // set the vendor id and avp code in the key
-      key.setVendor(ah->avp_vendor);
-      key.setAvpCode(ah->avp_code);
-
       // lookup up the entry
-      if ((it = m_entries.find(key)) != m_entries.end()) {
-        switch (it->second->getExtractorType()) {
+      if ((it = find(ah->avp_vendor, ah->avp_code)) != NULL) {
+        switch (it->base->getExtractorType()) {
           case etAvp: {
-            FDExtractorAvp* a = (FDExtractorAvp*) it->second;
+            FDExtractorAvp* a = (FDExtractorAvp*) it->base;
             a->setIndex(m_index++);
             a->setResolved();
             a->setAvp((struct avp*) loopavp);
             break;
           }
           case etAvpList: {
-            FDExtractorAvpList* al = (FDExtractorAvpList*) it->second;
+            FDExtractorAvpList* al = (FDExtractorAvpList*) it->base;
             FDExtractorAvp* a =
                 new FDExtractorAvp(*this, *al->getDictionaryEntry());
             a->setIndex(m_index++);
@@ -1774,13 +1846,13 @@ void FDExtractor::resolve() {
             break;
           }
           case etExtractor: {
-            FDExtractor* e = (FDExtractor*) it->second;
+            FDExtractor* e = (FDExtractor*) it->base;
             e->setIndex(m_index++);
             e->setReference(loopavp);
             break;
           }
           case etExtractorList: {
-            FDExtractorList* el = (FDExtractorList*) it->second;
+            FDExtractorList* el = (FDExtractorList*) it->base;
             FDExtractor* e      = el->createExtractor();
             e->setIndex(m_index++);
             e->setReference(loopavp);
@@ -343,183 +343,38 @@ class AvpDictionaryEntry {
 static SMutex dictEntriesMutex;
 static std::unordered_map<std::string, AvpDictionaryEntry*> dictEntries;
 
-class AVP {
- public:
-  AVP(const char* avp_name) { _init(avp_name); }
-  AVP(const char* avp_name, int32_t v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, int64_t v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, uint32_t v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, uint64_t v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, float v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, double v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, const int8_t* v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, const int8_t* v, size_t len) {
-    _init(avp_name);
-    set(v, len);
-  }
-  AVP(const char* avp_name, const uint8_t* v) {
-    _init(avp_name);
-    set(v);
-  }
-  AVP(const char* avp_name, const uint8_t* v, size_t len) {
-    _init(avp_name);
-    set(v, len);
-  }
-
-  ~AVP() {
-    if (mBuf) delete mBuf;
-  }
-
-  AVP& set(int32_t v) {
-    mValue.i32 = v;
-    return *this;
-  }
-  AVP& set(int64_t v) {
-    mValue.i64 = v;
-    return *this;
-  }
-  AVP& set(uint32_t v) {
-    mValue.u32 = v;
-    return *this;
-  }
-  AVP& set(uint64_t v) {
-    mValue.u64 = v;
-    return *this;
-  }
-  AVP& set(float v) {
-    mValue.f32 = v;
-    return *this;
-  }
-  AVP& set(double v) {
-    mValue.f64 = v;
-    return *this;
-  }
-  AVP& set(const int8_t* v) { return set(v, strlen((const char*) v)); }
-  AVP& set(const int8_t* v, size_t len) {
-    mValue.os.data = (uint8_t*) v;
-    mValue.os.len  = len;
-    return *this;
-  }
-  AVP& set(const uint8_t* v) { return set(v, strlen((const char*) v)); }
-  AVP& set(const uint8_t* v, size_t len) {
-    mValue.os.data = (uint8_t*) v;
-    mValue.os.len  = len;
-    return *this;
-  }
+// the entries are never removed, so the returned entry and the name it holds
+// stay valid for the life of the process
+static AvpDictionaryEntry* fdJsonGetDictionaryEntry(const char* avp_name) {
+  SMutexLock l(dictEntriesMutex);
 
-  void addTo(msg_or_avp* reference) { _addTo(reference); }
-  void addTo(AVP& reference) { _addTo(reference.mAvp); }
-
-  struct avp* getAvp() {
-    return mAvp;
-  }
+  std::string an = avp_name;
+  auto it        = dictEntries.find(an);
+  if (it != dictEntries.end()) return it->second;
 
-  void allocBuffer(size_t len) {
-    if (mBuf) {
-      delete mBuf;
-    }
-    mBuf = new Buffer<uint8_t>(len);
+  AvpDictionaryEntry* ade = new AvpDictionaryEntry();
+  try {
+    ade->init(avp_name);
+  } catch (...) {
+    delete ade;
+    throw;
   }
-  Buffer<uint8_t>& getBuffer() { return *mBuf; }
-
-  dict_avp_basetype getBaseType() { return mBaseData.avp_basetype; }
-  AvpDataType getType() { return mType; }
-
- private:
-  void _init(const char* avp_name) {
-    mName      = avp_name;
-    mBaseEntry = NULL;
-    memset(&mBaseData, 0, sizeof(mBaseData));
-    mType = ADTUnknown;
-    mBuf  = NULL;
-    mAvp  = NULL;
-    memset(&mValue, 0, sizeof(mValue));
-
-    /* check if an entry exists in dictEntries */
-    std::string an = avp_name;
-    auto it        = dictEntries.find(an);
-    if (it == dictEntries.end()) {
-      SMutexLock l(dictEntriesMutex);
-
-      it = dictEntries.find(an);
-      if (it == dictEntries.end()) {
-        AvpDictionaryEntry* ade = new AvpDictionaryEntry();
-        ade->init(avp_name);
-        std::pair<std::string, AvpDictionaryEntry*> data(
-            ade->getAvpName(), ade);
-        auto result = dictEntries.insert(data);
-        if (result.second == false) {
-          delete ade;
-          throw runtimeInfo(string_format(
-              "%s:%d - WARN - Unable to insert AvpDictionaryEntry for [%s]",
-              __FILE__, __LINE__, avp_name));
-        }
-
-        it = result.first;
-      }
-    }
 
-    mBaseEntry = it->second->getBaseEntry();
-    memcpy(&mBaseData, &it->second->getBaseData(), sizeof(mBaseData));
-    mType = it->second->getType();
+  std::pair<std::string, AvpDictionaryEntry*> data(ade->getAvpName(), ade);
+  auto result = dictEntries.insert(data);
+  if (result.second == false) {
+    delete ade;
+    throw runtimeInfo(string_format(
+        "%s:%d - WARN - Unable to insert AvpDictionaryEntry for [%s]",
+        __FILE__, __LINE__, avp_name));
   }
 
-  void _addTo(msg_or_avp* reference) {
-    int ret;
-
-    if ((ret = fd_msg_avp_new(mBaseEntry, 0, &mAvp)) != 0)
-      throw runtimeError(string_format(
-          "%s:%d - ERROR - Error [%d] creating [%s] AVP", __FILE__, __LINE__,
-          ret, mName));
-
-    try {
-      if (mBaseData.avp_basetype != AVP_TYPE_GROUPED) {
-        if ((ret = fd_msg_avp_setvalue(mAvp, &mValue)) != 0)
-          throw runtimeError(string_format(
-              "%s:%d - ERROR - Error [%d] setting AVP value for [%s]", __FILE__,
-              __LINE__, ret, mName));
-      }
-
-      if ((ret = fd_msg_avp_add(reference, MSG_BRW_LAST_CHILD, mAvp)) != 0)
-        throw runtimeError(string_format(
-            "%s:%d - ERROR - Error [%d] adding [%s] AVP", __FILE__, __LINE__,
-            ret, mName));
-    } catch (...) {
-      fd_msg_free(mAvp);
-      mAvp = NULL;
-      throw;
-    }
-  }
+  return result.first->second;
+}
 
-  const char* mName;
-  struct dict_object* mBaseEntry;
-  struct dict_avp_data mBaseData;
-  AvpDataType mType;
-  Buffer<uint8_t>* mBuf;
-  struct avp* mAvp;
-  union avp_value mValue;
-};
+static void fdJsonError(void (*errfunc)(const char*), const char* msg) {
+  if (errfunc) errfunc(msg);
+}
 
 #define THROW_DATATYPE_MISMATCH()                                              \
   {                                                                            \
@@ -622,17 +477,66 @@ static bool isHexString(const char* s, int len) {
   return true;
 }
 
-static void fdJsonAddAvps(
-    AVP& avp, const RAPIDJSON_NAMESPACE::Value& element,
-    void (*errfunc)(const char*));
-static void fdJsonAddAvps(
-    msg_or_avp* reference, const RAPIDJSON_NAMESPACE::Value& element,
-    void (*errfunc)(const char*));
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Appends the AVPs described by a parsed JSON block to an FDJsonEncoding.
+// Numbers must match the base type of the AVP, strings are only accepted for
+// octet string based AVPs and are converted according to the derived type
+// (Address, Time, "0x" prefixed hex OctetString), arrays repeat the AVP and
+// objects become grouped AVPs.  A member that cannot be converted is reported
+// through errfunc and skipped.
+class FDJsonCompiler {
+ public:
+  FDJsonCompiler(FDJsonEncoding& enc, void (*errfunc)(const char*))
+      : m_enc(enc), m_errfunc(errfunc) {}
+
+  void addMember(const char* name, const RAPIDJSON_NAMESPACE::Value& value);
+  void addMembers(const RAPIDJSON_NAMESPACE::Value& element);
+
+ private:
+  uint32_t addNode(AvpDictionaryEntry& avp, const union avp_value& value);
+  uint32_t addNode(AvpDictionaryEntry& avp, const uint8_t* data, size_t len);
+
+  FDJsonEncoding& m_enc;
+  void (*m_errfunc)(const char*);
+};
+
+uint32_t FDJsonCompiler::addNode(
+    AvpDictionaryEntry& avp, const union avp_value& value) {
+  FDJsonEncoding::Node n;
+
+  n.entry    = avp.getBaseEntry();
+  n.name     = avp.getAvpName().c_str();
+  n.basetype = avp.getBaseData().avp_basetype;
+  n.value    = value;
+  n.offset   = m_enc.m_data.size();
+  n.end      = m_enc.m_nodes.size() + 1;
+
+  m_enc.m_nodes.push_back(n);
+
+  return n.end - 1;
+}
+
+uint32_t FDJsonCompiler::addNode(
+    AvpDictionaryEntry& avp, const uint8_t* data, size_t len) {
+  union avp_value value;
+
+  memset(&value, 0, sizeof(value));
+  value.os.len = len;
+
+  uint32_t idx = addNode(avp, value);
+  m_enc.m_data.append((const char*) data, len);
+
+  return idx;
+}
+
+void FDJsonCompiler::addMember(
+    const char* name, const RAPIDJSON_NAMESPACE::Value& value) {
+  AvpDictionaryEntry& avp = *fdJsonGetDictionaryEntry(name);
+  union avp_value v;
 
-static void fdJsonAddAvp(
-    msg_or_avp* reference, const char* name,
-    const RAPIDJSON_NAMESPACE::Value& value, void (*errfunc)(const char*)) {
-  AVP avp(name);
+  memset(&v, 0, sizeof(v));
 
   switch (value.GetType()) {
     case RAPIDJSON_NAMESPACE::kFalseType:
@@ -650,35 +554,35 @@ static void fdJsonAddAvp(
       break;
     }
     case RAPIDJSON_NAMESPACE::kNumberType: {
-      switch (avp.getBaseType()) {
+      switch (avp.getBaseData().avp_basetype) {
         case AVP_TYPE_INTEGER32: {
           if (!value.IsInt()) THROW_DATATYPE_MISMATCH();
-          avp.set(value.GetInt());
+          v.i32 = value.GetInt();
           break;
         }
         case AVP_TYPE_INTEGER64: {
           if (!value.IsInt64()) THROW_DATATYPE_MISMATCH();
-          avp.set(value.GetInt64());
+          v.i64 = value.GetInt64();
           break;
         }
         case AVP_TYPE_UNSIGNED32: {
           if (!value.IsUint()) THROW_DATATYPE_MISMATCH();
-          avp.set(value.GetUint());
+          v.u32 = value.GetUint();
           break;
         }
         case AVP_TYPE_UNSIGNED64: {
           if (!value.IsUint64()) THROW_DATATYPE_MISMATCH();
-          avp.set(value.GetUint64());
+          v.u64 = value.GetUint64();
           break;
         }
         case AVP_TYPE_FLOAT32: {
           if (!value.IsFloat()) THROW_DATATYPE_MISMATCH();
-          avp.set(value.GetFloat());
+          v.f32 = value.GetFloat();
           break;
         }
         case AVP_TYPE_FLOAT64: {
           if (!value.IsDouble()) THROW_DATATYPE_MISMATCH();
-          avp.set(value.GetDouble());
+          v.f64 = value.GetDouble();
           break;
         }
         default: {
@@ -686,32 +590,34 @@ static void fdJsonAddAvp(
         }
       }
 
-      avp.addTo(reference);
+      addNode(avp, v);
 
       break;
     }
     case RAPIDJSON_NAMESPACE::kStringType: {
-      if (avp.getBaseType() != AVP_TYPE_OCTETSTRING) THROW_DATATYPE_MISMATCH();
+      if (avp.getBaseData().avp_basetype != AVP_TYPE_OCTETSTRING)
+        THROW_DATATYPE_MISMATCH();
 
-      size_t rawlen = strlen(value.GetString());
+      const uint8_t* p = (const uint8_t*) value.GetString();
+      size_t rawlen    = strlen(value.GetString());
 
       if (avp.getType() == ADTAddress) {
         sSS ss;
-        char abuf[18];
+        uint8_t abuf[18];
 
         if (inet_pton(AF_INET, value.GetString(), &((sSA4*) &ss)->sin_addr) ==
             1) {
           *(uint16_t*) abuf = htons(1);
           memcpy(abuf + 2, &((sSA4*) &ss)->sin_addr.s_addr, 4);
-          avp.set((uint8_t*) abuf, 6);
+          addNode(avp, abuf, 6);
         } else if (
             inet_pton(AF_INET6, value.GetString(), &((sSA6*) &ss)->sin6_addr) ==
             1) {
           *(uint16_t*) abuf = htons(2);
           memcpy(abuf + 2, &((sSA6*) &ss)->sin6_addr.s6_addr, 16);
-          avp.set((uint8_t*) abuf, 18);
+          addNode(avp, abuf, 18);
         } else {
-          avp.set((uint8_t*) value.GetString(), rawlen);
+          addNode(avp, p, rawlen);
         }
       } else if (avp.getType() == ADTTime) {
         union {
@@ -725,74 +631,45 @@ static void fdJsonAddAvp(
 
         t.getNTPTime(ntp);
 
-        val.u = ntp.second;
-
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-        uint8_t u8;
-        u8        = val.u8[0];
-        val.u8[0] = val.u8[3];
-        val.u8[3] = u8;
-        u8        = val.u8[1];
-        val.u8[1] = val.u8[2];
-        val.u8[2] = u8;
-#endif
-
-        avp.set(val.u8, sizeof(uint32_t));
-      } else if (avp.getType() == ADTOctetString) {
-        if (isHexString((const char*) value.GetString(), rawlen)) {
-          /*
-           * hex string format is "0x" or "0X" followed by an even number of hex
-           * characters binlen is equal to the final length + 1
-           */
-          size_t binlen = rawlen / 2;
-
-          /*
-           * allocate space for the binary string
-           */
-          avp.allocBuffer(binlen - 1);
-
-          /*
-           * grab a pointer to the hex character buffer
-           */
-          const uint8_t* p = (const uint8_t*) value.GetString();
-
-          /*
-           * create the binary string from the hex digit string
-           * start index at 1 (first hex digit divided by number of digits per
-           * byte, 2 / 2 = 1) to start at the first hex digit
-           */
-          for (uint32_t i = 1; i < binlen; i++)
-            avp.getBuffer().get()[i - 1] =
-                (HEX2BIN(p[i * 2]) << 4) + HEX2BIN(p[i * 2 + 1]);
-
-          /*
-           * assign the string to the avp
-           */
-          avp.set(avp.getBuffer().get(), binlen - 1);
-        } else {
-          avp.set((uint8_t*) value.GetString(), rawlen);
-        }
+        val.u = htonl(ntp.second);
+
+        addNode(avp, val.u8, sizeof(uint32_t));
+      } else if (
+          avp.getType() == ADTOctetString &&
+          isHexString((const char*) p, rawlen)) {
+        /*
+         * hex string format is "0x" or "0X" followed by an even number of hex
+         * characters, the binary string is one byte shorter than half of it
+         */
+        size_t binlen = rawlen / 2 - 1;
+        Buffer<uint8_t> buf(binlen ? binlen : 1);
+
+        /*
+         * start at the first hex digit following the "0x"
+         */
+        for (size_t i = 0; i < binlen; i++)
+          buf.get()[i] = (HEX2BIN(p[i * 2 + 2]) << 4) + HEX2BIN(p[i * 2 + 3]);
+
+        addNode(avp, buf.get(), binlen);
       } else  // some variant of a standard string
       {
-        avp.set((uint8_t*) value.GetString(), rawlen);
+        addNode(avp, p, rawlen);
       }
 
-      /* add to the message/grouped avp */
-      avp.addTo(reference);
-
       break;
     }
     case RAPIDJSON_NAMESPACE::kArrayType: {
-      /* iterate through array elements adding them to reference */
+      /* each array element is another instance of the AVP */
       for (RAPIDJSON_NAMESPACE::Value::ConstValueIterator it = value.Begin();
            it != value.End(); ++it) {
-        fdJsonAddAvp(reference, name, *it, errfunc);
+        addMember(name, *it);
       }
       break;
     }
     case RAPIDJSON_NAMESPACE::kObjectType: {
-      avp.addTo(reference);
-      fdJsonAddAvps(avp, value, errfunc);
+      uint32_t idx = addNode(avp, v);
+      addMembers(value);
+      m_enc.m_nodes[idx].end = m_enc.m_nodes.size();
       break;
     }
     default: {
@@ -804,57 +681,169 @@ static void fdJsonAddAvp(
   }
 }
 
-static void fdJsonAddAvps(
-    AVP& avp, const RAPIDJSON_NAMESPACE::Value& element,
-    void (*errfunc)(const char*)) {
-  fdJsonAddAvps(avp.getAvp(), element, errfunc);
-}
-
-static void fdJsonAddAvps(
-    msg_or_avp* reference, const RAPIDJSON_NAMESPACE::Value& element,
-    void (*errfunc)(const char*)) {
-  /* iterate through each of the child elements adding them to the reference */
+void FDJsonCompiler::addMembers(const RAPIDJSON_NAMESPACE::Value& element) {
+  /* iterate through each of the child elements adding them to the encoding */
   for (RAPIDJSON_NAMESPACE::Value::ConstMemberIterator it =
            element.MemberBegin();
        it != element.MemberEnd(); ++it) {
     try {
-      fdJsonAddAvp(reference, it->name.GetString(), it->value, errfunc);
+      addMember(it->name.GetString(), it->value);
     } catch (runtimeInfo& exi) {
-      errfunc(exi.what());
+      fdJsonError(m_errfunc, exi.what());
     }
   }
 }
 
-int fdJsonAddAvps(
-    const char* json, msg_or_avp* msg, void (*errfunc)(const char*)) {
-  int ret = FDJSON_SUCCESS;
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+int FDJsonEncoding::compile(const char* json, void (*errfunc)(const char*)) {
   RAPIDJSON_NAMESPACE::Document doc;
 
-  if (!json) {
-    errfunc(string_format(
-                "%s:%d - ERROR - Error parsing JSON string", __FILE__, __LINE__)
-                .c_str());
+  m_source.clear();
+  m_nodes.clear();
+  m_data.clear();
+
+  if (!json ||
+      doc.Parse<RAPIDJSON_NAMESPACE::kParseNoFlags>(json).HasParseError()) {
+    fdJsonError(
+        errfunc, string_format(
+                     "%s:%d - ERROR - Error parsing JSON string", __FILE__,
+                     __LINE__)
+                     .c_str());
     return FDJSON_JSON_PARSING_ERROR;
   }
 
-  if (doc.Parse<RAPIDJSON_NAMESPACE::kParseNoFlags>(json).HasParseError()) {
-    errfunc(string_format(
-                "%s:%d - ERROR - Error parsing JSON string", __FILE__, __LINE__)
-                .c_str());
-    return FDJSON_JSON_PARSING_ERROR;
+  m_source = json;
+
+  // unlike the members of a grouped AVP, a top level member that cannot be
+  // converted is not skipped, the exception is passed on to the caller
+  FDJsonCompiler compiler(*this, errfunc);
+  for (RAPIDJSON_NAMESPACE::Value::ConstMemberIterator it = doc.MemberBegin();
+       it != doc.MemberEnd(); ++it) {
+    compiler.addMember(it->name.GetString(), it->value);
   }
 
+  return FDJSON_SUCCESS;
+}
+
+int FDJsonEncoding::addTo(
+    msg_or_avp* reference, void (*errfunc)(const char*)) const {
   try {
-    for (RAPIDJSON_NAMESPACE::Value::ConstMemberIterator it = doc.MemberBegin();
-         it != doc.MemberEnd(); ++it) {
-      fdJsonAddAvp(msg, it->name.GetString(), it->value, errfunc);
-    }
+    add(reference, 0, m_nodes.size());
   } catch (runtimeError& ex) {
-    errfunc(ex.what());
-    ret = FDJSON_EXCEPTION;
+    fdJsonError(errfunc, ex.what());
+    return FDJSON_EXCEPTION;
+  }
+
+  return FDJSON_SUCCESS;
+}
+
+void FDJsonEncoding::add(
+    msg_or_avp* reference, uint32_t begin, uint32_t end) const {
+  uint32_t idx = begin;
+
+  while (idx < end) {
+    const Node& n = m_nodes[idx];
+    struct avp* avp;
+    int ret;
+
+    if ((ret = fd_msg_avp_new(n.entry, 0, &avp)) != 0)
+      throw runtimeError(string_format(
+          "%s:%d - ERROR - Error [%d] creating [%s] AVP", __FILE__, __LINE__,
+          ret, n.name));
+
+    try {
+      if (n.basetype != AVP_TYPE_GROUPED) {
+        // fd_msg_avp_setvalue() copies octet strings, the AVP does not
+        // reference m_data once it returns
+        union avp_value value = n.value;
+        if (n.basetype == AVP_TYPE_OCTETSTRING)
+          value.os.data = (uint8_t*) m_data.data() + n.offset;
+
+        if ((ret = fd_msg_avp_setvalue(avp, &value)) != 0)
+          throw runtimeError(string_format(
+              "%s:%d - ERROR - Error [%d] setting AVP value for [%s]",
+              __FILE__, __LINE__, ret, n.name));
+      }
+
+      if ((ret = fd_msg_avp_add(reference, MSG_BRW_LAST_CHILD, avp)) != 0)
+        throw runtimeError(string_format(
+            "%s:%d - ERROR - Error [%d] adding [%s] AVP", __FILE__, __LINE__,
+            ret, n.name));
+    } catch (...) {
+      fd_msg_free(avp);
+      throw;
+    }
+
+    add(avp, idx + 1, n.end);
+    idx = n.end;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+FDJsonEncodingPtr FDJsonCache::get(
+    const std::string& key, const std::string& json,
+    void (*errfunc)(const char*), bool& hit) {
+  {
+    SMutexLock l(m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->second->getSource() == json) {
+      hit = true;
+      return it->second;
+    }
+  }
+
+  hit = false;
+
+  // compiled outside of the lock, two threads missing on the same key both
+  // compile it and the last one to finish is kept
+  std::shared_ptr<FDJsonEncoding> enc(new FDJsonEncoding());
+  if (enc->compile(json.c_str(), errfunc) != FDJSON_SUCCESS)
+    return FDJsonEncodingPtr();
+
+  if (m_capacity == 0) return enc;
+
+  SMutexLock l(m_mutex);
+  auto it = m_entries.find(key);
+  if (it != m_entries.end()) {
+    it->second = enc;
+  } else {
+    // the blocks are cheap to compile again, so when the cache is full an
+    // arbitrary entry makes room rather than keeping LRU order
+    if (m_entries.size() >= m_capacity) m_entries.erase(m_entries.begin());
+    m_entries[key] = enc;
   }
 
-  return ret;
+  return enc;
+}
+
+void FDJsonCache::erase(const std::string& key) {
+  SMutexLock l(m_mutex);
+  m_entries.erase(key);
+}
+
+void FDJsonCache::clear() {
+  SMutexLock l(m_mutex);
+  m_entries.clear();
+}
+
+size_t FDJsonCache::size() {
+  SMutexLock l(m_mutex);
+  return m_entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+int fdJsonAddAvps(
+    const char* json, msg_or_avp* msg, void (*errfunc)(const char*)) {
+  FDJsonEncoding enc;
+  int ret = enc.compile(json, errfunc);
+
+  return ret == FDJSON_SUCCESS ? enc.addTo(msg, errfunc) : ret;
 }
 
 std::string fdJsonBinaryToHex(const unsigned char* buffer, size_t len) {
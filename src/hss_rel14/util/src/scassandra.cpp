@@ -196,6 +196,45 @@ void SCassIterator::release() {
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+SCassPrepared::SCassPrepared() : m_prepared(NULL) {}
+
+SCassPrepared::SCassPrepared(const CassPrepared* prepared)
+    : m_prepared(prepared) {}
+
+SCassPrepared::~SCassPrepared() {
+  release();
+}
+
+SCassPrepared& SCassPrepared::operator=(const CassPrepared* prepared) {
+  release();
+  m_prepared = prepared;
+  return *this;
+}
+
+SCassPrepared::SCassPrepared(SCassPrepared&& rval)
+    : m_prepared(rval.m_prepared) {
+  rval.m_prepared = NULL;
+}
+
+SCassPrepared& SCassPrepared::operator=(SCassPrepared&& rval) {
+  if (this != &rval) {
+    release();
+    m_prepared      = rval.m_prepared;
+    rval.m_prepared = NULL;
+  }
+  return *this;
+}
+
+void SCassPrepared::release() {
+  if (m_prepared) {
+    cass_prepared_free(m_prepared);
+    m_prepared = NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
 SCassResult::SCassResult() : m_result(NULL) {}
 
 SCassResult::SCassResult(const CassResult* result) : m_result(result) {}
@@ -289,19 +328,31 @@ SCassResult SCassFuture::result() {
   return SCassResult(cass_future_get_result(m_future));
 }
 
+SCassPrepared SCassFuture::prepared() {
+  return SCassPrepared(cass_future_get_prepared(m_future));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-SCassStatement::SCassStatement() : m_statement(NULL) {}
+SCassStatement::SCassStatement()
+    : m_statement(NULL), m_binderror(CASS_OK) {}
 
-SCassStatement::SCassStatement(const char* qry) : m_statement(NULL) {
+SCassStatement::SCassStatement(const char* qry)
+    : m_statement(NULL), m_binderror(CASS_OK) {
   query(qry);
 }
 
-SCassStatement::SCassStatement(const std::string& qry) : m_statement(NULL) {
+SCassStatement::SCassStatement(const std::string& qry)
+    : m_statement(NULL), m_binderror(CASS_OK) {
   query(qry);
 }
 
+SCassStatement::SCassStatement(SCassPrepared& prepared)
+    : m_statement(NULL), m_binderror(CASS_OK) {
+  this->prepared(prepared);
+}
+
 SCassStatement::~SCassStatement() {
   release();
 }
@@ -310,6 +361,7 @@ SCassStatement& SCassStatement::query(const char* qry) {
   release();
   m_query     = qry;
   m_statement = cass_statement_new(m_query.c_str(), 0);
+  m_binderror = CASS_OK;
   return *this;
 }
 
@@ -317,6 +369,31 @@ SCassStatement& SCassStatement::query(const std::string& qry) {
   return query(qry.c_str());
 }
 
+SCassStatement& SCassStatement::prepared(SCassPrepared& prepared) {
+  release();
+  m_query.clear();
+  m_statement = cass_prepared_bind(prepared.getPrepared());
+  m_binderror = CASS_OK;
+  return *this;
+}
+
+CassError SCassStatement::bind(size_t index, const char* v) {
+  return bound(cass_statement_bind_string(m_statement, index, v));
+}
+
+CassError SCassStatement::bind(size_t index, const std::string& v) {
+  return bound(
+      cass_statement_bind_string_n(m_statement, index, v.c_str(), v.size()));
+}
+
+CassError SCassStatement::bind(size_t index, int32_t v) {
+  return bound(cass_statement_bind_int32(m_statement, index, v));
+}
+
+CassError SCassStatement::bind(size_t index, int64_t v) {
+  return bound(cass_statement_bind_int64(m_statement, index, v));
+}
+
 void SCassStatement::release() {
   if (m_statement) {
     cass_statement_free(m_statement);
@@ -15,6 +15,10 @@
  */
 
 #include <climits>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "squeue.h"
 
@@ -30,52 +34,183 @@ SQueueMessage::~SQueueMessage() {}
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-SQueue::SQueue() {
-  // m_sem.init( 0, SEM_VALUE_MAX );
-  m_sem.init(0, 0);
+static inline void futex_wait(int* addr, int val) {
+  syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline void futex_wake(int* addr) {
+  syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+SQueue::SQueue(uint32_t capacity) : m_mutex(true) {
+  uint32_t size = 2;
+
+  // round the capacity up to a power of 2
+  while (size < capacity) size <<= 1;
+
+  m_cells = new Cell[size];
+  m_mask  = size - 1;
+
+  for (uint32_t i = 0; i < size; i++) {
+    m_cells[i].seq = i;
+    m_cells[i].msg = NULL;
+  }
+
+  m_enqueue     = 0;
+  m_dequeue     = 0;
+  m_pushed      = 0;
+  m_popwaiters  = 0;
+  m_spilled     = 0;
+  m_maxdepth    = 0;
+  m_spills      = 0;
+  m_popwaits    = 0;
 }
 
 SQueue::~SQueue() {
   SQueueMessage* m;
 
   while ((m = pop(false))) delete m;
+
+  delete[] m_cells;
+}
+
+uint32_t SQueue::depth() {
+  uint64_t deq = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+  uint64_t enq = __atomic_load_n(&m_enqueue, __ATOMIC_RELAXED);
+
+  uint32_t spilled = __atomic_load_n(&m_spilled, __ATOMIC_SEQ_CST);
+
+  return (enq > deq ? (uint32_t)(enq - deq) : 0) + spilled;
+}
+
+bool SQueue::tryPush(SQueueMessage* msg) {
+  uint64_t pos = __atomic_load_n(&m_enqueue, __ATOMIC_RELAXED);
+  Cell* cell;
+
+  while (true) {
+    cell         = &m_cells[pos & m_mask];
+    uint64_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    int64_t dif  = (int64_t) seq - (int64_t) pos;
+
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(
+              &m_enqueue, &pos, pos + 1, true, __ATOMIC_RELAXED,
+              __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0) {
+      // full
+      return false;
+    } else {
+      pos = __atomic_load_n(&m_enqueue, __ATOMIC_RELAXED);
+    }
+  }
+
+  cell->msg = msg;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+  // sample the high water mark, reading m_dequeue on every push would pull
+  // the consumers' cache line over
+  if ((pos & SQUEUE_DEPTH_SAMPLE) == 0 ||
+      (pos & m_mask) == m_mask) {
+    uint64_t deq = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+    uint32_t d   = (uint32_t)(pos + 1 - deq);
+    uint32_t md  = __atomic_load_n(&m_maxdepth, __ATOMIC_RELAXED);
+    while (d > md && d <= capacity() &&
+           !__atomic_compare_exchange_n(
+               &m_maxdepth, &md, d, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+  }
+
+  return true;
 }
 
-bool SQueue::push(uint16_t msgid, bool wait) {
-  SQueueMessage* m = new SQueueMessage(msgid);
+SQueueMessage* SQueue::tryPop() {
+  uint64_t pos = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+  Cell* cell;
+
+  while (true) {
+    cell         = &m_cells[pos & m_mask];
+    uint64_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    int64_t dif  = (int64_t) seq - (int64_t)(pos + 1);
+
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(
+              &m_dequeue, &pos, pos + 1, true, __ATOMIC_RELAXED,
+              __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0) {
+      // empty
+      return NULL;
+    } else {
+      pos = __atomic_load_n(&m_dequeue, __ATOMIC_RELAXED);
+    }
+  }
+
+  SQueueMessage* msg = cell->msg;
+  __atomic_store_n(&cell->seq, pos + m_mask + 1, __ATOMIC_RELEASE);
+
+  return msg;
+}
 
-  bool result = push(m, wait);
+SQueueMessage* SQueue::popOverflow() {
+  if (__atomic_load_n(&m_spilled, __ATOMIC_ACQUIRE) == 0) return NULL;
 
-  if (!result) delete m;
+  SMutexLock l(m_mutex);
 
-  return result;
+  if (m_overflow.empty()) return NULL;
+
+  SQueueMessage* msg = m_overflow.front();
+  m_overflow.pop_front();
+  __atomic_sub_fetch(&m_spilled, 1, __ATOMIC_SEQ_CST);
+
+  return msg;
 }
 
-bool SQueue::push(SQueueMessage* msg, bool wait) {
-  SMutexLock l(m_mutex, false);
+bool SQueue::push(uint16_t msgid) {
+  return push(new SQueueMessage(msgid));
+}
 
-  if (l.acquire(wait)) {
-    m_queue.push(msg);
-    m_sem.increment();
-    return true;
+bool SQueue::push(SQueueMessage* msg) {
+  // once a message has spilled, keep appending to the overflow list until
+  // the consumers have drained it so that the queue stays FIFO
+  if (__atomic_load_n(&m_spilled, __ATOMIC_ACQUIRE) > 0 || !tryPush(msg)) {
+    SMutexLock l(m_mutex);
+    m_overflow.push_back(msg);
+    __atomic_add_fetch(&m_spilled, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&m_spills, 1, __ATOMIC_RELAXED);
   }
 
-  return false;
+  // a consumer registers as a waiter before re-checking the depth, so either
+  // it sees this message or the waiter count is seen here
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&m_popwaiters, __ATOMIC_RELAXED) > 0) {
+    __atomic_add_fetch(&m_pushed, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&m_pushed);
+  }
+
+  return true;
 }
 
 SQueueMessage* SQueue::pop(bool wait) {
-  SQueueMessage* msg = NULL;
+  SQueueMessage* msg;
+  int spins = 0;
 
-  if (m_sem.decrement(wait)) {
-    SMutexLock l(m_mutex, false);
+  while (!(msg = tryPop()) && !(msg = popOverflow())) {
+    if (!wait) return NULL;
 
-    if (l.acquire(wait)) {
-      msg = m_queue.front();
-      m_queue.pop();
-    } else {
-      // increment the message count since we could not lock the queue
-      m_sem.increment();
+    if (spins == 0) __atomic_add_fetch(&m_popwaits, 1, __ATOMIC_RELAXED);
+
+    // yield briefly before sleeping, a producer may be about to publish
+    if (spins++ < SQUEUE_YIELDS) {
+      sched_yield();
+      continue;
     }
+
+    // the queue is empty, sleep until a producer adds a message
+    int pushed = __atomic_load_n(&m_pushed, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&m_popwaiters, 1, __ATOMIC_SEQ_CST);
+    if (depth() == 0) futex_wait(&m_pushed, pushed);
+    __atomic_sub_fetch(&m_popwaiters, 1, __ATOMIC_SEQ_CST);
   }
 
   return msg;
@@ -19,6 +19,11 @@
 
 #include <ctime>
 #include <memory>
+#include <new>
+#include <ctype.h>
+#include <string.h>
+
+#include "satomic.h"
 
 StatCollector::StatCollector(const std::string& name)
     : m_attemps_sent(0),
@@ -97,6 +102,90 @@ uint32_t StatCollector::getNbCodesTracked() {
   return m_trackedCodes.size();
 }
 
+uint32_t StatCollector::getCodeSlot(uint32_t vendor, uint32_t statcode) {
+  // the codes are registered before the collector is used, so the list can
+  // be searched without a lock
+  uint32_t slot = SSTATS_SLOT_CODES;
+  for (auto& val : m_trackedCodes) {
+    if (slot >= SSTATS_SLOTS) break;
+    if (val.first == vendor && val.second == statcode) return slot;
+    slot++;
+  }
+  return SSTATS_SLOT_UNKNOWN;
+}
+
+void StatCollector::load(const uint64_t* slots) {
+  m_attemps_sent  = slots[stat_attemp_sent];
+  m_sent_ko       = slots[stat_sent_ko];
+  m_attemps_recv  = slots[stat_attemp_received];
+  m_recv_ko       = slots[stat_received_ko];
+  m_unknownErrors = slots[SSTATS_SLOT_UNKNOWN];
+
+  uint32_t slot = SSTATS_SLOT_CODES;
+  for (auto& val : m_trackedCodes) {
+    if (slot >= SSTATS_SLOTS) break;
+    m_cumulativeCodes[val] = slots[slot++];
+  }
+}
+
+///////////////////////
+
+uint32_t SStatCounters::m_instances = 0;
+__thread SStatCounters::Shard* SStatCounters::t_shards[SSTATS_INSTANCES];
+
+SStatCounters::SStatCounters() : m_shards(NULL) {
+  m_id = atomic_fetch_inc(m_instances);
+}
+
+SStatCounters::~SStatCounters() {
+  while (m_shards) {
+    Shard* s = m_shards;
+    m_shards = s->next;
+    for (int t = 0; t < stat_type_max; t++)
+      for (int p = 0; p < stat_phase_max; p++) delete s->latency[t][p];
+    free(s);
+  }
+}
+
+SStatCounters::Shard* SStatCounters::attach() {
+  void* p = NULL;
+
+  // a cache line aligned table so that the threads do not false share
+  if (posix_memalign(&p, 64, sizeof(Shard)) != 0) throw std::bad_alloc();
+  memset(p, 0, sizeof(Shard));
+
+  Shard* s = (Shard*) p;
+
+  {
+    SMutexLock l(m_mutex);
+    s->next = m_shards;
+    __atomic_store_n(&m_shards, s, __ATOMIC_RELEASE);
+  }
+
+  t_shards[m_id] = s;
+
+  return s;
+}
+
+void SStatCounters::sum(uint32_t type, uint64_t* slots) {
+  memset(slots, 0, sizeof(uint64_t) * SSTATS_SLOTS);
+
+  Shard* s = __atomic_load_n(&m_shards, __ATOMIC_ACQUIRE);
+  for (; s; s = s->next)
+    for (int i = 0; i < SSTATS_SLOTS; i++)
+      slots[i] += __atomic_load_n(&s->counts[type][i], __ATOMIC_RELAXED);
+}
+
+void SStatCounters::merge(uint32_t type, uint32_t phase, SHistogram& h) {
+  h.reset();
+
+  Shard* s = __atomic_load_n(&m_shards, __ATOMIC_ACQUIRE);
+  for (; s; s = s->next) {
+    SHistogram* l = __atomic_load_n(&s->latency[type][phase], __ATOMIC_ACQUIRE);
+    if (l) h.merge(*l);
+  }
+}
+
 ///////////////////////
 
 SStats::SStats(
@@ -106,6 +195,8 @@ SStats::SStats(
       m_logElapsed(logElapsed),
       m_serializ_mode(serializ_mode),
       m_statlogger(NULL) {
+  for (int i = 0; i < stat_type_max; i++) m_collectors[i] = NULL;
+
   switch (engine) {
     case _srJson:
       m_serializer = new SStatsSerializerJson();
@@ -171,6 +262,7 @@ std::shared_ptr<std::string> SStats::getLive() {
 void SStats::dispatch(SEventThreadMessage& msg) {
   if (msg.getId() == STAT_CONSOLIDATE_EVENT) {
     std::string serializedStast;
+    consolidateCounters();
     if (m_serializ_mode == _srBase) {
       std::map<std::string, std::string> keyValues;
       getConsolidatedPeriodStat(keyValues);
@@ -190,10 +282,22 @@ void SStats::dispatch(SEventThreadMessage& msg) {
     m_idletimer.setInterval(((UpdateStatInterval&) msg).getInterval());
     m_idletimer.start();
   } else {
+    if (msg.getId() == STAT_GET_LIVE) consolidateCounters();
     dispatchDerived(msg);
   }
 }
 
+void SStats::consolidateCounters() {
+  if (!m_counters.enabled()) return;
+
+  uint64_t slots[SSTATS_SLOTS];
+  for (int i = 0; i < stat_type_max; i++) {
+    if (!m_collectors[i]) continue;
+    m_counters.sum(i, slots);
+    m_collectors[i]->load(slots);
+  }
+}
+
 void SStats::addGenerationTimeStamp(
     std::map<std::string, std::string>& keyValues) {
   STime time_now = STime::Now();
@@ -202,16 +306,181 @@ void SStats::addGenerationTimeStamp(
   keyValues["time_utc"] = now_str;
 }
 
+void SStats::registerCollector(StatType type, StatCollector& collector) {
+  m_collectors[type] = &collector;
+}
+
 void SStats::registerStatAttemp(StatType type, StatAttempType attempType) {
+  if (m_counters.enabled() && m_collectors[type]) {
+    m_counters.inc(type, attempType);
+    return;
+  }
+
   StatAttempMessage* statmsg = new StatAttempMessage(type, attempType);
   this->postMessage(statmsg);
 }
 
 void SStats::registerStatResult(StatType type, uint32_t vendor, uint32_t code) {
+  if (m_counters.enabled() && m_collectors[type]) {
+    m_counters.inc(type, m_collectors[type]->getCodeSlot(vendor, code));
+    return;
+  }
+
   StatResultMessage* statmsg = new StatResultMessage(type, vendor, code);
   postMessage(statmsg);
 }
 
+void SStats::getLatency(StatType type, StatPhase phase, SHistogram& h) {
+  if (m_counters.enabled())
+    m_counters.merge(type, phase, h);
+  else
+    h.reset();
+}
+
+const char* SStats::getPhaseName(StatPhase phase) {
+  static const char* names[] = {"total", "decode", "db", "compute", "send",
+                                "queue"};
+  return phase < stat_phase_max ? names[phase] : "unknown";
+}
+
+void SStats::appendLatencyObjects(
+    RAPIDJSON_NAMESPACE::Value& arrayObjects,
+    RAPIDJSON_NAMESPACE::Document::AllocatorType& allocator) {
+  SHistogram* h = new SHistogram();
+
+  for (int t = 0; t < stat_type_max; t++) {
+    if (!m_collectors[t]) continue;
+
+    for (int p = 0; p < stat_phase_max; p++) {
+      getLatency((StatType) t, (StatPhase) p, *h);
+      if (h->count() == 0) continue;
+
+      const char* name = m_collectors[t]->getName().c_str();
+
+      RAPIDJSON_NAMESPACE::Value obj(RAPIDJSON_NAMESPACE::kObjectType);
+      obj.AddMember("type", RAPIDJSON_NAMESPACE::StringRef(name), allocator);
+      obj.AddMember(
+          "phase", RAPIDJSON_NAMESPACE::StringRef(getPhaseName((StatPhase) p)),
+          allocator);
+      obj.AddMember("count", h->count(), allocator);
+      obj.AddMember("mean", h->mean(), allocator);
+      obj.AddMember("min", h->min(), allocator);
+      obj.AddMember("p50", h->percentile(50.0), allocator);
+      obj.AddMember("p90", h->percentile(90.0), allocator);
+      obj.AddMember("p99", h->percentile(99.0), allocator);
+      obj.AddMember("p999", h->percentile(99.9), allocator);
+      obj.AddMember("max", h->max(), allocator);
+      arrayObjects.PushBack(obj, allocator);
+    }
+  }
+
+  delete h;
+}
+
+void SStats::serializeLatency(const std::string& prefix, std::string& output) {
+  SHistogram* h = new SHistogram();
+  std::stringstream res;
+
+  for (int t = 0; t < stat_type_max; t++) {
+    if (!m_collectors[t]) continue;
+
+    for (int p = 0; p < stat_phase_max; p++) {
+      getLatency((StatType) t, (StatPhase) p, *h);
+      if (h->count() == 0) continue;
+
+      std::string name  = m_collectors[t]->getName();
+      std::string phase = getPhaseName((StatPhase) p);
+      for (auto& c : name) c = toupper(c);
+      for (auto& c : phase) c = toupper(c);
+
+      res << std::endl
+          << prefix << ",LATENCY," << name << "," << phase << ","
+          << h->count() << "," << h->mean() << ","
+          << h->percentile(50.0) << "," << h->percentile(90.0) << ","
+          << h->percentile(99.0) << "," << h->percentile(99.9) << ","
+          << h->max();
+    }
+  }
+
+  output = res.str();
+  delete h;
+}
+
+void SStats::serializeMetrics(const std::string& prefix, std::string& output) {
+  static const struct {
+    const char* name;
+    int slot;
+    const char* direction;
+  } attempts[] = {{"requests_total", stat_attemp_received, "received"},
+                  {"requests_total", stat_attemp_sent, "sent"},
+                  {"request_errors_total", stat_received_ko, "received"},
+                  {"request_errors_total", stat_sent_ko, "sent"}};
+  static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+  if (!m_counters.enabled()) return;
+
+  uint64_t slots[stat_type_max][SSTATS_SLOTS];
+  for (int t = 0; t < stat_type_max; t++)
+    if (m_collectors[t]) m_counters.sum(t, slots[t]);
+
+  std::stringstream res;
+
+  for (int i = 0; i < 4; i++) {
+    if (i % 2 == 0)
+      res << "# TYPE " << prefix << "_" << attempts[i].name << " counter\n";
+    for (int t = 0; t < stat_type_max; t++) {
+      if (!m_collectors[t]) continue;
+      res << prefix << "_" << attempts[i].name << "{command=\""
+          << m_collectors[t]->getName() << "\",direction=\""
+          << attempts[i].direction << "\"} " << slots[t][attempts[i].slot]
+          << "\n";
+    }
+  }
+
+  res << "# TYPE " << prefix << "_results_total counter\n";
+  for (int t = 0; t < stat_type_max; t++) {
+    if (!m_collectors[t]) continue;
+
+    uint32_t slot = SSTATS_SLOT_CODES;
+    for (auto& val : m_collectors[t]->getTrackedCodes()) {
+      if (slot >= SSTATS_SLOTS) break;
+      res << prefix << "_results_total{command=\""
+          << m_collectors[t]->getName() << "\",vendor=\"" << val.first
+          << "\",code=\"" << val.second << "\"} " << slots[t][slot++] << "\n";
+    }
+    res << prefix << "_results_total{command=\"" << m_collectors[t]->getName()
+        << "\",code=\"unknown\"} " << slots[t][SSTATS_SLOT_UNKNOWN] << "\n";
+  }
+
+  SHistogram* h = new SHistogram();
+
+  res << "# TYPE " << prefix << "_latency_microseconds summary\n";
+  for (int t = 0; t < stat_type_max; t++) {
+    if (!m_collectors[t]) continue;
+
+    for (int p = 0; p < stat_phase_max; p++) {
+      getLatency((StatType) t, (StatPhase) p, *h);
+      if (h->count() == 0) continue;
+
+      std::string labels = "command=\"" + m_collectors[t]->getName() +
+                           "\",phase=\"" + getPhaseName((StatPhase) p) + "\"";
+
+      for (int q = 0; q < 4; q++)
+        res << prefix << "_latency_microseconds{" << labels << ",quantile=\""
+            << quantiles[q] << "\"} " << h->percentile(quantiles[q] * 100.0)
+            << "\n";
+      res << prefix << "_latency_microseconds_sum{" << labels << "} "
+          << h->sum() << "\n";
+      res << prefix << "_latency_microseconds_count{" << labels << "} "
+          << h->count() << "\n";
+    }
+  }
+
+  delete h;
+
+  output = res.str();
+}
+
 void SStats::appendStatObject(
     RAPIDJSON_NAMESPACE::Value& arrayObjects,
     RAPIDJSON_NAMESPACE::Document::AllocatorType& allocator,
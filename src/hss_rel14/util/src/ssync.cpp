@@ -37,22 +37,27 @@ SMutex::~SMutex() {
 }
 
 void SMutex::init(const char* pName) {
+  init(true, PTHREAD_MUTEX_RECURSIVE);
+}
+
+void SMutex::init(bool shared, int type) {
   if (!mInitialized) {
     int res;
     pthread_mutexattr_t attr;
 
     if ((res = pthread_mutexattr_init(&attr)) != 0)
       SError::throwRuntimeExceptionWithErrno("Unable to initialize mutex");
-    else if (
-        (res = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED)) !=
-        0)
+    else if ((res = pthread_mutexattr_setpshared(
+                  &attr, shared ? PTHREAD_PROCESS_SHARED :
+                                  PTHREAD_PROCESS_PRIVATE)) != 0)
       SError::throwRuntimeExceptionWithErrno("Unable to initialize mutex");
-    else if (
-        (res = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE)) != 0)
+    else if ((res = pthread_mutexattr_settype(&attr, type)) != 0)
       SError::throwRuntimeExceptionWithErrno("Unable to initialize mutex");
     else if ((res = pthread_mutex_init(&mMutex, &attr)) != 0)
       SError::throwRuntimeExceptionWithErrno("Unable to initialize mutex");
 
+    pthread_mutexattr_destroy(&attr);
+
     mInitialized = true;
   }
 }
@@ -68,9 +73,9 @@ bool SMutex::enter(bool wait) {
   if (!mInitialized)
     SError::throwRuntimeException("SMutex::enter() - SMutex not initialized");
 
-  int res = pthread_mutex_lock(&mMutex);
+  int res = wait ? pthread_mutex_lock(&mMutex) : pthread_mutex_trylock(&mMutex);
 
-  if (res != 0 && wait)
+  if (res != 0 && res != EBUSY)
     SError::throwRuntimeExceptionWithErrno(
         "SMutex::enter() - Unable to lock mutex", res);
 
@@ -22,6 +22,8 @@
 #include <time.h>
 #include <pthread.h>
 #include <signal.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 
 #include <iostream>
 
@@ -266,6 +268,92 @@ void SEventThread::dispatch() {
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+// resolution of the SEventThread timers in milliseconds
+#define SEVENTTHREAD_TIMER_RESOLUTION (1)
+
+// Owns the timer wheel shared by all of the SEventThread timers and the
+// thread that advances it.  The timerfd is armed for the next tick that
+// needs attention only, so an idle process does not wake up every tick.
+class SEventThread::TimerService {
+ public:
+  // intentionally leaked, timers may still be stopped by static destructors
+  // after the service thread has been torn down
+  static TimerService& singleton() {
+    static TimerService* ts = new TimerService();
+    return *ts;
+  }
+
+  void start(SEventThread::Timer& t) {
+    SMutexLock l(m_mutex);
+
+    m_wheel.schedule(t, t.m_interval);
+
+    int64_t expires = m_wheel.expiresAt(t);
+    if (m_armed == 0 || expires < m_armed) arm(expires);
+  }
+
+  void stop(SEventThread::Timer& t) {
+    SMutexLock l(m_mutex);
+    m_wheel.cancel(t);
+  }
+
+  // called from advance() with the lock held
+  void expired(SEventThread::Timer& t) {
+    t.m_thread->postMessage(new STimerMessage(&t));
+    if (!t.m_oneshot) m_wheel.schedule(t, t.m_interval);
+  }
+
+ private:
+  TimerService() : m_wheel(SEVENTTHREAD_TIMER_RESOLUTION), m_armed(0) {
+    m_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (m_fd == -1)
+      SError::throwRuntimeExceptionWithErrno("Unable to create the timerfd");
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, _threadProc, this) != 0)
+      SError::throwRuntimeExceptionWithErrno("Unable to start timer thread");
+    pthread_detach(thread);
+  }
+
+  void arm(int64_t expires) {
+    struct itimerspec its;
+    its.it_value.tv_sec     = expires / 1000000000;
+    its.it_value.tv_nsec    = expires % 1000000000;
+    its.it_interval.tv_sec  = 0;
+    its.it_interval.tv_nsec = 0;
+    timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    m_armed = expires;
+  }
+
+  static void* _threadProc(void* arg) {
+    TimerService* ts = (TimerService*) arg;
+    uint64_t expirations;
+
+    while (true) {
+      // interrupted or spurious wake ups are harmless, the wheel is only
+      // advanced as far as the current time
+      if (read(ts->m_fd, &expirations, sizeof(expirations)) !=
+          sizeof(expirations))
+        continue;
+
+      SMutexLock l(ts->m_mutex);
+
+      ts->m_armed = 0;
+      ts->m_wheel.advance();
+
+      int64_t next = ts->m_wheel.nextExpiry();
+      if (next != -1) ts->arm(next);
+    }
+
+    return NULL;
+  }
+
+  SMutex m_mutex;
+  STimerWheel m_wheel;
+  int64_t m_armed;
+  int m_fd;
+};
+
 long SEventThread::Timer::m_nextid = 0;
 
 SEventThread::Timer::Timer() {
@@ -274,8 +362,6 @@ SEventThread::Timer::Timer() {
   m_thread   = NULL;
   m_interval = 0;
   m_oneshot  = true;
-
-  m_timer = NULL;
 }
 
 SEventThread::Timer::Timer(long milliseconds, bool oneshot) {
@@ -284,8 +370,6 @@ SEventThread::Timer::Timer(long milliseconds, bool oneshot) {
   m_thread   = NULL;
   m_interval = milliseconds;
   m_oneshot  = oneshot;
-
-  m_timer = NULL;
 }
 
 SEventThread::Timer::~Timer() {
@@ -297,76 +381,34 @@ void SEventThread::Timer::init(SEventThread* pThread) {
 
   m_thread = pThread;
 
-  struct sigevent sev;
-  sev.sigev_notify          = SIGEV_SIGNAL;
-  sev.sigev_signo           = SIGRTMIN;
-  sev.sigev_value.sival_ptr = this;
-  if (timer_create(CLOCK_REALTIME, &sev, &m_timer) == -1)
-    SError::throwRuntimeExceptionWithErrno("Unable to initialize timer");
+  // create the service (and its thread) up front rather than on first start
+  TimerService::singleton();
 }
 
 void SEventThread::Timer::destroy() {
-  if (m_timer != NULL) {
+  if (m_thread != NULL) {
     stop();
-    timer_delete(m_timer);
-    m_timer = NULL;
+    m_thread = NULL;
   }
 }
 
 void SEventThread::Timer::start() {
-  // std::cout << "SEventThread::Timer::start() 1" << std::endl;
-  if (m_timer == NULL)
+  if (m_thread == NULL)
     SError::throwRuntimeException("Timer is not initialized");
 
-  struct itimerspec its;
-  its.it_value.tv_sec     = m_interval / 1000;              // seconds
-  its.it_value.tv_nsec    = (m_interval % 1000) * 1000000;  // nano-seconds
-  its.it_interval.tv_sec  = m_oneshot ? 0 : its.it_value.tv_sec;
-  its.it_interval.tv_nsec = m_oneshot ? 0 : its.it_value.tv_nsec;
-  // std::cout << "SEventThread::Timer::start() 2 - value.tv_sec=" <<
-  // its.it_value.tv_sec << " value.tv_nsec=" << its.it_value.tv_nsec << "
-  // interval.tv_sec=" << its.it_interval.tv_sec << " interval.tv_nsec=" <<
-  // its.it_interval.tv_nsec << std::endl;
-  if (timer_settime(m_timer, 0, &its, NULL) == -1)
-    SError::throwRuntimeExceptionWithErrno("Unable to start timer");
-  // std::cout << "SEventThread::Timer::start() 3" << std::endl;
-}
-
-void SEventThread::Timer::stop() {
-  if (m_timer != NULL) {
-    struct itimerspec its;
-    its.it_value.tv_sec     = 0;  // seconds
-    its.it_value.tv_nsec    = 0;  // nano-seconds
-    its.it_interval.tv_sec  = its.it_value.tv_sec;
-    its.it_interval.tv_nsec = its.it_value.tv_nsec;
-    timer_settime(m_timer, 0, &its, NULL);
+  // like a POSIX timer, an interval of zero leaves the timer disarmed
+  if (m_interval <= 0) {
+    stop();
+    return;
   }
-}
 
-void SEventThread::Timer::_timerHandler(
-    int signo, siginfo_t* pinfo, void* pcontext) {
-  // std::cout << "SEventThread::Timer::_timerHandler() 1" << std::endl;
-  SEventThread::Timer* pTimer =
-      (SEventThread::Timer*) pinfo->si_value.sival_ptr;
-  if (pTimer) {
-    // std::cout << "SEventThread::Timer::_timerHandler() 2" << std::endl;
-    pTimer->m_thread->postMessage(new STimerMessage(pTimer));
-  }
+  TimerService::singleton().start(*this);
 }
 
-SEventThread::TimerHandler _initTimerHandler;
-
-void SEventThread::TimerHandler::init() {
-  // std::cout << "SEventThread::TimerHandler::init()" << std::endl;
-  struct sigaction sa;
-  sa.sa_flags     = SA_SIGINFO;
-  sa.sa_sigaction = SEventThread::Timer::_timerHandler;
-  sigemptyset(&sa.sa_mask);
-  int signo = SIGRTMIN;
-  if (sigaction(signo, &sa, NULL) == -1)
-    SError::throwRuntimeExceptionWithErrno("Unable to register timer handler");
+void SEventThread::Timer::stop() {
+  if (m_thread != NULL) TimerService::singleton().stop(*this);
 }
 
-void SEventThread::TimerHandler::uninit() {
-  // std::cout << "SEventThread::TimerHandler::uninit()" << std::endl;
+void SEventThread::Timer::onExpired() {
+  TimerService::singleton().expired(*this);
 }